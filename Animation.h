@@ -0,0 +1,726 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "Debug.h"
+
+// Portable replacement for the parts of Windows Animation the sample uses:
+// accelerate-decelerate transitions, storyboards with keyframes and curves
+// that can be handed to IDCompositionAnimation. Variables are kept as a
+// structure of arrays so that a tick evaluates the whole board with SIMD
+// instead of one COM call per card.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ANIMATION_SSE2 1
+#endif
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define ANIMATION_NEON 1
+#endif
+
+// Same parameters as CreateAccelerateDecelerateTransition. The variable
+// speeds up at a constant rate for the acceleration ratio of the duration,
+// moves at constant speed, then slows down to a stop at the final value for
+// the deceleration ratio of the duration.
+struct AccelerateDecelerate
+{
+	double Duration = 0.0;
+	double Final = 0.0;
+	double AccelerationRatio = 0.2;
+	double DecelerationRatio = 0.8;
+
+	AccelerateDecelerate() = default;
+
+	AccelerateDecelerate(double const duration,
+		double const finalValue,
+		double const accelerationRatio = 0.2,
+		double const decelerationRatio = 0.8) :
+		Duration(duration),
+		Final(finalValue),
+		AccelerationRatio(accelerationRatio),
+		DecelerationRatio(decelerationRatio)
+	{}
+};
+
+// A transition resolved against its start time and value. Times are in
+// seconds relative to the animator's epoch. Transitions start from rest; one
+// that interrupts another takes over its value but not its velocity.
+struct TransitionProfile
+{
+	float Start = 0.0f;
+	float Duration = 0.0f;
+	float AccelerateEnd = 0.0f;
+	float DecelerateStart = 0.0f;
+	float Initial = 0.0f;
+	float Velocity = 0.0f;
+	float HalfAcceleration = 0.0f;
+	float HalfDeceleration = 0.0f;
+
+	// A variable at rest
+	static TransitionProfile Idle(float const value)
+	{
+		TransitionProfile profile;
+		profile.Initial = value;
+		return profile;
+	}
+
+	static TransitionProfile Create(float const start,
+		float const initial,
+		AccelerateDecelerate const & transition)
+	{
+		ASSERT(transition.AccelerationRatio >= 0.0 && transition.DecelerationRatio >= 0.0);
+		ASSERT(transition.AccelerationRatio + transition.DecelerationRatio <= 1.0);
+
+		if (transition.Duration <= 0.0)
+		{
+			TransitionProfile profile = Idle(static_cast<float>(transition.Final));
+			profile.Start = start;
+			return profile;
+		}
+
+		double const duration = transition.Duration;
+		double const accelerate = transition.AccelerationRatio * duration;
+		double const decelerate = transition.DecelerationRatio * duration;
+
+		// The distance covered is the area under the trapezoid of the velocity
+		double const velocity = (transition.Final - initial) / (duration - (accelerate + decelerate) / 2.0);
+
+		TransitionProfile profile;
+		profile.Start = start;
+		profile.Duration = static_cast<float>(duration);
+		profile.AccelerateEnd = static_cast<float>(accelerate);
+		profile.DecelerateStart = static_cast<float>(duration - decelerate);
+		profile.Initial = initial;
+		profile.Velocity = static_cast<float>(velocity);
+		profile.HalfAcceleration = accelerate > 0.0 ? static_cast<float>(velocity / accelerate / 2.0) : 0.0f;
+		profile.HalfDeceleration = decelerate > 0.0 ? static_cast<float>(velocity / decelerate / 2.0) : 0.0f;
+		return profile;
+	}
+
+	float End() const
+	{
+		return Start + Duration;
+	}
+
+	float Final() const
+	{
+		return Value(End());
+	}
+
+	// The value at a time, with the operations in the same order as the SIMD
+	// kernels so that both produce the same bits
+	float Value(float const time) const
+	{
+		float const elapsed = std::min(std::max(time - Start, 0.0f), Duration);
+		float const accelerating = std::min(elapsed, AccelerateEnd);
+		float const cruising = std::min(std::max(elapsed - AccelerateEnd, 0.0f), DecelerateStart - AccelerateEnd);
+		float const decelerating = std::min(std::max(elapsed - DecelerateStart, 0.0f), Duration - DecelerateStart);
+
+		return Initial +
+			HalfAcceleration * accelerating * accelerating +
+			Velocity * (cruising + decelerating) -
+			HalfDeceleration * decelerating * decelerating;
+	}
+
+	// The polynomial of one phase (accelerating, cruising, decelerating or at
+	// rest) from the given time on. The phase is passed in rather than found
+	// from the time, which may round into its neighbour at the boundaries.
+	void Coefficients(unsigned const phase,
+		float const time,
+		float & linear,
+		float & quadratic) const
+	{
+		float const elapsed = time - Start;
+
+		switch (phase)
+		{
+		case 0:
+			linear = 2.0f * HalfAcceleration * elapsed;
+			quadratic = HalfAcceleration;
+			break;
+		case 1:
+			linear = Velocity;
+			quadratic = 0.0f;
+			break;
+		case 2:
+			linear = Velocity - 2.0f * HalfDeceleration * (elapsed - DecelerateStart);
+			quadratic = -HalfDeceleration;
+			break;
+		default:
+			linear = 0.0f;
+			quadratic = 0.0f;
+			break;
+		}
+	}
+};
+
+// Keyframes are offsets in seconds from the start of a storyboard
+typedef double Keyframe;
+
+// Transitions for any number of variables, scheduled together. As with
+// IUIAnimationStoryboard2, transitions added to the same variable follow one
+// another, and AddTransitionAtKeyframe starts one at a given offset.
+struct Storyboard
+{
+	struct Entry
+	{
+		unsigned Variable;
+		Keyframe Begin;
+		AccelerateDecelerate Transition;
+	};
+
+	std::vector<Entry> m_entries;
+
+	// Adds the transition after the last one for the variable and returns
+	// the keyframe at its end
+	Keyframe AddTransition(unsigned const variable,
+		AccelerateDecelerate const & transition)
+	{
+		Keyframe begin = 0.0;
+
+		for (Entry const & entry : m_entries)
+		{
+			if (entry.Variable == variable)
+			{
+				begin = std::max(begin, entry.Begin + entry.Transition.Duration);
+			}
+		}
+
+		return AddTransitionAtKeyframe(variable, transition, begin);
+	}
+
+	Keyframe AddTransitionAtKeyframe(unsigned const variable,
+		AccelerateDecelerate const & transition,
+		Keyframe const keyframe)
+	{
+		m_entries.push_back({ variable, keyframe, transition });
+
+		return keyframe + transition.Duration;
+	}
+
+	// Drops the variable's transitions that begin at or after the keyframe,
+	// as scheduling a transition there would
+	void RemoveTransitions(unsigned const variable,
+		Keyframe const keyframe = 0.0)
+	{
+		m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(), [&](Entry const & entry)
+		{
+			return entry.Variable == variable && entry.Begin >= keyframe;
+		}), m_entries.end());
+	}
+
+	bool Empty() const
+	{
+		return m_entries.empty();
+	}
+
+	void Clear()
+	{
+		m_entries.clear();
+	}
+};
+
+// One piece of a curve: the value is Constant + Linear * t + Quadratic * t^2
+// + Cubic * t^3, where t is the time since Begin. These are the arguments of
+// IDCompositionAnimation::AddCubic.
+struct CurveSegment
+{
+	double Begin;
+	float Constant;
+	float Linear;
+	float Quadratic;
+	float Cubic;
+};
+
+// A variable's value from now on, for IDCompositionAnimation: AddCubic for
+// every segment, then End(End, EndValue). Offsets are in seconds from the
+// animator time the curve was taken at.
+struct AnimationCurve
+{
+	std::vector<CurveSegment> Segments;
+	double End = 0.0;
+	float EndValue = 0.0f;
+
+	float Value(double const offset) const
+	{
+		if (Segments.empty() || offset >= End) return EndValue;
+
+		auto segment = std::upper_bound(Segments.begin(), Segments.end(), offset, [](double const time, CurveSegment const & s)
+		{
+			return time < s.Begin;
+		});
+
+		if (segment == Segments.begin()) return segment->Constant;
+
+		--segment;
+
+		float const t = static_cast<float>(offset - segment->Begin);
+
+		return segment->Constant + t * (segment->Linear + t * (segment->Quadratic + t * segment->Cubic));
+	}
+};
+
+//
+// Evaluate: value[i] = profile[i].Value(time) for a block of variables
+//
+
+struct AnimationArrays
+{
+	float const * Start;
+	float const * Duration;
+	float const * AccelerateEnd;
+	float const * DecelerateStart;
+	float const * Initial;
+	float const * Velocity;
+	float const * HalfAcceleration;
+	float const * HalfDeceleration;
+};
+
+inline void EvaluateScalar(AnimationArrays const & arrays,
+	float * values,
+	unsigned const count,
+	float const time)
+{
+	for (unsigned i = 0; i != count; ++i)
+	{
+		TransitionProfile profile;
+		profile.Start = arrays.Start[i];
+		profile.Duration = arrays.Duration[i];
+		profile.AccelerateEnd = arrays.AccelerateEnd[i];
+		profile.DecelerateStart = arrays.DecelerateStart[i];
+		profile.Initial = arrays.Initial[i];
+		profile.Velocity = arrays.Velocity[i];
+		profile.HalfAcceleration = arrays.HalfAcceleration[i];
+		profile.HalfDeceleration = arrays.HalfDeceleration[i];
+
+		values[i] = profile.Value(time);
+	}
+}
+
+#if ANIMATION_SSE2
+inline void EvaluateSse2(AnimationArrays const & arrays,
+	float * values,
+	unsigned const count,
+	float const time)
+{
+	__m128 const now = _mm_set1_ps(time);
+	__m128 const zero = _mm_setzero_ps();
+	unsigned i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128 const duration = _mm_loadu_ps(arrays.Duration + i);
+		__m128 const accelerateEnd = _mm_loadu_ps(arrays.AccelerateEnd + i);
+		__m128 const decelerateStart = _mm_loadu_ps(arrays.DecelerateStart + i);
+		__m128 const halfAcceleration = _mm_loadu_ps(arrays.HalfAcceleration + i);
+		__m128 const halfDeceleration = _mm_loadu_ps(arrays.HalfDeceleration + i);
+
+		__m128 const elapsed = _mm_min_ps(_mm_max_ps(_mm_sub_ps(now, _mm_loadu_ps(arrays.Start + i)), zero), duration);
+		__m128 const accelerating = _mm_min_ps(elapsed, accelerateEnd);
+		__m128 const cruising = _mm_min_ps(_mm_max_ps(_mm_sub_ps(elapsed, accelerateEnd), zero), _mm_sub_ps(decelerateStart, accelerateEnd));
+		__m128 const decelerating = _mm_min_ps(_mm_max_ps(_mm_sub_ps(elapsed, decelerateStart), zero), _mm_sub_ps(duration, decelerateStart));
+
+		__m128 value = _mm_add_ps(_mm_loadu_ps(arrays.Initial + i), _mm_mul_ps(_mm_mul_ps(halfAcceleration, accelerating), accelerating));
+		value = _mm_add_ps(value, _mm_mul_ps(_mm_loadu_ps(arrays.Velocity + i), _mm_add_ps(cruising, decelerating)));
+		value = _mm_sub_ps(value, _mm_mul_ps(_mm_mul_ps(halfDeceleration, decelerating), decelerating));
+
+		_mm_storeu_ps(values + i, value);
+	}
+
+	AnimationArrays rest = arrays;
+	rest.Start += i;
+	rest.Duration += i;
+	rest.AccelerateEnd += i;
+	rest.DecelerateStart += i;
+	rest.Initial += i;
+	rest.Velocity += i;
+	rest.HalfAcceleration += i;
+	rest.HalfDeceleration += i;
+
+	EvaluateScalar(rest, values + i, count - i, time);
+}
+#endif
+
+#if ANIMATION_NEON
+inline void EvaluateNeon(AnimationArrays const & arrays,
+	float * values,
+	unsigned const count,
+	float const time)
+{
+	float32x4_t const now = vdupq_n_f32(time);
+	float32x4_t const zero = vdupq_n_f32(0.0f);
+	unsigned i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		float32x4_t const duration = vld1q_f32(arrays.Duration + i);
+		float32x4_t const accelerateEnd = vld1q_f32(arrays.AccelerateEnd + i);
+		float32x4_t const decelerateStart = vld1q_f32(arrays.DecelerateStart + i);
+		float32x4_t const halfAcceleration = vld1q_f32(arrays.HalfAcceleration + i);
+		float32x4_t const halfDeceleration = vld1q_f32(arrays.HalfDeceleration + i);
+
+		float32x4_t const elapsed = vminq_f32(vmaxq_f32(vsubq_f32(now, vld1q_f32(arrays.Start + i)), zero), duration);
+		float32x4_t const accelerating = vminq_f32(elapsed, accelerateEnd);
+		float32x4_t const cruising = vminq_f32(vmaxq_f32(vsubq_f32(elapsed, accelerateEnd), zero), vsubq_f32(decelerateStart, accelerateEnd));
+		float32x4_t const decelerating = vminq_f32(vmaxq_f32(vsubq_f32(elapsed, decelerateStart), zero), vsubq_f32(duration, decelerateStart));
+
+		// Separate multiplies and adds rather than vmlaq, which may fuse
+		float32x4_t value = vaddq_f32(vld1q_f32(arrays.Initial + i), vmulq_f32(vmulq_f32(halfAcceleration, accelerating), accelerating));
+		value = vaddq_f32(value, vmulq_f32(vld1q_f32(arrays.Velocity + i), vaddq_f32(cruising, decelerating)));
+		value = vsubq_f32(value, vmulq_f32(vmulq_f32(halfDeceleration, decelerating), decelerating));
+
+		vst1q_f32(values + i, value);
+	}
+
+	AnimationArrays rest = arrays;
+	rest.Start += i;
+	rest.Duration += i;
+	rest.AccelerateEnd += i;
+	rest.DecelerateStart += i;
+	rest.Initial += i;
+	rest.Velocity += i;
+	rest.HalfAcceleration += i;
+	rest.HalfDeceleration += i;
+
+	EvaluateScalar(rest, values + i, count - i, time);
+}
+#endif
+
+inline void Evaluate(AnimationArrays const & arrays,
+	float * values,
+	unsigned const count,
+	float const time)
+{
+#if ANIMATION_SSE2
+	EvaluateSse2(arrays, values, count, time);
+#elif ANIMATION_NEON
+	EvaluateNeon(arrays, values, count, time);
+#else
+	EvaluateScalar(arrays, values, count, time);
+#endif
+}
+
+// The animation variables and the transitions scheduled on them. Update
+// starts transitions that are due and evaluates every variable at once.
+// Times passed in are absolute seconds, such as frame times from
+// GetFrameStatistics; internally they are kept relative to an epoch that
+// moves forward so that float offsets stay precise.
+struct Animator
+{
+	// Seconds after which times are rebased on the current time
+	static constexpr double RebaseSeconds = 64.0;
+
+	struct Pending
+	{
+		double Start;
+		AccelerateDecelerate Transition;
+	};
+
+	// The active transition of each variable
+	std::vector<float> m_start;
+	std::vector<float> m_duration;
+	std::vector<float> m_accelerateEnd;
+	std::vector<float> m_decelerateStart;
+	std::vector<float> m_initial;
+	std::vector<float> m_velocity;
+	std::vector<float> m_halfAcceleration;
+	std::vector<float> m_halfDeceleration;
+
+	std::vector<float> m_values;
+
+	// Transitions waiting for their start time, in order, per variable
+	std::vector<std::vector<Pending>> m_pending;
+	double m_nextStart = std::numeric_limits<double>::infinity();
+
+	double m_epoch = 0.0;
+	double m_time = 0.0;
+	bool m_started = false;
+
+	unsigned VariableCount() const
+	{
+		return static_cast<unsigned>(m_values.size());
+	}
+
+	unsigned CreateVariable(double const initial)
+	{
+		unsigned const variable = VariableCount();
+
+		m_start.push_back(0.0f);
+		m_duration.push_back(0.0f);
+		m_accelerateEnd.push_back(0.0f);
+		m_decelerateStart.push_back(0.0f);
+		m_initial.push_back(0.0f);
+		m_velocity.push_back(0.0f);
+		m_halfAcceleration.push_back(0.0f);
+		m_halfDeceleration.push_back(0.0f);
+		m_values.push_back(0.0f);
+		m_pending.emplace_back();
+
+		SetProfile(variable, TransitionProfile::Idle(static_cast<float>(initial)));
+		m_values[variable] = static_cast<float>(initial);
+
+		return variable;
+	}
+
+	// The value as of the last Update
+	float Value(unsigned const variable) const
+	{
+		return m_values[variable];
+	}
+
+	float const * Values() const
+	{
+		return m_values.data();
+	}
+
+	double Time() const
+	{
+		return m_time;
+	}
+
+	// Puts the variable at rest at the value, dropping its transitions, as
+	// for a new game
+	void Reset(unsigned const variable, double const value)
+	{
+		m_pending[variable].clear();
+		SetProfile(variable, TransitionProfile::Idle(static_cast<float>(value)));
+		m_values[variable] = static_cast<float>(value);
+	}
+
+	// True while the variable has an unfinished or pending transition
+	bool IsAnimating(unsigned const variable) const
+	{
+		return !m_pending[variable].empty() ||
+			RelativeTime(m_time) < Profile(variable).End();
+	}
+
+	// Schedules the storyboard to start at the given time. A transition
+	// replaces those of its variable that would start at or after it, and
+	// interrupts the one running when it starts. The clock starts at the
+	// first Update, not here, as the time may be in the future.
+	void Schedule(Storyboard const & storyboard, double const time)
+	{
+		std::vector<Storyboard::Entry> entries = storyboard.m_entries;
+
+		std::stable_sort(entries.begin(), entries.end(), [](Storyboard::Entry const & a, Storyboard::Entry const & b)
+		{
+			return a.Begin < b.Begin;
+		});
+
+		for (Storyboard::Entry const & entry : entries)
+		{
+			ASSERT(entry.Variable < VariableCount());
+
+			double const start = time + entry.Begin;
+			std::vector<Pending> & pending = m_pending[entry.Variable];
+
+			pending.erase(std::remove_if(pending.begin(), pending.end(), [start](Pending const & p)
+			{
+				return p.Start >= start;
+			}), pending.end());
+
+			pending.push_back({ start, entry.Transition });
+			m_nextStart = std::min(m_nextStart, start);
+		}
+	}
+
+	// Starts the transitions that are due and evaluates all variables
+	void Update(double const time)
+	{
+		Advance(time);
+
+		Evaluate(Arrays(), m_values.data(), VariableCount(), RelativeTime(time));
+	}
+
+	// Same as Update without SIMD, as a reference
+	void UpdateScalar(double const time)
+	{
+		Advance(time);
+
+		EvaluateScalar(Arrays(), m_values.data(), VariableCount(), RelativeTime(time));
+	}
+
+	// The variable's value from the last Update on, including transitions
+	// that have not started yet
+	AnimationCurve GetCurve(unsigned const variable) const
+	{
+		AnimationCurve curve;
+
+		float const now = RelativeTime(m_time);
+		float const infinity = std::numeric_limits<float>::infinity();
+
+		TransitionProfile profile = Profile(variable);
+		std::vector<Pending> const & pending = m_pending[variable];
+
+		float from = now;
+
+		for (size_t i = 0; ; ++i)
+		{
+			// Each transition runs until the next one starts
+			float const until = i < pending.size() ? RelativeTime(pending[i].Start) : infinity;
+
+			float const phases[] =
+			{
+				profile.Start,
+				profile.Start + profile.AccelerateEnd,
+				profile.Start + profile.DecelerateStart,
+				profile.End(),
+				infinity,
+			};
+
+			for (unsigned phase = 0; phase != 4; ++phase)
+			{
+				float const begin = std::max(from, phases[phase]);
+
+				if (begin >= std::min(until, phases[phase + 1])) continue;
+
+				CurveSegment segment = { static_cast<double>(begin) - now, profile.Value(begin), 0.0f, 0.0f, 0.0f };
+				profile.Coefficients(phase, begin, segment.Linear, segment.Quadratic);
+
+				curve.Segments.push_back(segment);
+			}
+
+			if (i == pending.size()) break;
+
+			from = until;
+			profile = TransitionProfile::Create(until, profile.Value(until), pending[i].Transition);
+		}
+
+		// The last segment is the variable at rest, which End describes
+		curve.End = curve.Segments.back().Begin;
+		curve.EndValue = curve.Segments.back().Constant;
+
+		if (curve.Segments.size() > 1)
+		{
+			curve.Segments.pop_back();
+		}
+
+		return curve;
+	}
+
+	TransitionProfile Profile(unsigned const variable) const
+	{
+		TransitionProfile profile;
+		profile.Start = m_start[variable];
+		profile.Duration = m_duration[variable];
+		profile.AccelerateEnd = m_accelerateEnd[variable];
+		profile.DecelerateStart = m_decelerateStart[variable];
+		profile.Initial = m_initial[variable];
+		profile.Velocity = m_velocity[variable];
+		profile.HalfAcceleration = m_halfAcceleration[variable];
+		profile.HalfDeceleration = m_halfDeceleration[variable];
+		return profile;
+	}
+
+private:
+
+	float RelativeTime(double const time) const
+	{
+		return static_cast<float>(time - m_epoch);
+	}
+
+	AnimationArrays Arrays() const
+	{
+		return
+		{
+			m_start.data(),
+			m_duration.data(),
+			m_accelerateEnd.data(),
+			m_decelerateStart.data(),
+			m_initial.data(),
+			m_velocity.data(),
+			m_halfAcceleration.data(),
+			m_halfDeceleration.data(),
+		};
+	}
+
+	void SetProfile(unsigned const variable, TransitionProfile const & profile)
+	{
+		m_start[variable] = profile.Start;
+		m_duration[variable] = profile.Duration;
+		m_accelerateEnd[variable] = profile.AccelerateEnd;
+		m_decelerateStart[variable] = profile.DecelerateStart;
+		m_initial[variable] = profile.Initial;
+		m_velocity[variable] = profile.Velocity;
+		m_halfAcceleration[variable] = profile.HalfAcceleration;
+		m_halfDeceleration[variable] = profile.HalfDeceleration;
+	}
+
+	void Advance(double const time)
+	{
+		if (!m_started)
+		{
+			m_epoch = time;
+			m_started = true;
+		}
+
+		ASSERT(time >= m_time || m_time == 0.0);
+		m_time = time;
+
+		if (time - m_epoch >= RebaseSeconds)
+		{
+			Rebase(time);
+		}
+
+		if (m_nextStart <= time)
+		{
+			StartPending(time);
+		}
+	}
+
+	void StartPending(double const time)
+	{
+		m_nextStart = std::numeric_limits<double>::infinity();
+
+		for (unsigned variable = 0; variable != VariableCount(); ++variable)
+		{
+			std::vector<Pending> & pending = m_pending[variable];
+
+			size_t started = 0;
+
+			for (; started != pending.size() && pending[started].Start <= time; ++started)
+			{
+				float const start = RelativeTime(pending[started].Start);
+				float const initial = Profile(variable).Value(start);
+
+				SetProfile(variable, TransitionProfile::Create(start, initial, pending[started].Transition));
+			}
+
+			pending.erase(pending.begin(), pending.begin() + started);
+
+			if (!pending.empty())
+			{
+				m_nextStart = std::min(m_nextStart, pending.front().Start);
+			}
+		}
+	}
+
+	// Moves the epoch to the given time. Transitions that have finished are
+	// reset to rest at their final value so that no start drifts far back.
+	void Rebase(double const time)
+	{
+		float const shift = RelativeTime(time);
+
+		for (unsigned variable = 0; variable != VariableCount(); ++variable)
+		{
+			TransitionProfile profile = Profile(variable);
+
+			if (profile.End() <= shift)
+			{
+				profile = TransitionProfile::Idle(profile.Final());
+			}
+			else
+			{
+				profile.Start -= shift;
+			}
+
+			SetProfile(variable, profile);
+		}
+
+		m_epoch = time;
+	}
+};
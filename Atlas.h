@@ -0,0 +1,374 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "Debug.h"
+#include "Board.h"
+
+// Rectangle packing for composition surfaces. Card faces are packed into a
+// few large pages instead of one surface per card side, and cards showing
+// the same letter share a single front tile.
+
+struct AtlasRect
+{
+	unsigned Page = 0;
+	unsigned Left = 0;
+	unsigned Top = 0;
+	unsigned Width = 0;
+	unsigned Height = 0;
+};
+
+// Skyline bottom-left packer for a single page. The skyline is the upper
+// edge of the packed area, stored as horizontal segments from left to right.
+struct SkylinePacker
+{
+	struct Segment
+	{
+		unsigned X;
+		unsigned Y;
+		unsigned Width;
+	};
+
+	unsigned m_width = 0;
+	unsigned m_height = 0;
+	unsigned long long m_usedArea = 0;
+	std::vector<Segment> m_skyline;
+
+	// Smallest rectangle known not to fit. The page only fills up, so
+	// anything at least as large in both dimensions is rejected at once.
+	unsigned m_failedWidth = ~0u;
+	unsigned m_failedHeight = ~0u;
+
+	SkylinePacker(unsigned const width, unsigned const height) :
+		m_width(width),
+		m_height(height)
+	{
+		m_skyline.push_back(Segment { 0, 0, width });
+	}
+
+	// Height of the packed area, the most a page surface needs
+	unsigned UsedHeight() const
+	{
+		unsigned height = 0;
+
+		for (Segment const & segment : m_skyline)
+		{
+			height = std::max(height, segment.Y);
+		}
+
+		return height;
+	}
+
+	// Returns the lowest y at which a rectangle of the given width fits with
+	// its left edge on segment index, or false if it does not fit.
+	bool Fit(size_t const index,
+		unsigned const width,
+		unsigned const height,
+		unsigned & y) const
+	{
+		unsigned const x = m_skyline[index].X;
+
+		if (x + width > m_width) return false;
+
+		y = 0;
+		unsigned remaining = width;
+
+		for (size_t i = index; remaining != 0; ++i)
+		{
+			ASSERT(i < m_skyline.size());
+
+			y = std::max(y, m_skyline[i].Y);
+
+			if (y + height > m_height) return false;
+
+			remaining -= std::min(remaining, m_skyline[i].Width);
+		}
+
+		return true;
+	}
+
+	bool Insert(unsigned const width,
+		unsigned const height,
+		unsigned & x,
+		unsigned & y)
+	{
+		if (width >= m_failedWidth && height >= m_failedHeight) return false;
+
+		size_t best = m_skyline.size();
+		unsigned bestY = ~0u;
+
+		for (size_t i = 0; i != m_skyline.size(); ++i)
+		{
+			unsigned candidate = 0;
+
+			if (Fit(i, width, height, candidate) && candidate < bestY)
+			{
+				best = i;
+				bestY = candidate;
+			}
+		}
+
+		if (best == m_skyline.size())
+		{
+			if (m_failedWidth == ~0u || (width <= m_failedWidth && height <= m_failedHeight))
+			{
+				m_failedWidth = width;
+				m_failedHeight = height;
+			}
+
+			return false;
+		}
+
+		x = m_skyline[best].X;
+		y = bestY;
+
+		// Raise the skyline under the new rectangle
+		Segment const added = { x, y + height, width };
+		m_skyline.insert(m_skyline.begin() + best, added);
+
+		for (size_t i = best + 1; i < m_skyline.size();)
+		{
+			Segment & segment = m_skyline[i];
+			unsigned const end = added.X + added.Width;
+
+			if (segment.X >= end) break;
+
+			unsigned const overlap = std::min(end - segment.X, segment.Width);
+
+			segment.X += overlap;
+			segment.Width -= overlap;
+
+			if (segment.Width == 0)
+			{
+				m_skyline.erase(m_skyline.begin() + i);
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		// Merge neighbours at the same height
+		for (size_t i = 0; i + 1 < m_skyline.size();)
+		{
+			if (m_skyline[i].Y == m_skyline[i + 1].Y)
+			{
+				m_skyline[i].Width += m_skyline[i + 1].Width;
+				m_skyline.erase(m_skyline.begin() + i + 1);
+			}
+			else
+			{
+				++i;
+			}
+		}
+
+		m_usedArea += static_cast<unsigned long long>(width) * height;
+
+		return true;
+	}
+};
+
+// A growing set of pages. Rectangles are padded so that linear filtering
+// during the flip animation never samples a neighbouring tile.
+struct Atlas
+{
+	unsigned m_pageWidth = 0;
+	unsigned m_pageHeight = 0;
+	unsigned m_padding = 0;
+	std::vector<SkylinePacker> m_pages;
+
+	Atlas(unsigned const pageWidth,
+		unsigned const pageHeight,
+		unsigned const padding) :
+		m_pageWidth(pageWidth),
+		m_pageHeight(pageHeight),
+		m_padding(padding)
+	{}
+
+	unsigned PageCount() const
+	{
+		return static_cast<unsigned>(m_pages.size());
+	}
+
+	AtlasRect Insert(unsigned const width, unsigned const height)
+	{
+		unsigned const paddedWidth = width + m_padding;
+		unsigned const paddedHeight = height + m_padding;
+
+		ASSERT(paddedWidth <= m_pageWidth && paddedHeight <= m_pageHeight);
+
+		AtlasRect rect;
+		rect.Width = width;
+		rect.Height = height;
+
+		for (rect.Page = 0; rect.Page != PageCount(); ++rect.Page)
+		{
+			if (m_pages[rect.Page].Insert(paddedWidth, paddedHeight, rect.Left, rect.Top))
+			{
+				return rect;
+			}
+		}
+
+		m_pages.emplace_back(m_pageWidth, m_pageHeight);
+
+		VERIFY(m_pages.back().Insert(paddedWidth, paddedHeight, rect.Left, rect.Top));
+
+		return rect;
+	}
+
+	// Size of a page surface, trimmed to the packed height
+	unsigned PageHeight(unsigned const page) const
+	{
+		return m_pages[page].UsedHeight();
+	}
+
+	unsigned long long Bytes() const
+	{
+		unsigned long long bytes = 0;
+
+		for (unsigned page = 0; page != PageCount(); ++page)
+		{
+			bytes += 4ull * m_pageWidth * PageHeight(page);
+		}
+
+		return bytes;
+	}
+
+	// Fraction of the page surfaces covered by rectangles, padding included
+	double Occupancy() const
+	{
+		unsigned long long used = 0;
+
+		for (SkylinePacker const & page : m_pages)
+		{
+			used += page.m_usedArea;
+		}
+
+		unsigned long long const bytes = Bytes();
+
+		return bytes ? 4.0 * used / bytes : 0.0;
+	}
+};
+
+// Atlas tiles for every card on the board that is still in play. Fronts are
+// shared by value; each back shows a different part of the background so it
+// gets a tile of its own.
+struct CardAtlas
+{
+	struct Front
+	{
+		wchar_t Value;
+		AtlasRect Rect;
+	};
+
+	static unsigned const PageSize = 2048;
+	static unsigned const Padding = 1;
+
+	Atlas m_atlas;
+	unsigned m_cardWidth = 0;
+	unsigned m_cardHeight = 0;
+	unsigned m_cardsInPlay = 0;
+	std::vector<Front> m_uniqueFronts;
+	std::vector<unsigned> m_fronts; // card index to m_uniqueFronts index
+	std::vector<AtlasRect> m_backs;
+
+	// Tiles needed for the board: one back per card in play and one front
+	// per distinct letter.
+	static unsigned CountTiles(Board const & board)
+	{
+		bool seen[128] = {};
+		unsigned tiles = 0;
+
+		for (Card const & card : board)
+		{
+			if (card.Status == CardStatus::Matched) continue;
+
+			++tiles;
+
+			if (static_cast<unsigned>(card.Value) >= 128 || !seen[card.Value]) ++tiles;
+			if (static_cast<unsigned>(card.Value) < 128) seen[card.Value] = true;
+		}
+
+		return tiles;
+	}
+
+	// Small boards get a page about as wide as it is tall instead of a full
+	// PageSize wide strip, so that a handful of cards does not cost more than
+	// separate surfaces would.
+	static unsigned PageWidth(unsigned const tiles, unsigned const cardWidth)
+	{
+		unsigned const rows = std::max(1u, static_cast<unsigned>(std::sqrt(static_cast<double>(tiles))));
+		unsigned const columns = (tiles + rows - 1) / rows;
+
+		return std::max(std::min(static_cast<unsigned>(PageSize), columns * (cardWidth + Padding)), cardWidth + Padding);
+	}
+
+	// Width and height are the physical card size
+	CardAtlas(Board const & board,
+		unsigned const cardWidth,
+		unsigned const cardHeight) :
+		m_atlas(PageWidth(CountTiles(board), cardWidth), std::max(static_cast<unsigned>(PageSize), cardHeight + Padding), Padding),
+		m_cardWidth(cardWidth),
+		m_cardHeight(cardHeight),
+		m_fronts(board.CardCount(), ~0u),
+		m_backs(board.CardCount())
+	{
+		// Letters index straight into a table rather than a map
+		unsigned byValue[128];
+		std::fill(std::begin(byValue), std::end(byValue), ~0u);
+
+		for (unsigned index = 0; index != board.CardCount(); ++index)
+		{
+			Card const & card = board[index];
+
+			if (card.Status == CardStatus::Matched) continue;
+
+			++m_cardsInPlay;
+
+			unsigned * shared = static_cast<unsigned>(card.Value) < 128 ? &byValue[card.Value] : nullptr;
+
+			if (shared && *shared != ~0u)
+			{
+				m_fronts[index] = *shared;
+			}
+			else
+			{
+				m_fronts[index] = static_cast<unsigned>(m_uniqueFronts.size());
+				m_uniqueFronts.push_back(Front { card.Value, m_atlas.Insert(cardWidth, cardHeight) });
+
+				if (shared) *shared = m_fronts[index];
+			}
+
+			m_backs[index] = m_atlas.Insert(cardWidth, cardHeight);
+		}
+	}
+
+	// False for cards that were already matched when the atlas was made
+	bool Contains(unsigned const index) const
+	{
+		return m_fronts[index] != ~0u;
+	}
+
+	AtlasRect const & FrontRect(unsigned const index) const
+	{
+		ASSERT(m_fronts[index] != ~0u);
+		return m_uniqueFronts[m_fronts[index]].Rect;
+	}
+
+	AtlasRect const & BackRect(unsigned const index) const
+	{
+		return m_backs[index];
+	}
+
+	// Bytes of two card sized surfaces per card in play, the previous scheme
+	unsigned long long PerCardBytes() const
+	{
+		return 2ull * 4 * m_cardWidth * m_cardHeight * m_cardsInPlay;
+	}
+
+	long long SavedBytes() const
+	{
+		return static_cast<long long>(PerCardBytes()) - static_cast<long long>(m_atlas.Bytes());
+	}
+};
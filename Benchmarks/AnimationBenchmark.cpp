@@ -0,0 +1,191 @@
+#include "Benchmark.h"
+#include "../Animation.h"
+#include <cmath>
+#include <random>
+#include <string>
+
+// Evaluates the flip animations of large boards with the portable animator:
+// a tick with the SIMD kernel against the scalar reference, and exporting
+// the curve of every card as the sample does for DirectComposition. Checks
+// the accelerate-decelerate profile, the storyboard keyframes and that the
+// exported curves follow the animator.
+
+static bool Near(double const a, double const b, double const tolerance = 1e-3)
+{
+	return std::fabs(a - b) <= tolerance;
+}
+
+static void CheckProfile()
+{
+	Animator animator;
+	unsigned const variable = animator.CreateVariable(0.0);
+
+	Storyboard storyboard;
+	storyboard.AddTransition(variable, AccelerateDecelerate(1.0, 180.0));
+	animator.Schedule(storyboard, 100.0);
+
+	// With ratios of 0.2 and 0.8 the peak velocity is twice the average
+	double const times[] = { 0.0, 0.1, 0.2, 0.5, 0.9, 1.0, 2.0 };
+	double const values[] = { 0.0, 9.0, 36.0, 123.75, 177.75, 180.0, 180.0 };
+
+	for (unsigned i = 0; i != 7; ++i)
+	{
+		animator.Update(100.0 + times[i]);
+		Check(Near(animator.Value(variable), values[i]), "accelerate-decelerate profile");
+	}
+}
+
+// A card shown and then both cards of a pair hidden at the keyframe after
+// the show, as LeftButtonUpHandler schedules a mismatch
+static void CheckStoryboard()
+{
+	Animator animator;
+	unsigned const first = animator.CreateVariable(180.0);
+	unsigned const second = animator.CreateVariable(0.0);
+
+	Storyboard storyboard;
+	Keyframe const keyframe = storyboard.AddTransition(second, AccelerateDecelerate(1.0, 180.0));
+	storyboard.AddTransitionAtKeyframe(first, AccelerateDecelerate(1.0, 0.0), keyframe);
+	storyboard.AddTransitionAtKeyframe(second, AccelerateDecelerate(1.0, 0.0), keyframe);
+
+	Check(keyframe == 1.0, "keyframe after the transition");
+
+	animator.Update(10.0);
+	animator.Schedule(storyboard, 10.0);
+
+	AnimationCurve const firstCurve = animator.GetCurve(first);
+	AnimationCurve const secondCurve = animator.GetCurve(second);
+
+	Check(firstCurve.End == 2.0 && firstCurve.EndValue == 0.0f, "first curve ends after the hide");
+	Check(secondCurve.End == 2.0 && secondCurve.EndValue == 0.0f, "second curve ends after the hide");
+
+	for (double time = 0.0; time <= 2.5; time += 1.0 / 64.0)
+	{
+		animator.Update(10.0 + time);
+
+		if (time < 1.0)
+		{
+			Check(animator.Value(first) == 180.0f, "first card waits for the keyframe");
+		}
+
+		Check(Near(animator.Value(first), firstCurve.Value(time)), "first curve follows the animator");
+		Check(Near(animator.Value(second), secondCurve.Value(time)), "second curve follows the animator");
+	}
+
+	Check(!animator.IsAnimating(first) && !animator.IsAnimating(second), "storyboard finished");
+}
+
+// Flips a random card every few milliseconds so that variables are found in
+// every phase of their transitions
+static void Scramble(Animator & animator, std::mt19937 & generator, double const time)
+{
+	std::uniform_real_distribution<double> offset(0.0, 1.0);
+	std::uniform_int_distribution<unsigned> pick(0, animator.VariableCount() - 1);
+
+	for (unsigned i = 0; i != animator.VariableCount() / 2; ++i)
+	{
+		unsigned const variable = pick(generator);
+
+		Storyboard storyboard;
+		Keyframe const keyframe = storyboard.AddTransition(variable, AccelerateDecelerate(0.5 + offset(generator), 180.0));
+		storyboard.AddTransitionAtKeyframe(variable, AccelerateDecelerate(1.0, offset(generator) < 0.5 ? 0.0 : 90.0), keyframe);
+
+		animator.Schedule(storyboard, time + offset(generator));
+	}
+}
+
+static void BenchmarkTick(unsigned const count)
+{
+	std::mt19937 generator(10);
+
+	Animator animator;
+	Animator reference;
+
+	for (unsigned i = 0; i != count; ++i)
+	{
+		animator.CreateVariable(0.0);
+		reference.CreateVariable(0.0);
+	}
+
+	std::mt19937 copy = generator;
+	Scramble(animator, generator, 1000.0);
+	Scramble(reference, copy, 1000.0);
+
+	// The SIMD kernel must produce the same values as the scalar one
+	for (double time = 1000.0; time < 1003.0; time += 1.0 / 60.0)
+	{
+		animator.Update(time);
+		reference.UpdateScalar(time);
+
+		for (unsigned i = 0; i != count; ++i)
+		{
+			Check(animator.Value(i) == reference.Value(i), "SIMD values match the scalar reference");
+		}
+	}
+
+	std::string const name = std::to_string(count) + " variables";
+
+	animator.Update(1003.0);
+	Scramble(animator, generator, 1003.0);
+	animator.Update(1003.5);
+
+	double time = 1003.5;
+
+	double const simd = Run(("Tick " + name).c_str(), count, [&]
+	{
+		animator.Update(time);
+		Consume(animator.Values()[0]);
+	});
+
+	double const scalar = Run(("Tick scalar " + name).c_str(), count, [&]
+	{
+		animator.UpdateScalar(time);
+		Consume(animator.Values()[0]);
+	});
+
+	Report(("  SIMD speedup " + name).c_str(), scalar / simd, "x");
+
+	// A curve per variable, compared against the animator at a few times
+	{
+		std::vector<AnimationCurve> curves;
+
+		for (unsigned i = 0; i < count; i += 97)
+		{
+			curves.push_back(animator.GetCurve(i));
+		}
+
+		Animator probe = animator;
+
+		for (double offset = 0.0; offset < 2.0; offset += 0.125)
+		{
+			probe.Update(time + offset);
+
+			for (unsigned i = 0; i < count; i += 97)
+			{
+				Check(Near(probe.Value(i), curves[i / 97].Value(offset), 1e-2), "curve follows the animator");
+			}
+		}
+	}
+
+	Run(("Export curves " + name).c_str(), count, [&]
+	{
+		for (unsigned i = 0; i != count; ++i)
+		{
+			AnimationCurve const curve = animator.GetCurve(i);
+			Consume(curve.End);
+		}
+	});
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	CheckProfile();
+	CheckStoryboard();
+
+	for (unsigned const count : { 52u, 1000u, 10000u, 100000u })
+	{
+		BenchmarkTick(count);
+	}
+}
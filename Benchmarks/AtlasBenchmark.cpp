@@ -0,0 +1,109 @@
+#include "Benchmark.h"
+#include "../Atlas.h"
+#include <random>
+#include <string>
+
+// Packs every card on boards from 3x6 to 100x100 into atlas pages and
+// reports page count, occupancy and the memory saved against two surfaces
+// per card. The packing is checked for overlaps before it is timed.
+
+struct Size
+{
+	unsigned Rows;
+	unsigned Columns;
+};
+
+static bool Overlap(AtlasRect const & a, AtlasRect const & b, unsigned const padding)
+{
+	return a.Page == b.Page &&
+		a.Left < b.Left + b.Width + padding &&
+		b.Left < a.Left + a.Width + padding &&
+		a.Top < b.Top + b.Height + padding &&
+		b.Top < a.Top + a.Height + padding;
+}
+
+static void Verify(CardAtlas const & atlas, Board const & board)
+{
+	std::vector<AtlasRect> rects;
+
+	for (CardAtlas::Front const & front : atlas.m_uniqueFronts)
+	{
+		rects.push_back(front.Rect);
+	}
+
+	for (unsigned index = 0; index != board.CardCount(); ++index)
+	{
+		if (board[index].Status == CardStatus::Matched) continue;
+
+		rects.push_back(atlas.BackRect(index));
+
+		Check(atlas.m_uniqueFronts[atlas.m_fronts[index]].Value == board[index].Value, "front tile shows the card's letter");
+	}
+
+	Check(atlas.m_uniqueFronts.size() <= 52, "fronts are shared by letter");
+
+	for (AtlasRect const & rect : rects)
+	{
+		Check(rect.Page < atlas.m_atlas.PageCount(), "rect on an existing page");
+		Check(rect.Left + rect.Width <= atlas.m_atlas.m_pageWidth, "rect inside page width");
+		Check(rect.Top + rect.Height <= atlas.m_atlas.PageHeight(rect.Page), "rect inside trimmed page height");
+	}
+
+	// Tiles land in order on a page, so only nearby rects can collide
+	for (size_t i = 0; i != rects.size(); ++i)
+		for (size_t j = i + 1; j != rects.size() && j < i + 256; ++j)
+		{
+			Check(!Overlap(rects[i], rects[j], 0), "tiles do not overlap");
+		}
+}
+
+static void BenchmarkAtlas(Size const & size, float const dpi)
+{
+	BoardGeometry const geometry = SampleBoard::Geometry(size.Rows, size.Columns);
+	Board board(geometry);
+	std::mt19937 generator(5);
+	board.Shuffle(generator);
+
+	unsigned const width = static_cast<unsigned>(LogicalToPhysical(CardWidth, dpi));
+	unsigned const height = static_cast<unsigned>(LogicalToPhysical(CardHeight, dpi));
+
+	CardAtlas const atlas(board, width, height);
+
+	Verify(atlas, board);
+
+	std::string const name = std::to_string(size.Rows) + "x" + std::to_string(size.Columns) +
+		" @" + std::to_string(static_cast<int>(dpi));
+
+	Run(("Pack " + name).c_str(), board.CardCount(), [&]
+	{
+		CardAtlas const packed(board, width, height);
+		Consume(packed.m_atlas.PageCount());
+	});
+
+	Report(("  surfaces per card scheme " + name).c_str(), 2.0 * board.CardCount(), "surfaces");
+	Report(("  surfaces atlas " + name).c_str(), atlas.m_atlas.PageCount(), "surfaces");
+	Report(("  unique fronts " + name).c_str(), static_cast<double>(atlas.m_uniqueFronts.size()), "tiles");
+	Report(("  occupancy " + name).c_str(), atlas.m_atlas.Occupancy() * 100.0, "%");
+	Report(("  per card bytes " + name).c_str(), atlas.PerCardBytes() / 1048576.0, "MiB");
+	Report(("  atlas bytes " + name).c_str(), atlas.m_atlas.Bytes() / 1048576.0, "MiB");
+	Report(("  saved " + name).c_str(), atlas.SavedBytes() / 1048576.0, "MiB");
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	Size const sizes[] =
+	{
+		{ 3, 6 },
+		{ 10, 10 },
+		{ 32, 32 },
+		{ 100, 100 },
+	};
+
+	for (float const dpi : { 96.0f, 144.0f })
+		for (Size const & size : sizes)
+		{
+			BenchmarkAtlas(size, dpi);
+		}
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../Layout.h"
+
+// Minimal micro-benchmark harness. Each benchmark executable has its own main
+// and calls Run for every case it measures.
+
+static double BenchmarkMinimumSeconds = 0.25;
+
+// The sample's cards, in logical units, for boards of any size made with
+// SampleBoard::Geometry(rows, columns)
+static float const CardMargin = SampleBoard::Geometry().Margin;
+static float const CardWidth = SampleBoard::Geometry().CardWidth;
+static float const CardHeight = SampleBoard::Geometry().CardHeight;
+
+// Keeps the optimizer from discarding a computed value.
+template <typename T>
+inline void Consume(T const & value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static volatile char sink;
+	sink = *reinterpret_cast<char const volatile *>(&value);
+#endif
+}
+
+// Parses the options shared by all benchmark executables.
+//   --quick   run every case for a few milliseconds only
+inline void BenchmarkInitialize(int const argc, char ** argv)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		if (0 == strcmp(argv[i], "--quick"))
+		{
+			BenchmarkMinimumSeconds = 0.01;
+		}
+	}
+}
+
+// Runs body repeatedly until BenchmarkMinimumSeconds has elapsed and reports
+// the time per call and per item. Items is the amount of work done by one
+// call of body (cards, pixels, events...).
+template <typename Body>
+double Run(char const * name,
+	double const items,
+	Body && body)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	unsigned long long iterations = 1;
+	double elapsed = 0.0;
+
+	for (;;)
+	{
+		auto const start = Clock::now();
+
+		for (unsigned long long i = 0; i != iterations; ++i)
+		{
+			body();
+		}
+
+		elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+		if (elapsed >= BenchmarkMinimumSeconds) break;
+
+		iterations = elapsed <= 0.0 ?
+			iterations * 10 :
+			static_cast<unsigned long long>(iterations * BenchmarkMinimumSeconds * 1.2 / elapsed) + 1;
+	}
+
+	double const perCall = elapsed * 1e9 / iterations;
+	double const perItem = perCall / items;
+
+	printf("%-48s %14.1f ns/op %12.2f ns/item %10llu runs\n",
+		name,
+		perCall,
+		perItem,
+		iterations);
+
+	return perItem;
+}
+
+// Prints a value that is not a timing, such as a memory footprint or ratio.
+inline void Report(char const * name,
+	double const value,
+	char const * unit)
+{
+	printf("%-48s %14.2f %s\n", name, value, unit);
+}
+
+// Aborts the benchmark when a result does not match its reference, so that
+// a fast but wrong implementation never reports a number.
+inline void Check(bool const condition, char const * what)
+{
+	if (!condition)
+	{
+		fprintf(stderr, "check failed: %s\n", what);
+		exit(1);
+	}
+}
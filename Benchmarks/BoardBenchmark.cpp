@@ -0,0 +1,141 @@
+#include "Benchmark.h"
+#include "../Board.h"
+#include <random>
+#include <string>
+
+// Shuffle, hit-test and match resolution on boards from the sample's 3x6 up
+// to 1000x1000 cards.
+
+static float const Dpi = 96.0f;
+
+struct Size
+{
+	unsigned Rows;
+	unsigned Columns;
+};
+
+static std::string Name(char const * what, Size const & size)
+{
+	return std::string(what) + " " + std::to_string(size.Rows) + "x" + std::to_string(size.Columns);
+}
+
+// Pairs every upper case card with a lower case partner so that the board
+// can be cleared by selecting the pairs in order.
+static std::vector<unsigned> SolveOrder(Board const & board)
+{
+	std::vector<std::vector<unsigned>> upper(26);
+	std::vector<std::vector<unsigned>> lower(26);
+
+	for (unsigned i = 0; i != board.CardCount(); ++i)
+	{
+		wchar_t const value = board[i].Value;
+
+		if (value >= L'a') lower[value - L'a'].push_back(i);
+		else upper[value - L'A'].push_back(i);
+	}
+
+	std::vector<unsigned> order;
+	order.reserve(board.CardCount());
+
+	for (unsigned letter = 0; letter != 26; ++letter)
+	{
+		for (size_t i = 0; i != upper[letter].size(); ++i)
+		{
+			order.push_back(upper[letter][i]);
+			order.push_back(lower[letter][i]);
+		}
+	}
+
+	return order;
+}
+
+static void BenchmarkBoard(Size const & size)
+{
+	BoardGeometry const geometry = SampleBoard::Geometry(size.Rows, size.Columns);
+	Board board(geometry);
+	std::mt19937 generator(42);
+
+	board.Shuffle(generator);
+	board.Arrange(Dpi, Dpi);
+
+	double const cards = board.CardCount();
+
+	Run(Name("Shuffle", size).c_str(), cards, [&]
+	{
+		board.Shuffle(generator);
+		Consume(board[0].Value);
+	});
+
+	// Hit-test a fixed set of random points over the whole window.
+	unsigned const queries = 1024;
+	std::vector<float> points(queries * 2);
+	std::uniform_real_distribution<float> x(0.0f, geometry.Width());
+	std::uniform_real_distribution<float> y(0.0f, geometry.Height());
+
+	for (unsigned i = 0; i != queries; ++i)
+	{
+		points[i * 2 + 0] = x(generator);
+		points[i * 2 + 1] = y(generator);
+	}
+
+	// A linear scan over a million cards is slow; sample fewer points there.
+	unsigned const hitQueries = board.CardCount() > 100000 ? 16 : queries;
+
+	Run(Name("CardAtPoint", size).c_str(), hitQueries, [&]
+	{
+		for (unsigned i = 0; i != hitQueries; ++i)
+		{
+			Consume(board.CardAtPoint(points[i * 2], points[i * 2 + 1], Dpi, Dpi));
+		}
+	});
+
+	// Resolve every pair: one mismatch followed by one match per pair.
+	board.Shuffle(generator);
+	Board const dealt = board;
+	std::vector<unsigned> const order = SolveOrder(dealt);
+
+	Check(order.size() == dealt.CardCount(), "every card has a partner");
+
+	Run(Name("Select (clear board)", size).c_str(), cards * 2, [&]
+	{
+		board = dealt;
+
+		for (size_t i = 0; i != order.size(); i += 2)
+		{
+			// Both upper case, so never a match
+			if (i + 2 != order.size())
+			{
+				Consume(board.Select(order[i]));
+				Consume(board.Select(order[i + 2]));
+			}
+
+			Consume(board.Select(order[i]));
+			Consume(board.Select(order[i + 1]));
+		}
+	});
+
+	Check(board.m_firstCard == Board::NoCard, "no card left selected");
+
+	for (Card const & card : board)
+	{
+		Check(card.Status == CardStatus::Matched, "board cleared");
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	Size const sizes[] =
+	{
+		{ 3, 6 },
+		{ 32, 32 },
+		{ 100, 100 },
+		{ 1000, 1000 },
+	};
+
+	for (Size const & size : sizes)
+	{
+		BenchmarkBoard(size);
+	}
+}
@@ -0,0 +1,296 @@
+#include "Benchmark.h"
+#include "../CardStore.h"
+#include <unordered_map>
+
+// Passes over a board of a million cards, half of them matched, with the
+// cards stored as an array of Card, as an array of Card with the two
+// pointers the sample's cards carry for their animation variable and
+// rotation, and as the columns of a CardStore. Checks that every layout
+// gives the same answers, that a store deals the same game as a board and
+// that a board copied through a store comes back the same.
+
+static BoardGeometry const Geometry = SampleBoard::Geometry(1000, 1000);
+static float const Dpi = 96.0f;
+
+// A card as the sample holds it, with its animation's objects
+struct HandleCard
+{
+	Card State;
+	void * Variable = nullptr;
+	void * Rotation = nullptr;
+};
+
+// Matches about half the pairs, picked at random
+static void MatchHalf(Board & board, Xoshiro256 & generator)
+{
+	std::unordered_map<wchar_t, unsigned> waiting;
+
+	for (unsigned index = 0; index != board.CardCount(); ++index)
+	{
+		wchar_t const value = board[index].Value;
+		auto partner = waiting.find(CardAlphabet::Partner(value));
+
+		if (partner == waiting.end()) partner = waiting.find(static_cast<wchar_t>(value - (L'a' - L'A')));
+
+		if (partner != waiting.end() && RandomBelow(generator, 2) == 0)
+		{
+			board[partner->second].Status = CardStatus::Matched;
+			board[index].Status = CardStatus::Matched;
+			waiting.erase(partner);
+		}
+		else if (waiting.find(value) == waiting.end())
+		{
+			waiting.emplace(value, index);
+		}
+	}
+}
+
+static bool SameBoard(Board const & a, Board const & b)
+{
+	for (unsigned index = 0; index != a.CardCount(); ++index)
+	{
+		if (a[index].Value != b[index].Value ||
+			a[index].Status != b[index].Status ||
+			a[index].OffsetX != b[index].OffsetX ||
+			a[index].OffsetY != b[index].OffsetY)
+		{
+			return false;
+		}
+	}
+
+	return a.m_firstCard == b.m_firstCard;
+}
+
+static unsigned ScanAtPoint(Board const & board, float const x, float const y, float const width, float const height)
+{
+	for (unsigned index = 0; index != board.CardCount(); ++index)
+	{
+		if (board.CardContains(index, x, y, width, height)) return index;
+	}
+
+	return Board::NoCard;
+}
+
+static unsigned ScanAtPoint(std::vector<HandleCard> const & cards, float const x, float const y, float const width, float const height)
+{
+	for (unsigned index = 0; index != cards.size(); ++index)
+	{
+		Card const & card = cards[index].State;
+
+		if (x > card.OffsetX && y > card.OffsetY && x < card.OffsetX + width && y < card.OffsetY + height) return index;
+	}
+
+	return Board::NoCard;
+}
+
+template <typename Cards, typename Get>
+static unsigned MatchedCount(Cards const & cards, Get && get)
+{
+	unsigned count = 0;
+
+	for (auto const & card : cards)
+	{
+		count += CardStatus::Matched == get(card).Status;
+	}
+
+	return count;
+}
+
+template <typename Cards, typename Get>
+static unsigned CountInPlay(Cards const & cards, Get && get, wchar_t const value)
+{
+	unsigned count = 0;
+
+	for (auto const & card : cards)
+	{
+		count += get(card).Value == value && CardStatus::Matched != get(card).Status;
+	}
+
+	return count;
+}
+
+static unsigned FindPartner(Board const & board, unsigned const index)
+{
+	for (unsigned other = 0; other != board.CardCount(); ++other)
+	{
+		if (Board::IsMatch(board[index].Value, board[other].Value) && CardStatus::Matched != board[other].Status) return other;
+	}
+
+	return Board::NoCard;
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	Board board(Geometry);
+	Xoshiro256 generator(2024);
+
+	board.Deal(CardAlphabet::Extended(), generator);
+	board.Arrange(Dpi, Dpi);
+	MatchHalf(board, generator);
+
+	unsigned const count = board.CardCount();
+
+	// Each card's animation variable, which the card with pointers points at
+	std::vector<float> variables(count);
+
+	for (unsigned index = 0; index != count; ++index)
+	{
+		variables[index] = static_cast<float>(index % 360);
+	}
+
+	std::vector<HandleCard> handleCards(count);
+
+	for (unsigned index = 0; index != count; ++index)
+	{
+		handleCards[index].State = board[index];
+		handleCards[index].Variable = &variables[index];
+	}
+
+	CardStore store(Geometry);
+	store.Load(board);
+
+	// Same deal, same copy back
+	Board dealtBoard(Geometry);
+	CardStore dealtStore(Geometry);
+	Xoshiro256 boardGenerator(7);
+	Xoshiro256 storeGenerator(7);
+
+	dealtBoard.Deal(CardAlphabet::Extended(), boardGenerator);
+	dealtStore.Deal(CardAlphabet::Extended(), storeGenerator);
+
+	Check(std::equal(dealtStore.m_values.begin(), dealtStore.m_values.end(), dealtBoard.begin(), [](wchar_t const value, Card const & card)
+	{
+		return value == card.Value;
+	}), "same deal");
+
+	board.Select(FindPartner(board, 0) == 0 ? 1 : 0);
+	store.Load(board);
+
+	Board stored(Geometry);
+	store.Store(stored);
+
+	Check(SameBoard(board, stored), "board round trip");
+
+	float const width = LogicalToPhysical(Geometry.CardWidth, Dpi);
+	float const height = LogicalToPhysical(Geometry.CardHeight, Dpi);
+
+	// The middle of the last card, so that every scan is of the whole board
+	float const x = board[count - 1].OffsetX + width / 2.0f;
+	float const y = board[count - 1].OffsetY + height / 2.0f;
+
+	auto const plain = [](Card const & card) -> Card const & { return card; };
+	auto const handled = [](HandleCard const & card) -> Card const & { return card.State; };
+
+	wchar_t const letter = board[0].Value;
+
+	Check(ScanAtPoint(board, x, y, width, height) == count - 1 &&
+		ScanAtPoint(handleCards, x, y, width, height) == count - 1 &&
+		store.ScanAtPoint(x, y, width, height) == count - 1 &&
+		store.CardAtPoint(x, y, Dpi, Dpi) == count - 1, "same hit");
+
+	Check(MatchedCount(board, plain) == store.MatchedCount() &&
+		MatchedCount(handleCards, handled) == store.MatchedCount(), "same matched count");
+
+	Check(CountInPlay(board, plain, letter) == store.CountInPlay(letter) &&
+		CountInPlay(handleCards, handled, letter) == store.CountInPlay(letter), "same cards in play");
+
+	for (unsigned index = 0; index != 64; ++index)
+	{
+		Check(FindPartner(board, index) == store.FindPartner(index), "same partner");
+	}
+
+	std::vector<float> handleAngles(count, 0.0f);
+	std::vector<float> storeAngles(count, 0.0f);
+
+	auto const animateHandles = [&]
+	{
+		for (unsigned index = 0; index != count; ++index)
+		{
+			HandleCard const & card = handleCards[index];
+
+			if (CardStatus::Matched != card.State.Status)
+			{
+				handleAngles[index] = *static_cast<float const *>(card.Variable);
+			}
+		}
+	};
+
+	auto const animateStore = [&]
+	{
+		store.ForEachAnimated([&](CardId const id, uint32_t const variable)
+		{
+			storeAngles[id] = variables[variable];
+		});
+	};
+
+	animateHandles();
+	animateStore();
+
+	Check(handleAngles == storeAngles, "same animation pass");
+
+	Report("  cards", count, "");
+	Report("  cards in play", count - store.MatchedCount(), "");
+	Report("  bytes per card array of Card", sizeof(Card), "B");
+	Report("  bytes per card array of Card with pointers", sizeof(HandleCard), "B");
+	Report("  bytes per card hit test columns", sizeof(float) * 2, "B");
+	Report("  bytes per card match scan columns", sizeof(wchar_t) + 1.0 / 8.0, "B");
+
+	Run("Hit test scan array of Card", count, [&]
+	{
+		Consume(ScanAtPoint(board, x, y, width, height));
+	});
+
+	Run("Hit test scan array of Card with pointers", count, [&]
+	{
+		Consume(ScanAtPoint(handleCards, x, y, width, height));
+	});
+
+	Run("Hit test scan CardStore", count, [&]
+	{
+		Consume(store.ScanAtPoint(x, y, width, height));
+	});
+
+	Run("Matched count array of Card", count, [&]
+	{
+		Consume(MatchedCount(board, plain));
+	});
+
+	Run("Matched count array of Card with pointers", count, [&]
+	{
+		Consume(MatchedCount(handleCards, handled));
+	});
+
+	Run("Matched count CardStore", count, [&]
+	{
+		Consume(store.MatchedCount());
+	});
+
+	Run("Match scan array of Card", count, [&]
+	{
+		Consume(CountInPlay(board, plain, letter));
+	});
+
+	Run("Match scan array of Card with pointers", count, [&]
+	{
+		Consume(CountInPlay(handleCards, handled, letter));
+	});
+
+	Run("Match scan CardStore", count, [&]
+	{
+		Consume(store.CountInPlay(letter));
+	});
+
+	Run("Animation pass array of Card with pointers", count, [&]
+	{
+		animateHandles();
+		Consume(handleAngles[count - 1]);
+	});
+
+	Run("Animation pass CardStore", count, [&]
+	{
+		animateStore();
+		Consume(storeAngles[count - 1]);
+	});
+}
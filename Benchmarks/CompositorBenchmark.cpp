@@ -0,0 +1,321 @@
+#include "Benchmark.h"
+#include "../BoardScene.h"
+#include "../RecordingCompositor.h"
+#include <algorithm>
+#include <random>
+#include <string>
+
+// Builds the board's visual tree on the recording compositor and holds the
+// frames the sample makes to a budget of compositor calls per card: the
+// first frame, a frame of clicks, a relayout after a DPI change and a new
+// game built from the cards and pages the last one pooled. A change that
+// makes any of them grow fails the run. Also times the headless build.
+
+// Calls per card in play, or per click for the flip frame, on top of a few
+// for the root, the three matrix transforms every card of a size shares and
+// one of each kind per atlas page
+static double const RootOverhead = 5.0;
+
+// Matrix transforms either side of the rotations, for all cards of one size
+static unsigned const SharedMatrices = 3;
+
+struct Budget
+{
+	char const * Name;
+	double Allocations;
+	double PropertySets;
+	double TreeChanges;
+	double Uploads;
+};
+
+// The first frame: a rotation and two faces of two visuals and a group per
+// card, one back tile and the fronts per card
+static Budget const BuildBudget = { "build", 7.0, 15.0, 4.0, 2.0 };
+
+// Selecting a card and then a wrong one animates both cards once
+static Budget const FlipBudget = { "flip", 0.0, 1.0, 0.0, 0.0 };
+
+// New pages and a new layout for every face, redrawing every tile. The faces
+// get groups with the shared matrices for the new size.
+static Budget const RelayoutBudget = { "relayout", 2.0, 10.0, 0.0, 2.0 };
+
+// Every card from the pool with its angle, layout and tiles set, and put
+// back in the emptied tree. Only pages larger than any pooled are allocated.
+static Budget const NewGameBudget = { "new game", 0.0, 9.0, 2.0, 2.0 };
+
+static unsigned const NewGames = 10;
+
+struct Size
+{
+	unsigned Rows;
+	unsigned Columns;
+};
+
+static void CheckBudget(Budget const & budget,
+	CompositorCounters const & frame,
+	double const items,
+	size_t const pageCount,
+	std::string const & name)
+{
+	double const overhead = RootOverhead + pageCount;
+
+	Report(("  allocations/" + std::string(budget.Name) + " " + name).c_str(), frame.Allocations / items, "per card");
+	Report(("  property sets/" + std::string(budget.Name) + " " + name).c_str(), frame.PropertySets / items, "per card");
+	Report(("  tree changes/" + std::string(budget.Name) + " " + name).c_str(), frame.TreeChanges / items, "per card");
+	Report(("  uploads/" + std::string(budget.Name) + " " + name).c_str(), frame.Uploads / items, "per card");
+
+	Check(frame.Commits == 1, "one commit per frame");
+	Check(frame.Allocations <= budget.Allocations * items + overhead, "allocations within budget");
+	Check(frame.PropertySets <= budget.PropertySets * items + overhead, "property sets within budget");
+	Check(frame.TreeChanges <= budget.TreeChanges * items + overhead, "tree changes within budget");
+	Check(frame.Uploads <= budget.Uploads * items + overhead, "uploads within budget");
+}
+
+// Draws every tile the way the sample does, through Upload
+static void UploadTiles(Board const & board,
+	CardAtlas const & atlas,
+	ScenePages const & pages,
+	PixelBuffer const & tile)
+{
+	for (CardAtlas::Front const & front : atlas.m_uniqueFronts)
+	{
+		pages[front.Rect.Page]->Upload(front.Rect.Left, front.Rect.Top, tile.View());
+	}
+
+	for (unsigned index = 0; index != board.CardCount(); ++index)
+	{
+		if (!atlas.Contains(index)) continue;
+
+		AtlasRect const & rect = atlas.BackRect(index);
+		pages[rect.Page]->Upload(rect.Left, rect.Top, tile.View());
+	}
+}
+
+static void BenchmarkBoard(Size const & size)
+{
+	BoardGeometry const geometry = SampleBoard::Geometry(size.Rows, size.Columns);
+	Board board(geometry);
+	std::mt19937 generator(12);
+	board.Shuffle(generator);
+	board.Arrange(96.0f, 96.0f);
+
+	PhysicalLayout const layout(geometry, 96.0f, 96.0f);
+	PixelBuffer const tile(layout.SurfaceWidth(), layout.SurfaceHeight());
+
+	std::string const name = std::to_string(size.Rows) + "x" + std::to_string(size.Columns);
+	double const cards = geometry.CardCount();
+
+	RecordingCompositor compositor;
+	Animator animator;
+	InteractionQueue queue;
+
+	for (unsigned i = 0; i != board.CardCount(); ++i)
+	{
+		animator.CreateVariable(0.0);
+	}
+
+	// The first frame
+	CardAtlas atlas(board, layout.SurfaceWidth(), layout.SurfaceHeight());
+	BoardScene scene(compositor, board.CardCount());
+	ScenePages pages = scene.CreatePages(atlas);
+
+	UploadTiles(board, atlas, pages, tile);
+	scene.Build(board, atlas, pages, layout);
+	compositor.Commit();
+
+	CheckBudget(BuildBudget, compositor.Frames().back(), cards, pages.size(), name);
+	Check(compositor.CountVisuals() == 1 + 4 * geometry.CardCount(), "two visuals per face");
+
+	// Two wrong guesses in one frame
+	unsigned first = 0;
+	unsigned second = 1;
+
+	while (Board::IsMatch(board[first].Value, board[second].Value)) ++second;
+
+	queue.Click(first);
+	queue.Click(second);
+	queue.Flush(board, animator, scene);
+
+	CheckBudget(FlipBudget, compositor.Frames().back(), 2.0, 0, name);
+
+	// Twice the DPI, with the tree kept
+	PhysicalLayout const large(geometry, 192.0f, 192.0f);
+	PixelBuffer const largeTile(large.SurfaceWidth(), large.SurfaceHeight());
+
+	board.Arrange(large.DpiX, large.DpiY);
+	CardAtlas const largeAtlas(board, large.SurfaceWidth(), large.SurfaceHeight());
+	ScenePages largePages = scene.CreatePages(largeAtlas);
+
+	UploadTiles(board, largeAtlas, largePages, largeTile);
+
+	for (unsigned index = 0; index != board.CardCount(); ++index)
+	{
+		scene.SetCardLayout(index, board[index], largeAtlas, largePages, large);
+	}
+
+	// As the sample does, once no card in the scene is on the old pages
+	scene.DiscardPages(pages);
+	pages = std::move(largePages);
+
+	compositor.Commit();
+
+	CheckBudget(RelayoutBudget, compositor.Frames().back(), cards, pages.size(), name);
+
+	// The old pages and matrices are released once no face uses them
+	Check(compositor.LiveObjects() == 1 + 7 * geometry.CardCount() + SharedMatrices + pages.size(), "old pages and matrices released");
+
+	// A pair matched, pooled once it has turned away
+	unsigned match = 1;
+
+	while (!Board::IsMatch(board[0].Value, board[match].Value)) ++match;
+
+	queue.Click(0);
+	queue.Click(match);
+	queue.Flush(board, animator, scene);
+
+	compositor.m_time += 2.0 * FlipDuration;
+	animator.Update(compositor.NextFrameTime());
+
+	Check(scene.ReleaseMatched(board, animator) == 2 && !scene.Contains(0) && !scene.Contains(match), "matched pair pooled");
+	Check(scene.m_pool.m_cardCounters.Pooled == 2, "pair kept for reuse");
+
+	compositor.Commit();
+
+	// New deals, every card from the pool
+	unsigned pageMisses = 0;
+
+	for (unsigned game = 0; game != NewGames; ++game)
+	{
+		board.Shuffle(generator);
+		board.Arrange(large.DpiX, large.DpiY);
+
+		for (unsigned index = 0; index != board.CardCount(); ++index)
+		{
+			animator.Reset(index, 0.0);
+		}
+
+		CardAtlas const dealt(board, large.SurfaceWidth(), large.SurfaceHeight());
+		unsigned long long const pageHits = scene.m_pool.m_pageCounters.Hits;
+
+		scene.Clear();
+		scene.ReleasePages(pages);
+		pages = scene.CreatePages(dealt);
+
+		UploadTiles(board, dealt, pages, largeTile);
+		scene.Build(board, dealt, pages, large);
+		compositor.Commit();
+
+		CompositorCounters const & frame = compositor.Frames().back();
+		unsigned const misses = static_cast<unsigned>(pages.size() - (scene.m_pool.m_pageCounters.Hits - pageHits));
+
+		Check(frame.Allocations == misses, "new game allocates only missing pages");
+		pageMisses += misses;
+
+		if (game + 1 == NewGames)
+		{
+			CheckBudget(NewGameBudget, frame, cards, pages.size(), name);
+		}
+	}
+
+	PoolCounters const & cardPool = scene.m_pool.m_cardCounters;
+	PoolCounters const & pagePool = scene.m_pool.m_pageCounters;
+
+	Check(cardPool.PeakResident == geometry.CardCount(), "no card made twice");
+	Check(cardPool.InUse + cardPool.Pooled == geometry.CardCount(), "cards counted");
+
+	Report(("  card pool hit rate " + name).c_str(), 100.0 * cardPool.HitRate(), "%");
+	Report(("  page pool hit rate " + name).c_str(), 100.0 * pagePool.HitRate(), "%");
+	Report(("  pages allocated in " + std::to_string(NewGames) + " new games " + name).c_str(), pageMisses, "");
+	Report(("  peak resident pages " + name).c_str(), pagePool.PeakResident, "");
+	Report(("  peak resident page MB " + name).c_str(), pagePool.PeakResidentBytes / 1048576.0, "MB");
+
+	Run(("Build scene " + name).c_str(), cards, [&]
+	{
+		RecordingCompositor counting(false);
+		BoardScene built(counting, board.CardCount());
+		ScenePages const builtPages = built.CreatePages(largeAtlas);
+
+		built.Build(board, largeAtlas, builtPages, large);
+		counting.Commit();
+
+		Consume(counting.Frames().back().Allocations);
+	});
+
+	CardAtlas const dealt(board, large.SurfaceWidth(), large.SurfaceHeight());
+
+	Run(("New game scene " + name).c_str(), cards, [&]
+	{
+		scene.Clear();
+		scene.ReleasePages(pages);
+		pages = scene.CreatePages(dealt);
+
+		scene.Build(board, dealt, pages, large);
+		compositor.Commit();
+
+		compositor.ClearRecording();
+		Consume(compositor.LiveObjects());
+	});
+
+	Run(("Relayout scene " + name).c_str(), cards, [&]
+	{
+		for (unsigned index = 0; index != board.CardCount(); ++index)
+		{
+			scene.SetCardLayout(index, board[index], dealt, pages, large);
+		}
+
+		compositor.ClearRecording();
+		Consume(compositor.LiveObjects());
+	});
+}
+
+// Discarded pages are freed, though pooled cards and cards left in the
+// scene showed them
+static void CheckDiscardedPages()
+{
+	BoardGeometry const geometry = SampleBoard::Geometry(3, 6);
+	Board board(geometry);
+	board.Arrange(96.0f, 96.0f);
+
+	PhysicalLayout const layout(geometry, 96.0f, 96.0f);
+	CardAtlas const atlas(board, layout.SurfaceWidth(), layout.SurfaceHeight());
+
+	for (bool const pooled : { true, false })
+	{
+		RecordingCompositor compositor;
+		BoardScene scene(compositor, board.CardCount());
+		ScenePages pages = scene.CreatePages(atlas);
+
+		scene.Build(board, atlas, pages, layout);
+		compositor.Commit();
+
+		if (pooled) scene.Clear();
+
+		std::vector<std::weak_ptr<CompositorSurface>> const discarded(pages.begin(), pages.end());
+
+		scene.DiscardPages(pages);
+		compositor.Commit();
+
+		Check(std::all_of(discarded.begin(), discarded.end(), [](std::weak_ptr<CompositorSurface> const & page)
+		{
+			return page.expired();
+		}), "discarded pages freed");
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	CheckDiscardedPages();
+
+	Size const sizes[] =
+	{
+		{ 3, 6 },
+		{ 20, 26 },
+	};
+
+	for (Size const & size : sizes)
+	{
+		BenchmarkBoard(size);
+	}
+}
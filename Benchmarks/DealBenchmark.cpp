@@ -0,0 +1,403 @@
+#include "Benchmark.h"
+#include "../Interaction.h"
+#include <random>
+#include <string>
+
+// Checks the generators against their reference outputs, that deals use
+// every letter evenly and only pair partners match, and that a seed and the
+// logged clicks replay a game exactly. Then measures deals per second from
+// the sample's 3x6 to a million cards, against the shuffle it replaces.
+
+struct Size
+{
+	unsigned Rows;
+	unsigned Columns;
+};
+
+// Board::Shuffle as it was: a distribution per pair, letters repeating
+// freely, then std::shuffle
+template <typename Generator>
+static void DealWithDistributions(Board & board, Generator & generator)
+{
+	std::uniform_int_distribution<short> distribution(L'A', L'Z');
+
+	std::vector<wchar_t> values(board.CardCount());
+
+	for (unsigned i = 0; i != board.CardCount() / 2; ++i)
+	{
+		wchar_t const value = distribution(generator);
+		values[i * 2 + 0] = value;
+		values[i * 2 + 1] = static_cast<wchar_t>(value - L'A' + L'a');
+	}
+
+	std::shuffle(values.begin(), values.end(), generator);
+
+	for (unsigned i = 0; i != board.CardCount(); ++i)
+	{
+		board[i].Value = values[i];
+		board[i].Status = CardStatus::Hidden;
+	}
+
+	board.m_firstCard = Board::NoCard;
+}
+
+static void CheckGenerators()
+{
+	// The reference implementations' first outputs
+	Xoshiro256 xoshiro(0);
+	uint64_t const state[] = { 1, 2, 3, 4 };
+	std::copy(std::begin(state), std::end(state), xoshiro.m_state);
+
+	uint64_t const xoshiroExpected[] = { 11520, 0, 1509978240, 1215971899390074240ull };
+
+	for (uint64_t const expected : xoshiroExpected)
+	{
+		Check(xoshiro() == expected, "xoshiro256** matches the reference");
+	}
+
+	SplitMix64 splitMix(0);
+	Check(splitMix() == 0xE220A8397B1DCDAFull && splitMix() == 0x6E789E6AA1B965F4ull, "SplitMix64 matches the reference");
+
+	Pcg32 pcg(42, 54);
+	uint32_t const pcgExpected[] = { 0xA15C02B7, 0x7B47F409, 0xBA1D3330, 0x83D2F293, 0xBFA4784B, 0xCBED606E };
+
+	for (uint32_t const expected : pcgExpected)
+	{
+		Check(pcg() == expected, "PCG32 matches the reference");
+	}
+
+	// Every value of a small bound about as often as the others
+	Xoshiro256 generator(19);
+	unsigned const bound = 7;
+	unsigned const draws = 70000;
+	unsigned counts[bound] = {};
+
+	for (unsigned i = 0; i != draws; ++i)
+	{
+		counts[RandomBelow(generator, bound)] += 1;
+	}
+
+	for (unsigned const count : counts)
+	{
+		Check(count > draws / bound - 600 && count < draws / bound + 600, "bounded numbers uniform");
+	}
+
+	for (uint32_t const large : { 1u, 3u, 1000u, 0x80000001u, 0xFFFFFFFFu })
+	{
+		for (unsigned i = 0; i != 1000; ++i)
+		{
+			Check(RandomBelow(generator, large) < large, "bounded numbers in range");
+		}
+	}
+}
+
+static bool InAlphabet(CardAlphabet const & alphabet, wchar_t const value)
+{
+	return std::find(alphabet.Letters.begin(), alphabet.Letters.end(), value) != alphabet.Letters.end();
+}
+
+static void CheckDeal(Size const & size,
+	CardAlphabet const & alphabet,
+	char const * alphabetName)
+{
+	BoardGeometry const geometry = SampleBoard::Geometry(size.Rows, size.Columns);
+	Board board(geometry);
+	Xoshiro256 generator(size.Rows * 1000 + size.Columns);
+
+	// A game in progress, which the deal must reset
+	board.Deal(alphabet, generator);
+	board.Select(0);
+	board[1].Status = CardStatus::Matched;
+
+	board.Deal(alphabet, generator);
+
+	Check(board.m_firstCard == Board::NoCard, "no card selected after a deal");
+
+	std::vector<unsigned> letters(alphabet.Size());
+	std::vector<unsigned> partners(alphabet.Size());
+
+	for (Card const & card : board)
+	{
+		Check(card.Status == CardStatus::Hidden, "cards face down after a deal");
+
+		auto const letter = std::find(alphabet.Letters.begin(), alphabet.Letters.end(), card.Value);
+
+		if (letter != alphabet.Letters.end())
+		{
+			++letters[letter - alphabet.Letters.begin()];
+			continue;
+		}
+
+		wchar_t const first = static_cast<wchar_t>(card.Value - (L'a' - L'A'));
+		auto const partner = std::find(alphabet.Letters.begin(), alphabet.Letters.end(), first);
+
+		Check(partner != alphabet.Letters.end(), "only the alphabet dealt");
+
+		if (partner != alphabet.Letters.end())
+		{
+			++partners[partner - alphabet.Letters.begin()];
+		}
+	}
+
+	unsigned const pairs = board.CardCount() / 2;
+	unsigned const rounds = pairs / alphabet.Size();
+
+	for (unsigned letter = 0; letter != alphabet.Size(); ++letter)
+	{
+		Check(letters[letter] == partners[letter], "every letter with its partner");
+		Check(letters[letter] == rounds || letters[letter] == rounds + 1, "letters used evenly");
+	}
+
+	// Matches only within a pair, across all the alphabet's letters
+	for (wchar_t const first : alphabet.Letters)
+		for (wchar_t const second : alphabet.Letters)
+		{
+			Check(!Board::IsMatch(first, second), "capitals never match");
+			Check(Board::IsMatch(first, CardAlphabet::Partner(second)) == (first == second), "only partners match");
+			Check(!InAlphabet(alphabet, CardAlphabet::Partner(second)), "partners outside the alphabet");
+		}
+
+	// Seeds alone decide the deal
+	Board again(geometry);
+	Xoshiro256 same(7);
+	Xoshiro256 other(8);
+
+	board.Deal(alphabet, same);
+	again.Deal(alphabet, other);
+
+	bool different = false;
+
+	for (unsigned index = 0; index != board.CardCount(); ++index)
+	{
+		different = different || board[index].Value != again[index].Value;
+	}
+
+	Check(different || board.CardCount() <= 2, "other seeds deal differently");
+
+	Xoshiro256 replay(7);
+	again.Deal(alphabet, replay);
+
+	for (unsigned index = 0; index != board.CardCount(); ++index)
+	{
+		Check(board[index].Value == again[index].Value, "same seed deals the same");
+	}
+
+	Report(("  pairs per letter " + std::to_string(size.Rows) + "x" + std::to_string(size.Columns) + " " + alphabetName).c_str(),
+		static_cast<double>(pairs) / alphabet.Size(), "");
+}
+
+// Every position as likely to get an upper case card as a lower case one,
+// and every card as likely to be at the first position
+static void CheckUniform()
+{
+	BoardGeometry const geometry = SampleBoard::Geometry(2, 3);
+	CardAlphabet const alphabet = CardAlphabet::Ranges({ { L'A', L'C' } });
+	Board board(geometry);
+	Xoshiro256 generator(3);
+
+	unsigned const deals = 60000;
+	unsigned upper[6] = {};
+	unsigned first[6] = {};
+
+	for (unsigned deal = 0; deal != deals; ++deal)
+	{
+		board.Deal(alphabet, generator);
+
+		for (unsigned index = 0; index != board.CardCount(); ++index)
+		{
+			upper[index] += board[index].Value < L'a';
+		}
+
+		wchar_t const value = board[0].Value;
+		first[value < L'a' ? value - L'A' : 3 + value - L'a'] += 1;
+	}
+
+	for (unsigned index = 0; index != 6; ++index)
+	{
+		Check(upper[index] > deals / 2 - 800 && upper[index] < deals / 2 + 800, "upper case anywhere");
+		Check(first[index] > deals / 6 - 500 && first[index] < deals / 6 + 500, "any card first");
+	}
+}
+
+// Logs every curve a game animates, to compare one play with its replay
+struct LoggingCompositor : FrameCompositor
+{
+	double m_time = 100.0;
+	std::vector<unsigned> m_cards;
+	std::vector<AnimationCurve> m_curves;
+	unsigned m_commits = 0;
+
+	double NextFrameTime() override
+	{
+		return m_time;
+	}
+
+	void AnimateAngle(unsigned const card, AnimationCurve const & curve) override
+	{
+		m_cards.push_back(card);
+		m_curves.push_back(curve);
+	}
+
+	void Commit() override
+	{
+		++m_commits;
+		m_time += 1.0 / 60.0;
+	}
+};
+
+struct Played
+{
+	std::vector<Card> Cards;
+	LoggingCompositor Compositor;
+};
+
+// Deals from the seed and applies the logged clicks, a few per frame
+static Played Play(BoardGeometry const & geometry,
+	uint64_t const seed,
+	std::vector<unsigned> const & clicks)
+{
+	Board board(geometry);
+	Xoshiro256 generator(seed);
+	board.Deal(CardAlphabet::Extended(), generator);
+
+	Animator animator;
+	InteractionQueue queue;
+	Played played;
+
+	for (unsigned index = 0; index != board.CardCount(); ++index)
+	{
+		animator.CreateVariable(0.0);
+	}
+
+	for (size_t click = 0; click != clicks.size(); ++click)
+	{
+		queue.Click(clicks[click]);
+
+		if (click % 3 == 2) queue.Flush(board, animator, played.Compositor);
+	}
+
+	queue.Flush(board, animator, played.Compositor);
+
+	played.Cards.assign(board.begin(), board.end());
+	return played;
+}
+
+static bool SameCurve(AnimationCurve const & a, AnimationCurve const & b)
+{
+	if (a.Segments.size() != b.Segments.size() || a.End != b.End || a.EndValue != b.EndValue) return false;
+
+	for (size_t i = 0; i != a.Segments.size(); ++i)
+	{
+		CurveSegment const & left = a.Segments[i];
+		CurveSegment const & right = b.Segments[i];
+
+		if (left.Begin != right.Begin ||
+			left.Constant != right.Constant ||
+			left.Linear != right.Linear ||
+			left.Quadratic != right.Quadratic ||
+			left.Cubic != right.Cubic) return false;
+	}
+
+	return true;
+}
+
+static void CheckReplay()
+{
+	BoardGeometry const geometry = SampleBoard::Geometry(12, 16);
+	Xoshiro256 input(20);
+	std::vector<unsigned> clicks;
+
+	for (unsigned click = 0; click != 2000; ++click)
+	{
+		clicks.push_back(RandomBelow(input, geometry.CardCount()));
+	}
+
+	Played const first = Play(geometry, 12345, clicks);
+	Played const second = Play(geometry, 12345, clicks);
+
+	unsigned matched = 0;
+
+	for (size_t index = 0; index != first.Cards.size(); ++index)
+	{
+		Check(first.Cards[index].Value == second.Cards[index].Value &&
+			first.Cards[index].Status == second.Cards[index].Status, "replayed board the same");
+
+		matched += first.Cards[index].Status == CardStatus::Matched;
+	}
+
+	Check(matched != 0, "replayed game made matches");
+	Check(first.Compositor.m_commits == second.Compositor.m_commits, "replayed frames the same");
+	Check(first.Compositor.m_cards == second.Compositor.m_cards, "replayed animations the same");
+
+	for (size_t i = 0; i != first.Compositor.m_curves.size() && i != second.Compositor.m_curves.size(); ++i)
+	{
+		Check(SameCurve(first.Compositor.m_curves[i], second.Compositor.m_curves[i]), "replayed curves the same");
+	}
+}
+
+template <typename Deal>
+static void TimeDeals(char const * what,
+	std::string const & name,
+	Board & board,
+	Deal && deal)
+{
+	double const perCard = Run((std::string("Deal ") + what + " " + name).c_str(), board.CardCount(), [&]
+	{
+		deal();
+		Consume(board[0].Value);
+	});
+
+	Report((std::string("  deals/s ") + what + " " + name).c_str(), 1e9 / (perCard * board.CardCount()), "deals/s");
+}
+
+static void BenchmarkBoard(Size const & size)
+{
+	BoardGeometry const geometry = SampleBoard::Geometry(size.Rows, size.Columns);
+	Board board(geometry);
+	std::string const name = std::to_string(size.Rows) + "x" + std::to_string(size.Columns);
+
+	std::mt19937 mersenne(19);
+	Xoshiro256 xoshiro(19);
+	Pcg32 pcg(19);
+
+	TimeDeals("distributions, mt19937", name, board, [&] { DealWithDistributions(board, mersenne); });
+	TimeDeals("mt19937", name, board, [&] { board.Deal(CardAlphabet::Extended(), mersenne); });
+	TimeDeals("PCG32", name, board, [&] { board.Deal(CardAlphabet::Extended(), pcg); });
+	TimeDeals("xoshiro256**", name, board, [&] { board.Deal(CardAlphabet::Extended(), xoshiro); });
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	CheckGenerators();
+
+	Size const checked[] =
+	{
+		{ 3, 6 },
+		{ 4, 13 },
+		{ 12, 16 },
+		{ 100, 100 },
+	};
+
+	for (Size const & size : checked)
+	{
+		CheckDeal(size, CardAlphabet::Latin(), "Latin");
+		CheckDeal(size, CardAlphabet::Extended(), "extended");
+	}
+
+	CheckUniform();
+	CheckReplay();
+
+	Size const sizes[] =
+	{
+		{ 3, 6 },
+		{ 100, 100 },
+		{ 1000, 1000 },
+	};
+
+	for (Size const & size : sizes)
+	{
+		BenchmarkBoard(size);
+	}
+}
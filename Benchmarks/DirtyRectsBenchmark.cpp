@@ -0,0 +1,411 @@
+#include "Benchmark.h"
+#include "../Board.h"
+#include "../DirtyRects.h"
+#include "../SoftwareRenderer.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+// Frames of frequent small changes on a large board: highlight borders,
+// corner badges and the letter's box changing on a few dozen cards a frame.
+// Each frame is redrawn once with every changed card drawn whole and once
+// with only the frame's dirty rectangles drawn, merged per card. Checks that
+// a card drawn in parts comes out the same as one drawn whole, leaving the
+// pixels outside its parts alone, and that a region covers every rectangle
+// added to it, before the times and pixels per frame are reported.
+
+static BoardGeometry const Geometry = SampleBoard::Geometry(16, 32);
+static float const FontSize = 96.0f;
+static unsigned const ChangesPerFrame = 48;
+static unsigned const FrameCount = 64;
+static unsigned const BorderWidth = 4;
+static unsigned const BadgeSize = 24;
+
+static PixelBuffer CreateBackground(unsigned const width, unsigned const height)
+{
+	PixelBuffer background(width, height);
+
+	for (unsigned y = 0; y != height; ++y)
+	{
+		uint32_t * row = background.View().Row(y);
+
+		for (unsigned x = 0; x != width; ++x)
+		{
+			row[x] = PackColor(x & 0xFF, y & 0xFF, (x ^ y) & 0xFF, 0xFF);
+		}
+	}
+
+	return background;
+}
+
+static bool SameView(ConstPixelView const & a, ConstPixelView const & b)
+{
+	if (a.Width != b.Width || a.Height != b.Height) return false;
+
+	for (unsigned y = 0; y != a.Height; ++y)
+	{
+		if (0 != memcmp(a.Row(y), b.Row(y), a.Width * sizeof(uint32_t))) return false;
+	}
+
+	return true;
+}
+
+static DirtyRect RandomRect(Xoshiro256 & generator, unsigned const width, unsigned const height)
+{
+	unsigned const left = RandomBelow(generator, width);
+	unsigned const top = RandomBelow(generator, height);
+
+	return DirtyRect(left,
+		top,
+		left + 1 + RandomBelow(generator, width - left),
+		top + 1 + RandomBelow(generator, height - top));
+}
+
+struct Change
+{
+	unsigned Card;
+	DirtyRect Rect;
+};
+
+// The rectangles one small change dirties on a card: the four sides of a
+// highlight border, the badge in the top right corner, or the letter's box
+static void AddChange(Xoshiro256 & generator,
+	unsigned const card,
+	unsigned const width,
+	unsigned const height,
+	DirtyRect const & letter,
+	std::vector<Change> & frame)
+{
+	switch (RandomBelow(generator, 3))
+	{
+	case 0:
+		frame.push_back(Change { card, DirtyRect(0, 0, width, BorderWidth) });
+		frame.push_back(Change { card, DirtyRect(0, height - BorderWidth, width, height) });
+		frame.push_back(Change { card, DirtyRect(0, BorderWidth, BorderWidth, height - BorderWidth) });
+		frame.push_back(Change { card, DirtyRect(width - BorderWidth, BorderWidth, width, height - BorderWidth) });
+		break;
+
+	case 1:
+		frame.push_back(Change { card, DirtyRect(width - BadgeSize, 0, width, BadgeSize) });
+		break;
+
+	default:
+		frame.push_back(Change { card, letter });
+		break;
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	Board board(Geometry);
+	Xoshiro256 generator(2025);
+
+	board.Deal(CardAlphabet::Latin(), generator);
+
+	PixelBuffer const background = CreateBackground(static_cast<unsigned>(Geometry.Width()), static_cast<unsigned>(Geometry.Height()));
+
+	// Parts match the whole at 96 DPI, where backs are copied, and at 144,
+	// where they are scaled
+	for (float const dpi : { 96.0f, 144.0f })
+	{
+		board.Arrange(dpi, dpi);
+
+		SoftwareRenderer const renderer(dpi, dpi, Geometry.CardWidth, Geometry.CardHeight, FontSize, background.View());
+
+		unsigned const width = renderer.Width();
+		unsigned const height = renderer.Height();
+
+		PixelBuffer whole(width, height);
+		PixelBuffer parts(width, height);
+		Xoshiro256 rects(7);
+
+		for (unsigned index = 0; index != 16; ++index)
+		{
+			Card const & card = board[index * 31 % board.CardCount()];
+			bool const front = index % 2 == 0;
+
+			auto const draw = [&](PixelView const & target, DirtyRect const & part)
+			{
+				if (front)
+				{
+					renderer.DrawCardFront(target, card.Value, part);
+				}
+				else
+				{
+					renderer.DrawCardBack(target, card.OffsetX, card.OffsetY, part);
+				}
+			};
+
+			if (front)
+			{
+				renderer.DrawCardFront(whole.View(), card.Value);
+			}
+			else
+			{
+				renderer.DrawCardBack(whole.View(), card.OffsetX, card.OffsetY);
+			}
+
+			// One random part, then the rest of the card in bands
+			Clear(parts.View(), 0xDEADBEEFu);
+
+			DirtyRect const part = RandomRect(rects, width, height);
+			draw(parts.View(), part);
+
+			bool outsideUntouched = true;
+
+			for (unsigned y = 0; y != height; ++y)
+			{
+				for (unsigned x = 0; x != width; ++x)
+				{
+					bool const inside = x >= part.Left && x < part.Right && y >= part.Top && y < part.Bottom;
+					uint32_t const pixel = parts.View().Row(y)[x];
+
+					if (inside ? pixel != whole.View().Row(y)[x] : pixel != 0xDEADBEEFu) outsideUntouched = false;
+				}
+			}
+
+			Check(outsideUntouched, "part drawn as in the whole and nothing outside it");
+
+			for (unsigned top = 0; top < height; top += 37)
+			{
+				draw(parts.View(), DirtyRect(0, top, width, std::min(top + 37, height)));
+			}
+
+			Check(SameView(parts.View(), whole.View()), "card drawn in parts same as whole");
+		}
+	}
+
+	// A region covers every rectangle added, in at most MaxRects
+	{
+		Xoshiro256 rects(11);
+
+		for (unsigned round = 0; round != 1000; ++round)
+		{
+			DirtyRegion region;
+			std::vector<DirtyRect> added;
+
+			for (unsigned count = 1 + RandomBelow(rects, 12); count; --count)
+			{
+				added.push_back(RandomRect(rects, 150, 210));
+				region.Add(added.back());
+			}
+
+			Check(region.m_rects.size() <= DirtyRegion::MaxRects, "region within its rectangles");
+
+			for (DirtyRect const & rect : added)
+			{
+				Check(std::any_of(region.m_rects.begin(), region.m_rects.end(), [&](DirtyRect const & covering)
+				{
+					return covering.Contains(rect);
+				}), "region covers what was added");
+			}
+		}
+
+		DirtyRegion region;
+		region.Add(DirtyRect(0, 0, 10, 10));
+		region.Add(DirtyRect(2, 2, 8, 8));
+		region.Add(DirtyRect(10, 0, 20, 10));
+
+		Check(region.m_rects.size() == 1 && region.Area() == 200, "contained and adjacent rectangles merged");
+	}
+
+	// A draw that throws does not leave its frame behind for the next one
+	{
+		FrameDamage damage;
+		damage.Add(0, 150, 210, DirtyRect(0, 0, 10, 10));
+		damage.Add(1, 150, 210, DirtyRect(0, 0, 10, 10));
+
+		bool thrown = false;
+
+		try
+		{
+			damage.Flush([](unsigned, DirtyRect const &)
+			{
+				throw std::runtime_error("draw failed");
+			});
+		}
+		catch (std::runtime_error const &)
+		{
+			thrown = true;
+		}
+
+		Check(thrown && damage.Empty() && damage.m_index.empty(), "frame dropped when a draw throws");
+
+		damage.Add(1, 150, 210, DirtyRect(0, 0, 10, 10));
+
+		Check(damage.m_surfaces.size() == 1 && damage.m_index.at(1) == 0, "next frame starts empty");
+	}
+
+	// The frames, at 96 DPI, on every card surface of the board, with the
+	// glyphs cached as the sample caches them
+	board.Arrange(96.0f, 96.0f);
+
+	GlyphCache glyphs;
+	SoftwareRenderer const renderer(96.0f, 96.0f, Geometry.CardWidth, Geometry.CardHeight, FontSize, background.View(), &glyphs);
+
+	unsigned const width = renderer.Width();
+	unsigned const height = renderer.Height();
+	unsigned const count = board.CardCount();
+
+	std::vector<PixelBuffer> surfaces;
+	std::vector<DirtyRect> letters;
+	surfaces.reserve(count);
+
+	for (unsigned index = 0; index != count; ++index)
+	{
+		CoverageMask const glyph = renderer.RasterizeGlyph(board[index].Value);
+
+		letters.push_back(DirtyRect(static_cast<unsigned>(glyph.Left),
+			static_cast<unsigned>(glyph.Top),
+			static_cast<unsigned>(glyph.Left) + glyph.Width,
+			static_cast<unsigned>(glyph.Top) + glyph.Height));
+
+		surfaces.emplace_back(width, height);
+	}
+
+	// Every other card face up
+	auto const drawCard = [&](unsigned const index, DirtyRect const & part)
+	{
+		Card const & card = board[index];
+
+		if (index % 2 == 0)
+		{
+			renderer.DrawCardFront(surfaces[index].View(), card.Value, part);
+		}
+		else
+		{
+			renderer.DrawCardBack(surfaces[index].View(), card.OffsetX, card.OffsetY, part);
+		}
+	};
+
+	auto const drawWhole = [&](unsigned const index)
+	{
+		Card const & card = board[index];
+
+		if (index % 2 == 0)
+		{
+			renderer.DrawCardFront(surfaces[index].View(), card.Value);
+		}
+		else
+		{
+			renderer.DrawCardBack(surfaces[index].View(), card.OffsetX, card.OffsetY);
+		}
+	};
+
+	std::vector<std::vector<Change>> frames(FrameCount);
+
+	for (std::vector<Change> & frame : frames)
+	{
+		for (unsigned change = 0; change != ChangesPerFrame; ++change)
+		{
+			unsigned const card = RandomBelow(generator, count);
+
+			AddChange(generator, card, width, height, letters[card], frame);
+		}
+	}
+
+	// The whole redraw draws each changed card once a frame
+	std::vector<std::vector<unsigned>> changedCards(FrameCount);
+	uint64_t wholePixels = 0;
+
+	for (unsigned frame = 0; frame != FrameCount; ++frame)
+	{
+		for (Change const & change : frames[frame])
+		{
+			changedCards[frame].push_back(change.Card);
+		}
+
+		std::sort(changedCards[frame].begin(), changedCards[frame].end());
+		changedCards[frame].erase(std::unique(changedCards[frame].begin(), changedCards[frame].end()), changedCards[frame].end());
+
+		wholePixels += static_cast<uint64_t>(changedCards[frame].size()) * width * height;
+	}
+
+	FrameDamage damage;
+
+	auto const flushFrame = [&](std::vector<Change> const & frame)
+	{
+		for (Change const & change : frame)
+		{
+			damage.Add(change.Card, width, height, change.Rect);
+		}
+
+		return damage.Flush([&](unsigned const card, DirtyRect const & part)
+		{
+			drawCard(card, part);
+		});
+	};
+
+	// Both ways leave the same pixels
+	for (unsigned index = 0; index != count; ++index)
+	{
+		drawWhole(index);
+	}
+
+	std::vector<PixelBuffer> reference = surfaces;
+
+	for (std::vector<Change> const & frame : frames)
+	{
+		flushFrame(frame);
+	}
+
+	bool same = true;
+
+	for (unsigned index = 0; index != count; ++index)
+	{
+		same = same && SameView(surfaces[index].View(), reference[index].View());
+	}
+
+	Check(same, "dirty rectangle frames same as whole redraws");
+
+	DamageCounters const counters = damage.m_counters;
+
+	Check(counters.Frames == FrameCount && counters.WholePixels == wholePixels, "counters cover every frame");
+
+	Report("  cards", count, "");
+	Report("  changes per frame", ChangesPerFrame, "");
+	Report("  cards changed per frame", static_cast<double>(wholePixels) / FrameCount / (width * height), "");
+	Report("  rectangles drawn per frame", static_cast<double>(counters.Draws) / counters.Frames, "");
+	Report("  pixels per frame whole cards", static_cast<double>(wholePixels) / FrameCount, "");
+	Report("  pixels per frame dirty rects", counters.PixelsPerFrame(), "");
+	Report("  peak pixels per frame dirty rects", static_cast<double>(counters.PeakFramePixels), "");
+	Report("  dirty rect pixels of whole cards", counters.DrawnShare() * 100.0, "%");
+
+	unsigned next = 0;
+
+	Run("Frame of small changes whole cards", ChangesPerFrame, [&]
+	{
+		std::vector<unsigned> const & cards = changedCards[next++ % FrameCount];
+
+		for (unsigned const card : cards)
+		{
+			drawWhole(card);
+		}
+
+		Consume(surfaces[cards.front()].Pixels[0]);
+	});
+
+	next = 0;
+
+	Run("Frame of small changes dirty rects", ChangesPerFrame, [&]
+	{
+		std::vector<Change> const & frame = frames[next++ % FrameCount];
+
+		Consume(flushFrame(frame));
+	});
+
+	std::vector<Change> const & frame = frames[0];
+
+	Run("Dirty rects of a frame merged", static_cast<double>(frame.size()), [&]
+	{
+		for (Change const & change : frame)
+		{
+			damage.Add(change.Card, width, height, change.Rect);
+		}
+
+		Consume(damage.Flush([](unsigned, DirtyRect const &) {}));
+	});
+}
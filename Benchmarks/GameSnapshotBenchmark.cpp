@@ -0,0 +1,393 @@
+#include "Benchmark.h"
+#include "../GameSnapshot.h"
+#include "../Metrics.h"
+#include <string>
+#include <unordered_map>
+
+// Saving and restoring the game. Checks that a board and a store come back
+// from a snapshot as they were and write the same bytes, that a restore
+// plays the log over the snapshot, skipping a record torn by a crash and
+// records a newer snapshot already has, that a damaged snapshot is refused
+// and that the turns in flight carry on. Then reports the throughput of
+// saving and of restoring a board of a million cards, from memory and from
+// a mapped file, and of appending to the log.
+
+static BoardGeometry const SampleGeometry = SampleBoard::Geometry(3, 6);
+static BoardGeometry const LargeGeometry = SampleBoard::Geometry(1000, 1000);
+
+static char const SnapshotPath[] = "GameSnapshotBenchmark.state";
+static char const LogPath[] = "GameSnapshotBenchmark.state.log";
+
+static bool SameBoard(Board const & a, Board const & b)
+{
+	for (unsigned index = 0; index != a.CardCount(); ++index)
+	{
+		if (a[index].Value != b[index].Value || a[index].Status != b[index].Status) return false;
+	}
+
+	return a.m_firstCard == b.m_firstCard;
+}
+
+// Matches about half the pairs, picked at random, and selects a card
+static void PlayHalf(Board & board, Xoshiro256 & generator)
+{
+	std::unordered_map<wchar_t, unsigned> waiting;
+
+	for (unsigned index = 0; index != board.CardCount(); ++index)
+	{
+		wchar_t const value = board[index].Value;
+		auto partner = waiting.find(CardAlphabet::Partner(value));
+
+		if (partner == waiting.end()) partner = waiting.find(static_cast<wchar_t>(value - (L'a' - L'A')));
+
+		if (partner != waiting.end() && RandomBelow(generator, 2) == 0)
+		{
+			board[partner->second].Status = CardStatus::Matched;
+			board[index].Status = CardStatus::Matched;
+			waiting.erase(partner);
+		}
+		else if (waiting.find(value) == waiting.end())
+		{
+			waiting.emplace(value, index);
+		}
+	}
+
+	board.Select(waiting.begin()->second);
+}
+
+static std::vector<uint8_t> ReadAll(char const * path)
+{
+	MappedFile file;
+	Check(file.Open(path), "file mapped");
+
+	return std::vector<uint8_t>(file.Data(), file.Data() + file.Size());
+}
+
+static void WriteAll(char const * path, std::vector<uint8_t> const & data)
+{
+	FILE * const file = OpenFile(path, true);
+	Check(file && data.size() == fwrite(data.data(), 1, data.size(), file) && 0 == fclose(file), "file written");
+}
+
+// Plays clicks on the sample's board, logging each as the sample does
+static void Play(Board & board, GameSaveFile & save, Xoshiro256 & generator, unsigned const clicks)
+{
+	for (unsigned click = 0; click != clicks; ++click)
+	{
+		unsigned const card = RandomBelow(generator, board.CardCount());
+
+		Check(save.Append(GameRecordKind::Select, card), "record appended");
+		board.Select(card);
+	}
+}
+
+static void CheckSaveFile()
+{
+	Board board(SampleGeometry);
+	Xoshiro256 generator(11);
+	GameProgress progress;
+	progress.Seed = 5;
+	progress.Games = 1;
+
+	Xoshiro256 dealer(progress.Seed);
+	board.Deal(CardAlphabet::Latin(), dealer);
+
+	GameSaveFile save(SnapshotPath, LogPath);
+	Check(save.Snapshot(board, progress), "snapshot written");
+
+	std::vector<uint8_t> const dealt = ReadAll(SnapshotPath);
+
+	Play(board, save, generator, 10);
+
+	// A new game and more clicks, all in the log
+	progress.Seed = NextGameSeed(progress.Seed);
+	++progress.Games;
+
+	Xoshiro256 nextDealer(progress.Seed);
+	board.Deal(CardAlphabet::Latin(), nextDealer);
+	Check(save.Append(GameRecordKind::NewGame, progress.Seed), "record appended");
+
+	Play(board, save, generator, 12);
+
+	Board const beforeLast = board;
+	Play(board, save, generator, 1);
+
+	std::vector<uint8_t> const log = ReadAll(LogPath);
+	save.CloseLog();
+
+	Board restored(SampleGeometry);
+	GameProgress restoredProgress;
+	GameSaveFile reopened(SnapshotPath, LogPath);
+
+	Check(reopened.Restore(CardAlphabet::Latin(), restored, restoredProgress), "game restored");
+	Check(SameBoard(board, restored), "snapshot and log restored");
+	Check(restoredProgress.Seed == progress.Seed && restoredProgress.Games == progress.Games, "seed and games restored");
+
+	// The restore wrote a snapshot with everything in it; the old log is stale
+	reopened.CloseLog();
+	WriteAll(LogPath, log);
+
+	Board again(SampleGeometry);
+	GameSaveFile stale(SnapshotPath, LogPath);
+
+	Check(stale.Restore(CardAlphabet::Latin(), again, restoredProgress) && SameBoard(board, again), "stale records skipped");
+
+	// A crash in the middle of the last record
+	stale.CloseLog();
+	WriteAll(SnapshotPath, dealt);
+	WriteAll(LogPath, std::vector<uint8_t>(log.begin(), log.end() - 5));
+
+	Board torn(SampleGeometry);
+	GameSaveFile tornSave(SnapshotPath, LogPath);
+
+	Check(tornSave.Restore(CardAlphabet::Latin(), torn, restoredProgress) && SameBoard(beforeLast, torn), "torn record dropped");
+
+	tornSave.CloseLog();
+
+	// As many cards, in other rows and columns
+	Board transposed(SampleBoard::Geometry(SampleGeometry.Columns, SampleGeometry.Rows));
+	Board const untouched = transposed;
+	GameSaveFile otherSize(SnapshotPath, LogPath);
+
+	Check(!otherSize.Restore(CardAlphabet::Latin(), transposed, restoredProgress) && SameBoard(untouched, transposed), "other rows and columns refused");
+	RemoveFile(SnapshotPath);
+	RemoveFile(LogPath);
+
+	Board missing(SampleGeometry);
+	GameSaveFile none(SnapshotPath, LogPath);
+
+	Check(!none.Restore(CardAlphabet::Latin(), missing, restoredProgress), "no snapshot, no restore");
+}
+
+static void CheckDamage(std::vector<uint8_t> const & data)
+{
+	GameSnapshotView view;
+	Check(view.Open(data.data(), data.size()), "snapshot opened");
+
+	std::vector<uint8_t> damaged = data;
+	damaged[0] ^= 1;
+	Check(!view.Open(damaged.data(), damaged.size()), "wrong signature refused");
+
+	damaged = data;
+	damaged[4] += 1;
+	Check(!view.Open(damaged.data(), damaged.size()), "other version refused");
+
+	Check(!view.Open(data.data(), data.size() - 8), "truncated refused");
+}
+
+static void CheckAnimations()
+{
+	Board board(SampleGeometry);
+	Xoshiro256 dealer(3);
+	board.Deal(CardAlphabet::Latin(), dealer);
+
+	Animator animator;
+
+	for (unsigned index = 0; index != board.CardCount(); ++index)
+	{
+		animator.CreateVariable(0.0);
+	}
+
+	board.Select(0);
+
+	Storyboard storyboard;
+	storyboard.AddTransition(0, CreateFlipTransition(FlipDuration, FaceUpAngle));
+	animator.Schedule(storyboard, 10.0);
+	animator.Update(10.25);
+
+	GameProgress progress;
+	progress.Animations = CollectAnimations(animator);
+
+	Check(progress.Animations.size() == 1 && progress.Animations[0].Card == 0, "turn in flight collected");
+
+	std::vector<uint8_t> data;
+	ExportGameSnapshot(board, progress, 0, data);
+
+	GameSnapshotView view;
+	Check(view.Open(data.data(), data.size()), "snapshot opened");
+
+	GameAnimation const & saved = view.Animations[0];
+
+	Check(saved.Angle == animator.Value(0) &&
+		saved.Final == static_cast<float>(FaceUpAngle) &&
+		std::abs(saved.Remaining - 0.75f) < 1e-4f, "turn saved");
+
+	// Resumed after a restart, some time later
+	Animator resumed;
+
+	for (unsigned index = 0; index != board.CardCount(); ++index)
+	{
+		resumed.CreateVariable(0.0);
+	}
+
+	std::vector<GameAnimation> const animations(view.Animations, view.Animations + view.Header->Animations);
+	RestoreAnimations(board, animations, resumed, 500.0);
+
+	Check(resumed.Value(0) == saved.Angle && resumed.IsAnimating(0), "turn resumed");
+
+	resumed.Update(500.0 + saved.Remaining);
+	Check(resumed.Value(0) == static_cast<float>(FaceUpAngle) && !resumed.IsAnimating(0), "turn finished");
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	CheckSaveFile();
+	CheckAnimations();
+
+	Board board(LargeGeometry);
+	Xoshiro256 generator(2024);
+	GameProgress progress;
+	progress.Seed = 2024;
+	progress.Games = 1;
+
+	board.Deal(CardAlphabet::Extended(), generator);
+	PlayHalf(board, generator);
+
+	CardStore store(LargeGeometry);
+	store.Load(board);
+
+	unsigned const count = board.CardCount();
+
+	std::vector<uint8_t> boardData;
+	std::vector<uint8_t> storeData;
+
+	ExportGameSnapshot(board, progress, 0, boardData);
+	ExportGameSnapshot(store, progress, 0, storeData);
+
+	Check(boardData == storeData, "board and store write the same snapshot");
+	CheckDamage(boardData);
+
+	GameSnapshotView view;
+	Check(view.Open(boardData.data(), boardData.size()), "snapshot opened");
+
+	Board restored(LargeGeometry);
+	RestoreGameSnapshot(view, restored);
+
+	CardStore restoredStore(LargeGeometry);
+	RestoreGameSnapshot(view, restoredStore);
+
+	Board fromStore(LargeGeometry);
+	restoredStore.Store(fromStore);
+
+	Check(SameBoard(board, restored) && SameBoard(board, fromStore), "board restored");
+
+	GameSaveFile save(SnapshotPath, LogPath);
+	Check(save.Snapshot(board, progress), "snapshot written");
+
+	double const megabytes = boardData.size() / 1e6;
+
+	Report("  snapshot bytes per card", static_cast<double>(boardData.size()) / count, "B");
+	Report("  snapshot MB", megabytes, "MB");
+
+	double const exportBoard = Run("Export snapshot Board 1000x1000", count, [&]
+	{
+		ExportGameSnapshot(board, progress, 0, boardData);
+		Consume(boardData.front());
+	});
+
+	double const exportStore = Run("Export snapshot CardStore 1000x1000", count, [&]
+	{
+		ExportGameSnapshot(store, progress, 0, storeData);
+		Consume(storeData.front());
+	});
+
+	double const saveFile = Run("Save snapshot file 1000x1000", count, [&]
+	{
+		Consume(save.Snapshot(store, progress));
+	});
+
+	Run("Map and open snapshot 1000x1000", 1, [&]
+	{
+		MappedFile file;
+		GameSnapshotView mapped;
+
+		Consume(file.Open(SnapshotPath) && mapped.Open(file.Data(), file.Size()));
+	});
+
+	MappedFile file;
+	GameSnapshotView mapped;
+	Check(file.Open(SnapshotPath) && mapped.Open(file.Data(), file.Size()), "snapshot mapped");
+
+	double const restoreBoard = Run("Restore Board from mapped snapshot 1000x1000", count, [&]
+	{
+		RestoreGameSnapshot(mapped, restored);
+		Consume(restored.m_firstCard);
+	});
+
+	double const restoreStore = Run("Restore CardStore from mapped snapshot 1000x1000", count, [&]
+	{
+		RestoreGameSnapshot(mapped, restoredStore);
+		Consume(restoredStore.m_firstCard);
+	});
+
+	file.Close();
+
+	// Each per item time is for one card, so the snapshot's bytes over the
+	// time for all of them
+	auto const rate = [&](double const perCard)
+	{
+		return megabytes / (perCard * count * 1e-9);
+	};
+
+	Report("  export Board", rate(exportBoard), "MB/s");
+	Report("  export CardStore", rate(exportStore), "MB/s");
+	Report("  save file", rate(saveFile), "MB/s");
+	Report("  restore Board mapped", rate(restoreBoard), "MB/s");
+	Report("  restore CardStore mapped", rate(restoreStore), "MB/s");
+
+	Check(save.Snapshot(board, progress), "snapshot written");
+
+	unsigned card = 0;
+
+	Run("Append log record", 1, [&]
+	{
+		card = (card + 1) % count;
+		Consume(save.Append(GameRecordKind::Select, card));
+	});
+
+	Check(save.Snapshot(board, progress), "snapshot written");
+
+	for (unsigned record = 0; record != GameSaveFile::DefaultSnapshotRecords; ++record)
+	{
+		unsigned const selected = RandomBelow(generator, count);
+
+		save.Append(GameRecordKind::Select, selected);
+		board.Select(selected);
+	}
+
+	save.CloseLog();
+
+	std::vector<uint8_t> const log = ReadAll(LogPath);
+	GameProgress restartedProgress;
+
+	// Replaying the log alone, from memory
+	uint32_t const before = reinterpret_cast<GameRecord const *>(log.data() + sizeof(GameLogHeader))->Sequence - 1;
+
+	Run("Replay full log 1000x1000", GameSaveFile::DefaultSnapshotRecords, [&]
+	{
+		ReadGameLog(log.data(), log.size(), before, [&](GameRecord const & record)
+		{
+			return ApplyGameRecord(record, CardAlphabet::Extended(), restored, restartedProgress);
+		});
+
+		Consume(restored.m_firstCard);
+	});
+
+	// A restart maps the snapshot, replays the log and saves both again
+	Board restarted(LargeGeometry);
+	GameSaveFile restart(SnapshotPath, LogPath);
+
+	Stopwatch const stopwatch;
+	bool const carriedOn = restart.Restore(CardAlphabet::Extended(), restarted, restartedProgress);
+	double const restartSeconds = stopwatch.ElapsedSeconds();
+
+	Check(carriedOn && SameBoard(board, restarted), "restored after restart");
+
+	Report("  restart with a full log", restartSeconds * 1000.0, "ms");
+
+	restart.CloseLog();
+	RemoveFile(SnapshotPath);
+	RemoveFile(LogPath);
+}
@@ -0,0 +1,200 @@
+#include "Benchmark.h"
+#include "../Board.h"
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+// Compares the compile time layout tables with the run time ones and with the
+// formulas the board used before it had tables. Every offset, the board size
+// and every hit test must come out bit for bit the same at scale factors from
+// 100% to 400%; then arranging and hit testing are timed for each variant.
+
+// The sample's own board, SampleBoard, and two larger ones with its cards
+struct DeckBoard
+{
+	static constexpr BoardGeometry Geometry() { return SampleBoard::Geometry(4, 13); }
+};
+
+struct LargeBoard
+{
+	static constexpr BoardGeometry Geometry() { return SampleBoard::Geometry(20, 26); }
+};
+
+// The sample's table is generated by the compiler
+typedef StaticBoardLayout<SampleBoard> SampleLayout;
+
+static_assert(SampleLayout::Table.Left[0] == 15.0f && SampleLayout::Table.Left[5] == 840.0f, "column offsets");
+static_assert(SampleLayout::Table.Top[0] == 15.0f && SampleLayout::Table.Top[2] == 465.0f, "row offsets");
+static_assert(SampleLayout().Width() == 1005.0f && SampleLayout().Height() == 690.0f, "board size");
+
+// Read at run time, as the window's DPI is, so that the timed loops cannot
+// be folded into constants
+static volatile float TimedDpi = 144.0f;
+
+static bool Same(float const a, float const b)
+{
+	return 0 == memcmp(&a, &b, sizeof(float));
+}
+
+// Board::Arrange before the tables, one layout conversion per card
+static void FormulaArrange(Board & board, float const dpiX, float const dpiY)
+{
+	BoardGeometry const & geometry = board.m_geometry;
+	PhysicalLayout const layout(geometry, dpiX, dpiY);
+
+	for (unsigned row = 0; row != geometry.Rows; ++row)
+		for (unsigned column = 0; column != geometry.Columns; ++column)
+		{
+			Card & card = board[row * geometry.Columns + column];
+
+			card.OffsetX = layout.CardLeft(column);
+			card.OffsetY = layout.CardTop(row);
+		}
+}
+
+template <typename Table>
+static void CheckTable(Table const & table, BoardGeometry const & geometry)
+{
+	Check(table.Rows() == geometry.Rows && table.Columns() == geometry.Columns, "table size");
+	Check(Same(table.Width(), geometry.Width()) && Same(table.Height(), geometry.Height()), "board size matches the formula");
+	Check(Same(table.PitchX(), geometry.CardWidth + geometry.Margin) && Same(table.PitchY(), geometry.CardHeight + geometry.Margin), "pitch matches the formula");
+
+	for (unsigned column = 0; column != geometry.Columns; ++column)
+	{
+		Check(Same(table.CardLeft(column), geometry.CardLeft(column)), "column offset matches the formula");
+	}
+
+	for (unsigned row = 0; row != geometry.Rows; ++row)
+	{
+		Check(Same(table.CardTop(row), geometry.CardTop(row)), "row offset matches the formula");
+	}
+}
+
+template <typename Policy>
+static void BenchmarkBoard()
+{
+	StaticBoardLayout<Policy> const fixed;
+	BoardGeometry const geometry = Policy::Geometry();
+	BoardLayout const runtime(geometry);
+
+	CheckTable(fixed, geometry);
+	CheckTable(runtime, geometry);
+
+	Board formula(geometry);
+	Board board(geometry);
+	std::mt19937 generator(14);
+	board.Shuffle(generator);
+
+	std::string const size = std::to_string(geometry.Rows) + "x" + std::to_string(geometry.Columns);
+	double const cards = geometry.CardCount();
+
+	for (unsigned const percent : { 100u, 125u, 150u, 175u, 200u, 250u, 300u, 400u })
+	{
+		float const dpi = 96.0f * percent / 100.0f;
+
+		FormulaArrange(formula, dpi, dpi);
+		board.Arrange(fixed, dpi, dpi);
+
+		for (unsigned index = 0; index != board.CardCount(); ++index)
+		{
+			Check(Same(board[index].OffsetX, formula[index].OffsetX) && Same(board[index].OffsetY, formula[index].OffsetY), "static offsets match the formula");
+		}
+
+		board.Arrange(runtime, dpi, dpi);
+
+		for (unsigned index = 0; index != board.CardCount(); ++index)
+		{
+			Check(Same(board[index].OffsetX, formula[index].OffsetX) && Same(board[index].OffsetY, formula[index].OffsetY), "run time offsets match the formula");
+		}
+
+		PhysicalLayout const layout(geometry, dpi, dpi);
+		std::uniform_real_distribution<float> randomX(0.0f, static_cast<float>(layout.ClientWidth()));
+		std::uniform_real_distribution<float> randomY(0.0f, static_cast<float>(layout.ClientHeight()));
+
+		for (unsigned i = 0; i != 10000; ++i)
+		{
+			float const x = randomX(generator);
+			float const y = randomY(generator);
+
+			Check(board.CardAtPoint(fixed, x, y, dpi, dpi) == board.CardAtPoint(runtime, x, y, dpi, dpi), "static and run time hit tests agree");
+		}
+
+		for (unsigned index = 0; index != board.CardCount(); ++index)
+		{
+			float const x = board[index].OffsetX + layout.CardWidth() / 2.0f;
+			float const y = board[index].OffsetY + layout.CardHeight() / 2.0f;
+
+			Check(board.CardAtPoint(fixed, x, y, dpi, dpi) == index, "card hit at its center");
+		}
+	}
+
+	float const dpi = TimedDpi;
+	PhysicalLayout const layout(geometry, dpi, dpi);
+	std::vector<float> points;
+	std::uniform_real_distribution<float> randomX(0.0f, static_cast<float>(layout.ClientWidth()));
+	std::uniform_real_distribution<float> randomY(0.0f, static_cast<float>(layout.ClientHeight()));
+
+	for (unsigned i = 0; i != 1024; ++i)
+	{
+		points.push_back(randomX(generator));
+		points.push_back(randomY(generator));
+	}
+
+	Run(("Arrange formula " + size).c_str(), cards, [&]
+	{
+		FormulaArrange(board, dpi, dpi);
+		Consume(board[0].OffsetX);
+	});
+
+	Run(("Arrange run time table " + size).c_str(), cards, [&]
+	{
+		board.Arrange(runtime, dpi, dpi);
+		Consume(board[0].OffsetX);
+	});
+
+	Run(("Arrange static table " + size).c_str(), cards, [&]
+	{
+		board.Arrange(fixed, dpi, dpi);
+		Consume(board[0].OffsetX);
+	});
+
+	Run(("Hit test run time table " + size).c_str(), points.size() / 2, [&]
+	{
+		unsigned hits = 0;
+
+		for (size_t i = 0; i != points.size(); i += 2)
+		{
+			hits += board.CardAtPoint(runtime, points[i], points[i + 1], dpi, dpi) != Board::NoCard;
+		}
+
+		Consume(hits);
+	});
+
+	Run(("Hit test static table " + size).c_str(), points.size() / 2, [&]
+	{
+		unsigned hits = 0;
+
+		for (size_t i = 0; i != points.size(); i += 2)
+		{
+			hits += board.CardAtPoint(fixed, points[i], points[i + 1], dpi, dpi) != Board::NoCard;
+		}
+
+		Consume(hits);
+	});
+
+	Run(("Build run time table " + size).c_str(), cards, [&]
+	{
+		BoardLayout const built(geometry);
+		Consume(built.Left.back());
+	});
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	BenchmarkBoard<SampleBoard>();
+	BenchmarkBoard<DeckBoard>();
+	BenchmarkBoard<LargeBoard>();
+}
@@ -0,0 +1,110 @@
+#include "Benchmark.h"
+#include "../Board.h"
+#include "../SoftwareRenderer.h"
+#include <random>
+#include <string>
+
+// Redraws every card front of a board with the software renderer: without a
+// glyph cache, with a cache that starts cold on every redraw and with a warm
+// cache. Reports the hit and miss counts of each.
+
+struct Size
+{
+	unsigned Rows;
+	unsigned Columns;
+};
+
+static void BenchmarkRedraw(Size const & size, float const dpi)
+{
+	BoardGeometry const geometry = SampleBoard::Geometry(size.Rows, size.Columns);
+	Board board(geometry);
+	std::mt19937 generator(9);
+	board.Shuffle(generator);
+
+	PixelBuffer const background(1, 1);
+	GlyphCache glyphs;
+
+	SoftwareRenderer const uncached(dpi, dpi, CardWidth, CardHeight, CardHeight / 2.0f, background.View());
+	SoftwareRenderer const cached(dpi, dpi, CardWidth, CardHeight, CardHeight / 2.0f, background.View(), &glyphs);
+
+	PixelBuffer target(uncached.Width(), uncached.Height());
+	PixelBuffer reference(uncached.Width(), uncached.Height());
+
+	// The cache must not change a single pixel
+	for (unsigned index = 0; index < board.CardCount(); index += 7)
+	{
+		uncached.DrawCardFront(reference.View(), board[index].Value);
+		cached.DrawCardFront(target.View(), board[index].Value);
+		Check(target.Pixels == reference.Pixels, "cached glyph draws the same pixels");
+	}
+
+	std::string const name = std::to_string(size.Rows) + "x" + std::to_string(size.Columns) +
+		" @" + std::to_string(static_cast<int>(dpi));
+
+	double const cards = board.CardCount();
+
+	Run(("Board fronts, no cache " + name).c_str(), cards, [&]
+	{
+		for (Card const & card : board)
+		{
+			uncached.DrawCardFront(target.View(), card.Value);
+		}
+
+		Consume(target.Pixels[0]);
+	});
+
+	glyphs.ResetCounters();
+	unsigned long long redraws = 0;
+
+	Run(("Board fronts, cold cache " + name).c_str(), cards, [&]
+	{
+		glyphs.Clear();
+
+		for (Card const & card : board)
+		{
+			cached.DrawCardFront(target.View(), card.Value);
+		}
+
+		++redraws;
+		Consume(target.Pixels[0]);
+	});
+
+	Report(("  cold hits per redraw " + name).c_str(), static_cast<double>(glyphs.m_hits) / redraws, "hits");
+	Report(("  cold misses per redraw " + name).c_str(), static_cast<double>(glyphs.m_misses) / redraws, "misses");
+
+	glyphs.ResetCounters();
+	redraws = 0;
+
+	Run(("Board fronts, warm cache " + name).c_str(), cards, [&]
+	{
+		for (Card const & card : board)
+		{
+			cached.DrawCardFront(target.View(), card.Value);
+		}
+
+		++redraws;
+		Consume(target.Pixels[0]);
+	});
+
+	Report(("  warm hits per redraw " + name).c_str(), static_cast<double>(glyphs.m_hits) / redraws, "hits");
+	Report(("  warm misses per redraw " + name).c_str(), static_cast<double>(glyphs.m_misses) / redraws, "misses");
+	Report(("  cache size " + name).c_str(), glyphs.Bytes() / 1024.0, "KiB");
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	Size const sizes[] =
+	{
+		{ 3, 6 },
+		{ 10, 10 },
+		{ 32, 32 },
+	};
+
+	for (float const dpi : { 96.0f, 192.0f })
+		for (Size const & size : sizes)
+		{
+			BenchmarkRedraw(size, dpi);
+		}
+}
@@ -0,0 +1,245 @@
+#include "Benchmark.h"
+#include "../Board.h"
+#include "../SpatialIndex.h"
+#include <random>
+#include <string>
+
+// Compares the original linear CardAtPoint scan with the grid computation in
+// Board::CardAtPoint and the general SpatialGrid at 18, 10k and 1M cards.
+// Before timing, all three are checked against each other on card centers,
+// card edges, margins and random points.
+
+struct Size
+{
+	unsigned Rows;
+	unsigned Columns;
+};
+
+// The scan SampleWindow::CardAtPoint used before the board was indexed
+static unsigned LinearCardAtPoint(Board const & board,
+	float const x,
+	float const y,
+	float const dpiX,
+	float const dpiY)
+{
+	float const width = LogicalToPhysical(CardWidth, dpiX);
+	float const height = LogicalToPhysical(CardHeight, dpiY);
+
+	for (unsigned i = 0; i != board.CardCount(); ++i)
+	{
+		if (board.CardContains(i, x, y, width, height)) return i;
+	}
+
+	return Board::NoCard;
+}
+
+static SpatialGrid BuildGrid(Board const & board, float const dpiX, float const dpiY)
+{
+	BoardGeometry const & geometry = board.m_geometry;
+
+	float const width = LogicalToPhysical(CardWidth, dpiX);
+	float const height = LogicalToPhysical(CardHeight, dpiY);
+
+	SpatialGrid grid(Bounds(0.0f,
+			0.0f,
+			LogicalToPhysical(geometry.Width(), dpiX),
+			LogicalToPhysical(geometry.Height(), dpiY)),
+		LogicalToPhysical(CardWidth + CardMargin, dpiX),
+		LogicalToPhysical(CardHeight + CardMargin, dpiY));
+
+	for (Card const & card : board)
+	{
+		grid.Insert(Bounds(card.OffsetX, card.OffsetY, card.OffsetX + width, card.OffsetY + height));
+	}
+
+	return grid;
+}
+
+static std::string Name(char const * what, unsigned const cards, float const dpi)
+{
+	return std::string(what) + " " + std::to_string(cards) + " cards @" + std::to_string(static_cast<int>(dpi));
+}
+
+static void Verify(Board const & board,
+	SpatialGrid const & grid,
+	float const dpi,
+	std::vector<float> const & randomPoints)
+{
+	float const width = LogicalToPhysical(CardWidth, dpi);
+	float const height = LogicalToPhysical(CardHeight, dpi);
+	float const margin = LogicalToPhysical(CardMargin, dpi);
+
+	auto const check = [&](float const x, float const y, unsigned const expected)
+	{
+		unsigned const linear = LinearCardAtPoint(board, x, y, dpi, dpi);
+
+		Check(linear == expected, "linear scan matches expectation");
+		Check(board.CardAtPoint(x, y, dpi, dpi) == expected, "grid hit-test matches linear scan");
+		Check(grid.Query(x, y) == expected, "spatial grid matches linear scan");
+	};
+
+	// Sample a bounded number of cards on big boards; the linear reference is slow.
+	unsigned const step = std::max(1u, board.CardCount() / 2000);
+
+	for (unsigned i = 0; i < board.CardCount(); i += step)
+	{
+		Card const & card = board[i];
+
+		float const left = card.OffsetX;
+		float const top = card.OffsetY;
+		float const right = left + width;
+		float const bottom = top + height;
+
+		check(left + width / 2, top + height / 2, i);
+
+		// Edges are exclusive
+		check(left, top + height / 2, Board::NoCard);
+		check(right, top + height / 2, Board::NoCard);
+		check(left + width / 2, top, Board::NoCard);
+		check(left + width / 2, bottom, Board::NoCard);
+
+		// Just inside each edge
+		check(std::nextafter(left, right), top + height / 2, i);
+		check(std::nextafter(right, left), top + height / 2, i);
+		check(left + width / 2, std::nextafter(top, bottom), i);
+		check(left + width / 2, std::nextafter(bottom, top), i);
+
+		// Margins to the left of, above and diagonally from the card
+		check(left - margin / 2, top + height / 2, Board::NoCard);
+		check(left + width / 2, top - margin / 2, Board::NoCard);
+		check(left - margin / 2, top - margin / 2, Board::NoCard);
+	}
+
+	// Outside the window
+	check(-1.0f, -1.0f, Board::NoCard);
+	check(1e9f, 1e9f, Board::NoCard);
+
+	for (size_t i = 0; i < randomPoints.size() && i < 4096; i += 2)
+	{
+		check(randomPoints[i], randomPoints[i + 1],
+			LinearCardAtPoint(board, randomPoints[i], randomPoints[i + 1], dpi, dpi));
+	}
+}
+
+static void BenchmarkHitTest(Size const & size, float const dpi)
+{
+	BoardGeometry const geometry = SampleBoard::Geometry(size.Rows, size.Columns);
+	Board board(geometry);
+	std::mt19937 generator(7);
+
+	board.Shuffle(generator);
+	board.Arrange(dpi, dpi);
+
+	SpatialGrid const grid = BuildGrid(board, dpi, dpi);
+
+	unsigned const queries = 4096;
+	std::vector<float> points(queries * 2);
+	std::uniform_real_distribution<float> x(0.0f, LogicalToPhysical(geometry.Width(), dpi));
+	std::uniform_real_distribution<float> y(0.0f, LogicalToPhysical(geometry.Height(), dpi));
+
+	for (unsigned i = 0; i != queries; ++i)
+	{
+		points[i * 2 + 0] = x(generator);
+		points[i * 2 + 1] = y(generator);
+	}
+
+	Verify(board, grid, dpi, points);
+
+	unsigned const cards = board.CardCount();
+	unsigned const linearQueries = cards > 100000 ? 16 : cards > 1000 ? 256 : queries;
+
+	Run(Name("Linear scan", cards, dpi).c_str(), linearQueries, [&]
+	{
+		for (unsigned i = 0; i != linearQueries; ++i)
+		{
+			Consume(LinearCardAtPoint(board, points[i * 2], points[i * 2 + 1], dpi, dpi));
+		}
+	});
+
+	Run(Name("Board grid", cards, dpi).c_str(), queries, [&]
+	{
+		for (unsigned i = 0; i != queries; ++i)
+		{
+			Consume(board.CardAtPoint(points[i * 2], points[i * 2 + 1], dpi, dpi));
+		}
+	});
+
+	Run(Name("SpatialGrid", cards, dpi).c_str(), queries, [&]
+	{
+		for (unsigned i = 0; i != queries; ++i)
+		{
+			Consume(grid.Query(points[i * 2], points[i * 2 + 1]));
+		}
+	});
+}
+
+static void BenchmarkMovedCards()
+{
+	// Cards scattered at random positions, as if mid-animation
+	unsigned const cards = 10000;
+	float const extent = 10000.0f;
+	std::mt19937 generator(11);
+	std::uniform_real_distribution<float> position(0.0f, extent - CardWidth);
+
+	std::vector<Bounds> bounds(cards);
+	SpatialGrid grid(Bounds(0.0f, 0.0f, extent, extent), CardWidth, CardHeight);
+
+	for (Bounds & item : bounds)
+	{
+		float const left = position(generator);
+		float const top = position(generator);
+		item = Bounds(left, top, left + CardWidth, top + CardHeight);
+		grid.Insert(item);
+	}
+
+	std::uniform_real_distribution<float> point(0.0f, extent);
+
+	for (unsigned i = 0; i != 4096; ++i)
+	{
+		float const x = point(generator);
+		float const y = point(generator);
+
+		unsigned expected = SpatialGrid::NoItem;
+
+		for (unsigned item = 0; item != cards; ++item)
+		{
+			if (bounds[item].Contains(x, y))
+			{
+				expected = item;
+				break;
+			}
+		}
+
+		Check(grid.Query(x, y) == expected, "spatial grid matches linear scan for moved cards");
+	}
+
+	unsigned item = 0;
+
+	Run("SpatialGrid update 10000 moved cards", 1, [&]
+	{
+		float const left = position(generator);
+		float const top = position(generator);
+		grid.Update(item, Bounds(left, top, left + CardWidth, top + CardHeight));
+		item = (item + 1) % cards;
+	});
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	Size const sizes[] =
+	{
+		{ 3, 6 },
+		{ 100, 100 },
+		{ 1000, 1000 },
+	};
+
+	for (float const dpi : { 96.0f, 144.0f })
+		for (Size const & size : sizes)
+		{
+			BenchmarkHitTest(size, dpi);
+		}
+
+	BenchmarkMovedCards();
+}
@@ -0,0 +1,191 @@
+#include "Benchmark.h"
+#include "../ImageDecoders.h"
+#include "../Layout.h"
+#include "../Metrics.h"
+#include <cstdio>
+#include <random>
+#include <string>
+
+// Decodes 4K and 8K JPEG and PNG backgrounds through StreamingImage. Reports
+// the time until the rows behind the first row of cards are ready, which is
+// what the first frame waits for, against the time to decode the whole image.
+// The test images are encoded at startup and deleted afterwards.
+
+struct Size
+{
+	char const * Name;
+	unsigned Width;
+	unsigned Height;
+};
+
+// Smooth gradients with a little noise, so that both codecs compress it
+// about as well as a photograph
+static std::vector<uint8_t> CreateRgb(unsigned const width, unsigned const height)
+{
+	std::vector<uint8_t> rgb(static_cast<size_t>(width) * height * 3);
+	std::mt19937 generator(8);
+	std::uniform_int_distribution<int> noise(-8, 8);
+
+	for (unsigned y = 0; y != height; ++y)
+		for (unsigned x = 0; x != width; ++x)
+		{
+			uint8_t * pixel = &rgb[(static_cast<size_t>(y) * width + x) * 3];
+
+			int const values[] =
+			{
+				static_cast<int>(x * 255 / width),
+				static_cast<int>(y * 255 / height),
+				static_cast<int>((x + y) * 127 / (width + height)) + 64
+			};
+
+			for (unsigned c = 0; c != 3; ++c)
+			{
+				pixel[c] = static_cast<uint8_t>(std::min(std::max(values[c] + noise(generator), 0), 255));
+			}
+		}
+
+	return rgb;
+}
+
+static void WriteJpeg(char const * path, std::vector<uint8_t> const & rgb, unsigned const width, unsigned const height)
+{
+	FileHandle file(fopen(path, "wb"));
+	Check(file != nullptr, "create JPEG file");
+
+	jpeg_compress_struct info = {};
+	jpeg_error_mgr error;
+	info.err = jpeg_std_error(&error);
+	jpeg_create_compress(&info);
+	jpeg_stdio_dest(&info, file.get());
+
+	info.image_width = width;
+	info.image_height = height;
+	info.input_components = 3;
+	info.in_color_space = JCS_RGB;
+	jpeg_set_defaults(&info);
+	jpeg_set_quality(&info, 90, true);
+	jpeg_start_compress(&info, true);
+
+	while (info.next_scanline != height)
+	{
+		JSAMPROW row = const_cast<JSAMPROW>(&rgb[static_cast<size_t>(info.next_scanline) * width * 3]);
+		jpeg_write_scanlines(&info, &row, 1);
+	}
+
+	jpeg_finish_compress(&info);
+	jpeg_destroy_compress(&info);
+}
+
+static void WritePng(char const * path, std::vector<uint8_t> const & rgb, unsigned const width, unsigned const height)
+{
+	FileHandle file(fopen(path, "wb"));
+	Check(file != nullptr, "create PNG file");
+
+	png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+	png_infop info = png_create_info_struct(png);
+	Check(png && info && !setjmp(png_jmpbuf(png)), "PNG encoder");
+
+	png_init_io(png, file.get());
+	png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGB,
+		PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+	png_write_info(png, info);
+
+	for (unsigned y = 0; y != height; ++y)
+	{
+		png_write_row(png, const_cast<png_bytep>(&rgb[static_cast<size_t>(y) * width * 3]));
+	}
+
+	png_write_end(png, nullptr);
+	png_destroy_write_struct(&png, &info);
+}
+
+// Decodes the file in a single ReadRows call, the reference for the strips
+static PixelBuffer DecodeWhole(char const * path)
+{
+	std::unique_ptr<ImageDecoder> decoder = OpenImageFile(path);
+	Check(decoder != nullptr, "open image");
+
+	PixelBuffer pixels(decoder->Width(), decoder->Height());
+	Check(decoder->ReadRows(pixels.View()), "decode image");
+
+	return pixels;
+}
+
+static void BenchmarkFile(char const * format, char const * path, Size const & size)
+{
+	std::string const name = std::string(format) + " " + size.Name;
+	double const megapixels = size.Width * static_cast<double>(size.Height) / 1e6;
+
+	// Rows a back on the first row of cards reads at 96 DPI, plus one for
+	// linear filtering
+	BoardGeometry const geometry(1, 1, CardMargin, CardHeight, CardHeight);
+	unsigned const firstRow = static_cast<unsigned>(geometry.CardTop(0) + geometry.CardHeight) + 1;
+
+	{
+		PixelBuffer const reference = DecodeWhole(path);
+
+		StreamingImage image(OpenImageFile(path));
+		Check(image.Wait(image.Height()), "streamed decode completes");
+		ConstPixelView const decoded = image.ReadyView();
+
+		for (unsigned y = 0; y != decoded.Height; ++y)
+		{
+			Check(0 == memcmp(decoded.Row(y), reference.View().Row(y), decoded.Width * sizeof(uint32_t)), "strips decode the same pixels");
+		}
+	}
+
+	DurationMetric first;
+	DurationMetric whole;
+
+	Run(("Time to first card row " + name).c_str(), 1.0, [&]
+	{
+		Stopwatch const stopwatch;
+
+		StreamingImage image(OpenImageFile(path));
+		Check(image.Wait(firstRow), "first card row decoded");
+
+		first.Record(stopwatch.ElapsedSeconds());
+	});
+
+	Run(("Decode whole image " + name).c_str(), megapixels, [&]
+	{
+		Stopwatch const stopwatch;
+
+		StreamingImage image(OpenImageFile(path));
+		Check(image.Wait(image.Height()), "image decoded");
+
+		whole.Record(stopwatch.ElapsedSeconds());
+	});
+
+	Report(("  first card row " + name).c_str(), first.Mean() * 1000.0, "ms");
+	Report(("  whole image " + name).c_str(), whole.Mean() * 1000.0, "ms");
+	Report(("  throughput " + name).c_str(), megapixels / whole.Mean(), "MP/s");
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	Size const sizes[] =
+	{
+		{ "4K", 3840, 2160 },
+		{ "8K", 7680, 4320 },
+	};
+
+	for (Size const & size : sizes)
+	{
+		std::vector<uint8_t> const rgb = CreateRgb(size.Width, size.Height);
+
+		std::string const jpeg = std::string("ImageBenchmark-") + size.Name + ".jpg";
+		std::string const png = std::string("ImageBenchmark-") + size.Name + ".png";
+
+		WriteJpeg(jpeg.c_str(), rgb, size.Width, size.Height);
+		WritePng(png.c_str(), rgb, size.Width, size.Height);
+
+		BenchmarkFile("JPEG", jpeg.c_str(), size);
+		BenchmarkFile("PNG", png.c_str(), size);
+
+		remove(jpeg.c_str());
+		remove(png.c_str());
+	}
+}
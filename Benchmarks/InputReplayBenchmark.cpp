@@ -0,0 +1,209 @@
+#include "Benchmark.h"
+#include "../InputReplay.h"
+#include <cstdio>
+#include <string>
+
+// The performance regression suite: plays recorded sessions through the
+// sample's game headless and reports the latency of every input event.
+// Scripts a session of games as a player would click them, checks that the
+// log survives the file and that replays at any speed end on the same
+// board, then replays it at the recorded pace, ten times faster and as fast
+// as possible. Logs the sample saved (SampleInput.log in the temp folder)
+// can be given on the command line and are replayed at full speed.
+//
+//   InputReplayBenchmark [--quick] [log...]
+
+static bool SameLog(InputLog const & a, InputLog const & b)
+{
+	if (a.Seed != b.Seed ||
+		a.Geometry.Rows != b.Geometry.Rows ||
+		a.Geometry.Columns != b.Geometry.Columns ||
+		a.Geometry.Margin != b.Geometry.Margin ||
+		a.Geometry.CardWidth != b.Geometry.CardWidth ||
+		a.Geometry.CardHeight != b.Geometry.CardHeight ||
+		a.DpiX != b.DpiX ||
+		a.DpiY != b.DpiY ||
+		a.Events.size() != b.Events.size()) return false;
+
+	for (size_t index = 0; index != a.Events.size(); ++index)
+	{
+		InputEvent const & left = a.Events[index];
+		InputEvent const & right = b.Events[index];
+
+		if (left.Time != right.Time || left.Kind != right.Kind || left.X != right.X || left.Y != right.Y) return false;
+	}
+
+	return true;
+}
+
+static void CheckLogFile(InputLog const & log)
+{
+	std::vector<uint8_t> data = ExportInputLog(log);
+	InputLog imported;
+
+	Check(ImportInputLog(data.data(), data.size(), imported) && SameLog(log, imported), "log round trip");
+	Check(!ImportInputLog(data.data(), data.size() - 1, imported), "truncated log refused");
+
+	std::string const path = "InputReplayBenchmark.log";
+
+	Check(WriteInputLog(path.c_str(), log), "log written");
+	Check(ReadInputLog(path.c_str(), imported) && SameLog(log, imported), "log read back");
+
+	remove(path.c_str());
+
+	Report("  log size", static_cast<double>(data.size()) / log.Events.size(), "bytes/event");
+
+	// A new game at time 0 takes the last four bytes, its kind first
+	InputLog single = log;
+	single.Events.assign(1, InputEvent { 0, InputKind::NewGame, 0.0f, 0.0f });
+
+	data = ExportInputLog(single);
+	data[data.size() - 4] = 9;
+
+	Check(!ImportInputLog(data.data(), data.size(), imported), "unknown event refused");
+}
+
+static bool SameBoard(Board const & a, Board const & b)
+{
+	for (unsigned index = 0; index != a.CardCount(); ++index)
+	{
+		if (a[index].Value != b[index].Value || a[index].Status != b[index].Status) return false;
+	}
+
+	return true;
+}
+
+static void ReportLatency(std::string const & name,
+	ReplayReport const & report)
+{
+	Report(("  p50 latency " + name).c_str(), report.Latency.Percentile(50.0) * 1e6, "us");
+	Report(("  p90 latency " + name).c_str(), report.Latency.Percentile(90.0) * 1e6, "us");
+	Report(("  p99 latency " + name).c_str(), report.Latency.Percentile(99.0) * 1e6, "us");
+	Report(("  max latency " + name).c_str(), report.Latency.Max() * 1e6, "us");
+	Report(("  p99 frame work " + name).c_str(), report.FrameWork.Percentile(99.0) * 1e6, "us");
+}
+
+// Replays the log at the options' speed and checks that it ends where a
+// replay at full speed does
+static ReplayReport ReplaySame(InputLog const & log,
+	ReplayOptions const & options)
+{
+	ReplayOptions full = options;
+	full.Speed = 0.0;
+
+	HeadlessGame timed(log);
+	HeadlessGame reference(log);
+
+	ReplayReport const report = ReplayInput(log, timed, options);
+	ReplayInput(log, reference, full);
+
+	Check(SameBoard(timed.m_board, reference.m_board) &&
+		timed.m_queue.m_commits == reference.m_queue.m_commits, "same frames at any speed");
+
+	return report;
+}
+
+static void BenchmarkSession(BoardGeometry const & geometry,
+	unsigned const games,
+	double const pacedSeconds)
+{
+	std::string const name = std::to_string(geometry.Rows) + "x" + std::to_string(geometry.Columns);
+
+	InputLog const log = ScriptInputSession(geometry, 2024, games);
+
+	CheckLogFile(log);
+
+	// Every game played out, the same at any speed
+	HeadlessGame fast(log);
+	ReplayOptions full;
+	full.Speed = 0.0;
+	ReplayReport const report = ReplayInput(log, fast, full);
+
+	unsigned matched = 0;
+
+	for (Card const & card : fast.m_board)
+	{
+		matched += card.Status == CardStatus::Matched;
+	}
+
+	Check(matched == geometry.CardCount(), "every card matched");
+	Check(fast.m_games == games, "every game dealt");
+
+	unsigned clicks = 0;
+
+	for (InputEvent const & event : log.Events)
+	{
+		clicks += InputKind::Click == event.Kind;
+	}
+
+	Check(report.Events == log.Events.size() && report.Clicks + report.Missed == clicks, "every event fed");
+	Check(report.Latency.Count() == report.Events - report.Missed, "a latency for every event shown");
+	Check(fast.m_queue.m_clicksApplied == report.Clicks, "every click applied");
+
+	HeadlessGame again(log);
+	ReplayInput(log, again, full);
+
+	Check(SameBoard(fast.m_board, again.m_board) &&
+		fast.m_compositor.Frames().size() == again.m_compositor.Frames().size(), "replay repeats");
+
+	// At the recorded pace and ten times faster, as much of the session as
+	// either plays in the wall time given
+	ReplayOptions paced;
+	paced.Until = pacedSeconds;
+
+	ReplayOptions faster;
+	faster.Speed = 10.0;
+	faster.Until = 10.0 * pacedSeconds;
+
+	ReplayReport const pacedReport = ReplaySame(log, paced);
+	ReplayReport const fasterReport = ReplaySame(log, faster);
+
+	Report(("  events " + name).c_str(), report.Events, "");
+	Report(("  log seconds " + name).c_str(), log.Seconds(), "s");
+	Report(("  replay seconds full speed " + name).c_str(), report.Seconds, "s");
+
+	ReportLatency("1x " + name, pacedReport);
+	ReportLatency("10x " + name, fasterReport);
+	ReportLatency("full speed " + name, report);
+
+	Run(("Replay session full speed " + name).c_str(), report.Events, [&]
+	{
+		HeadlessGame game(log);
+		Consume(ReplayInput(log, game, full).Frames);
+	});
+}
+
+static void ReplayFile(char const * path)
+{
+	InputLog log;
+
+	Check(ReadInputLog(path, log), "log file read");
+
+	HeadlessGame game(log);
+	ReplayOptions full;
+	full.Speed = 0.0;
+
+	ReplayReport const report = ReplayInput(log, game, full);
+
+	Report(("  events " + std::string(path)).c_str(), report.Events, "");
+	Report(("  games " + std::string(path)).c_str(), game.m_games, "");
+	ReportLatency(path, report);
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	bool const quick = BenchmarkMinimumSeconds < 0.25;
+
+	// The sample's board, and a larger one
+	BenchmarkSession(SampleBoard::Geometry(3, 6), 6, quick ? 1.0 : 10.0);
+	BenchmarkSession(SampleBoard::Geometry(8, 12), 2, quick ? 1.0 : 10.0);
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (argv[i][0] == '-') continue;
+
+		ReplayFile(argv[i]);
+	}
+}
@@ -0,0 +1,250 @@
+#include "Benchmark.h"
+#include "../Interaction.h"
+#include <cmath>
+#include <random>
+#include <string>
+
+// Scripted play through the interaction queue with a fake compositor that
+// counts the calls a frame makes. Checks that clicks arriving within one
+// frame produce one commit and the same board and curves as applying them
+// one at a time, then measures the cost per click at several input rates.
+
+static double const FrameSeconds = 1.0 / 60.0;
+
+struct FakeCompositor : FrameCompositor
+{
+	double m_time = 1000.0;
+	unsigned m_frameTimes = 0;
+	unsigned m_animations = 0;
+	unsigned m_animationObjects = 0;
+	unsigned m_commits = 0;
+	std::vector<bool> m_hasAnimation;
+	std::vector<AnimationCurve> m_curves;
+
+	explicit FakeCompositor(unsigned const cards) :
+		m_hasAnimation(cards, false),
+		m_curves(cards)
+	{}
+
+	double NextFrameTime() override
+	{
+		++m_frameTimes;
+		return m_time;
+	}
+
+	void AnimateAngle(unsigned const card, AnimationCurve const & curve) override
+	{
+		++m_animations;
+
+		if (!m_hasAnimation[card])
+		{
+			m_hasAnimation[card] = true;
+			++m_animationObjects;
+		}
+
+		m_curves[card] = curve;
+	}
+
+	void Commit() override
+	{
+		++m_commits;
+	}
+};
+
+struct Game
+{
+	Board m_board;
+	Animator m_animator;
+	InteractionQueue m_queue;
+
+	explicit Game(BoardGeometry const & geometry) :
+		m_board(geometry)
+	{
+		std::mt19937 generator(11);
+		m_board.Shuffle(generator);
+
+		for (unsigned i = 0; i != m_board.CardCount(); ++i)
+		{
+			m_animator.CreateVariable(0.0);
+		}
+	}
+};
+
+// Clicks that play the board to the end: a random card, sometimes a wrong
+// guess and then its match
+static std::vector<unsigned> Script(Board const & board)
+{
+	std::mt19937 generator(12);
+	std::vector<unsigned> order(board.CardCount());
+
+	for (unsigned i = 0; i != board.CardCount(); ++i)
+	{
+		order[i] = i;
+	}
+
+	std::shuffle(order.begin(), order.end(), generator);
+
+	std::vector<bool> done(board.CardCount(), false);
+	std::vector<unsigned> clicks;
+
+	for (unsigned const card : order)
+	{
+		if (done[card]) continue;
+
+		unsigned match = Board::NoCard;
+		unsigned wrong = Board::NoCard;
+
+		for (unsigned other = 0; other != board.CardCount(); ++other)
+		{
+			if (other == card || done[other]) continue;
+
+			if (Board::IsMatch(board[card].Value, board[other].Value))
+			{
+				if (match == Board::NoCard) match = other;
+			}
+			else if (wrong == Board::NoCard)
+			{
+				wrong = other;
+			}
+		}
+
+		if (wrong != Board::NoCard && generator() % 2)
+		{
+			clicks.push_back(card);
+			clicks.push_back(wrong);
+		}
+
+		clicks.push_back(card);
+		clicks.push_back(match);
+
+		done[card] = done[match] = true;
+	}
+
+	return clicks;
+}
+
+static void CheckQueue()
+{
+	BoardGeometry const geometry = SampleBoard::Geometry(4, 8);
+
+	Game batched(geometry);
+	Game single(geometry);
+
+	FakeCompositor batchedCompositor(geometry.CardCount());
+	FakeCompositor singleCompositor(geometry.CardCount());
+
+	Check(!batched.m_queue.Flush(batched.m_board, batched.m_animator, batchedCompositor), "nothing to commit");
+	Check(batchedCompositor.m_commits == 0, "no commit without input");
+
+	batched.m_queue.Invalidate();
+	batched.m_queue.Flush(batched.m_board, batched.m_animator, batchedCompositor);
+	Check(batchedCompositor.m_commits == 1 && batchedCompositor.m_animations == 0, "a redraw commits without animating");
+
+	std::vector<unsigned> const clicks = Script(batched.m_board);
+
+	// Ten clicks per frame, against one flush per click at the same time
+	for (size_t begin = 0; begin < clicks.size(); begin += 10)
+	{
+		size_t const end = std::min(begin + 10, clicks.size());
+		unsigned const commits = batchedCompositor.m_commits;
+
+		for (size_t i = begin; i != end; ++i)
+		{
+			batched.m_queue.Click(clicks[i]);
+
+			single.m_queue.Click(clicks[i]);
+			single.m_queue.Flush(single.m_board, single.m_animator, singleCompositor);
+		}
+
+		batched.m_queue.Flush(batched.m_board, batched.m_animator, batchedCompositor);
+
+		Check(batchedCompositor.m_commits == commits + 1, "one commit per frame");
+
+		for (unsigned card = 0; card != geometry.CardCount(); ++card)
+		{
+			Check(batched.m_board[card].Status == single.m_board[card].Status, "batched clicks give the same board");
+
+			AnimationCurve const & a = batchedCompositor.m_curves[card];
+			AnimationCurve const & b = singleCompositor.m_curves[card];
+
+			for (double offset = 0.0; offset < 3.0; offset += 0.1)
+			{
+				Check(std::fabs(a.Value(offset) - b.Value(offset)) < 1e-3, "batched clicks give the same curves");
+			}
+		}
+
+		batchedCompositor.m_time += FrameSeconds;
+		singleCompositor.m_time += FrameSeconds;
+	}
+
+	for (Card const & card : batched.m_board)
+	{
+		Check(card.Status == CardStatus::Matched, "script plays the board to the end");
+	}
+
+	Check(batchedCompositor.m_animationObjects <= geometry.CardCount(), "one animation object per card");
+	Check(batchedCompositor.m_frameTimes == batchedCompositor.m_commits - 1, "one frame time query per frame");
+}
+
+static void BenchmarkRate(unsigned const rows, unsigned const columns, unsigned const clicksPerFrame)
+{
+	BoardGeometry const geometry = SampleBoard::Geometry(rows, columns);
+
+	std::vector<unsigned> const clicks = Script(Game(geometry).m_board);
+
+	FakeCompositor compositor(geometry.CardCount());
+
+	std::string const name = std::to_string(rows) + "x" + std::to_string(columns) +
+		", " + std::to_string(clicksPerFrame) + " clicks/frame";
+
+	Run(("Scripted game " + name).c_str(), static_cast<double>(clicks.size()), [&]
+	{
+		Game game(geometry);
+
+		for (size_t begin = 0; begin < clicks.size(); begin += clicksPerFrame)
+		{
+			size_t const end = std::min(begin + clicksPerFrame, clicks.size());
+
+			for (size_t i = begin; i != end; ++i)
+			{
+				game.m_queue.Click(clicks[i]);
+			}
+
+			game.m_queue.Flush(game.m_board, game.m_animator, compositor);
+			compositor.m_time += FrameSeconds;
+		}
+
+		Consume(game.m_queue.m_commits);
+	});
+
+	Game game(geometry);
+	FakeCompositor counted(geometry.CardCount());
+
+	for (size_t begin = 0; begin < clicks.size(); begin += clicksPerFrame)
+	{
+		for (size_t i = begin; i != std::min(begin + clicksPerFrame, clicks.size()); ++i)
+		{
+			game.m_queue.Click(clicks[i]);
+		}
+
+		game.m_queue.Flush(game.m_board, game.m_animator, counted);
+		counted.m_time += FrameSeconds;
+	}
+
+	Report(("  commits per click " + name).c_str(), static_cast<double>(counted.m_commits) / clicks.size(), "");
+	Report(("  animations per click " + name).c_str(), static_cast<double>(counted.m_animations) / clicks.size(), "");
+	Report(("  animation objects " + name).c_str(), counted.m_animationObjects, "");
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	CheckQueue();
+
+	for (unsigned const clicksPerFrame : { 1u, 4u, 16u, 64u })
+	{
+		BenchmarkRate(4, 13, clicksPerFrame);
+		BenchmarkRate(20, 26, clicksPerFrame);
+	}
+}
@@ -0,0 +1,118 @@
+#include "Benchmark.h"
+#include "../Atlas.h"
+#include "../SoftwareRenderer.h"
+#include <random>
+#include <string>
+
+// The work a DPI change does for scale factors from 100% to 400%: arranging
+// the board, packing the atlas at the new card size and redrawing one frame's
+// batch of cards. The layout is checked at every scale first: cards stay
+// inside the client area, never overlap and are hit at their centers.
+
+// Matches the window's per frame redraw budget
+static unsigned const CardsPerFrame = 8;
+
+static void Verify(Board const & board, PhysicalLayout const & layout)
+{
+	BoardGeometry const & geometry = layout.Geometry;
+
+	for (unsigned row = 0; row != geometry.Rows; ++row)
+		for (unsigned column = 0; column != geometry.Columns; ++column)
+		{
+			unsigned const index = row * geometry.Columns + column;
+			Card const & card = board[index];
+
+			Check(card.OffsetX == layout.CardLeft(column) && card.OffsetY == layout.CardTop(row), "arranged at the layout offsets");
+			Check(card.OffsetX + layout.SurfaceWidth() <= layout.ClientWidth(), "card inside the client width");
+			Check(card.OffsetY + layout.SurfaceHeight() <= layout.ClientHeight(), "card inside the client height");
+
+			if (column != 0)
+			{
+				Check(board[index - 1].OffsetX + layout.CardWidth() < card.OffsetX, "cards do not overlap horizontally");
+			}
+
+			if (row != 0)
+			{
+				Check(board[index - geometry.Columns].OffsetY + layout.CardHeight() < card.OffsetY, "cards do not overlap vertically");
+			}
+
+			float const x = card.OffsetX + layout.CardWidth() / 2.0f;
+			float const y = card.OffsetY + layout.CardHeight() / 2.0f;
+
+			Check(board.CardAtPoint(x, y, layout.DpiX, layout.DpiY) == index, "card hit at its center");
+		}
+
+	Check(PhysicalToLogical(layout.CardLeft(geometry.Columns - 1), layout.DpiX) == geometry.CardLeft(geometry.Columns - 1),
+		"offsets convert back to logical units");
+}
+
+static void BenchmarkScale(unsigned const rows,
+	unsigned const columns,
+	unsigned const percent)
+{
+	float const dpi = 96.0f * percent / 100.0f;
+
+	BoardGeometry const geometry = SampleBoard::Geometry(rows, columns);
+	PhysicalLayout const layout(geometry, dpi, dpi);
+
+	Board board(geometry);
+	std::mt19937 generator(7);
+	board.Shuffle(generator);
+	board.Arrange(dpi, dpi);
+
+	Verify(board, layout);
+
+	std::string const name = std::to_string(rows) + "x" + std::to_string(columns) +
+		" @" + std::to_string(percent) + "%";
+
+	double const cards = board.CardCount();
+
+	Run(("Arrange " + name).c_str(), cards, [&]
+	{
+		board.Arrange(dpi, dpi);
+		Consume(board[0].OffsetX);
+	});
+
+	Run(("Arrange and pack atlas " + name).c_str(), cards, [&]
+	{
+		board.Arrange(dpi, dpi);
+		CardAtlas const atlas(board, layout.SurfaceWidth(), layout.SurfaceHeight());
+		Consume(atlas.m_atlas.m_pages.size());
+	});
+
+	PixelBuffer const background(
+		layout.ClientWidth(),
+		layout.ClientHeight());
+
+	GlyphCache glyphs;
+	SoftwareRenderer const renderer(dpi, dpi, CardWidth, CardHeight, CardHeight / 2.0f, background.View(), &glyphs);
+	PixelBuffer target(renderer.Width(), renderer.Height());
+
+	// One frame's batch with a warm glyph cache, front and back per card
+	Run(("Redraw one frame of cards " + name).c_str(), CardsPerFrame, [&]
+	{
+		for (unsigned index = 0; index != CardsPerFrame; ++index)
+		{
+			Card const & card = board[index % board.CardCount()];
+
+			renderer.DrawCardFront(target.View(), card.Value);
+			renderer.DrawCardBack(target.View(), card.OffsetX, card.OffsetY);
+		}
+
+		Consume(target.Pixels[0]);
+	});
+
+	Report(("  frames to redraw " + name).c_str(), (board.CardCount() + CardsPerFrame - 1) / CardsPerFrame, "frames");
+	Report(("  card surface " + name).c_str(), layout.SurfaceWidth() * layout.SurfaceHeight() * 4 / 1024.0, "KiB");
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	for (unsigned const percent : { 100u, 125u, 150u, 175u, 200u, 250u, 300u, 350u, 400u })
+	{
+		BenchmarkScale(3, 6, percent);
+		BenchmarkScale(10, 10, percent);
+	}
+}
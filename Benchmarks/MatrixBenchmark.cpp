@@ -0,0 +1,291 @@
+#include "Benchmark.h"
+#include "../Matrix.h"
+#include <cstring>
+#include <random>
+
+// Checks the matrix library against the D2D1::Matrix4x4F helpers it
+// replaces, transcribed below from d2d1_1helper.h, and checks that the card
+// flip transforms put the corners where the compositor should draw them.
+// Then times the products and the card face matrices.
+
+// D2D1::Matrix4x4F with its _11 to _44 members. D2D1SinCos is not
+// available here; the standard functions stand in for it.
+struct D2DMatrix4x4F
+{
+	float _11, _12, _13, _14;
+	float _21, _22, _23, _24;
+	float _31, _32, _33, _34;
+	float _41, _42, _43, _44;
+
+	static D2DMatrix4x4F Translation(float x, float y, float z)
+	{
+		D2DMatrix4x4F translation;
+
+		translation._11 = 1.0; translation._12 = 0.0; translation._13 = 0.0; translation._14 = 0.0;
+		translation._21 = 0.0; translation._22 = 1.0; translation._23 = 0.0; translation._24 = 0.0;
+		translation._31 = 0.0; translation._32 = 0.0; translation._33 = 1.0; translation._34 = 0.0;
+		translation._41 = x;   translation._42 = y;   translation._43 = z;   translation._44 = 1.0;
+
+		return translation;
+	}
+
+	static D2DMatrix4x4F RotationY(float degreeY)
+	{
+		float angleInRadian = degreeY * (3.141592654f / 180.0f);
+
+		float sinAngle = std::sin(angleInRadian);
+		float cosAngle = std::cos(angleInRadian);
+
+		D2DMatrix4x4F rotationY =
+		{
+			cosAngle, 0, -sinAngle, 0,
+			0, 1, 0, 0,
+			sinAngle, 0, cosAngle, 0,
+			0, 0, 0, 1
+		};
+
+		return rotationY;
+	}
+
+	static D2DMatrix4x4F PerspectiveProjection(float depth)
+	{
+		float proj = 0;
+
+		if (depth > 0)
+		{
+			proj = -1 / depth;
+		}
+
+		D2DMatrix4x4F projection =
+		{
+			1, 0, 0, 0,
+			0, 1, 0, 0,
+			0, 0, 1, proj,
+			0, 0, 0, 1
+		};
+
+		return projection;
+	}
+
+	D2DMatrix4x4F operator*(D2DMatrix4x4F const & matrix) const
+	{
+		D2DMatrix4x4F result;
+
+		result._11 = _11 * matrix._11 + _12 * matrix._21 + _13 * matrix._31 + _14 * matrix._41;
+		result._12 = _11 * matrix._12 + _12 * matrix._22 + _13 * matrix._32 + _14 * matrix._42;
+		result._13 = _11 * matrix._13 + _12 * matrix._23 + _13 * matrix._33 + _14 * matrix._43;
+		result._14 = _11 * matrix._14 + _12 * matrix._24 + _13 * matrix._34 + _14 * matrix._44;
+
+		result._21 = _21 * matrix._11 + _22 * matrix._21 + _23 * matrix._31 + _24 * matrix._41;
+		result._22 = _21 * matrix._12 + _22 * matrix._22 + _23 * matrix._32 + _24 * matrix._42;
+		result._23 = _21 * matrix._13 + _22 * matrix._23 + _23 * matrix._33 + _24 * matrix._43;
+		result._24 = _21 * matrix._14 + _22 * matrix._24 + _23 * matrix._34 + _24 * matrix._44;
+
+		result._31 = _31 * matrix._11 + _32 * matrix._21 + _33 * matrix._31 + _34 * matrix._41;
+		result._32 = _31 * matrix._12 + _32 * matrix._22 + _33 * matrix._32 + _34 * matrix._42;
+		result._33 = _31 * matrix._13 + _32 * matrix._23 + _33 * matrix._33 + _34 * matrix._43;
+		result._34 = _31 * matrix._14 + _32 * matrix._24 + _33 * matrix._34 + _34 * matrix._44;
+
+		result._41 = _41 * matrix._11 + _42 * matrix._21 + _43 * matrix._31 + _44 * matrix._41;
+		result._42 = _41 * matrix._12 + _42 * matrix._22 + _43 * matrix._32 + _44 * matrix._42;
+		result._43 = _41 * matrix._13 + _42 * matrix._23 + _43 * matrix._33 + _44 * matrix._43;
+		result._44 = _41 * matrix._14 + _42 * matrix._24 + _43 * matrix._34 + _44 * matrix._44;
+
+		return result;
+	}
+};
+
+static_assert(sizeof(D2DMatrix4x4F) == sizeof(Matrix4x4), "same layout");
+
+static bool Same(Matrix4x4 const & matrix, D2DMatrix4x4F const & d2d)
+{
+	return 0 == memcmp(&matrix, &d2d, sizeof(matrix));
+}
+
+static D2DMatrix4x4F ToD2D(Matrix4x4 const & matrix)
+{
+	D2DMatrix4x4F d2d;
+	memcpy(&d2d, &matrix, sizeof(d2d));
+	return d2d;
+}
+
+static Matrix4x4 RandomMatrix(std::mt19937 & generator)
+{
+	std::uniform_real_distribution<float> random(-1000.0f, 1000.0f);
+	Matrix4x4 matrix;
+
+	for (unsigned row = 0; row != 4; ++row)
+		for (unsigned column = 0; column != 4; ++column)
+		{
+			matrix.M[row][column] = random(generator);
+		}
+
+	return matrix;
+}
+
+static void CheckHelpers()
+{
+	float const values[] = { -720.0f, -180.0f, -90.0f, -1.5f, 0.0f, 0.5f, 45.0f, 90.0f, 135.0f, 180.0f, 270.0f, 359.9f };
+
+	for (float const value : values)
+	{
+		Check(Same(Matrix4x4::Translation(value, -value, value / 3.0f), D2DMatrix4x4F::Translation(value, -value, value / 3.0f)), "translation matches D2D");
+		Check(Same(Matrix4x4::RotationY(value), D2DMatrix4x4F::RotationY(value)), "rotation matches D2D");
+		Check(Same(Matrix4x4::PerspectiveProjection(value), D2DMatrix4x4F::PerspectiveProjection(value)), "perspective matches D2D");
+	}
+
+	std::mt19937 generator(16);
+
+	for (unsigned i = 0; i != 10000; ++i)
+	{
+		Matrix4x4 const left = RandomMatrix(generator);
+		Matrix4x4 const right = RandomMatrix(generator);
+		D2DMatrix4x4F const expected = ToD2D(left) * ToD2D(right);
+
+		Check(Same(MultiplyScalar(left, right), expected), "scalar product matches D2D");
+		Check(Same(left * right, expected), "product matches D2D");
+	}
+
+	// The card face matrices as the sample built them with the D2D helpers
+	for (float const dpi : { 96.0f, 120.0f, 144.0f, 192.0f })
+	{
+		float const width = 150.0f * dpi / 96.0f;
+		float const height = 210.0f * dpi / 96.0f;
+
+		for (bool const front : { false, true })
+		{
+			D2DMatrix4x4F const pre = D2DMatrix4x4F::Translation(-width / 2.0f, -height / 2.0f, 0.0f) *
+				D2DMatrix4x4F::RotationY(front ? 180.0f : 0.0f);
+
+			Check(Same(CardFacePreTransform(width, height, front), pre), "pre transform matches D2D");
+		}
+
+		D2DMatrix4x4F const post = D2DMatrix4x4F::PerspectiveProjection(width * 2.0f) *
+			D2DMatrix4x4F::Translation(width / 2.0f, height / 2.0f, 0.0f);
+
+		Check(Same(CardFacePostTransform(width, height), post), "post transform matches D2D");
+	}
+}
+
+static bool Near(float const a, float const b)
+{
+	return std::fabs(a - b) <= 0.01f;
+}
+
+// Where a corner of a face lands on the board at the card's angle
+static Vector4 Project(float const width,
+	float const height,
+	bool const front,
+	float const angle,
+	float const x,
+	float const y)
+{
+	Matrix4x4 const matrix = CardFacePreTransform(width, height, front) *
+		Matrix4x4::RotationY(angle) *
+		CardFacePostTransform(width, height);
+
+	Vector4 const point = matrix.Transform(Vector4 { x, y, 0.0f, 1.0f });
+
+	return Vector4 { point.X / point.W, point.Y / point.W, point.Z / point.W, 1.0f };
+}
+
+static void CheckCardFlip()
+{
+	float const width = 150.0f;
+	float const height = 210.0f;
+
+	float const corners[][2] =
+	{
+		{ 0.0f, 0.0f },
+		{ width, 0.0f },
+		{ 0.0f, height },
+		{ width, height },
+	};
+
+	for (auto const & corner : corners)
+	{
+		// The back shows unflipped face down, the front mirrored twice face up
+		Vector4 const back = Project(width, height, false, 0.0f, corner[0], corner[1]);
+		Check(Near(back.X, corner[0]) && Near(back.Y, corner[1]), "back in place face down");
+
+		Vector4 const front = Project(width, height, true, 180.0f, corner[0], corner[1]);
+		Check(Near(front.X, corner[0]) && Near(front.Y, corner[1]), "front in place face up");
+
+		// Edge on halfway through the flip, narrower than the card
+		Vector4 const edge = Project(width, height, false, 90.0f, corner[0], corner[1]);
+		Check(Near(edge.X, width / 2.0f), "edge on at 90 degrees");
+	}
+
+	// Turning, one edge comes towards the eye and looks taller than the
+	// card while the other goes away and looks shorter
+	float const nearHeight = Project(width, height, false, 45.0f, 0.0f, height).Y - Project(width, height, false, 45.0f, 0.0f, 0.0f).Y;
+	float const farHeight = Project(width, height, false, 45.0f, width, height).Y - Project(width, height, false, 45.0f, width, 0.0f).Y;
+	Check(nearHeight > height && farHeight < height, "perspective");
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	CheckHelpers();
+	CheckCardFlip();
+
+	std::mt19937 generator(16);
+	std::vector<Matrix4x4> matrices;
+
+	for (unsigned i = 0; i != 256; ++i)
+	{
+		matrices.push_back(RandomMatrix(generator));
+	}
+
+	std::vector<D2DMatrix4x4F> d2d;
+
+	for (Matrix4x4 const & matrix : matrices)
+	{
+		d2d.push_back(ToD2D(matrix));
+	}
+
+	// Every product is stored, so that none of it can be left out
+	unsigned const count = static_cast<unsigned>(matrices.size()) - 1;
+	std::vector<D2DMatrix4x4F> d2dProducts(count);
+	std::vector<Matrix4x4> products(count);
+
+	Run("Product D2D helper", count, [&]
+	{
+		for (unsigned i = 0; i != count; ++i)
+		{
+			d2dProducts[i] = d2d[i] * d2d[i + 1];
+		}
+
+		Consume(d2dProducts[0]._11);
+	});
+
+	Run("Product scalar", count, [&]
+	{
+		for (unsigned i = 0; i != count; ++i)
+		{
+			products[i] = MultiplyScalar(matrices[i], matrices[i + 1]);
+		}
+
+		Consume(products[0].M[0][0]);
+	});
+
+	Run("Product", count, [&]
+	{
+		for (unsigned i = 0; i != count; ++i)
+		{
+			products[i] = matrices[i] * matrices[i + 1];
+		}
+
+		Consume(products[0].M[0][0]);
+	});
+
+	Run("Card face matrices", 3, [&]
+	{
+		Matrix4x4 const front = CardFacePreTransform(300.0f, 420.0f, true);
+		Matrix4x4 const back = CardFacePreTransform(300.0f, 420.0f, false);
+		Matrix4x4 const post = CardFacePostTransform(300.0f, 420.0f);
+
+		Consume(front.M[3][0] + back.M[3][0] + post.M[2][3]);
+	});
+}
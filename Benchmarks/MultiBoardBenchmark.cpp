@@ -0,0 +1,290 @@
+#include "Benchmark.h"
+#include "../Metrics.h"
+#include "../ParallelRenderer.h"
+#include "../RecordingCompositor.h"
+#include "../Random.h"
+#include "../SharedResources.h"
+#include <string>
+#include <unordered_set>
+
+// Memory and startup time of every board after the first, for a wall of the
+// sample's boards in one process. Separate boards each bring their own
+// device, decoded background, glyphs, workers and face transforms, as one
+// sample window per process would. Shared boards use one set of them and
+// have only their own target, scene, layout and tiles. Boards alternate
+// between two DPIs, as on a wall of mixed monitors.
+
+static BoardGeometry const Geometry = SampleBoard::Geometry(3, 6);
+static float const Dpis[] = { 96.0f, 144.0f };
+static unsigned const Workers = 2;
+static unsigned const BackgroundWidth = 1920;
+static unsigned const BackgroundHeight = 1080;
+
+// Stands in for the codec, with a little arithmetic per pixel
+struct GradientDecoder : ImageDecoder
+{
+	unsigned m_row = 0;
+
+	unsigned Width() const override
+	{
+		return BackgroundWidth;
+	}
+
+	unsigned Height() const override
+	{
+		return BackgroundHeight;
+	}
+
+	bool ReadRows(PixelView const & rows) override
+	{
+		for (unsigned y = 0; y != rows.Height; ++y, ++m_row)
+		{
+			uint32_t * const row = rows.Row(y);
+
+			for (unsigned x = 0; x != rows.Width; ++x)
+			{
+				uint32_t const noise = (x * 2654435761u ^ m_row * 40503u) >> 27;
+
+				row[x] = 0xFF000000u |
+					(x * 255 / BackgroundWidth) << 16 |
+					(m_row * 255 / BackgroundHeight) << 8 |
+					(0x60u + noise);
+			}
+		}
+
+		return true;
+	}
+};
+
+// A window's own part: its target on the device, board, scene and tiles
+struct HostedBoard
+{
+	RecordingCompositor m_compositor;
+	Board m_board;
+	std::unique_ptr<CardAtlas> m_atlas;
+	std::unique_ptr<BoardScene> m_scene;
+	ScenePages m_pages;
+	std::vector<PixelBuffer> m_staging;
+
+	// Deals and draws the board, as the sample's first paint does
+	HostedBoard(std::shared_ptr<RecordingState> const & device,
+		SharedBoardResources & resources,
+		float const dpi,
+		uint64_t const seed) :
+		m_compositor(device),
+		m_board(Geometry)
+	{
+		PhysicalLayout const layout(Geometry, dpi, dpi);
+		Xoshiro256 generator(seed);
+
+		m_board.Deal(CardAlphabet::Latin(), generator);
+		m_board.Arrange(dpi, dpi);
+
+		m_atlas.reset(new CardAtlas(m_board, layout.SurfaceWidth(), layout.SurfaceHeight()));
+		m_scene.reset(new BoardScene(m_compositor, m_board.CardCount(), resources.FaceTransforms));
+		m_pages = m_scene->CreatePages(*m_atlas);
+		m_scene->Build(m_board, *m_atlas, m_pages, layout);
+
+		if (!resources.Background)
+		{
+			resources.Background.reset(new StreamingImage(std::unique_ptr<ImageDecoder>(new GradientDecoder)));
+		}
+
+		Check(resources.Background->Wait(resources.Background->Height()), "background decoded");
+
+		SoftwareRenderer const renderer(dpi,
+			dpi,
+			Geometry.CardWidth,
+			Geometry.CardHeight,
+			Geometry.CardHeight / 2.0f,
+			resources.Background->ReadyView(),
+			&resources.Glyphs);
+
+		DrawAtlasPages(m_board, *m_atlas, renderer, resources.Pool, m_staging);
+
+		for (unsigned page = 0; page != m_pages.size(); ++page)
+		{
+			PixelBuffer const & staged = m_staging[page];
+			m_pages[page]->Upload(0, 0, staged.View());
+		}
+
+		m_compositor.Commit();
+	}
+
+	size_t StagingBytes() const
+	{
+		size_t bytes = 0;
+
+		for (PixelBuffer const & page : m_staging)
+		{
+			bytes += page.Pixels.size() * sizeof(uint32_t);
+		}
+
+		return bytes;
+	}
+};
+
+// A board with a device and resources of its own
+struct SeparateBoard
+{
+	std::shared_ptr<RecordingState> m_device = std::make_shared<RecordingState>();
+	SharedBoardResources m_resources;
+	HostedBoard m_board;
+
+	SeparateBoard(float const dpi,
+		uint64_t const seed) :
+		m_resources(Workers),
+		m_board(m_device, m_resources, dpi, seed)
+	{}
+};
+
+struct Footprint
+{
+	double Bytes = 0.0;
+	double Objects = 0.0;
+};
+
+static Footprint SeparateFootprint(std::vector<std::unique_ptr<SeparateBoard>> const & boards)
+{
+	Footprint footprint;
+
+	for (std::unique_ptr<SeparateBoard> const & board : boards)
+	{
+		footprint.Bytes += static_cast<double>(board->m_device->LiveSurfaceBytes + board->m_resources.Bytes() + board->m_board.StagingBytes());
+		footprint.Objects += board->m_device->LiveObjects;
+	}
+
+	return footprint;
+}
+
+static Footprint SharedFootprint(RecordingState const & device,
+	SharedBoardResources const & resources,
+	std::vector<std::unique_ptr<HostedBoard>> const & boards)
+{
+	Footprint footprint;
+	footprint.Bytes = static_cast<double>(device.LiveSurfaceBytes + resources.Bytes());
+	footprint.Objects = device.LiveObjects;
+
+	for (std::unique_ptr<HostedBoard> const & board : boards)
+	{
+		footprint.Bytes += static_cast<double>(board->StagingBytes());
+	}
+
+	return footprint;
+}
+
+static void ReportBoards(char const * mode,
+	DurationSamples const & startup,
+	Footprint const & first,
+	Footprint const & all,
+	unsigned const count)
+{
+	std::string const name = std::string(mode);
+	double const added = count - 1;
+
+	double later = 0.0;
+
+	for (unsigned board = 1; board != count; ++board)
+	{
+		later += startup.Seconds[board];
+	}
+
+	Report(("  first board startup " + name).c_str(), startup.Seconds[0] * 1000.0, "ms");
+	Report(("  added board startup " + name).c_str(), later / added * 1000.0, "ms");
+	Report(("  first board MB " + name).c_str(), first.Bytes / 1048576.0, "MB");
+	Report(("  added board MB " + name).c_str(), (all.Bytes - first.Bytes) / added / 1048576.0, "MB");
+	Report(("  added board objects " + name).c_str(), (all.Objects - first.Objects) / added, "");
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	unsigned const count = BenchmarkMinimumSeconds < 0.25 ? 6 : 16;
+
+	// Each on its own
+	std::vector<std::unique_ptr<SeparateBoard>> separate;
+	DurationSamples separateStartup;
+	Footprint separateFirst;
+
+	for (unsigned board = 0; board != count; ++board)
+	{
+		Stopwatch const stopwatch;
+		separate.emplace_back(new SeparateBoard(Dpis[board % 2], board));
+		separateStartup.Record(stopwatch.ElapsedSeconds());
+
+		if (board == 0) separateFirst = SeparateFootprint(separate);
+	}
+
+	Footprint const separateAll = SeparateFootprint(separate);
+
+	// All on one device
+	std::shared_ptr<RecordingState> const device = std::make_shared<RecordingState>();
+	SharedBoardResources resources(Workers);
+	std::vector<std::unique_ptr<HostedBoard>> shared;
+	DurationSamples sharedStartup;
+	Footprint sharedFirst;
+
+	for (unsigned board = 0; board != count; ++board)
+	{
+		Stopwatch const stopwatch;
+		shared.emplace_back(new HostedBoard(device, resources, Dpis[board % 2], board));
+		sharedStartup.Record(stopwatch.ElapsedSeconds());
+
+		if (board == 0) sharedFirst = SharedFootprint(*device, resources, shared);
+	}
+
+	Footprint const sharedAll = SharedFootprint(*device, resources, shared);
+
+	// The boards of each DPI share three face transforms, and each glyph of
+	// each DPI is rasterized once
+	double const separateObjects = separateAll.Objects / count;
+	double const sharedObjects = (sharedAll.Objects - 3.0 * 2) / count;
+
+	Check(resources.FaceTransforms->m_entries.size() == 2, "face transforms per DPI");
+	Check(separateObjects - sharedObjects == 3.0, "face transforms shared");
+
+	std::unordered_set<GlyphKey, GlyphKeyHash> glyphs;
+	size_t separateGlyphs = 0;
+
+	for (std::unique_ptr<SeparateBoard> const & board : separate)
+	{
+		for (auto const & glyph : board->m_resources.Glyphs.m_glyphs)
+		{
+			glyphs.insert(glyph.first);
+		}
+
+		separateGlyphs += board->m_resources.Glyphs.Count();
+	}
+
+	Check(resources.Glyphs.Count() == glyphs.size(), "each glyph rasterized once");
+
+	for (unsigned board = 0; board != count; ++board)
+	{
+		Check(shared[board]->m_compositor.CountVisuals() == separate[board]->m_board.m_compositor.CountVisuals(), "same tree either way");
+	}
+
+	ReportBoards("separate", separateStartup, separateFirst, separateAll, count);
+	ReportBoards("shared", sharedStartup, sharedFirst, sharedAll, count);
+
+	Report("  glyphs rasterized separate", static_cast<double>(separateGlyphs), "");
+	Report("  glyphs rasterized shared", static_cast<double>(resources.Glyphs.Count()), "");
+	Report("  added board memory saved", 100.0 * (1.0 - (sharedAll.Bytes - sharedFirst.Bytes) / (separateAll.Bytes - separateFirst.Bytes)), "%");
+
+	shared.clear();
+	separate.clear();
+
+	unsigned seed = count;
+
+	Run("Add board separate", 1, [&]
+	{
+		SeparateBoard const board(Dpis[0], ++seed);
+		Consume(board.m_device->LiveObjects);
+	});
+
+	Run("Add board shared", 1, [&]
+	{
+		HostedBoard const board(device, resources, Dpis[0], ++seed);
+		Consume(device->LiveObjects);
+	});
+}
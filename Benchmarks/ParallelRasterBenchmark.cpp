@@ -0,0 +1,192 @@
+#include "Benchmark.h"
+#include "../ParallelRenderer.h"
+#include <cstring>
+#include <random>
+#include <string>
+
+// Rasterizes every tile of the card atlas on thread pools of 1 to 16 threads,
+// the work the software path does at startup and after device loss. The
+// tiles must match a serial draw bit for bit, with and without a glyph
+// cache, before the times and the speedup over one thread are reported.
+
+struct Size
+{
+	unsigned Rows;
+	unsigned Columns;
+};
+
+static PixelBuffer CreateBackground(unsigned const width, unsigned const height)
+{
+	PixelBuffer background(width, height);
+
+	for (unsigned y = 0; y != height; ++y)
+	{
+		uint32_t * row = background.View().Row(y);
+
+		for (unsigned x = 0; x != width; ++x)
+		{
+			row[x] = PackColor(x & 0xFF, y & 0xFF, (x ^ y) & 0xFF, 0xFF);
+		}
+	}
+
+	return background;
+}
+
+static bool SameTile(std::vector<PixelBuffer> const & a,
+	std::vector<PixelBuffer> const & b,
+	AtlasRect const & rect)
+{
+	ConstPixelView const left = a[rect.Page].View().SubView(rect.Left, rect.Top, rect.Width, rect.Height);
+	ConstPixelView const right = b[rect.Page].View().SubView(rect.Left, rect.Top, rect.Width, rect.Height);
+
+	for (unsigned y = 0; y != left.Height; ++y)
+	{
+		if (0 != memcmp(left.Row(y), right.Row(y), left.Width * sizeof(uint32_t))) return false;
+	}
+
+	return true;
+}
+
+// The serial draw the software renderer did before, one tile at a time. The
+// pages are reused as DrawAtlasPages reuses them, so that only the drawing
+// is compared.
+static void DrawSerial(Board const & board,
+	CardAtlas const & atlas,
+	SoftwareRenderer const & renderer,
+	std::vector<PixelBuffer> & pages)
+{
+	pages.resize(atlas.m_atlas.PageCount());
+
+	for (unsigned page = 0; page != atlas.m_atlas.PageCount(); ++page)
+	{
+		pages[page].Resize(atlas.m_atlas.m_pageWidth, atlas.m_atlas.PageHeight(page));
+	}
+
+	for (CardAtlas::Front const & front : atlas.m_uniqueFronts)
+	{
+		AtlasRect const & rect = front.Rect;
+		renderer.DrawCardFront(pages[rect.Page].View().SubView(rect.Left, rect.Top, rect.Width, rect.Height), front.Value);
+	}
+
+	for (unsigned index = 0; index != board.CardCount(); ++index)
+	{
+		if (!atlas.Contains(index)) continue;
+
+		AtlasRect const & rect = atlas.BackRect(index);
+		renderer.DrawCardBack(pages[rect.Page].View().SubView(rect.Left, rect.Top, rect.Width, rect.Height), board[index].OffsetX, board[index].OffsetY);
+	}
+}
+
+static void CheckTiles(Board const & board,
+	CardAtlas const & atlas,
+	std::vector<PixelBuffer> const & expected,
+	std::vector<PixelBuffer> const & actual)
+{
+	Check(expected.size() == actual.size(), "same page count");
+
+	for (CardAtlas::Front const & front : atlas.m_uniqueFronts)
+	{
+		Check(SameTile(expected, actual, front.Rect), "front matches the serial draw");
+	}
+
+	for (unsigned index = 0; index != board.CardCount(); ++index)
+	{
+		if (!atlas.Contains(index)) continue;
+
+		Check(SameTile(expected, actual, atlas.BackRect(index)), "back matches the serial draw");
+	}
+}
+
+static void BenchmarkBoard(Size const & size, float const dpi)
+{
+	BoardGeometry const geometry = SampleBoard::Geometry(size.Rows, size.Columns);
+	Board board(geometry);
+	std::mt19937 generator(15);
+	board.Shuffle(generator);
+	board.Arrange(dpi, dpi);
+
+	// Some cards already matched, as after device loss mid game
+	for (unsigned index = 0; index < board.CardCount(); index += 7)
+	{
+		board[index].Status = CardStatus::Matched;
+	}
+
+	PixelBuffer const background = CreateBackground(
+		static_cast<unsigned>(geometry.Width()),
+		static_cast<unsigned>(geometry.Height()));
+
+	GlyphCache glyphs;
+	SoftwareRenderer const cached(dpi, dpi, CardWidth, CardHeight, CardHeight / 2.0f, background.View(), &glyphs);
+	SoftwareRenderer const uncached(dpi, dpi, CardWidth, CardHeight, CardHeight / 2.0f, background.View());
+
+	CardAtlas const atlas(board, cached.Width(), cached.Height());
+
+	std::vector<PixelBuffer> expected;
+	DrawSerial(board, atlas, uncached, expected);
+
+	std::string const name = std::to_string(size.Rows) + "x" + std::to_string(size.Columns) +
+		" @" + std::to_string(static_cast<int>(dpi));
+
+	double const tiles = atlas.m_uniqueFronts.size() + atlas.m_cardsInPlay;
+
+	// Touched once first, so that neither variant is timed faulting in pages
+	std::vector<PixelBuffer> pages;
+	DrawSerial(board, atlas, cached, pages);
+
+	double const serial = Run(("Serial draw " + name).c_str(), tiles, [&]
+	{
+		DrawSerial(board, atlas, cached, pages);
+		Consume(pages[0].Pixels[0]);
+	});
+
+	double single = 0.0;
+
+	for (unsigned const threads : { 1u, 2u, 4u, 8u, 16u })
+	{
+		ThreadPool pool(threads);
+
+		// Stale pixels from an earlier draw must all be replaced
+		for (PixelBuffer & page : pages)
+		{
+			std::fill(page.Pixels.begin(), page.Pixels.end(), 0xDEADBEEF);
+		}
+
+		DrawAtlasPages(board, atlas, uncached, pool, pages);
+		CheckTiles(board, atlas, expected, pages);
+
+		DrawAtlasPages(board, atlas, cached, pool, pages);
+		CheckTiles(board, atlas, expected, pages);
+
+		double const parallel = Run(("Parallel draw " + name + ", " + std::to_string(threads) + " threads").c_str(), tiles, [&]
+		{
+			DrawAtlasPages(board, atlas, cached, pool, pages);
+			Consume(pages[0].Pixels[0]);
+		});
+
+		if (threads == 1) single = parallel;
+
+		Report(("  speedup over 1 thread " + name + ", " + std::to_string(threads) + " threads").c_str(), single / parallel, "x");
+	}
+
+	Report(("  serial over 1 thread " + name).c_str(), serial / single, "x");
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	// Speedups beyond this many threads are not to be expected
+	Report("Cores", ThreadPool::DefaultThreads(), "");
+
+	Size const sizes[] =
+	{
+		{ 3, 6 },
+		{ 20, 26 },
+	};
+
+	for (float const dpi : { 96.0f, 192.0f })
+		for (Size const & size : sizes)
+		{
+			BenchmarkBoard(size, dpi);
+		}
+}
@@ -0,0 +1,252 @@
+#include "Benchmark.h"
+#include "../SoftwareRenderer.h"
+#include <cstring>
+#include <random>
+#include <string>
+
+// Throughput of the software raster kernels in megapixels per second, for
+// the scalar reference and every SIMD variant compiled in, followed by whole
+// card faces drawn the way the sample draws them.
+
+static unsigned const Width = 1024;
+static unsigned const Height = 1024;
+
+typedef void (*FillKernel)(uint32_t *, unsigned, uint32_t);
+typedef void (*CompositeKernel)(uint32_t *, uint8_t const *, unsigned, uint32_t);
+
+template <typename Kernel>
+struct Variant
+{
+	char const * Name;
+	Kernel Function;
+};
+
+static Variant<FillKernel> const FillVariants[] =
+{
+	{ "scalar", FillRowScalar },
+#if RASTER_SSE2
+	{ "sse2", FillRowSse2 },
+#endif
+#if RASTER_AVX2
+	{ "avx2", FillRowAvx2 },
+#endif
+#if RASTER_NEON
+	{ "neon", FillRowNeon },
+#endif
+};
+
+static Variant<CompositeKernel> const CompositeVariants[] =
+{
+	{ "scalar", CompositeRowScalar },
+#if RASTER_SSE2
+	{ "sse2", CompositeRowSse2 },
+#endif
+#if RASTER_AVX2
+	{ "avx2", CompositeRowAvx2 },
+#endif
+#if RASTER_NEON
+	{ "neon", CompositeRowNeon },
+#endif
+};
+
+static void ReportThroughput(std::string const & name, double const nanosecondsPerPixel)
+{
+	Report((name + " throughput").c_str(), 1e3 / nanosecondsPerPixel, "MP/s");
+}
+
+static PixelBuffer NoiseImage(unsigned const width, unsigned const height, unsigned const seed)
+{
+	PixelBuffer image(width, height);
+	std::mt19937 generator(seed);
+
+	for (uint32_t & pixel : image.Pixels)
+	{
+		pixel = generator();
+	}
+
+	return image;
+}
+
+static void BenchmarkFill()
+{
+	PixelBuffer reference(Width, Height);
+	FillRowScalar(reference.Pixels.data(), Width * Height, 0xFFFFFFFFu);
+
+	for (Variant<FillKernel> const & variant : FillVariants)
+	{
+		PixelBuffer target(Width, Height);
+		PixelView const view = target.View();
+
+		variant.Function(target.Pixels.data() + 1, Width * Height - 1, 0xFFFFFFFFu);
+		variant.Function(target.Pixels.data(), 1, 0xFFFFFFFFu);
+		Check(target.Pixels == reference.Pixels, "fill matches scalar");
+
+		std::string const name = std::string("Fill 1024x1024 ") + variant.Name;
+
+		ReportThroughput(name, Run(name.c_str(), Width * Height, [&]
+		{
+			for (unsigned y = 0; y != Height; ++y)
+			{
+				variant.Function(view.Row(y), Width, 0xFFFFFFFFu);
+			}
+
+			Consume(target.Pixels[0]);
+		}));
+	}
+}
+
+// The background's pixels keep their alpha, whole or scaled, so that a
+// translucent background is drawn as Direct2D draws it
+static void BenchmarkCopy()
+{
+	PixelBuffer const source = NoiseImage(Width + 3, Height, 1);
+	PixelBuffer target(Width, Height);
+	PixelView const view = target.View();
+
+	// Unaligned source rows, as for a card at an arbitrary offset
+	auto const copy = [&]
+	{
+		CopyRect(view, source.View(), 3, 0);
+	};
+
+	copy();
+
+	bool same = true;
+
+	for (unsigned y = 0; y != Height; ++y)
+	{
+		same = same && 0 == memcmp(view.Row(y), source.View().Row(y) + 3, Width * sizeof(uint32_t));
+	}
+
+	Check(same, "copy keeps every pixel as it is");
+
+	PixelBuffer scaled(Width / 2, Height / 2);
+	ScaleRect(scaled.View(), source.View(), 3.0f, 0.0f, static_cast<float>(Width), static_cast<float>(Height));
+
+	Check(scaled.View().Row(0)[0] == source.View().Row(1)[4], "scale keeps the alpha");
+
+	ReportThroughput("Copy 1024x1024", Run("Copy 1024x1024", Width * Height, [&]
+	{
+		copy();
+		Consume(target.Pixels[0]);
+	}));
+}
+
+static void BenchmarkComposite()
+{
+	PixelBuffer const background = NoiseImage(Width, Height, 2);
+
+	// Premultiplied destination, as composited surfaces always are
+	PixelBuffer destination = background;
+
+	for (uint32_t & pixel : destination.Pixels)
+	{
+		unsigned const alpha = pixel >> 24;
+		uint32_t result = alpha << 24;
+
+		for (unsigned shift = 0; shift != 24; shift += 8)
+		{
+			result |= Divide255((pixel >> shift & 0xFF) * alpha) << shift;
+		}
+
+		pixel = result;
+	}
+
+	std::vector<uint8_t> coverage(Width * Height);
+	std::mt19937 generator(3);
+
+	for (uint8_t & value : coverage)
+	{
+		unsigned const random = generator() & 0x3FF;
+		value = random < 256 ? 0 : random < 512 ? 255 : static_cast<uint8_t>(random);
+	}
+
+	uint32_t const colors[] = { PremultipliedColor(0.0f, 0.0f, 0.0f), PremultipliedColor(0.2f, 0.4f, 0.8f, 0.5f) };
+
+	for (uint32_t const color : colors)
+	{
+		PixelBuffer reference = destination;
+
+		for (unsigned y = 0; y != Height; ++y)
+		{
+			CompositeRowScalar(reference.View().Row(y), coverage.data() + y * Width, Width, color);
+		}
+
+		for (Variant<CompositeKernel> const & variant : CompositeVariants)
+		{
+			PixelBuffer target = destination;
+
+			for (unsigned y = 0; y != Height; ++y)
+			{
+				variant.Function(target.View().Row(y), coverage.data() + y * Width, Width, color);
+			}
+
+			Check(target.Pixels == reference.Pixels, "composite matches scalar");
+		}
+	}
+
+	for (Variant<CompositeKernel> const & variant : CompositeVariants)
+	{
+		PixelBuffer target = destination;
+		PixelView const view = target.View();
+
+		std::string const name = std::string("Composite 1024x1024 ") + variant.Name;
+
+		ReportThroughput(name, Run(name.c_str(), Width * Height, [&]
+		{
+			for (unsigned y = 0; y != Height; ++y)
+			{
+				variant.Function(view.Row(y), coverage.data() + y * Width, Width, 0xFF000000u);
+			}
+
+			Consume(target.Pixels[0]);
+		}));
+	}
+}
+
+static void BenchmarkCards(float const dpi)
+{
+	PixelBuffer const background = NoiseImage(1920, 1080, 4);
+	SoftwareRenderer const renderer(dpi, dpi, 150.0f, 210.0f, 105.0f, background.View());
+
+	PixelBuffer target(renderer.Width(), renderer.Height());
+	double const pixels = static_cast<double>(target.Width) * target.Height;
+	std::string const suffix = " @" + std::to_string(static_cast<int>(dpi));
+
+	CoverageMask const glyph = renderer.RasterizeGlyph(L'W');
+
+	std::string name = "DrawCardFront (rasterize glyph)" + suffix;
+
+	ReportThroughput(name, Run(name.c_str(), pixels, [&]
+	{
+		renderer.DrawCardFront(target.View(), L'W');
+		Consume(target.Pixels[0]);
+	}));
+
+	name = "DrawCardFront (prerasterized glyph)" + suffix;
+
+	ReportThroughput(name, Run(name.c_str(), pixels, [&]
+	{
+		renderer.DrawCardFront(target.View(), glyph);
+		Consume(target.Pixels[0]);
+	}));
+
+	name = "DrawCardBack" + suffix;
+
+	ReportThroughput(name, Run(name.c_str(), pixels, [&]
+	{
+		renderer.DrawCardBack(target.View(), LogicalToPhysical(15.0f, dpi), LogicalToPhysical(240.0f, dpi));
+		Consume(target.Pixels[0]);
+	}));
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	BenchmarkFill();
+	BenchmarkCopy();
+	BenchmarkComposite();
+	BenchmarkCards(96.0f);
+	BenchmarkCards(144.0f);
+}
@@ -0,0 +1,168 @@
+#include "Benchmark.h"
+#include "../Atlas.h"
+#include "../Metrics.h"
+#include "../SoftwareRenderer.h"
+#include <random>
+#include <string>
+
+// Rebuilds the card pages of a board the way the software path does after
+// device loss. A full rebuild copies the background again (standing in for
+// the decode, so it understates the real cost), drops the glyph cache and
+// recomputes the layout. An incremental rebuild keeps all of that and only
+// draws into fresh pages, as new surfaces would need. Both must produce the
+// same pixels.
+
+struct Size
+{
+	unsigned Rows;
+	unsigned Columns;
+};
+
+static PixelBuffer CreateBackground(unsigned const width, unsigned const height)
+{
+	PixelBuffer background(width, height);
+
+	for (unsigned y = 0; y != height; ++y)
+	{
+		uint32_t * row = background.View().Row(y);
+
+		for (unsigned x = 0; x != width; ++x)
+		{
+			row[x] = PackColor(x & 0xFF, y & 0xFF, (x ^ y) & 0xFF, 0xFF);
+		}
+	}
+
+	return background;
+}
+
+static void DrawPages(Board const & board,
+	CardAtlas const & atlas,
+	SoftwareRenderer const & renderer,
+	std::vector<PixelBuffer> & pages)
+{
+	pages.clear();
+
+	for (unsigned page = 0; page != atlas.m_atlas.PageCount(); ++page)
+	{
+		pages.emplace_back(atlas.m_atlas.m_pageWidth, atlas.m_atlas.PageHeight(page));
+	}
+
+	auto const tile = [&](AtlasRect const & rect)
+	{
+		return pages[rect.Page].View().SubView(rect.Left, rect.Top, rect.Width, rect.Height);
+	};
+
+	for (CardAtlas::Front const & front : atlas.m_uniqueFronts)
+	{
+		renderer.DrawCardFront(tile(front.Rect), front.Value);
+	}
+
+	for (unsigned index = 0; index != board.CardCount(); ++index)
+	{
+		Card const & card = board[index];
+
+		if (card.Status == CardStatus::Matched) continue;
+
+		renderer.DrawCardBack(tile(atlas.BackRect(index)), card.OffsetX, card.OffsetY);
+	}
+}
+
+static void BenchmarkRebuild(Size const & size, float const dpi)
+{
+	BoardGeometry const geometry = SampleBoard::Geometry(size.Rows, size.Columns);
+	Board board(geometry);
+	std::mt19937 generator(6);
+	board.Shuffle(generator);
+
+	PixelBuffer const decoded = CreateBackground(
+		static_cast<unsigned>(geometry.Width()),
+		static_cast<unsigned>(geometry.Height()));
+
+	// Retained across device loss
+	PixelBuffer background = decoded;
+	GlyphCache glyphs;
+	board.Arrange(dpi, dpi);
+
+	// Copying over the background of the same size keeps its storage, so the
+	// renderer's view stays valid through a full rebuild
+	PixelBuffer const & pixels = background;
+	SoftwareRenderer const renderer(dpi, dpi, CardWidth, CardHeight, CardHeight / 2.0f, pixels.View(), &glyphs);
+
+	unsigned const width = renderer.Width();
+	unsigned const height = renderer.Height();
+
+	CardAtlas const layout(board, width, height);
+
+	std::vector<PixelBuffer> pages;
+	std::vector<PixelBuffer> reference;
+
+	DurationMetric full;
+	DurationMetric incremental;
+
+	auto const fullRebuild = [&]
+	{
+		Stopwatch const stopwatch;
+
+		background = decoded;
+		glyphs.Clear();
+		board.Arrange(dpi, dpi);
+		CardAtlas const atlas(board, width, height);
+		DrawPages(board, atlas, renderer, pages);
+
+		full.Record(stopwatch.ElapsedSeconds());
+	};
+
+	auto const incrementalRebuild = [&]
+	{
+		Stopwatch const stopwatch;
+
+		DrawPages(board, layout, renderer, pages);
+
+		incremental.Record(stopwatch.ElapsedSeconds());
+	};
+
+	fullRebuild();
+	reference.swap(pages);
+	incrementalRebuild();
+
+	Check(pages.size() == reference.size(), "same page count");
+
+	for (size_t page = 0; page != pages.size(); ++page)
+	{
+		Check(pages[page].Pixels == reference[page].Pixels, "incremental rebuild draws the same pixels");
+	}
+
+	std::string const name = std::to_string(size.Rows) + "x" + std::to_string(size.Columns) +
+		" @" + std::to_string(static_cast<int>(dpi));
+
+	double const cards = board.CardCount();
+
+	full = DurationMetric();
+	incremental = DurationMetric();
+
+	Run(("Full rebuild " + name).c_str(), cards, fullRebuild);
+	Run(("Incremental rebuild " + name).c_str(), cards, incrementalRebuild);
+
+	Report(("  full rebuild mean " + name).c_str(), full.Mean() * 1000.0, "ms");
+	Report(("  full rebuild max " + name).c_str(), full.Max * 1000.0, "ms");
+	Report(("  incremental rebuild mean " + name).c_str(), incremental.Mean() * 1000.0, "ms");
+	Report(("  incremental rebuild max " + name).c_str(), incremental.Max * 1000.0, "ms");
+	Report(("  speedup " + name).c_str(), full.Mean() / incremental.Mean(), "x");
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	Size const sizes[] =
+	{
+		{ 3, 6 },
+		{ 10, 10 },
+	};
+
+	for (float const dpi : { 96.0f, 144.0f })
+		for (Size const & size : sizes)
+		{
+			BenchmarkRebuild(size, dpi);
+		}
+}
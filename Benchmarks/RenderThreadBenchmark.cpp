@@ -0,0 +1,196 @@
+#include "Benchmark.h"
+#include "../InputReplay.h"
+#include <string>
+#include <thread>
+
+// The render thread against the message loop doing the work itself. Checks
+// that the command queue keeps every command in order when it fills, that a
+// snapshot is never seen half written, and that a session played through the
+// render thread at the recorded pace ends where the message loop's does.
+// Then reports, for the sample's board and a larger one, how long the
+// message thread is held by each event and the latency from input to commit,
+// at the recorded pace and for a burst of input posted all at once.
+
+// A producer pushing numbers through a queue small enough to fill
+static void CheckQueue(unsigned const count)
+{
+	SpscQueue<unsigned> queue(64);
+	unsigned full = 0;
+
+	std::thread producer([&]
+	{
+		for (unsigned value = 1; value <= count; ++value)
+		{
+			while (!queue.TryPush(value))
+			{
+				++full;
+				std::this_thread::yield();
+			}
+		}
+	});
+
+	unsigned expected = 1;
+	bool ordered = true;
+
+	while (expected <= count)
+	{
+		unsigned value = 0;
+
+		if (!queue.TryPop(value))
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		ordered = ordered && value == expected;
+		++expected;
+	}
+
+	producer.join();
+
+	Check(ordered && queue.Empty(), "queue in order");
+
+	Report("  queue full on push", static_cast<double>(full), "");
+}
+
+// A writer publishing snapshots whose every value is the snapshot's number,
+// read as fast as possible
+static void CheckSnapshots(unsigned const count)
+{
+	SnapshotBuffer<std::vector<unsigned>> buffer(std::vector<unsigned>(4096, 0));
+	unsigned reads = 0;
+	bool whole = true;
+	bool forward = true;
+
+	std::thread writer([&]
+	{
+		for (unsigned number = 1; number <= count; ++number)
+		{
+			std::vector<unsigned> & snapshot = buffer.BeginWrite();
+			std::fill(snapshot.begin(), snapshot.end(), number);
+			buffer.Publish();
+		}
+	});
+
+	unsigned last = 0;
+
+	while (last != count)
+	{
+		SnapshotReader<std::vector<unsigned>> const snapshot(buffer);
+		unsigned const number = snapshot->front();
+
+		whole = whole && std::all_of(snapshot->begin(), snapshot->end(), [number](unsigned const value)
+		{
+			return value == number;
+		});
+
+		forward = forward && number >= last;
+		last = number;
+		++reads;
+	}
+
+	writer.join();
+
+	Check(whole, "snapshots whole");
+	Check(forward && buffer.Published() == count, "snapshots in order");
+
+	Report("  snapshot reads", static_cast<double>(reads), "");
+}
+
+static bool SameBoard(Board const & a, Board const & b)
+{
+	for (unsigned index = 0; index != a.CardCount(); ++index)
+	{
+		if (a[index].Value != b[index].Value || a[index].Status != b[index].Status) return false;
+	}
+
+	return true;
+}
+
+static void ReportReplay(std::string const & name,
+	ReplayReport const & report)
+{
+	Report(("  p99 message thread held " + name).c_str(), report.Handling.Percentile(99.0) * 1e6, "us");
+	Report(("  max message thread held " + name).c_str(), report.Handling.Max() * 1e6, "us");
+	Report(("  p50 latency " + name).c_str(), report.Latency.Percentile(50.0) * 1e6, "us");
+	Report(("  p99 latency " + name).c_str(), report.Latency.Percentile(99.0) * 1e6, "us");
+	Report(("  commits " + name).c_str(), report.Frames, "");
+}
+
+static void BenchmarkSession(BoardGeometry const & geometry,
+	unsigned const games,
+	double const pacedSeconds)
+{
+	std::string const name = std::to_string(geometry.Rows) + "x" + std::to_string(geometry.Columns);
+
+	InputLog const log = ScriptInputSession(geometry, 2024, games);
+
+	// At the recorded pace every click has a frame to itself either way
+	ReplayOptions paced;
+	paced.Until = pacedSeconds;
+
+	HeadlessGame inlineGame(log);
+	HeadlessGame threadedGame(log);
+
+	ReplayReport const inlineReport = ReplayInput(log, inlineGame, paced);
+	ReplayReport const threadedReport = ReplayOnRenderThread(log, threadedGame, paced);
+
+	Check(threadedReport.Events == inlineReport.Events, "every event posted");
+	Check(threadedReport.Latency.Count() == threadedReport.Events - threadedReport.Missed, "a latency for every event shown");
+	Check(SameBoard(inlineGame.m_board, threadedGame.m_board) && inlineGame.m_games == threadedGame.m_games, "same game on the render thread");
+
+	// The whole session at once, as a burst of input
+	ReplayOptions burst;
+	burst.Speed = 0.0;
+
+	HeadlessGame inlineBurst(log);
+	HeadlessGame threadedBurst(log);
+
+	ReplayReport const inlineBurstReport = ReplayInput(log, inlineBurst, burst);
+	ReplayReport const threadedBurstReport = ReplayOnRenderThread(log, threadedBurst, burst);
+
+	Check(threadedBurstReport.Events == log.Events.size() && threadedBurst.m_games == games, "every event of the burst applied");
+
+	ReportReplay("1x inline " + name, inlineReport);
+	ReportReplay("1x render thread " + name, threadedReport);
+	ReportReplay("burst inline " + name, inlineBurstReport);
+	ReportReplay("burst render thread " + name, threadedBurstReport);
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	bool const quick = BenchmarkMinimumSeconds < 0.25;
+
+	CheckQueue(quick ? 100000 : 1000000);
+	CheckSnapshots(quick ? 2000 : 20000);
+
+	// The sample's board, and a larger one whose rebuilds take longer
+	BenchmarkSession(SampleBoard::Geometry(3, 6), 6, quick ? 3.0 : 10.0);
+	BenchmarkSession(SampleBoard::Geometry(8, 12), 2, quick ? 3.0 : 10.0);
+
+	SpscQueue<RenderCommand> queue(RenderThread::DefaultCapacity);
+	RenderCommand command;
+
+	Run("Queue push and pop", 1, [&]
+	{
+		queue.TryPush(command);
+		queue.TryPop(command);
+		Consume(command.Arrival);
+	});
+
+	HeadlessGame game(ScriptInputSession(SampleBoard::Geometry(3, 6), 1, 1));
+	HeadlessRenderClient client(game);
+
+	Run("Publish board snapshot", 1, [&]
+	{
+		client.Publish();
+	});
+
+	Run("Read board snapshot", 1, [&]
+	{
+		SnapshotReader<BoardSnapshot> const snapshot(client.m_snapshots);
+		Consume(snapshot->Games);
+	});
+}
@@ -0,0 +1,181 @@
+#include "Benchmark.h"
+#include "../Board.h"
+#include "../ImageDecoders.h"
+#include "../Metrics.h"
+#include "../SoftwareRenderer.h"
+#include "../TileCache.h"
+#include <random>
+#include <string>
+
+// Cold start against warm start of the card backs. A cold start decodes the
+// JPEG background, draws every back and writes the tile cache; a warm start
+// hashes the source, maps the cache and copies each tile once, standing in
+// for the upload. The mapped tiles are checked against the drawn backs.
+
+struct Size
+{
+	unsigned Rows;
+	unsigned Columns;
+};
+
+static void WriteJpeg(char const * path, unsigned const width, unsigned const height)
+{
+	FileHandle file(fopen(path, "wb"));
+	Check(file != nullptr, "create JPEG file");
+
+	jpeg_compress_struct info = {};
+	jpeg_error_mgr error;
+	info.err = jpeg_std_error(&error);
+	jpeg_create_compress(&info);
+	jpeg_stdio_dest(&info, file.get());
+
+	info.image_width = width;
+	info.image_height = height;
+	info.input_components = 3;
+	info.in_color_space = JCS_RGB;
+	jpeg_set_defaults(&info);
+	jpeg_set_quality(&info, 90, true);
+	jpeg_start_compress(&info, true);
+
+	std::vector<uint8_t> row(width * 3);
+	std::mt19937 generator(9);
+
+	while (info.next_scanline != height)
+	{
+		for (unsigned x = 0; x != width; ++x)
+		{
+			row[x * 3 + 0] = static_cast<uint8_t>(x * 255 / width + generator() % 8);
+			row[x * 3 + 1] = static_cast<uint8_t>(info.next_scanline * 255 / height);
+			row[x * 3 + 2] = static_cast<uint8_t>(128 + generator() % 16);
+		}
+
+		JSAMPROW pointer = row.data();
+		jpeg_write_scanlines(&info, &pointer, 1);
+	}
+
+	jpeg_finish_compress(&info);
+	jpeg_destroy_compress(&info);
+}
+
+static void BenchmarkStart(char const * source, Size const & size, float const dpi)
+{
+	BoardGeometry const geometry = SampleBoard::Geometry(size.Rows, size.Columns);
+	PhysicalLayout const layout(geometry, dpi, dpi);
+
+	std::string const cache = "TileCacheBenchmark-" + std::to_string(static_cast<int>(dpi)) + ".tiles";
+
+	TileCacheKey key;
+	key.SourceHash = HashFile(source);
+	key.DpiX = dpi;
+	key.DpiY = dpi;
+	key.TileWidth = layout.SurfaceWidth();
+	key.TileHeight = layout.SurfaceHeight();
+	key.Rows = size.Rows;
+	key.Columns = size.Columns;
+
+	auto const coldStart = [&]
+	{
+		StreamingImage image(OpenImageFile(source));
+		Check(image.Wait(image.Height()), "background decoded");
+
+		SoftwareRenderer const renderer(dpi, dpi, CardWidth, CardHeight, CardHeight / 2.0f, image.ReadyView());
+
+		Check(WriteTileCache(cache.c_str(), key, [&](unsigned const slot, PixelView const & tile)
+		{
+			renderer.DrawCardBack(tile, layout.CardLeft(slot % size.Columns), layout.CardTop(slot / size.Columns));
+		}), "tile cache written");
+	};
+
+	PixelBuffer staging(layout.SurfaceWidth(), layout.SurfaceHeight());
+
+	auto const warmStart = [&]
+	{
+		TileCacheKey current = key;
+		current.SourceHash = HashFile(source);
+
+		TileCache tiles;
+		Check(tiles.Open(cache.c_str(), current), "tile cache hit");
+
+		for (unsigned slot = 0; slot != geometry.CardCount(); ++slot)
+		{
+			CopyRect(staging.View(), tiles.Tile(slot), 0, 0);
+		}
+
+		Consume(staging.Pixels[0]);
+	};
+
+	coldStart();
+
+	// The cache must hold exactly the backs the renderer draws
+	{
+		StreamingImage image(OpenImageFile(source));
+		Check(image.Wait(image.Height()), "background decoded");
+
+		SoftwareRenderer const renderer(dpi, dpi, CardWidth, CardHeight, CardHeight / 2.0f, image.ReadyView());
+
+		TileCache tiles;
+		Check(tiles.Open(cache.c_str(), key), "tile cache hit");
+
+		PixelBuffer back(layout.SurfaceWidth(), layout.SurfaceHeight());
+
+		for (unsigned slot = 0; slot != geometry.CardCount(); ++slot)
+		{
+			renderer.DrawCardBack(back.View(), layout.CardLeft(slot % size.Columns), layout.CardTop(slot / size.Columns));
+
+			ConstPixelView const tile = tiles.Tile(slot);
+
+			for (unsigned y = 0; y != tile.Height; ++y)
+			{
+				Check(0 == memcmp(tile.Row(y), back.View().Row(y), tile.Width * sizeof(uint32_t)), "cached tile matches the drawn back");
+			}
+		}
+
+		TileCacheKey other = key;
+		other.DpiX = other.DpiY = dpi * 2.0f;
+		Check(!tiles.Open(cache.c_str(), other), "another DPI misses");
+
+		other = key;
+		other.SourceHash ^= 1;
+		Check(!tiles.Open(cache.c_str(), other), "another source misses");
+	}
+
+	std::string const name = std::to_string(size.Rows) + "x" + std::to_string(size.Columns) +
+		" @" + std::to_string(static_cast<int>(dpi));
+
+	double const cards = geometry.CardCount();
+
+	double const cold = Run(("Cold start " + name).c_str(), cards, coldStart);
+	double const warm = Run(("Warm start " + name).c_str(), cards, warmStart);
+
+	Run(("  source hash only " + name).c_str(), 1.0, [&]
+	{
+		Consume(HashFile(source));
+	});
+
+	Report(("  warm start speedup " + name).c_str(), cold / warm, "x");
+	Report(("  cache file " + name).c_str(), (sizeof(TileCacheHeader) + key.TileBytes() * geometry.CardCount()) / 1024.0, "KiB");
+
+	remove(cache.c_str());
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	char const * const source = "TileCacheBenchmark.jpg";
+	WriteJpeg(source, 3840, 2160);
+
+	Size const sizes[] =
+	{
+		{ 3, 6 },
+		{ 6, 12 },
+	};
+
+	for (float const dpi : { 96.0f, 192.0f })
+		for (Size const & size : sizes)
+		{
+			BenchmarkStart(source, size, dpi);
+		}
+
+	remove(source);
+}
@@ -0,0 +1,235 @@
+#include "Benchmark.h"
+#include "../Metrics.h"
+#include "../Trace.h"
+#include <string>
+#include <thread>
+#include <vector>
+
+// Checks that the rings keep the newest events, that snapshots taken while
+// other threads record are consistent and that the binary format reads back
+// what was written. Then measures the cost of an event, which must stay
+// under EventBudget nanoseconds, and of exporting a full trace.
+
+static double const EventBudget = 50.0;
+
+static void CheckRing()
+{
+	Tracer tracer(8);
+
+	for (uint64_t i = 0; i != 20; ++i)
+	{
+		tracer.Record("Event", i * 10, 5, i);
+	}
+
+	TraceSnapshot const snapshot = tracer.Collect();
+
+	Check(snapshot.Threads.size() == 1, "one ring per thread");
+	Check(snapshot.Names.size() == 1 && snapshot.Names[0] == "Event", "names stored once");
+
+	TraceThread const & thread = snapshot.Threads[0];
+
+	Check(thread.Dropped == 13, "oldest events dropped");
+	Check(thread.Records.size() == 7, "ring full but for the slot being written");
+
+	for (unsigned i = 0; i != thread.Records.size(); ++i)
+	{
+		Check(thread.Records[i].Argument == 13 + i, "newest events kept in order");
+	}
+}
+
+// Each writer records a count as the argument, so a consistent snapshot of
+// a thread is a run of consecutive numbers starting at the dropped count
+static void CheckThread(TraceThread const & thread)
+{
+	for (size_t i = 0; i != thread.Records.size(); ++i)
+	{
+		Check(thread.Records[i].Argument == thread.Dropped + i, "snapshot consistent while recording");
+	}
+}
+
+static TraceSnapshot CheckConcurrent(unsigned const writers, uint64_t const events)
+{
+	Tracer tracer(1024);
+	std::atomic<unsigned> done(0);
+	std::vector<std::thread> threads;
+
+	for (unsigned i = 0; i != writers; ++i)
+	{
+		threads.emplace_back([&]
+		{
+			tracer.NameThread("Writer");
+
+			for (uint64_t count = 0; count != events; ++count)
+			{
+				TraceScope const scope(tracer, count % 2 ? "Odd" : "Even", count);
+			}
+
+			++done;
+		});
+	}
+
+	unsigned snapshots = 0;
+
+	while (done != writers)
+	{
+		TraceSnapshot const snapshot = tracer.Collect();
+
+		for (TraceThread const & thread : snapshot.Threads)
+		{
+			CheckThread(thread);
+		}
+
+		++snapshots;
+	}
+
+	for (std::thread & thread : threads)
+	{
+		thread.join();
+	}
+
+	TraceSnapshot const snapshot = tracer.Collect();
+
+	Check(snapshot.Threads.size() == writers, "one ring per writer");
+
+	for (TraceThread const & thread : snapshot.Threads)
+	{
+		CheckThread(thread);
+		Check(thread.Name == "Writer", "thread named");
+		Check(thread.Dropped + thread.Records.size() == events, "every event counted");
+	}
+
+	Report("  snapshots taken while recording", snapshots, "");
+
+	return snapshot;
+}
+
+static void CheckExport(TraceSnapshot const & snapshot)
+{
+	std::vector<uint8_t> const binary = ExportBinaryTrace(snapshot);
+
+	TraceSnapshot imported;
+	Check(ImportBinaryTrace(binary.data(), binary.size(), imported), "binary trace read");
+	Check(imported == snapshot, "binary trace reads back the snapshot");
+
+	Check(!ImportBinaryTrace(binary.data(), binary.size() - 1, imported), "truncated trace rejected");
+
+	std::string const json = ExportChromeTrace(snapshot);
+	size_t events = 0;
+
+	for (size_t found = json.find("\"ph\":\"X\""); found != std::string::npos; found = json.find("\"ph\":\"X\"", found + 1))
+	{
+		++events;
+	}
+
+	Check(0 == json.find("{\"displayTimeUnit") && json.back() == '\n', "JSON object");
+	Check(events == snapshot.RecordCount(), "one complete event per record");
+
+	// Thread names are escaped as event names are
+	TraceSnapshot named;
+	named.Names.push_back("Say \"hi\"");
+	named.Threads.resize(1);
+	named.Threads[0].Id = 1;
+	named.Threads[0].Name = "C:\\Work \"main\"";
+	named.Threads[0].Records.push_back({ 0, 0, 1, 0 });
+
+	std::string const escaped = ExportChromeTrace(named);
+
+	Check(std::string::npos != escaped.find("\"args\":{\"name\":\"C:\\\\Work \\\"main\\\"\"}}"), "thread name escaped");
+	Check(std::string::npos != escaped.find("{\"name\":\"Say \\\"hi\\\"\""), "event name escaped");
+}
+
+static void BenchmarkEvents()
+{
+	unsigned const count = 1000;
+	Tracer tracer;
+
+	double const clock = Run("Clock read", count, [&]
+	{
+		for (unsigned i = 0; i != count; ++i)
+		{
+			Consume(TraceClock::Now());
+		}
+	});
+
+	double const scoped = Run("Scoped event", count, [&]
+	{
+		for (unsigned i = 0; i != count; ++i)
+		{
+			TraceScope const scope(tracer, "Scope", i);
+		}
+	});
+
+	Run("  recorded with given times", count, [&]
+	{
+		for (unsigned i = 0; i != count; ++i)
+		{
+			tracer.Record("Record", i, 1, i);
+		}
+	});
+
+	// A scoped event reads the clock twice, and the budget includes both
+	Report("  scoped event clock reads", 2.0 * clock, "ns/item");
+
+	Check(scoped < EventBudget, "scoped event within budget");
+
+	// Every thread records into its own ring, so writers do not slow each
+	// other down. Reported per core in use.
+	unsigned const cores = std::max(1u, std::thread::hardware_concurrency());
+
+	for (unsigned const writers : { 2u, 4u, 8u })
+	{
+		uint64_t const events = static_cast<uint64_t>(BenchmarkMinimumSeconds * 4000000);
+		std::vector<std::thread> threads;
+		Stopwatch const stopwatch;
+
+		for (unsigned i = 0; i != writers; ++i)
+		{
+			threads.emplace_back([&]
+			{
+				for (uint64_t event = 0; event != events; ++event)
+				{
+					TraceScope const scope(tracer, "Scope", event);
+				}
+			});
+		}
+
+		for (std::thread & thread : threads)
+		{
+			thread.join();
+		}
+
+		double const perEvent = stopwatch.ElapsedSeconds() * 1e9 * std::min(writers, cores) / (events * writers);
+
+		Report(("  scoped event, " + std::to_string(writers) + " threads").c_str(), perEvent, "ns/event");
+	}
+
+	TraceSnapshot const snapshot = tracer.Collect();
+	double const records = static_cast<double>(snapshot.RecordCount());
+
+	Run("Export Chrome trace", records, [&]
+	{
+		Consume(ExportChromeTrace(snapshot).size());
+	});
+
+	Run("Export binary trace", records, [&]
+	{
+		Consume(ExportBinaryTrace(snapshot).size());
+	});
+
+	Run("Collect", records, [&]
+	{
+		Consume(tracer.Collect().Threads.size());
+	});
+
+	Report("  Chrome trace size", ExportChromeTrace(snapshot).size() / records, "bytes/event");
+	Report("  binary trace size", ExportBinaryTrace(snapshot).size() / records, "bytes/event");
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	CheckRing();
+	CheckExport(CheckConcurrent(4, 200000));
+	BenchmarkEvents();
+}
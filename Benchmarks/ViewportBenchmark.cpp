@@ -0,0 +1,291 @@
+#include "Benchmark.h"
+#include "../RecordingCompositor.h"
+#include "../VirtualBoardScene.h"
+#include <random>
+#include <string>
+
+// Compares the surface memory and compositor objects of the full scene with
+// those of the virtual scene, which only gives faces to the cards in a
+// 1280x720 view, as boards grow to 50,000 cards. Scrolls and zooms across
+// every board, checking that exactly the cards in view have faces and that
+// the pool stops growing once it covers the largest view, then times the
+// scrolling.
+
+static float const ViewWidth = 1280.0f;
+static float const ViewHeight = 720.0f;
+static unsigned const Prefetch = 1;
+
+struct Size
+{
+	unsigned Rows;
+	unsigned Columns;
+};
+
+static bool Near(float const a, float const b)
+{
+	return std::fabs(a - b) <= 0.001f * std::max(1.0f, std::fabs(b));
+}
+
+static void CheckViewport()
+{
+	BoardViewport viewport(ViewWidth, ViewHeight);
+	viewport.Left = 300.0f;
+	viewport.Top = 200.0f;
+
+	float const x = viewport.BoardX(640.0f);
+	float const y = viewport.BoardY(100.0f);
+
+	viewport.ZoomAt(2.0f, 640.0f, 100.0f);
+
+	Check(viewport.Zoom == 2.0f && Near(viewport.BoardX(640.0f), x) && Near(viewport.BoardY(100.0f), y), "zoom keeps the point under the cursor");
+
+	Vector4 const client = viewport.Transform().Transform(Vector4 { x, y, 0.0f, 1.0f });
+	Check(Near(client.X, 640.0f) && Near(client.Y, 100.0f), "transform maps board to client points");
+
+	viewport.ZoomAt(100.0f, 0.0f, 0.0f);
+	Check(viewport.Zoom == BoardViewport::MaximumZoom, "zoom limited");
+
+	viewport.Zoom = 1.0f;
+	viewport.Left = -50.0f;
+	viewport.Top = 5000.0f;
+	viewport.Clamp(4000.0f, 3000.0f);
+	Check(viewport.Left == 0.0f && viewport.Top == 3000.0f - ViewHeight, "view kept on the board");
+
+	viewport.Clamp(1000.0f, 3000.0f);
+	Check(viewport.Left == (1000.0f - ViewWidth) / 2.0f, "small board centered");
+}
+
+// Every card the view touches that is still in play has faces, and only
+// cards within the prefetch margin of the view do
+static void CheckFaces(Board const & board,
+	PhysicalLayout const & layout,
+	BoardViewport const & viewport,
+	VirtualBoardScene const & scene)
+{
+	BoardGeometry const & geometry = layout.Geometry;
+	float const pitchX = layout.CardLeft(1) - layout.CardLeft(0);
+	float const pitchY = layout.CardTop(1) - layout.CardTop(0);
+	unsigned live = 0;
+
+	for (unsigned row = 0; row != geometry.Rows; ++row)
+		for (unsigned column = 0; column != geometry.Columns; ++column)
+		{
+			unsigned const index = row * geometry.Columns + column;
+
+			float const left = layout.CardLeft(column);
+			float const top = layout.CardTop(row);
+
+			bool const shown =
+				left < viewport.Left + viewport.Width() && left + layout.CardWidth() > viewport.Left &&
+				top < viewport.Top + viewport.Height() && top + layout.CardHeight() > viewport.Top;
+
+			bool const near =
+				left < viewport.Left + viewport.Width() + (Prefetch + 1) * pitchX && left + layout.CardWidth() > viewport.Left - (Prefetch + 1) * pitchX &&
+				top < viewport.Top + viewport.Height() + (Prefetch + 1) * pitchY && top + layout.CardHeight() > viewport.Top - (Prefetch + 1) * pitchY;
+
+			bool const matched = board[index].Status == CardStatus::Matched;
+
+			if (shown && !matched) Check(scene.Contains(index), "card in view has faces");
+			if (!near || matched) Check(!scene.Contains(index), "card far from view has none");
+
+			live += scene.Contains(index);
+		}
+
+	Check(live == scene.LiveCount(), "slots in use counted");
+}
+
+static void DrawBacks(VirtualBoardScene const & scene,
+	std::vector<unsigned> & backs,
+	PixelBuffer const & tile)
+{
+	for (unsigned const index : backs)
+	{
+		CardTile const & back = scene.BackTile(index);
+		back.Surface->Upload(back.Rect.Left, back.Rect.Top, tile.View());
+	}
+
+	backs.clear();
+}
+
+static float RotationAngle(VirtualBoardScene const & scene, unsigned const index)
+{
+	return static_cast<RecordingRotateTransform const &>(*scene.m_slots[scene.m_cardSlots[index]].Card.Rotation).m_angle;
+}
+
+struct Footprint
+{
+	uint64_t Bytes;
+	unsigned Objects;
+};
+
+static Footprint FullScene(Board const & board,
+	PhysicalLayout const & layout)
+{
+	RecordingCompositor compositor(false);
+	BoardScene scene(compositor, board.CardCount());
+	CardAtlas const atlas(board, layout.SurfaceWidth(), layout.SurfaceHeight());
+	ScenePages const pages = scene.CreatePages(atlas);
+
+	scene.Build(board, atlas, pages, layout);
+	compositor.Commit();
+
+	return Footprint { compositor.LiveSurfaceBytes(), compositor.LiveObjects() };
+}
+
+static Footprint BenchmarkBoard(Size const & size)
+{
+	BoardGeometry const geometry = SampleBoard::Geometry(size.Rows, size.Columns);
+	PhysicalLayout const layout(geometry, 96.0f, 96.0f);
+	Board board(geometry);
+	std::mt19937 generator(17);
+	board.Shuffle(generator);
+	board.Arrange(layout.DpiX, layout.DpiY);
+
+	// Some cards matched already
+	for (unsigned index = 3; index < board.CardCount(); index += 11)
+	{
+		board[index].Status = CardStatus::Matched;
+	}
+
+	std::string const name = std::to_string(size.Rows) + "x" + std::to_string(size.Columns);
+	PixelBuffer const tile(layout.SurfaceWidth(), layout.SurfaceHeight());
+
+	RecordingCompositor compositor(false);
+	VirtualBoardScene scene(compositor, Prefetch);
+	BoardViewport viewport(ViewWidth, ViewHeight);
+	std::vector<unsigned> backs;
+
+	scene.SetLayout(board, layout);
+	scene.Update(board, viewport, backs);
+	DrawBacks(scene, backs, tile);
+	compositor.Commit();
+
+	CheckFaces(board, layout, viewport, scene);
+
+	// A card selected in view keeps its state when it scrolls out and back
+	unsigned const selected = board[0].Status == CardStatus::Matched ? 1 : 0;
+	board[selected].Status = CardStatus::Selected;
+
+	// Across every row, down by a third of the view a time
+	float const boardWidth = static_cast<float>(layout.ClientWidth());
+	float const boardHeight = static_cast<float>(layout.ClientHeight());
+	unsigned peak = scene.LiveCount();
+	unsigned frames = 0;
+	uint64_t uploads = 0;
+
+	for (float top = 0.0f; top < boardHeight; top += ViewHeight / 3.0f)
+		for (float left = 0.0f; left < boardWidth; left += ViewWidth / 3.0f)
+		{
+			viewport.Left = left;
+			viewport.Top = top;
+			viewport.Clamp(boardWidth, boardHeight);
+
+			scene.Update(board, viewport, backs);
+			uploads += backs.size();
+			DrawBacks(scene, backs, tile);
+			compositor.Commit();
+
+			CheckFaces(board, layout, viewport, scene);
+
+			peak = std::max(peak, scene.LiveCount());
+			++frames;
+		}
+
+	// Rounded up to whole rows of tiles on each page
+	Check(scene.SlotCount() < peak + scene.m_slotColumns * scene.m_slotPages.size(), "pool no larger than the largest view");
+
+	// Back to the start with the selected card face up
+	viewport.Left = 0.0f;
+	viewport.Top = 0.0f;
+	scene.Update(board, viewport, backs);
+	DrawBacks(scene, backs, tile);
+	compositor.Commit();
+
+	Check(scene.Contains(selected) && RotationAngle(scene, selected) == static_cast<float>(FaceUpAngle), "selected card face up again");
+
+	uint64_t const scrolledBytes = compositor.LiveSurfaceBytes();
+
+	Check(scrolledBytes == scene.SurfaceBytes(), "surfaces counted");
+
+	// Zoomed out, four times the cards are in view
+	viewport.ZoomAt(0.5f, ViewWidth / 2.0f, ViewHeight / 2.0f);
+	viewport.Clamp(boardWidth, boardHeight);
+	scene.Update(board, viewport, backs);
+	DrawBacks(scene, backs, tile);
+	compositor.Commit();
+
+	CheckFaces(board, layout, viewport, scene);
+
+	unsigned const zoomedSlots = scene.SlotCount();
+	uint64_t const zoomedBytes = compositor.LiveSurfaceBytes();
+
+	// Zoomed in again, the pool keeps its slots for the next zoom
+	viewport.Zoom = 1.0f;
+	scene.Update(board, viewport, backs);
+	DrawBacks(scene, backs, tile);
+	compositor.Commit();
+
+	CheckFaces(board, layout, viewport, scene);
+	Check(scene.SlotCount() == zoomedSlots, "slots kept for reuse");
+
+	Footprint const full = FullScene(board, layout);
+
+	Report(("  surface MB full " + name).c_str(), full.Bytes / 1048576.0, "MB");
+	Report(("  surface MB virtual " + name).c_str(), scrolledBytes / 1048576.0, "MB");
+	Report(("  surface MB virtual zoomed out " + name).c_str(), zoomedBytes / 1048576.0, "MB");
+	Report(("  objects full " + name).c_str(), full.Objects, "");
+	Report(("  objects virtual " + name).c_str(), compositor.LiveObjects(), "");
+	Report(("  slots virtual " + name).c_str(), peak, "");
+	Report(("  backs drawn per scroll " + name).c_str(), frames ? static_cast<double>(uploads) / frames : 0.0, "");
+
+	// A row or a column of cards at a time, back and forth
+	float const pitchY = layout.CardTop(1) - layout.CardTop(0);
+	float const startTop = std::min(boardHeight / 2.0f, std::max(0.0f, boardHeight - ViewHeight - pitchY));
+	unsigned step = 0;
+
+	viewport.Left = 0.0f;
+	viewport.Top = startTop;
+
+	Run(("Scroll one row " + name).c_str(), 1, [&]
+	{
+		viewport.Top = startTop + (++step % 2) * pitchY;
+
+		scene.Update(board, viewport, backs);
+		DrawBacks(scene, backs, tile);
+		compositor.Commit();
+		compositor.ClearRecording();
+
+		Consume(scene.LiveCount());
+	});
+
+	return Footprint { scrolledBytes, compositor.LiveObjects() };
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkInitialize(argc, argv);
+
+	CheckViewport();
+
+	Size const sizes[] =
+	{
+		{ 10, 10 },
+		{ 50, 50 },
+		{ 100, 100 },
+		{ 200, 250 },
+	};
+
+	std::vector<Footprint> footprints;
+
+	for (Size const & size : sizes)
+	{
+		footprints.push_back(BenchmarkBoard(size));
+	}
+
+	// Boards many views across all take the same
+	for (size_t size = 2; size != footprints.size(); ++size)
+	{
+		Check(footprints[size].Bytes == footprints[1].Bytes, "memory bounded by the view");
+		Check(footprints[size].Objects == footprints[1].Objects, "objects bounded by the view");
+	}
+}
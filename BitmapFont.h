@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Built-in 5x7 dot font for the letters A-Z and a-z. The software renderer
+// has no access to DirectWrite, so card faces are drawn from these dots,
+// supersampled into an antialiased coverage mask.
+
+static unsigned const BitmapFontColumns = 5;
+static unsigned const BitmapFontRows = 7;
+
+static unsigned char const BitmapFontGlyphs[52][BitmapFontRows] =
+{
+	{ 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 }, // A
+	{ 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E }, // B
+	{ 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E }, // C
+	{ 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C }, // D
+	{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F }, // E
+	{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 }, // F
+	{ 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F }, // G
+	{ 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 }, // H
+	{ 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E }, // I
+	{ 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C }, // J
+	{ 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 }, // K
+	{ 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F }, // L
+	{ 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 }, // M
+	{ 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 }, // N
+	{ 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, // O
+	{ 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 }, // P
+	{ 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D }, // Q
+	{ 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 }, // R
+	{ 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E }, // S
+	{ 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 }, // T
+	{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, // U
+	{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 }, // V
+	{ 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A }, // W
+	{ 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 }, // X
+	{ 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 }, // Y
+	{ 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F }, // Z
+	{ 0x00, 0x00, 0x0E, 0x01, 0x0F, 0x11, 0x0F }, // a
+	{ 0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x1E }, // b
+	{ 0x00, 0x00, 0x0E, 0x10, 0x10, 0x11, 0x0E }, // c
+	{ 0x01, 0x01, 0x0D, 0x13, 0x11, 0x11, 0x0F }, // d
+	{ 0x00, 0x00, 0x0E, 0x11, 0x1F, 0x10, 0x0E }, // e
+	{ 0x06, 0x09, 0x08, 0x1C, 0x08, 0x08, 0x08 }, // f
+	{ 0x00, 0x0F, 0x11, 0x11, 0x0F, 0x01, 0x0E }, // g
+	{ 0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x11 }, // h
+	{ 0x04, 0x00, 0x0C, 0x04, 0x04, 0x04, 0x0E }, // i
+	{ 0x02, 0x00, 0x06, 0x02, 0x02, 0x12, 0x0C }, // j
+	{ 0x10, 0x10, 0x12, 0x14, 0x18, 0x14, 0x12 }, // k
+	{ 0x0C, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E }, // l
+	{ 0x00, 0x00, 0x1A, 0x15, 0x15, 0x11, 0x11 }, // m
+	{ 0x00, 0x00, 0x16, 0x19, 0x11, 0x11, 0x11 }, // n
+	{ 0x00, 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E }, // o
+	{ 0x00, 0x00, 0x1E, 0x11, 0x1E, 0x10, 0x10 }, // p
+	{ 0x00, 0x00, 0x0D, 0x13, 0x0F, 0x01, 0x01 }, // q
+	{ 0x00, 0x00, 0x16, 0x19, 0x10, 0x10, 0x10 }, // r
+	{ 0x00, 0x00, 0x0E, 0x10, 0x0E, 0x01, 0x1E }, // s
+	{ 0x08, 0x08, 0x1C, 0x08, 0x08, 0x09, 0x06 }, // t
+	{ 0x00, 0x00, 0x11, 0x11, 0x11, 0x13, 0x0D }, // u
+	{ 0x00, 0x00, 0x11, 0x11, 0x11, 0x0A, 0x04 }, // v
+	{ 0x00, 0x00, 0x11, 0x11, 0x15, 0x15, 0x0A }, // w
+	{ 0x00, 0x00, 0x11, 0x0A, 0x04, 0x0A, 0x11 }, // x
+	{ 0x00, 0x00, 0x11, 0x11, 0x0F, 0x01, 0x0E }, // y
+	{ 0x00, 0x00, 0x1F, 0x02, 0x04, 0x08, 0x1F }, // z
+};
+
+// 8-bit coverage, 0 is transparent and 255 fully covered. Left and Top place
+// the mask within the card face it is drawn on.
+struct CoverageMask
+{
+	int Left = 0;
+	int Top = 0;
+	unsigned Width = 0;
+	unsigned Height = 0;
+	std::vector<uint8_t> Alpha;
+
+	uint8_t const * Row(unsigned const y) const
+	{
+		return Alpha.data() + y * Width;
+	}
+};
+
+// Returns the dot rows for the character or nullptr if it has no glyph.
+inline unsigned char const * BitmapFontGlyph(wchar_t const value)
+{
+	if (value >= L'A' && value <= L'Z') return BitmapFontGlyphs[value - L'A'];
+	if (value >= L'a' && value <= L'z') return BitmapFontGlyphs[26 + value - L'a'];
+	return nullptr;
+}
+
+// Rasterizes the glyph with its cap height at roughly 70% of the em size,
+// in physical pixels. Each pixel is sampled 4x4 times.
+inline CoverageMask RasterizeBitmapGlyph(wchar_t const value,
+	float const emSize)
+{
+	CoverageMask mask;
+
+	unsigned char const * glyph = BitmapFontGlyph(value);
+
+	if (!glyph) return mask;
+
+	float const dot = emSize * 0.7f / BitmapFontRows;
+
+	mask.Width = static_cast<unsigned>(std::ceil(dot * BitmapFontColumns));
+	mask.Height = static_cast<unsigned>(std::ceil(dot * BitmapFontRows));
+	mask.Alpha.resize(mask.Width * mask.Height);
+
+	unsigned const samples = 4;
+
+	for (unsigned y = 0; y != mask.Height; ++y)
+		for (unsigned x = 0; x != mask.Width; ++x)
+		{
+			unsigned covered = 0;
+
+			for (unsigned sy = 0; sy != samples; ++sy)
+				for (unsigned sx = 0; sx != samples; ++sx)
+				{
+					unsigned const row = static_cast<unsigned>((y + (sy + 0.5f) / samples) / dot);
+					unsigned const column = static_cast<unsigned>((x + (sx + 0.5f) / samples) / dot);
+
+					if (row < BitmapFontRows &&
+						column < BitmapFontColumns &&
+						(glyph[row] >> (BitmapFontColumns - 1 - column) & 1))
+					{
+						++covered;
+					}
+				}
+
+			mask.Alpha[y * mask.Width + x] = static_cast<uint8_t>(covered * 255 / (samples * samples));
+		}
+
+	return mask;
+}
@@ -0,0 +1,364 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <initializer_list>
+#include <random>
+#include <utility>
+#include <vector>
+#include "Debug.h"
+#include "Layout.h"
+#include "Random.h"
+
+// Platform neutral card board. Holds the game state that used to live on
+// SampleWindow so that it can be built and profiled without Windows headers.
+
+enum class CardStatus
+{
+	Hidden,
+	Selected,
+	Matched
+};
+
+struct Card
+{
+	CardStatus Status = CardStatus::Hidden;
+	wchar_t Value = L' ';
+	float OffsetX = 0.0f;
+	float OffsetY = 0.0f;
+};
+
+// The letters cards are dealt from, each the first of a pair. A letter's
+// partner is 'a' - 'A' after it, as IsMatch expects, which holds for the
+// upper and lower case of the Latin, Greek and Cyrillic alphabets alike.
+struct CardAlphabet
+{
+	std::vector<wchar_t> Letters;
+
+	unsigned Size() const
+	{
+		return static_cast<unsigned>(Letters.size());
+	}
+
+	static wchar_t Partner(wchar_t const letter)
+	{
+		return static_cast<wchar_t>(letter + (L'a' - L'A'));
+	}
+
+	// A to Z, the sample's
+	static CardAlphabet const & Latin()
+	{
+		static CardAlphabet const alphabet = Ranges({ { L'A', L'Z' } });
+		return alphabet;
+	}
+
+	// Latin, Greek and Cyrillic capitals, 82 pairs before a letter repeats.
+	// There is no capital final sigma.
+	static CardAlphabet const & Extended()
+	{
+		static CardAlphabet const alphabet = Ranges({ { L'A', L'Z' }, { 0x391, 0x3A1 }, { 0x3A3, 0x3A9 }, { 0x410, 0x42F } });
+		return alphabet;
+	}
+
+	// Inclusive ranges of letters
+	static CardAlphabet Ranges(std::initializer_list<std::pair<wchar_t, wchar_t>> const ranges)
+	{
+		CardAlphabet alphabet;
+
+		for (std::pair<wchar_t, wchar_t> const & range : ranges)
+		{
+			for (wchar_t letter = range.first; letter <= range.second; ++letter)
+			{
+				alphabet.Letters.push_back(letter);
+			}
+		}
+
+		return alphabet;
+	}
+};
+
+// Deals the values of a new game of count cards in linear time. Every
+// letter is used once before any is used again, the letters of an
+// unfinished last round are picked at random, and the values are then
+// shuffled by Fisher-Yates, packed apart from the cards so that the random
+// swaps stay in cache longer. The generator's state alone decides the deal,
+// so a seed replays it. Values holds the cards' values first and the
+// alphabet after them, as scratch.
+template <typename Generator>
+void DealCardValues(CardAlphabet const & alphabet,
+	Generator & generator,
+	unsigned const count,
+	std::vector<wchar_t> & values)
+{
+	ASSERT(alphabet.Size() != 0 && count % 2 == 0);
+
+	unsigned const pairs = count / 2;
+	unsigned const letters = alphabet.Size();
+	unsigned const rest = pairs % letters;
+
+	// The alphabet's first rest letters are picked for the last round
+	values.resize(count + letters);
+	wchar_t * const picked = values.data() + count;
+
+	std::copy(alphabet.Letters.begin(), alphabet.Letters.end(), picked);
+
+	for (unsigned i = 0; i != rest; ++i)
+	{
+		std::swap(picked[i], picked[i + RandomBelow(generator, letters - i)]);
+	}
+
+	unsigned pair = 0;
+
+	for (; pair + letters <= pairs; pair += letters)
+	{
+		for (unsigned letter = 0; letter != letters; ++letter)
+		{
+			values[(pair + letter) * 2 + 0] = alphabet.Letters[letter];
+			values[(pair + letter) * 2 + 1] = CardAlphabet::Partner(alphabet.Letters[letter]);
+		}
+	}
+
+	for (unsigned letter = 0; letter != rest; ++letter)
+	{
+		values[(pair + letter) * 2 + 0] = picked[letter];
+		values[(pair + letter) * 2 + 1] = CardAlphabet::Partner(picked[letter]);
+	}
+
+	for (unsigned i = count - 1; i > 0; --i)
+	{
+		std::swap(values[i], values[RandomBelow(generator, i + 1)]);
+	}
+}
+
+enum class SelectionResult
+{
+	None,
+	Selected,
+	Matched,
+	Mismatched
+};
+
+struct Selection
+{
+	SelectionResult Result = SelectionResult::None;
+	unsigned First = 0;
+	unsigned Second = 0;
+};
+
+struct Board
+{
+	static unsigned const NoCard = ~0u;
+
+	BoardGeometry m_geometry;
+	BoardLayout m_layout;
+	std::vector<Card> m_cards;
+	unsigned m_firstCard = NoCard;
+
+	explicit Board(BoardGeometry const & geometry) :
+		m_geometry(geometry),
+		m_layout(geometry),
+		m_cards(geometry.CardCount())
+	{
+		ASSERT(geometry.CardCount() % 2 == 0);
+	}
+
+	unsigned CardCount() const
+	{
+		return static_cast<unsigned>(m_cards.size());
+	}
+
+	Card & operator[](unsigned const index)
+	{
+		ASSERT(index < m_cards.size());
+		return m_cards[index];
+	}
+
+	Card const & operator[](unsigned const index) const
+	{
+		ASSERT(index < m_cards.size());
+		return m_cards[index];
+	}
+
+	std::vector<Card>::iterator begin() { return m_cards.begin(); }
+	std::vector<Card>::iterator end() { return m_cards.end(); }
+	std::vector<Card>::const_iterator begin() const { return m_cards.begin(); }
+	std::vector<Card>::const_iterator end() const { return m_cards.end(); }
+
+	template <typename Generator>
+	void Shuffle(Generator & generator)
+	{
+		Deal(CardAlphabet::Latin(), generator);
+	}
+
+	// Deals a new game in linear time, as DealCardValues
+	template <typename Generator>
+	void Deal(CardAlphabet const & alphabet,
+		Generator & generator)
+	{
+		std::vector<wchar_t> values;
+		DealCardValues(alphabet, generator, CardCount(), values);
+
+		for (unsigned i = 0; i != CardCount(); ++i)
+		{
+			m_cards[i].Value = values[i];
+			m_cards[i].Status = CardStatus::Hidden;
+		}
+
+		m_firstCard = NoCard;
+	}
+
+	// Computes the physical offset of every card for the given DPI.
+	void Arrange(float const dpiX,
+		float const dpiY)
+	{
+		Arrange(m_layout, dpiX, dpiY);
+	}
+
+	// As above with the offsets from a layout table of the same size, such
+	// as a StaticBoardLayout
+	template <typename Table>
+	void Arrange(Table const & table,
+		float const dpiX,
+		float const dpiY)
+	{
+		ASSERT(table.Rows() == m_geometry.Rows && table.Columns() == m_geometry.Columns);
+
+		for (unsigned row = 0; row != table.Rows(); ++row)
+		{
+			float const top = LogicalToPhysical(table.CardTop(row), dpiY);
+
+			for (unsigned column = 0; column != table.Columns(); ++column)
+			{
+				Card & card = m_cards[row * table.Columns() + column];
+
+				card.OffsetX = LogicalToPhysical(table.CardLeft(column), dpiX);
+				card.OffsetY = top;
+			}
+		}
+	}
+
+	// Returns true if the physical point is strictly inside the card.
+	bool CardContains(unsigned const index,
+		float const x,
+		float const y,
+		float const width,
+		float const height) const
+	{
+		Card const & card = m_cards[index];
+
+		return x > card.OffsetX &&
+			y > card.OffsetY &&
+			x < (card.OffsetX + width) &&
+			y < (card.OffsetY + height);
+	}
+
+	// Returns the index of the card under the physical point or NoCard.
+	// The cards sit on a regular grid so the slot is computed directly rather
+	// than scanning the board. Rounding can only misplace a point that lies on
+	// the leading edge of a card into the previous slot, so that slot is
+	// checked as well.
+	unsigned CardAtPoint(float const x,
+		float const y,
+		float const dpiX,
+		float const dpiY) const
+	{
+		return CardAtPoint(m_layout, x, y, dpiX, dpiY);
+	}
+
+	template <typename Table>
+	unsigned CardAtPoint(Table const & table,
+		float const x,
+		float const y,
+		float const dpiX,
+		float const dpiY) const
+	{
+		float const width = LogicalToPhysical(table.CardWidth(), dpiX);
+		float const height = LogicalToPhysical(table.CardHeight(), dpiY);
+
+		float const pitchX = LogicalToPhysical(table.PitchX(), dpiX);
+		float const pitchY = LogicalToPhysical(table.PitchY(), dpiY);
+
+		float const column = std::floor((x - LogicalToPhysical(table.Margin(), dpiX)) / pitchX);
+		float const row = std::floor((y - LogicalToPhysical(table.Margin(), dpiY)) / pitchY);
+
+		for (float r = row; r >= row - 1.0f; r -= 1.0f)
+		{
+			if (r < 0.0f || r >= table.Rows()) continue;
+
+			for (float c = column; c >= column - 1.0f; c -= 1.0f)
+			{
+				if (c < 0.0f || c >= table.Columns()) continue;
+
+				unsigned const index = static_cast<unsigned>(r) * table.Columns() + static_cast<unsigned>(c);
+
+				if (CardContains(index, x, y, width, height))
+				{
+					return index;
+				}
+			}
+		}
+
+		return NoCard;
+	}
+
+	static bool IsMatch(wchar_t const first, wchar_t const second)
+	{
+		int const expected = 'a' - 'A';
+
+		int const actual = std::abs(first - second);
+
+		return expected == actual;
+	}
+
+	// Returns true if selecting the card would change the board.
+	bool CanSelect(unsigned const index) const
+	{
+		return index != NoCard &&
+			index != m_firstCard &&
+			m_cards[index].Status != CardStatus::Matched;
+	}
+
+	// Flips the card at index and resolves a match against the first
+	// selected card, if any.
+	Selection Select(unsigned const index)
+	{
+		Selection selection;
+
+		if (!CanSelect(index)) return selection;
+
+		Card & next = m_cards[index];
+
+		if (m_firstCard == NoCard)
+		{
+			m_firstCard = index;
+			next.Status = CardStatus::Selected;
+
+			selection.Result = SelectionResult::Selected;
+			selection.First = index;
+			selection.Second = index;
+		}
+		else
+		{
+			Card & first = m_cards[m_firstCard];
+			first.Status = CardStatus::Hidden;
+
+			if (IsMatch(first.Value, next.Value))
+			{
+				first.Status = next.Status = CardStatus::Matched;
+				selection.Result = SelectionResult::Matched;
+			}
+			else
+			{
+				selection.Result = SelectionResult::Mismatched;
+			}
+
+			selection.First = m_firstCard;
+			selection.Second = index;
+
+			m_firstCard = NoCard;
+		}
+
+		return selection;
+	}
+};
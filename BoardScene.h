@@ -0,0 +1,591 @@
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "Atlas.h"
+#include "Board.h"
+#include "Compositor.h"
+#include "Interaction.h"
+#include "Layout.h"
+
+// The board's visual tree, built through the compositor interface. Each card
+// has a front and a back face that share one rotation; the faces show tiles
+// of the atlas pages. Drawing the tiles is left to the card renderers. Cards
+// and pages the scene stops using are pooled for the next game.
+
+// A card sized region of an atlas page
+struct CardTile
+{
+	std::shared_ptr<CompositorSurface> Surface;
+	AtlasRect Rect;
+
+	CardTile(std::shared_ptr<CompositorSurface> const & surface,
+		AtlasRect const & rect) :
+		Surface(surface),
+		Rect(rect)
+	{}
+};
+
+typedef std::vector<std::shared_ptr<CompositorSurface>> ScenePages;
+
+// One side of a card positioned on the board, showing one tile of an atlas
+// page. The outer visual carries the offset, clip and flip effect in card
+// space; the inner visual shifts the page so that the tile lands at the
+// origin. Everything that depends on the DPI can be changed in place. The
+// matrices around the rotation are shared by every face of the same size
+// and side; only the group that joins them to the card's rotation is the
+// face's own.
+struct CardFace
+{
+	std::shared_ptr<CompositorVisual> Visual;
+	std::shared_ptr<CompositorVisual> Content;
+	std::shared_ptr<CompositorMatrixTransform> Pre;
+	std::shared_ptr<CompositorMatrixTransform> Post;
+	CompositorSurface const * Page = nullptr; // what Content shows, not owned
+
+	// Lets go of the page if it is one of these
+	void Detach(ScenePages const & pages)
+	{
+		if (!Page) return;
+
+		for (std::shared_ptr<CompositorSurface> const & page : pages)
+		{
+			if (page.get() != Page) continue;
+
+			Content->SetContent(nullptr);
+			Page = nullptr;
+			return;
+		}
+	}
+};
+
+// The matrix transforms for faces of one size. Faces laid out at another
+// size keep theirs until they move to the new one.
+struct FaceTransforms
+{
+	float Width = 0.0f;
+	float Height = 0.0f;
+	std::shared_ptr<CompositorMatrixTransform> FrontPre;
+	std::shared_ptr<CompositorMatrixTransform> BackPre;
+	std::shared_ptr<CompositorMatrixTransform> Post;
+};
+
+// Face transforms of every size in use on one compositor device, so that
+// the boards sharing the device share them as well. Entries are weak: the
+// faces keep the transforms alive, and a size no face uses is dropped.
+struct FaceTransformCache
+{
+	struct Entry
+	{
+		float Width;
+		float Height;
+		std::weak_ptr<CompositorMatrixTransform> FrontPre;
+		std::weak_ptr<CompositorMatrixTransform> BackPre;
+		std::weak_ptr<CompositorMatrixTransform> Post;
+	};
+
+	std::vector<Entry> m_entries;
+
+	// Returns false if no face of the size is left
+	bool Find(float const width,
+		float const height,
+		FaceTransforms & transforms) const
+	{
+		for (Entry const & entry : m_entries)
+		{
+			if (entry.Width != width || entry.Height != height) continue;
+
+			transforms.Width = width;
+			transforms.Height = height;
+			transforms.FrontPre = entry.FrontPre.lock();
+			transforms.BackPre = entry.BackPre.lock();
+			transforms.Post = entry.Post.lock();
+
+			return transforms.FrontPre && transforms.BackPre && transforms.Post;
+		}
+
+		return false;
+	}
+
+	void Add(FaceTransforms const & transforms)
+	{
+		m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(), [&](Entry const & entry)
+		{
+			return entry.Post.expired() ||
+				(entry.Width == transforms.Width && entry.Height == transforms.Height);
+		}), m_entries.end());
+
+		m_entries.push_back(Entry { transforms.Width, transforms.Height, transforms.FrontPre, transforms.BackPre, transforms.Post });
+	}
+
+	// For a new device, on which the old transforms cannot be used
+	void Clear()
+	{
+		m_entries.clear();
+	}
+};
+
+// The card's angle is the animator variable with the same index
+struct SceneCard
+{
+	std::shared_ptr<CompositorRotateTransform> Rotation;
+	CardFace Front;
+	CardFace Back;
+};
+
+// Creates card faces and lays them out on the compositor, sharing the flip
+// matrices between faces of one size, and through the cache, if any, with
+// the other factories on the device. Used by the scenes, which decide what
+// cards have faces.
+struct CardFaceFactory
+{
+	Compositor & m_compositor;
+	FaceTransforms m_faceTransforms;
+	std::shared_ptr<FaceTransformCache> m_transformCache;
+
+	explicit CardFaceFactory(Compositor & compositor,
+		std::shared_ptr<FaceTransformCache> const & transformCache = nullptr) :
+		m_compositor(compositor),
+		m_transformCache(transformCache)
+	{}
+
+	// Visuals hide their back, as each card shows its other face instead
+	std::shared_ptr<CompositorVisual> CreateVisual()
+	{
+		std::shared_ptr<CompositorVisual> visual = m_compositor.CreateVisual();
+		visual->SetBackFaceVisible(false);
+		return visual;
+	}
+
+	// A rotation and two faces, without layout
+	void CreateCard(SceneCard & card,
+		bool const faceUp)
+	{
+		card.Rotation = m_compositor.CreateRotateTransform();
+
+		if (faceUp)
+		{
+			card.Rotation->SetAngle(static_cast<float>(FaceUpAngle));
+		}
+
+		card.Rotation->SetAxis(0.0f, 1.0f, 0.0f);
+
+		CreateCardFace(card.Front);
+		CreateCardFace(card.Back);
+	}
+
+	// The flip transform is set with the layout, once the size is known
+	void CreateCardFace(CardFace & face)
+	{
+		face.Visual = CreateVisual();
+		face.Content = CreateVisual();
+
+		face.Visual->AddVisual(face.Content);
+	}
+
+	std::shared_ptr<CompositorMatrixTransform> CreateMatrixTransform(Matrix4x4 const & matrix)
+	{
+		std::shared_ptr<CompositorMatrixTransform> const transform = m_compositor.CreateMatrixTransform();
+		transform->SetMatrix(matrix);
+		return transform;
+	}
+
+	// The transforms for faces of the size, made when the size changes
+	FaceTransforms const & ShareFaceTransforms(float const width,
+		float const height)
+	{
+		FaceTransforms & shared = m_faceTransforms;
+
+		if (shared.Post && shared.Width == width && shared.Height == height) return shared;
+
+		if (m_transformCache && m_transformCache->Find(width, height, shared)) return shared;
+
+		shared.Width = width;
+		shared.Height = height;
+		shared.FrontPre = CreateMatrixTransform(CardFacePreTransform(width, height, true));
+		shared.BackPre = CreateMatrixTransform(CardFacePreTransform(width, height, false));
+		shared.Post = CreateMatrixTransform(CardFacePostTransform(width, height));
+
+		if (m_transformCache)
+		{
+			m_transformCache->Add(shared);
+		}
+
+		return shared;
+	}
+
+	// Points the face at its tile and updates everything that depends on
+	// the DPI: the card offset, clip and flip transform. The flip transform
+	// is only replaced when the card size changes.
+	void SetFaceLayout(CardFace & face,
+		std::shared_ptr<CompositorRotateTransform> const & rotation,
+		Card const & card,
+		std::shared_ptr<CompositorSurface> const & page,
+		AtlasRect const & rect,
+		PhysicalLayout const & layout,
+		bool const front)
+	{
+		face.Visual->SetOffset(card.OffsetX, card.OffsetY);
+
+		face.Visual->SetClip(0.0f,
+			0.0f,
+			static_cast<float>(rect.Width),
+			static_cast<float>(rect.Height));
+
+		face.Content->SetOffset(-static_cast<float>(rect.Left), -static_cast<float>(rect.Top));
+		face.Content->SetContent(page);
+		face.Page = page.get();
+
+		FaceTransforms const & shared = ShareFaceTransforms(layout.CardWidth(), layout.CardHeight());
+		std::shared_ptr<CompositorMatrixTransform> const & pre = front ? shared.FrontPre : shared.BackPre;
+
+		if (pre == face.Pre && shared.Post == face.Post) return;
+
+		face.Pre = pre;
+		face.Post = shared.Post;
+
+		std::shared_ptr<CompositorTransform> const transforms[] =
+		{
+			face.Pre,
+			rotation,
+			face.Post
+		};
+
+		face.Visual->SetTransform(m_compositor.CreateTransformGroup(transforms, 3));
+	}
+};
+
+// Requests made of a pool and what it holds. Resident objects are those in
+// use and those kept for reuse, so the peak is the most the pool has cost.
+struct PoolCounters
+{
+	unsigned long long Requests = 0;
+	unsigned long long Hits = 0;
+	unsigned InUse = 0;
+	unsigned Pooled = 0;
+	unsigned PeakResident = 0;
+	unsigned long long ResidentBytes = 0;
+	unsigned long long PeakResidentBytes = 0;
+
+	// Bytes of an object created for a miss
+	void Acquired(bool const hit,
+		unsigned long long const bytes = 0)
+	{
+		++Requests;
+		++InUse;
+
+		if (hit)
+		{
+			++Hits;
+			--Pooled;
+		}
+		else
+		{
+			ResidentBytes += bytes;
+		}
+
+		PeakResident = std::max(PeakResident, InUse + Pooled);
+		PeakResidentBytes = std::max(PeakResidentBytes, ResidentBytes);
+	}
+
+	void Released()
+	{
+		--InUse;
+		++Pooled;
+	}
+
+	void Discarded(unsigned long long const bytes = 0)
+	{
+		--InUse;
+		ResidentBytes -= bytes;
+	}
+
+	double HitRate() const
+	{
+		return Requests ? static_cast<double>(Hits) / Requests : 0.0;
+	}
+};
+
+// Cards and pages the scene no longer shows, kept for the next ones it
+// needs. A pooled card keeps its rotation, visuals and flip transforms, so
+// that reusing it at the same size only sets its layout and angle. Pages are
+// taken by size: the smallest pooled page that holds the one asked for, as
+// pages are trimmed to what the atlas packed and so vary a little from deal
+// to deal. The compositor makes every surface in the one format.
+struct ScenePool
+{
+	CardFaceFactory & m_faces;
+	std::vector<SceneCard> m_cards;
+	std::vector<std::shared_ptr<CompositorSurface>> m_pages;
+	PoolCounters m_cardCounters;
+	PoolCounters m_pageCounters;
+
+	explicit ScenePool(CardFaceFactory & faces) :
+		m_faces(faces)
+	{}
+
+	void AcquireCard(SceneCard & card,
+		bool const faceUp)
+	{
+		bool const hit = !m_cards.empty();
+
+		m_cardCounters.Acquired(hit);
+
+		if (!hit)
+		{
+			m_faces.CreateCard(card, faceUp);
+			return;
+		}
+
+		card = std::move(m_cards.back());
+		m_cards.pop_back();
+
+		// Any animation it has belongs to the card it showed before
+		card.Rotation->SetAngle(faceUp ? static_cast<float>(FaceUpAngle) : 0.0f);
+	}
+
+	// The card must be out of the visual tree
+	void ReleaseCard(SceneCard & card)
+	{
+		m_cards.push_back(std::move(card));
+		card = SceneCard();
+
+		m_cardCounters.Released();
+	}
+
+	std::shared_ptr<CompositorSurface> AcquirePage(unsigned const width,
+		unsigned const height)
+	{
+		auto best = m_pages.end();
+
+		for (auto page = m_pages.begin(); page != m_pages.end(); ++page)
+		{
+			if ((*page)->Width() < width || (*page)->Height() < height) continue;
+
+			if (best == m_pages.end() || Area(**page) < Area(**best))
+			{
+				best = page;
+			}
+		}
+
+		if (best == m_pages.end())
+		{
+			m_pageCounters.Acquired(false, 4ull * width * height);
+			return m_faces.m_compositor.CreateSurface(width, height);
+		}
+
+		m_pageCounters.Acquired(true);
+
+		std::shared_ptr<CompositorSurface> const page = std::move(*best);
+		m_pages.erase(best);
+
+		return page;
+	}
+
+	// Faces may still show the page until their cards are reused
+	void ReleasePage(std::shared_ptr<CompositorSurface> const & page)
+	{
+		m_pages.push_back(page);
+		m_pageCounters.Released();
+	}
+
+	// A page in use that is let go rather than pooled
+	void DiscardPage(CompositorSurface const & page)
+	{
+		m_pageCounters.Discarded(4ull * Area(page));
+	}
+
+private:
+
+	static unsigned long long Area(CompositorSurface const & page)
+	{
+		return 1ull * page.Width() * page.Height();
+	}
+};
+
+struct BoardScene : FrameCompositor
+{
+	Compositor & m_compositor;
+	std::shared_ptr<CompositorVisual> m_root;
+	std::vector<SceneCard> m_cards;
+	CardFaceFactory m_faces;
+	ScenePool m_pool;
+
+	// Scenes on one device may share a cache of face transforms
+	BoardScene(Compositor & compositor,
+		unsigned const cardCount,
+		std::shared_ptr<FaceTransformCache> const & transformCache = nullptr) :
+		m_compositor(compositor),
+		m_cards(cardCount),
+		m_faces(compositor, transformCache),
+		m_pool(m_faces)
+	{
+		m_root = m_faces.CreateVisual();
+		m_compositor.SetRoot(m_root);
+	}
+
+	// From the pool where it has pages large enough
+	ScenePages CreatePages(CardAtlas const & atlas)
+	{
+		ScenePages pages;
+
+		for (unsigned page = 0; page != atlas.m_atlas.PageCount(); ++page)
+		{
+			pages.push_back(m_pool.AcquirePage(atlas.m_atlas.m_pageWidth, atlas.m_atlas.PageHeight(page)));
+		}
+
+		return pages;
+	}
+
+	// Returns pages no card will be laid out on again to the pool
+	void ReleasePages(ScenePages & pages)
+	{
+		for (std::shared_ptr<CompositorSurface> const & page : pages)
+		{
+			m_pool.ReleasePage(page);
+		}
+
+		pages.clear();
+	}
+
+	// For pages of another layout, which the next games will not fit. Faces
+	// still showing them let go, in the scene and in the pool, so that the
+	// pages are freed as the counters say.
+	void DiscardPages(ScenePages & pages)
+	{
+		for (SceneCard & card : m_cards)
+		{
+			if (!card.Front.Visual) continue;
+
+			card.Front.Detach(pages);
+			card.Back.Detach(pages);
+		}
+
+		for (SceneCard & card : m_pool.m_cards)
+		{
+			card.Front.Detach(pages);
+			card.Back.Detach(pages);
+		}
+
+		for (std::shared_ptr<CompositorSurface> const & page : pages)
+		{
+			m_pool.DiscardPage(*page);
+		}
+
+		pages.clear();
+	}
+
+	// Adds every card still in play, face up if it is selected
+	void Build(Board const & board,
+		CardAtlas const & atlas,
+		ScenePages const & pages,
+		PhysicalLayout const & layout)
+	{
+		for (unsigned index = 0; index != board.CardCount(); ++index)
+		{
+			Card const & card = board[index];
+
+			if (card.Status == CardStatus::Matched) continue;
+
+			AddCard(index, card.Status == CardStatus::Selected);
+			SetCardLayout(index, card, atlas, pages, layout);
+		}
+	}
+
+	bool Contains(unsigned const index) const
+	{
+		return m_cards[index].Front.Visual != nullptr;
+	}
+
+	void AddCard(unsigned const index,
+		bool const faceUp)
+	{
+		SceneCard & card = m_cards[index];
+
+		m_pool.AcquireCard(card, faceUp);
+
+		m_root->AddVisual(card.Front.Visual);
+		m_root->AddVisual(card.Back.Visual);
+	}
+
+	void RemoveCard(unsigned const index)
+	{
+		SceneCard & card = m_cards[index];
+
+		m_root->RemoveVisual(card.Front.Visual);
+		m_root->RemoveVisual(card.Back.Visual);
+
+		m_pool.ReleaseCard(card);
+	}
+
+	// Every card to the pool, before a new game is built. The root only
+	// holds the cards, so it is emptied in one call.
+	void Clear()
+	{
+		m_root->RemoveAllVisuals();
+
+		for (SceneCard & card : m_cards)
+		{
+			if (card.Front.Visual) m_pool.ReleaseCard(card);
+		}
+	}
+
+	// Matched cards that have finished turning away leave the tree for the
+	// pool. The animator must have been updated to the time of the next
+	// frame. Returns how many left.
+	unsigned ReleaseMatched(Board const & board,
+		Animator const & animator)
+	{
+		unsigned released = 0;
+
+		for (unsigned index = 0; index != CardCount(); ++index)
+		{
+			if (!Contains(index) ||
+				board[index].Status != CardStatus::Matched ||
+				animator.IsAnimating(index)) continue;
+
+			RemoveCard(index);
+			++released;
+		}
+
+		return released;
+	}
+
+	unsigned CardCount() const
+	{
+		return static_cast<unsigned>(m_cards.size());
+	}
+
+	void SetCardLayout(unsigned const index,
+		Card const & card,
+		CardAtlas const & atlas,
+		ScenePages const & pages,
+		PhysicalLayout const & layout)
+	{
+		SceneCard & scene = m_cards[index];
+
+		AtlasRect const & frontRect = atlas.FrontRect(index);
+		AtlasRect const & backRect = atlas.BackRect(index);
+
+		m_faces.SetFaceLayout(scene.Front, scene.Rotation, card, pages[frontRect.Page], frontRect, layout, true);
+		m_faces.SetFaceLayout(scene.Back, scene.Rotation, card, pages[backRect.Page], backRect, layout, false);
+	}
+
+	double NextFrameTime() override
+	{
+		return m_compositor.NextFrameTime();
+	}
+
+	void AnimateAngle(unsigned const card, AnimationCurve const & curve) override
+	{
+		if (!Contains(card)) return;
+
+		m_cards[card].Rotation->SetAngle(curve);
+	}
+
+	void Commit() override
+	{
+		m_compositor.Commit();
+	}
+};
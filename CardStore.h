@@ -0,0 +1,361 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Board.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// The board's cards as component columns rather than an array of Card. A
+// card's id is its slot and stays the same for the whole game, and every
+// column is indexed by it: a status bitset, the values, the offsets and the
+// handles of its animation variable and of its place in the scene. A pass
+// over the board reads only the columns it needs, so the hit test scan
+// touches eight bytes a card, the match scans four and a bit, and the
+// animation pass a bit and a handle. Board keeps the array of Card for the
+// small boards the sample plays; the store is for passes over large ones.
+
+inline unsigned CountCardBits(uint64_t const bits)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	return static_cast<unsigned>(__popcnt64(bits));
+#elif defined(__GNUC__) || defined(__clang__)
+	return static_cast<unsigned>(__builtin_popcountll(bits));
+#else
+	unsigned count = 0;
+	for (uint64_t rest = bits; rest; rest &= rest - 1) ++count;
+	return count;
+#endif
+}
+
+// The index of the lowest set bit, which there must be
+inline unsigned LowestCardBit(uint64_t const bits)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long index = 0;
+	_BitScanForward64(&index, bits);
+	return static_cast<unsigned>(index);
+#elif defined(__GNUC__) || defined(__clang__)
+	return static_cast<unsigned>(__builtin_ctzll(bits));
+#else
+	unsigned index = 0;
+	while (!(bits >> index & 1)) ++index;
+	return index;
+#endif
+}
+
+typedef uint32_t CardId;
+
+struct CardStore
+{
+	static CardId const NoCard = Board::NoCard;
+	static uint32_t const NoHandle = ~0u;
+
+	BoardGeometry m_geometry;
+	BoardLayout m_layout;
+	unsigned m_count;
+
+	// Status: a bit for every matched card, and the one selected card. A
+	// card that is neither is hidden.
+	std::vector<uint64_t> m_matched;
+	CardId m_firstCard = NoCard;
+
+	std::vector<wchar_t> m_values;
+	std::vector<float> m_offsetX;
+	std::vector<float> m_offsetY;
+	std::vector<uint32_t> m_animation; // the animator variable, the card's id by default
+	std::vector<uint32_t> m_scene;     // the scene's slot, NoHandle while not in the tree
+
+	explicit CardStore(BoardGeometry const & geometry) :
+		m_geometry(geometry),
+		m_layout(geometry),
+		m_count(geometry.CardCount()),
+		m_matched((m_count + 63) / 64, 0),
+		m_values(m_count, L' '),
+		m_offsetX(m_count, 0.0f),
+		m_offsetY(m_count, 0.0f),
+		m_animation(m_count),
+		m_scene(m_count, static_cast<uint32_t>(NoHandle))
+	{
+		ASSERT(m_count % 2 == 0);
+
+		for (CardId id = 0; id != m_count; ++id)
+		{
+			m_animation[id] = id;
+		}
+	}
+
+	unsigned CardCount() const
+	{
+		return m_count;
+	}
+
+	bool IsMatched(CardId const id) const
+	{
+		ASSERT(id < m_count);
+		return 0 != (m_matched[id / 64] >> id % 64 & 1);
+	}
+
+	CardStatus Status(CardId const id) const
+	{
+		if (IsMatched(id)) return CardStatus::Matched;
+
+		return id == m_firstCard ? CardStatus::Selected : CardStatus::Hidden;
+	}
+
+	// The same deal as Board::Deal from the same generator state, straight
+	// into the values column
+	template <typename Generator>
+	void Deal(CardAlphabet const & alphabet,
+		Generator & generator)
+	{
+		DealCardValues(alphabet, generator, m_count, m_values);
+		m_values.resize(m_count);
+
+		std::fill(m_matched.begin(), m_matched.end(), 0);
+		m_firstCard = NoCard;
+	}
+
+	// Copies a board of the same geometry in, or back out
+	void Load(Board const & board)
+	{
+		ASSERT(board.CardCount() == m_count);
+
+		std::fill(m_matched.begin(), m_matched.end(), 0);
+		m_firstCard = board.m_firstCard;
+
+		for (CardId id = 0; id != m_count; ++id)
+		{
+			Card const & card = board[id];
+
+			m_values[id] = card.Value;
+			m_offsetX[id] = card.OffsetX;
+			m_offsetY[id] = card.OffsetY;
+
+			if (CardStatus::Matched == card.Status)
+			{
+				m_matched[id / 64] |= uint64_t(1) << id % 64;
+			}
+		}
+	}
+
+	void Store(Board & board) const
+	{
+		ASSERT(board.CardCount() == m_count);
+
+		board.m_firstCard = m_firstCard;
+
+		for (CardId id = 0; id != m_count; ++id)
+		{
+			Card & card = board[id];
+
+			card.Value = m_values[id];
+			card.OffsetX = m_offsetX[id];
+			card.OffsetY = m_offsetY[id];
+			card.Status = Status(id);
+		}
+	}
+
+	void Arrange(float const dpiX,
+		float const dpiY)
+	{
+		Arrange(m_layout, dpiX, dpiY);
+	}
+
+	template <typename Table>
+	void Arrange(Table const & table,
+		float const dpiX,
+		float const dpiY)
+	{
+		ASSERT(table.Rows() == m_geometry.Rows && table.Columns() == m_geometry.Columns);
+
+		for (unsigned row = 0; row != table.Rows(); ++row)
+		{
+			float const top = LogicalToPhysical(table.CardTop(row), dpiY);
+			CardId const first = row * table.Columns();
+
+			for (unsigned column = 0; column != table.Columns(); ++column)
+			{
+				m_offsetX[first + column] = LogicalToPhysical(table.CardLeft(column), dpiX);
+				m_offsetY[first + column] = top;
+			}
+		}
+	}
+
+	bool CardContains(CardId const id,
+		float const x,
+		float const y,
+		float const width,
+		float const height) const
+	{
+		return x > m_offsetX[id] &&
+			y > m_offsetY[id] &&
+			x < m_offsetX[id] + width &&
+			y < m_offsetY[id] + height;
+	}
+
+	// As Board::CardAtPoint, from the grid
+	unsigned CardAtPoint(float const x,
+		float const y,
+		float const dpiX,
+		float const dpiY) const
+	{
+		float const width = LogicalToPhysical(m_layout.CardWidth(), dpiX);
+		float const height = LogicalToPhysical(m_layout.CardHeight(), dpiY);
+
+		float const pitchX = LogicalToPhysical(m_layout.PitchX(), dpiX);
+		float const pitchY = LogicalToPhysical(m_layout.PitchY(), dpiY);
+
+		float const column = std::floor((x - LogicalToPhysical(m_layout.Margin(), dpiX)) / pitchX);
+		float const row = std::floor((y - LogicalToPhysical(m_layout.Margin(), dpiY)) / pitchY);
+
+		for (float r = row; r >= row - 1.0f; r -= 1.0f)
+		{
+			if (r < 0.0f || r >= m_layout.Rows()) continue;
+
+			for (float c = column; c >= column - 1.0f; c -= 1.0f)
+			{
+				if (c < 0.0f || c >= m_layout.Columns()) continue;
+
+				CardId const id = static_cast<unsigned>(r) * m_layout.Columns() + static_cast<unsigned>(c);
+
+				if (CardContains(id, x, y, width, height)) return id;
+			}
+		}
+
+		return NoCard;
+	}
+
+	// The first card under the physical point by a scan of the offsets, for
+	// cards that have been moved off the grid. Reads the two offset columns
+	// only.
+	CardId ScanAtPoint(float const x,
+		float const y,
+		float const width,
+		float const height) const
+	{
+		for (CardId id = 0; id != m_count; ++id)
+		{
+			if (CardContains(id, x, y, width, height)) return id;
+		}
+
+		return NoCard;
+	}
+
+	unsigned MatchedCount() const
+	{
+		unsigned count = 0;
+
+		for (uint64_t const bits : m_matched)
+		{
+			count += CountCardBits(bits);
+		}
+
+		return count;
+	}
+
+	// The cards in play with the value. Reads the values, and the status bit
+	// of a card only once its value is the one.
+	unsigned CountInPlay(wchar_t const value) const
+	{
+		unsigned count = 0;
+
+		for (CardId id = 0; id != m_count; ++id)
+		{
+			if (m_values[id] == value) count += !IsMatched(id);
+		}
+
+		return count;
+	}
+
+	// The first card in play that matches the card, or NoCard. Reads the
+	// values, and the status bit of a card only once its value matches.
+	CardId FindPartner(CardId const id) const
+	{
+		wchar_t const value = m_values[id];
+
+		for (CardId other = 0; other != m_count; ++other)
+		{
+			if (Board::IsMatch(value, m_values[other]) && !IsMatched(other)) return other;
+		}
+
+		return NoCard;
+	}
+
+	// Calls visit(id) for every card not yet matched, a word of the bitset
+	// at a time, so that runs of matched cards cost nothing
+	template <typename Visit>
+	void ForEachInPlay(Visit && visit) const
+	{
+		for (size_t word = 0; word != m_matched.size(); ++word)
+		{
+			uint64_t bits = ~m_matched[word];
+
+			// No cards past the last
+			if (word + 1 == m_matched.size() && m_count % 64 != 0)
+			{
+				bits &= (uint64_t(1) << m_count % 64) - 1;
+			}
+
+			for (; bits; bits &= bits - 1)
+			{
+				visit(static_cast<CardId>(word * 64 + LowestCardBit(bits)));
+			}
+		}
+	}
+
+	// Calls visit(id, variable) for every card in play, reading the status
+	// bits and the animation handles only
+	template <typename Visit>
+	void ForEachAnimated(Visit && visit) const
+	{
+		ForEachInPlay([&](CardId const id)
+		{
+			visit(id, m_animation[id]);
+		});
+	}
+
+	bool CanSelect(CardId const id) const
+	{
+		return id != NoCard &&
+			id != m_firstCard &&
+			!IsMatched(id);
+	}
+
+	// As Board::Select
+	Selection Select(CardId const id)
+	{
+		Selection selection;
+
+		if (!CanSelect(id)) return selection;
+
+		if (m_firstCard == NoCard)
+		{
+			m_firstCard = id;
+
+			selection.Result = SelectionResult::Selected;
+			selection.First = id;
+			selection.Second = id;
+			return selection;
+		}
+
+		if (Board::IsMatch(m_values[m_firstCard], m_values[id]))
+		{
+			m_matched[m_firstCard / 64] |= uint64_t(1) << m_firstCard % 64;
+			m_matched[id / 64] |= uint64_t(1) << id % 64;
+			selection.Result = SelectionResult::Matched;
+		}
+		else
+		{
+			selection.Result = SelectionResult::Mismatched;
+		}
+
+		selection.First = m_firstCard;
+		selection.Second = id;
+
+		m_firstCard = NoCard;
+		return selection;
+	}
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <memory>
+#include "Animation.h"
+#include "Matrix.h"
+#include "Raster.h"
+
+// The composition calls the sample makes, as a thin interface over the
+// compositor. The sample implements it with DirectComposition; the
+// recording compositor keeps the visual tree in memory so that it can be
+// built and counted anywhere. Objects passed to another object are kept
+// alive by it, as COM references would.
+
+// A premultiplied BGRA8 surface
+struct CompositorSurface
+{
+	virtual ~CompositorSurface() {}
+
+	virtual unsigned Width() const = 0;
+	virtual unsigned Height() const = 0;
+
+	// Copies physical pixels into the surface one to one
+	virtual void Upload(unsigned left, unsigned top, ConstPixelView const & pixels) = 0;
+};
+
+// A 3D transform, usable as a visual's effect or in a group
+struct CompositorTransform
+{
+	virtual ~CompositorTransform() {}
+};
+
+struct CompositorMatrixTransform : CompositorTransform
+{
+	virtual void SetMatrix(Matrix4x4 const & matrix) = 0;
+};
+
+struct CompositorRotateTransform : CompositorTransform
+{
+	virtual void SetAxis(float x, float y, float z) = 0;
+
+	// In degrees, either fixed or animated from the curve's start on
+	virtual void SetAngle(float angle) = 0;
+	virtual void SetAngle(AnimationCurve const & curve) = 0;
+};
+
+struct CompositorVisual
+{
+	virtual ~CompositorVisual() {}
+
+	virtual void SetOffset(float x, float y) = 0;
+	virtual void SetClip(float left, float top, float right, float bottom) = 0;
+	virtual void SetBackFaceVisible(bool visible) = 0;
+	virtual void SetContent(std::shared_ptr<CompositorSurface> const & surface) = 0;
+	virtual void SetTransform(std::shared_ptr<CompositorTransform> const & transform) = 0;
+
+	// Adds the child on top of the existing ones
+	virtual void AddVisual(std::shared_ptr<CompositorVisual> const & child) = 0;
+	virtual void RemoveVisual(std::shared_ptr<CompositorVisual> const & child) = 0;
+	virtual void RemoveAllVisuals() = 0;
+};
+
+struct Compositor
+{
+	virtual ~Compositor() {}
+
+	virtual std::shared_ptr<CompositorVisual> CreateVisual() = 0;
+	virtual std::shared_ptr<CompositorSurface> CreateSurface(unsigned width, unsigned height) = 0;
+	virtual std::shared_ptr<CompositorMatrixTransform> CreateMatrixTransform() = 0;
+	virtual std::shared_ptr<CompositorRotateTransform> CreateRotateTransform() = 0;
+
+	// Applies the transforms in order
+	virtual std::shared_ptr<CompositorTransform> CreateTransformGroup(std::shared_ptr<CompositorTransform> const * transforms,
+		unsigned count) = 0;
+
+	virtual void SetRoot(std::shared_ptr<CompositorVisual> const & root) = 0;
+
+	// The time of the next frame in seconds, from the frame statistics
+	virtual double NextFrameTime() = 0;
+
+	virtual void Commit() = 0;
+
+	// Blocks until the last commit has reached the compositor
+	virtual void WaitForCommitCompletion() = 0;
+};
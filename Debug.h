@@ -1,8 +1,13 @@
 #pragma once
 
 #ifndef ASSERT
+#ifdef _WIN32
 #include <crtdbg.h>
 #define ASSERT _ASSERTE
+#else
+#include <cassert>
+#define ASSERT assert
+#endif
 #endif
 
 #ifndef VERIFY
@@ -30,7 +35,9 @@ void DebugTrace(wchar_t const * format, Args... args)
     OutputDebugString(buffer);
 }
 #define TRACE DebugTrace
-#else
+#elif defined(_MSC_VER)
 #define TRACE __noop
+#else
+#define TRACE(...) ((void)0)
 #endif
 #endif
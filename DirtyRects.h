@@ -0,0 +1,318 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// The parts of card surfaces that changed since the last frame, so that a
+// change to part of a card redraws that part only: BeginDraw is given the
+// part as its update rectangle rather than the whole tile. Rectangles are
+// in physical pixels relative to the card's tile.
+
+struct DirtyRect
+{
+	unsigned Left = 0;
+	unsigned Top = 0;
+	unsigned Right = 0;
+	unsigned Bottom = 0;
+
+	DirtyRect() = default;
+
+	DirtyRect(unsigned const left,
+		unsigned const top,
+		unsigned const right,
+		unsigned const bottom) :
+		Left(left),
+		Top(top),
+		Right(right),
+		Bottom(bottom)
+	{}
+
+	unsigned Width() const
+	{
+		return Right - Left;
+	}
+
+	unsigned Height() const
+	{
+		return Bottom - Top;
+	}
+
+	bool Empty() const
+	{
+		return Left >= Right || Top >= Bottom;
+	}
+
+	uint64_t Area() const
+	{
+		return Empty() ? 0 : static_cast<uint64_t>(Width()) * Height();
+	}
+
+	bool Contains(DirtyRect const & other) const
+	{
+		return Left <= other.Left && Top <= other.Top && Right >= other.Right && Bottom >= other.Bottom;
+	}
+
+	DirtyRect Union(DirtyRect const & other) const
+	{
+		return DirtyRect(std::min(Left, other.Left),
+			std::min(Top, other.Top),
+			std::max(Right, other.Right),
+			std::max(Bottom, other.Bottom));
+	}
+
+	DirtyRect Intersect(DirtyRect const & other) const
+	{
+		DirtyRect const rect(std::max(Left, other.Left),
+			std::max(Top, other.Top),
+			std::min(Right, other.Right),
+			std::min(Bottom, other.Bottom));
+
+		return rect.Empty() ? DirtyRect() : rect;
+	}
+};
+
+// The parts of one surface to redraw, as a few rectangles. Two rectangles
+// are merged when their bounds are not much larger than the two together,
+// so that one redraw replaces two for few extra pixels, which also merges a
+// rectangle into one that contains it. Rectangles that overlap but would
+// waste too much when merged are both kept and the overlap is drawn twice.
+// Past MaxRects the pair that wastes least is merged regardless.
+struct DirtyRegion
+{
+	static unsigned const MaxRects = 4;
+
+	std::vector<DirtyRect> m_rects;
+
+	bool Empty() const
+	{
+		return m_rects.empty();
+	}
+
+	void Clear()
+	{
+		m_rects.clear();
+	}
+
+	// Pixels the rectangles cover, counting overlaps for each
+	uint64_t Area() const
+	{
+		uint64_t area = 0;
+
+		for (DirtyRect const & rect : m_rects)
+		{
+			area += rect.Area();
+		}
+
+		return area;
+	}
+
+	DirtyRect Bounds() const
+	{
+		DirtyRect bounds;
+
+		for (DirtyRect const & rect : m_rects)
+		{
+			bounds = bounds.Empty() ? rect : bounds.Union(rect);
+		}
+
+		return bounds;
+	}
+
+	void Add(DirtyRect rect)
+	{
+		if (rect.Empty()) return;
+
+		// A merged rectangle may now be worth merging with one passed over
+		for (size_t i = 0; i != m_rects.size();)
+		{
+			if (Worth(m_rects[i], rect))
+			{
+				rect = rect.Union(m_rects[i]);
+				m_rects[i] = m_rects.back();
+				m_rects.pop_back();
+				i = 0;
+			}
+			else
+			{
+				++i;
+			}
+		}
+
+		m_rects.push_back(rect);
+
+		if (m_rects.size() > MaxRects)
+		{
+			MergeCheapest();
+		}
+	}
+
+	// At most a third more pixels than the two, counting the overlap once
+	static bool Worth(DirtyRect const & a,
+		DirtyRect const & b)
+	{
+		uint64_t const together = a.Area() + b.Area() - a.Intersect(b).Area();
+
+		return a.Union(b).Area() * 3 <= together * 4;
+	}
+
+	static uint64_t Waste(DirtyRect const & a,
+		DirtyRect const & b)
+	{
+		uint64_t const together = a.Area() + b.Area() - a.Intersect(b).Area();
+
+		return a.Union(b).Area() - together;
+	}
+
+private:
+
+	void MergeCheapest()
+	{
+		size_t first = 0;
+		size_t second = 1;
+		uint64_t least = ~uint64_t(0);
+
+		for (size_t i = 0; i != m_rects.size(); ++i)
+		{
+			for (size_t j = i + 1; j != m_rects.size(); ++j)
+			{
+				uint64_t const waste = Waste(m_rects[i], m_rects[j]);
+
+				if (waste < least)
+				{
+					least = waste;
+					first = i;
+					second = j;
+				}
+			}
+		}
+
+		DirtyRect const merged = m_rects[first].Union(m_rects[second]);
+
+		m_rects.erase(m_rects.begin() + second);
+		m_rects.erase(m_rects.begin() + first);
+
+		Add(merged);
+	}
+};
+
+// Pixels redrawn over a run of frames, against what redrawing every changed
+// tile whole would have drawn
+struct DamageCounters
+{
+	unsigned Frames = 0;
+	uint64_t Draws = 0;
+	uint64_t PixelsDrawn = 0;
+	uint64_t WholePixels = 0;
+	uint64_t LastFramePixels = 0;
+	uint64_t PeakFramePixels = 0;
+
+	double PixelsPerFrame() const
+	{
+		return Frames ? static_cast<double>(PixelsDrawn) / Frames : 0.0;
+	}
+
+	// Drawn pixels as a share of whole tile redraws, from 0 to 1
+	double DrawnShare() const
+	{
+		return WholePixels ? static_cast<double>(PixelsDrawn) / WholePixels : 0.0;
+	}
+};
+
+// The dirty region of each surface changed this frame. Surfaces are the
+// caller's numbers, such as card indices, each with the size of its tile to
+// clip to. Flush hands out every rectangle once and starts the next frame.
+struct FrameDamage
+{
+	struct Surface
+	{
+		unsigned Id;
+		unsigned Width;
+		unsigned Height;
+		DirtyRegion Region;
+	};
+
+	std::vector<Surface> m_surfaces;
+	std::unordered_map<unsigned, size_t> m_index;
+	DamageCounters m_counters;
+
+	bool Empty() const
+	{
+		return m_surfaces.empty();
+	}
+
+	void Add(unsigned const surface,
+		unsigned const width,
+		unsigned const height,
+		DirtyRect const & part)
+	{
+		DirtyRect const clipped = part.Intersect(DirtyRect(0, 0, width, height));
+
+		if (clipped.Empty()) return;
+
+		auto const found = m_index.emplace(surface, m_surfaces.size());
+
+		if (found.second)
+		{
+			m_surfaces.push_back(Surface { surface, width, height, DirtyRegion() });
+		}
+
+		m_surfaces[found.first->second].Region.Add(clipped);
+	}
+
+	void AddWhole(unsigned const surface,
+		unsigned const width,
+		unsigned const height)
+	{
+		Add(surface, width, height, DirtyRect(0, 0, width, height));
+	}
+
+	// Drops the frame's rectangles, for surfaces that are gone. The counters
+	// are kept.
+	void Clear()
+	{
+		m_surfaces.clear();
+		m_index.clear();
+	}
+
+	// Calls draw(surface, rect) for each rectangle of the frame, surfaces in
+	// the order they first changed. Returns the pixels drawn. The next frame
+	// starts empty even if draw throws.
+	template <typename Draw>
+	uint64_t Flush(Draw && draw)
+	{
+		std::vector<Surface> surfaces;
+		surfaces.swap(m_surfaces);
+		m_index.clear();
+
+		uint64_t pixels = 0;
+
+		for (Surface const & surface : surfaces)
+		{
+			for (DirtyRect const & rect : surface.Region.m_rects)
+			{
+				draw(surface.Id, rect);
+
+				pixels += rect.Area();
+				++m_counters.Draws;
+			}
+
+			m_counters.WholePixels += static_cast<uint64_t>(surface.Width) * surface.Height;
+		}
+
+		if (!surfaces.empty())
+		{
+			++m_counters.Frames;
+			m_counters.PixelsDrawn += pixels;
+			m_counters.LastFramePixels = pixels;
+			m_counters.PeakFramePixels = std::max(m_counters.PeakFramePixels, pixels);
+		}
+
+		// Kept for the next frame's rectangles
+		surfaces.clear();
+		m_surfaces.swap(surfaces);
+
+		return pixels;
+	}
+};
@@ -0,0 +1,606 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Animation.h"
+#include "Board.h"
+#include "CardStore.h"
+#include "Interaction.h"
+#include "MappedFile.h"
+
+// The game on disk, so that a restart carries on where it left off. A
+// snapshot is the board at a point: its geometry, the values, a bit per
+// matched card, the selected card, the game's seed and the cards still
+// turning. It has a fixed layout with every section aligned, so a restore
+// maps the file and reads the columns where they lie, with nothing to parse.
+// Between snapshots each selection and new game is appended to a log of
+// fixed size records, which a restore plays over the snapshot. Once the log
+// is long enough it is folded into a new snapshot.
+//
+// Numbers are stored as the machine has them, little endian on every
+// platform the sample runs on.
+
+// A card still turning when the snapshot was taken: where it was, where it
+// comes to rest and how many seconds it had left. The turn resumes as a
+// single transition to the final angle.
+struct GameAnimation
+{
+	uint32_t Card;
+	float Angle;
+	float Final;
+	float Remaining;
+};
+
+static_assert(sizeof(GameAnimation) == 16, "animations are packed");
+
+struct GameSnapshotHeader
+{
+	static uint32_t const Signature = 0x53534742; // "BGSS"
+	static uint32_t const CurrentVersion = 1;
+
+	uint32_t Magic = Signature;
+	uint32_t Version = CurrentVersion;
+	uint32_t Rows = 0;
+	uint32_t Columns = 0;
+	float Margin = 0.0f;
+	float CardWidth = 0.0f;
+	float CardHeight = 0.0f;
+	uint32_t FirstCard = Board::NoCard;
+	uint64_t Seed = 0;      // of the game on the board
+	uint32_t Games = 0;     // dealt in the session
+	uint32_t Animations = 0;
+	uint32_t Sequence = 0;  // of the last log record the snapshot includes
+	uint32_t Reserved[3] = {};
+};
+
+// The values follow the header as 16 bit letters, padded to 8 bytes, then
+// the matched bits in 64 bit words, then the animations.
+static_assert(sizeof(GameSnapshotHeader) == 64, "sections are aligned");
+
+inline size_t GameValueBytes(unsigned const cards)
+{
+	return (cards * sizeof(uint16_t) + 7) & ~size_t(7);
+}
+
+inline size_t GameMatchedBytes(unsigned const cards)
+{
+	return (cards + 63) / 64 * sizeof(uint64_t);
+}
+
+inline size_t GameSnapshotSize(unsigned const cards,
+	unsigned const animations)
+{
+	return sizeof(GameSnapshotHeader) +
+		GameValueBytes(cards) +
+		GameMatchedBytes(cards) +
+		animations * sizeof(GameAnimation);
+}
+
+// The session around the board that a snapshot keeps
+struct GameProgress
+{
+	uint64_t Seed = 0;
+	unsigned Games = 0;
+	std::vector<GameAnimation> Animations;
+};
+
+// A snapshot read in place. The pointers are into the data, which must
+// outlive the view and be 8 byte aligned, as a mapped file or a vector is.
+struct GameSnapshotView
+{
+	GameSnapshotHeader const * Header = nullptr;
+	uint16_t const * Values = nullptr;
+	uint64_t const * Matched = nullptr;
+	GameAnimation const * Animations = nullptr;
+
+	// Returns false if the data is not a complete snapshot of this version
+	// for a board that can be dealt
+	bool Open(uint8_t const * const data,
+		size_t const size)
+	{
+		*this = GameSnapshotView();
+
+		if (size < sizeof(GameSnapshotHeader)) return false;
+
+		GameSnapshotHeader const * const header = reinterpret_cast<GameSnapshotHeader const *>(data);
+
+		if (header->Magic != GameSnapshotHeader::Signature ||
+			header->Version != GameSnapshotHeader::CurrentVersion ||
+			header->Rows == 0 || header->Columns == 0 ||
+			header->Rows > 0xFFFF || header->Columns > 0xFFFF ||
+			header->Rows * header->Columns % 2 != 0)
+		{
+			return false;
+		}
+
+		unsigned const cards = header->Rows * header->Columns;
+
+		if (size != GameSnapshotSize(cards, header->Animations) ||
+			(header->FirstCard != Board::NoCard && header->FirstCard >= cards))
+		{
+			return false;
+		}
+
+		uint8_t const * const values = data + sizeof(GameSnapshotHeader);
+		uint8_t const * const matched = values + GameValueBytes(cards);
+
+		Header = header;
+		Values = reinterpret_cast<uint16_t const *>(values);
+		Matched = reinterpret_cast<uint64_t const *>(matched);
+		Animations = reinterpret_cast<GameAnimation const *>(matched + GameMatchedBytes(cards));
+		return true;
+	}
+
+	unsigned CardCount() const
+	{
+		return Header->Rows * Header->Columns;
+	}
+
+	BoardGeometry Geometry() const
+	{
+		return BoardGeometry(Header->Rows, Header->Columns, Header->Margin, Header->CardWidth, Header->CardHeight);
+	}
+
+	bool IsMatched(unsigned const card) const
+	{
+		return 0 != (Matched[card / 64] >> card % 64 & 1);
+	}
+
+	CardStatus Status(unsigned const card) const
+	{
+		if (IsMatched(card)) return CardStatus::Matched;
+
+		return card == Header->FirstCard ? CardStatus::Selected : CardStatus::Hidden;
+	}
+};
+
+// Sizes data for the snapshot and fills in everything but the values and
+// matched bits, which it clears. Returns the view of it to fill those in.
+inline GameSnapshotView LayOutGameSnapshot(BoardGeometry const & geometry,
+	unsigned const firstCard,
+	GameProgress const & progress,
+	uint32_t const sequence,
+	std::vector<uint8_t> & data)
+{
+	unsigned const cards = geometry.CardCount();
+	unsigned const animations = static_cast<unsigned>(progress.Animations.size());
+
+	data.assign(GameSnapshotSize(cards, animations), 0);
+
+	GameSnapshotHeader header;
+	header.Rows = geometry.Rows;
+	header.Columns = geometry.Columns;
+	header.Margin = geometry.Margin;
+	header.CardWidth = geometry.CardWidth;
+	header.CardHeight = geometry.CardHeight;
+	header.FirstCard = firstCard;
+	header.Seed = progress.Seed;
+	header.Games = progress.Games;
+	header.Animations = animations;
+	header.Sequence = sequence;
+
+	memcpy(data.data(), &header, sizeof(header));
+
+	GameSnapshotView view;
+	VERIFY(view.Open(data.data(), data.size()));
+
+	if (animations)
+	{
+		memcpy(const_cast<GameAnimation *>(view.Animations), progress.Animations.data(), animations * sizeof(GameAnimation));
+	}
+
+	return view;
+}
+
+inline void ExportGameSnapshot(Board const & board,
+	GameProgress const & progress,
+	uint32_t const sequence,
+	std::vector<uint8_t> & data)
+{
+	GameSnapshotView const view = LayOutGameSnapshot(board.m_geometry, board.m_firstCard, progress, sequence, data);
+
+	uint16_t * const values = const_cast<uint16_t *>(view.Values);
+	uint64_t * const matched = const_cast<uint64_t *>(view.Matched);
+
+	for (unsigned card = 0; card != board.CardCount(); ++card)
+	{
+		ASSERT(static_cast<uint32_t>(board[card].Value) <= 0xFFFF);
+
+		values[card] = static_cast<uint16_t>(board[card].Value);
+
+		if (CardStatus::Matched == board[card].Status)
+		{
+			matched[card / 64] |= uint64_t(1) << card % 64;
+		}
+	}
+}
+
+// The store's bits are the snapshot's, word for word
+inline void ExportGameSnapshot(CardStore const & store,
+	GameProgress const & progress,
+	uint32_t const sequence,
+	std::vector<uint8_t> & data)
+{
+	GameSnapshotView const view = LayOutGameSnapshot(store.m_geometry, store.m_firstCard, progress, sequence, data);
+
+	uint16_t * const values = const_cast<uint16_t *>(view.Values);
+
+	for (CardId card = 0; card != store.CardCount(); ++card)
+	{
+		ASSERT(static_cast<uint32_t>(store.m_values[card]) <= 0xFFFF);
+
+		values[card] = static_cast<uint16_t>(store.m_values[card]);
+	}
+
+	memcpy(const_cast<uint64_t *>(view.Matched), store.m_matched.data(), store.m_matched.size() * sizeof(uint64_t));
+}
+
+// The board must have the snapshot's geometry. Offsets are left as they
+// are, for Arrange.
+inline void RestoreGameSnapshot(GameSnapshotView const & view,
+	Board & board)
+{
+	ASSERT(board.CardCount() == view.CardCount());
+
+	for (unsigned card = 0; card != board.CardCount(); ++card)
+	{
+		board[card].Value = static_cast<wchar_t>(view.Values[card]);
+		board[card].Status = (view.Matched[card / 64] >> card % 64 & 1) ? CardStatus::Matched : CardStatus::Hidden;
+	}
+
+	board.m_firstCard = view.Header->FirstCard;
+
+	if (board.m_firstCard != Board::NoCard)
+	{
+		board[board.m_firstCard].Status = CardStatus::Selected;
+	}
+}
+
+inline void RestoreGameSnapshot(GameSnapshotView const & view,
+	CardStore & store)
+{
+	ASSERT(store.CardCount() == view.CardCount());
+
+	for (CardId card = 0; card != store.CardCount(); ++card)
+	{
+		store.m_values[card] = static_cast<wchar_t>(view.Values[card]);
+	}
+
+	memcpy(store.m_matched.data(), view.Matched, store.m_matched.size() * sizeof(uint64_t));
+	store.m_firstCard = view.Header->FirstCard;
+}
+
+// The cards whose variable is still moving, as of the animator's last
+// Update. Variables are the cards' indices, as the sample creates them.
+inline std::vector<GameAnimation> CollectAnimations(Animator const & animator)
+{
+	std::vector<GameAnimation> animations;
+
+	for (unsigned card = 0; card != animator.VariableCount(); ++card)
+	{
+		if (!animator.IsAnimating(card)) continue;
+
+		AnimationCurve const curve = animator.GetCurve(card);
+
+		animations.push_back(GameAnimation {
+			card,
+			animator.Value(card),
+			curve.EndValue,
+			static_cast<float>(curve.End) });
+	}
+
+	return animations;
+}
+
+// The angle a card rests at for its status. Matched cards leave the scene,
+// turned edge on.
+inline double RestingAngle(CardStatus const status)
+{
+	switch (status)
+	{
+	case CardStatus::Selected: return FaceUpAngle;
+	case CardStatus::Matched: return MatchedAngle;
+	default: return 0.0;
+	}
+}
+
+// Puts every card's variable at rest at its status's angle and then resumes
+// the turns, from their angles at the time given
+inline void RestoreAnimations(Board const & board,
+	std::vector<GameAnimation> const & animations,
+	Animator & animator,
+	double const time)
+{
+	ASSERT(animator.VariableCount() == board.CardCount());
+
+	for (unsigned card = 0; card != board.CardCount(); ++card)
+	{
+		animator.Reset(card, RestingAngle(board[card].Status));
+	}
+
+	Storyboard storyboard;
+
+	for (GameAnimation const & animation : animations)
+	{
+		if (animation.Card >= board.CardCount()) continue;
+
+		animator.Reset(animation.Card, animation.Angle);
+		storyboard.AddTransition(animation.Card, CreateFlipTransition(animation.Remaining, animation.Final));
+	}
+
+	if (!storyboard.Empty())
+	{
+		animator.Schedule(storyboard, time);
+	}
+}
+
+// The log is a small header and then the records, each a change the game
+// made since the snapshot, numbered on from the snapshot's Sequence
+
+enum class GameRecordKind : uint32_t
+{
+	Select,  // Argument is the card
+	NewGame, // Argument is the seed dealt from
+};
+
+struct GameRecord
+{
+	uint32_t Sequence;
+	GameRecordKind Kind;
+	uint64_t Argument;
+};
+
+static_assert(sizeof(GameRecord) == 16, "records are packed");
+
+struct GameLogHeader
+{
+	static uint32_t const Signature = 0x4C534742; // "BGSL"
+	static uint32_t const CurrentVersion = 1;
+
+	uint32_t Magic = Signature;
+	uint32_t Version = CurrentVersion;
+	uint32_t Reserved[2] = {};
+};
+
+static_assert(sizeof(GameLogHeader) == sizeof(GameRecord), "records are aligned");
+
+// Calls apply(record) for each record after the sequence number, read in
+// place, in order, until one is missing or apply returns false. A record
+// torn by a crash is not counted, and neither are records a newer snapshot
+// already includes. Returns the sequence number of the last record applied.
+template <typename Apply>
+uint32_t ReadGameLog(uint8_t const * const data,
+	size_t const size,
+	uint32_t sequence,
+	Apply && apply)
+{
+	if (size < sizeof(GameLogHeader)) return sequence;
+
+	GameLogHeader const * const header = reinterpret_cast<GameLogHeader const *>(data);
+
+	if (header->Magic != GameLogHeader::Signature || header->Version != GameLogHeader::CurrentVersion) return sequence;
+
+	GameRecord const * const records = reinterpret_cast<GameRecord const *>(data + sizeof(GameLogHeader));
+	size_t const count = (size - sizeof(GameLogHeader)) / sizeof(GameRecord);
+
+	for (size_t i = 0; i != count; ++i)
+	{
+		if (records[i].Sequence <= sequence) continue;
+		if (records[i].Sequence != sequence + 1 || !apply(records[i])) break;
+
+		sequence = records[i].Sequence;
+	}
+
+	return sequence;
+}
+
+// Plays a record on a board or a store. Returns false if the record does
+// not fit the board, which ends the log.
+template <typename Cards>
+bool ApplyGameRecord(GameRecord const & record,
+	CardAlphabet const & alphabet,
+	Cards & cards,
+	GameProgress & progress)
+{
+	switch (record.Kind)
+	{
+	case GameRecordKind::Select:
+	{
+		if (record.Argument >= cards.CardCount()) return false;
+
+		cards.Select(static_cast<unsigned>(record.Argument));
+		return true;
+	}
+	case GameRecordKind::NewGame:
+	{
+		progress.Seed = record.Argument;
+		++progress.Games;
+
+		Xoshiro256 generator(progress.Seed);
+		cards.Deal(alphabet, generator);
+		return true;
+	}
+	}
+
+	return false;
+}
+
+// A game saved as a snapshot file and the log next to it. Restore reads
+// both and starts them again from the board it restored; after that the
+// game's changes are appended as they happen and the log is folded into a
+// new snapshot every so many records. A snapshot is written next to its
+// file and moved over it, and only then is the log started again, so a
+// crash at any point leaves a snapshot and the records after it.
+struct GameSaveFile
+{
+	// Records appended before NeedsSnapshot
+	static unsigned const DefaultSnapshotRecords = 1024;
+
+	std::basic_string<PathChar> m_path;
+	std::basic_string<PathChar> m_logPath;
+	FILE * m_log = nullptr;
+	uint32_t m_sequence = 0;
+	unsigned m_records = 0;
+	unsigned m_snapshotRecords = DefaultSnapshotRecords;
+	std::vector<uint8_t> m_data;
+
+	GameSaveFile(PathChar const * path,
+		PathChar const * logPath) :
+		m_path(path),
+		m_logPath(logPath)
+	{}
+
+	GameSaveFile(GameSaveFile const &) = delete;
+	GameSaveFile & operator=(GameSaveFile const &) = delete;
+
+	~GameSaveFile()
+	{
+		CloseLog();
+	}
+
+	bool IsOpen() const
+	{
+		return m_log != nullptr;
+	}
+
+	bool NeedsSnapshot() const
+	{
+		return m_records >= m_snapshotRecords;
+	}
+
+	// Maps the snapshot, restores the board from it and plays the log over
+	// it, then starts both again from the result. A record that does not fit
+	// the board ends the log. Progress has the snapshot's turns of the cards
+	// the log left alone. Returns false, with the board as it was, if there
+	// is no snapshot for the board or it has other rows and columns.
+	template <typename Cards>
+	bool Restore(CardAlphabet const & alphabet,
+		Cards & cards,
+		GameProgress & progress)
+	{
+		CloseLog();
+
+		{
+			MappedFile file;
+			GameSnapshotView view;
+
+			if (!file.Open(m_path.c_str()) ||
+				!view.Open(file.Data(), file.Size()) ||
+				view.Header->Rows != cards.m_geometry.Rows ||
+				view.Header->Columns != cards.m_geometry.Columns)
+			{
+				return false;
+			}
+
+			RestoreGameSnapshot(view, cards);
+
+			progress.Seed = view.Header->Seed;
+			progress.Games = view.Header->Games;
+			progress.Animations.assign(view.Animations, view.Animations + view.Header->Animations);
+			m_sequence = view.Header->Sequence;
+		}
+
+		std::vector<uint64_t> changed;
+
+		MappedFile log;
+
+		if (log.Open(m_logPath.c_str()))
+		{
+			m_sequence = ReadGameLog(log.Data(), log.Size(), m_sequence, [&](GameRecord const & record)
+			{
+				if (!ApplyGameRecord(record, alphabet, cards, progress)) return false;
+
+				if (GameRecordKind::NewGame == record.Kind)
+				{
+					progress.Animations.clear();
+					changed.clear();
+				}
+				else
+				{
+					changed.push_back(record.Argument);
+				}
+
+				return true;
+			});
+		}
+
+		std::sort(changed.begin(), changed.end());
+
+		progress.Animations.erase(std::remove_if(progress.Animations.begin(), progress.Animations.end(), [&](GameAnimation const & animation)
+		{
+			return std::binary_search(changed.begin(), changed.end(), animation.Card);
+		}), progress.Animations.end());
+
+		log.Close();
+
+		return Snapshot(cards, progress);
+	}
+
+	// Writes the board as the new snapshot and starts an empty log after it
+	template <typename Cards>
+	bool Snapshot(Cards const & cards,
+		GameProgress const & progress)
+	{
+		CloseLog();
+
+		ExportGameSnapshot(cards, progress, m_sequence, m_data);
+
+		std::basic_string<PathChar> temporary(m_path);
+		temporary += static_cast<PathChar>('~');
+
+		FILE * file = OpenFile(temporary.c_str(), true);
+
+		if (!file) return false;
+
+		bool const written = m_data.size() == fwrite(m_data.data(), 1, m_data.size(), file);
+
+		if (0 != fclose(file) || !written || !MoveFileOver(temporary.c_str(), m_path.c_str()))
+		{
+			RemoveFile(temporary.c_str());
+			return false;
+		}
+
+		m_records = 0;
+		m_log = OpenFile(m_logPath.c_str(), true);
+
+		GameLogHeader const header;
+
+		if (m_log && (1 != fwrite(&header, sizeof(header), 1, m_log) || 0 != fflush(m_log)))
+		{
+			CloseLog();
+		}
+
+		return m_log != nullptr;
+	}
+
+	// Appends the change to the log and hands it to the system, so that it
+	// survives the process. Returns false if the log is not open.
+	bool Append(GameRecordKind const kind,
+		uint64_t const argument)
+	{
+		if (!m_log) return false;
+
+		GameRecord const record = { m_sequence + 1, kind, argument };
+
+		if (1 != fwrite(&record, sizeof(record), 1, m_log) || 0 != fflush(m_log))
+		{
+			CloseLog();
+			return false;
+		}
+
+		++m_sequence;
+		++m_records;
+		return true;
+	}
+
+	void CloseLog()
+	{
+		if (!m_log) return;
+
+		fclose(m_log);
+		m_log = nullptr;
+	}
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include "BitmapFont.h"
+
+// Rasterized glyphs keyed on character, font, size and DPI. A card face
+// redraw only blits the cached coverage mask, and the masks live in system
+// memory so they survive device loss.
+
+struct GlyphKey
+{
+	wchar_t Value = 0;
+	uint32_t Font = 0;
+	float Size = 0.0f;
+	float Dpi = 0.0f;
+
+	GlyphKey() = default;
+
+	GlyphKey(wchar_t const value,
+		uint32_t const font,
+		float const size,
+		float const dpi) :
+		Value(value),
+		Font(font),
+		Size(size),
+		Dpi(dpi)
+	{}
+
+	bool operator==(GlyphKey const & other) const
+	{
+		return Value == other.Value &&
+			Font == other.Font &&
+			Size == other.Size &&
+			Dpi == other.Dpi;
+	}
+};
+
+struct GlyphKeyHash
+{
+	size_t operator()(GlyphKey const & key) const
+	{
+		uint32_t size;
+		uint32_t dpi;
+		memcpy(&size, &key.Size, sizeof(size));
+		memcpy(&dpi, &key.Dpi, sizeof(dpi));
+
+		uint64_t hash = static_cast<uint64_t>(key.Value) * 0x9E3779B97F4A7C15ull;
+		hash ^= (static_cast<uint64_t>(key.Font) << 32 | size) * 0xC2B2AE3D27D4EB4Full;
+		hash ^= dpi * 0x165667B19E3779F9ull;
+
+		return static_cast<size_t>(hash ^ hash >> 29);
+	}
+};
+
+// Identifies a font by family name, FNV-1a over the characters
+inline uint32_t FontId(wchar_t const * family)
+{
+	uint32_t hash = 2166136261u;
+
+	for (; *family; ++family)
+	{
+		hash = (hash ^ static_cast<uint32_t>(*family)) * 16777619u;
+	}
+
+	return hash;
+}
+
+struct GlyphCache
+{
+	std::unordered_map<GlyphKey, CoverageMask, GlyphKeyHash> m_glyphs;
+	unsigned long long m_hits = 0;
+	unsigned long long m_misses = 0;
+
+	// Returns the cached mask, calling rasterize() to produce it on a miss.
+	// References stay valid until Clear.
+	template <typename Rasterize>
+	CoverageMask const & Get(GlyphKey const & key, Rasterize && rasterize)
+	{
+		auto const found = m_glyphs.find(key);
+
+		if (found != m_glyphs.end())
+		{
+			++m_hits;
+			return found->second;
+		}
+
+		++m_misses;
+		return m_glyphs.emplace(key, rasterize()).first->second;
+	}
+
+	void Clear()
+	{
+		m_glyphs.clear();
+	}
+
+	void ResetCounters()
+	{
+		m_hits = 0;
+		m_misses = 0;
+	}
+
+	size_t Count() const
+	{
+		return m_glyphs.size();
+	}
+
+	size_t Bytes() const
+	{
+		size_t bytes = 0;
+
+		for (auto const & glyph : m_glyphs)
+		{
+			bytes += glyph.second.Alpha.size();
+		}
+
+		return bytes;
+	}
+};
@@ -0,0 +1,315 @@
+#pragma once
+
+#include <csetjmp>
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "ImageSource.h"
+
+// Portable decoders for the background image. Each codec is compiled in when
+// its library is found by the build, which defines IMAGE_JPEG and IMAGE_PNG.
+// The Windows sample decodes through WIC instead.
+
+#if IMAGE_JPEG
+#include <jpeglib.h>
+#endif
+
+#if IMAGE_PNG
+#include <png.h>
+#endif
+
+struct FileCloser
+{
+	void operator()(FILE * file) const
+	{
+		fclose(file);
+	}
+};
+
+typedef std::unique_ptr<FILE, FileCloser> FileHandle;
+
+#if IMAGE_JPEG
+
+// libjpeg decodes scanlines in order, so each strip is decoded on demand.
+struct JpegDecoder : ImageDecoder
+{
+	struct ErrorManager
+	{
+		jpeg_error_mgr Base;
+		jmp_buf Jump;
+	};
+
+	FileHandle m_file;
+	jpeg_decompress_struct m_info = {};
+	ErrorManager m_error = {};
+	std::vector<uint8_t> m_scanline;
+	bool m_started = false;
+
+	explicit JpegDecoder(FileHandle file) :
+		m_file(std::move(file))
+	{
+		m_info.err = jpeg_std_error(&m_error.Base);
+		m_error.Base.error_exit = [](j_common_ptr info)
+		{
+			longjmp(reinterpret_cast<ErrorManager *>(info->err)->Jump, 1);
+		};
+
+		jpeg_create_decompress(&m_info);
+	}
+
+	~JpegDecoder()
+	{
+		jpeg_destroy_decompress(&m_info);
+	}
+
+	// Reads the header. Returns false if the file is not a valid JPEG.
+	bool Open()
+	{
+		if (setjmp(m_error.Jump)) return false;
+
+		jpeg_stdio_src(&m_info, m_file.get());
+		jpeg_read_header(&m_info, true);
+
+#ifdef JCS_EXTENSIONS
+		// libjpeg-turbo converts straight to the surface format
+		m_info.out_color_space = JCS_EXT_BGRA;
+#else
+		m_info.out_color_space = JCS_RGB;
+#endif
+
+		jpeg_start_decompress(&m_info);
+		m_started = true;
+
+		m_scanline.resize(static_cast<size_t>(m_info.output_width) * m_info.output_components);
+
+		return true;
+	}
+
+	unsigned Width() const override
+	{
+		return m_info.output_width;
+	}
+
+	unsigned Height() const override
+	{
+		return m_info.output_height;
+	}
+
+	bool ReadRows(PixelView const & rows) override
+	{
+		ASSERT(m_started && rows.Width == Width());
+
+		if (setjmp(m_error.Jump)) return false;
+
+		for (unsigned y = 0; y != rows.Height; ++y)
+		{
+#ifdef JCS_EXTENSIONS
+			JSAMPROW scanline = reinterpret_cast<JSAMPROW>(rows.Row(y));
+			jpeg_read_scanlines(&m_info, &scanline, 1);
+#else
+			JSAMPROW scanline = m_scanline.data();
+			jpeg_read_scanlines(&m_info, &scanline, 1);
+
+			uint32_t * target = rows.Row(y);
+
+			for (unsigned x = 0; x != rows.Width; ++x)
+			{
+				uint8_t const * rgb = m_scanline.data() + x * 3;
+				target[x] = PackColor(rgb[2], rgb[1], rgb[0], 0xFF);
+			}
+#endif
+		}
+
+		return true;
+	}
+};
+
+#endif
+
+#if IMAGE_PNG
+
+// libpng reads rows in order unless the image is interlaced; interlaced
+// images are decoded in full on the first strip and then handed out.
+struct PngDecoder : ImageDecoder
+{
+	FileHandle m_file;
+	png_structp m_png = nullptr;
+	png_infop m_info = nullptr;
+	unsigned m_width = 0;
+	unsigned m_height = 0;
+	bool m_alpha = false;
+	bool m_interlaced = false;
+	unsigned m_row = 0;
+	PixelBuffer m_whole;
+
+	explicit PngDecoder(FileHandle file) :
+		m_file(std::move(file))
+	{
+		m_png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+
+		if (m_png)
+		{
+			m_info = png_create_info_struct(m_png);
+		}
+	}
+
+	~PngDecoder()
+	{
+		png_destroy_read_struct(&m_png, &m_info, nullptr);
+	}
+
+	bool Open()
+	{
+		if (!m_png || !m_info) return false;
+
+		if (setjmp(png_jmpbuf(m_png))) return false;
+
+		png_init_io(m_png, m_file.get());
+		png_read_info(m_png, m_info);
+
+		m_width = png_get_image_width(m_png, m_info);
+		m_height = png_get_image_height(m_png, m_info);
+
+		png_byte const type = png_get_color_type(m_png, m_info);
+
+		m_alpha = (type & PNG_COLOR_MASK_ALPHA) || png_get_valid(m_png, m_info, PNG_INFO_tRNS);
+		m_interlaced = png_get_interlace_type(m_png, m_info) != PNG_INTERLACE_NONE;
+
+		png_set_expand(m_png);
+		png_set_strip_16(m_png);
+		png_set_gray_to_rgb(m_png);
+		png_set_bgr(m_png);
+		png_set_filler(m_png, 0xFF, PNG_FILLER_AFTER);
+
+		if (m_interlaced)
+		{
+			png_set_interlace_handling(m_png);
+		}
+
+		png_read_update_info(m_png, m_info);
+
+		return true;
+	}
+
+	unsigned Width() const override
+	{
+		return m_width;
+	}
+
+	unsigned Height() const override
+	{
+		return m_height;
+	}
+
+	bool ReadRows(PixelView const & rows) override
+	{
+		ASSERT(rows.Width == m_width && m_row + rows.Height <= m_height);
+
+		if (m_interlaced)
+		{
+			if (m_whole.Pixels.empty() && !ReadWhole()) return false;
+
+			for (unsigned y = 0; y != rows.Height; ++y)
+			{
+				memcpy(rows.Row(y), m_whole.View().Row(m_row + y), m_width * sizeof(uint32_t));
+			}
+		}
+		else
+		{
+			if (setjmp(png_jmpbuf(m_png))) return false;
+
+			for (unsigned y = 0; y != rows.Height; ++y)
+			{
+				png_read_row(m_png, reinterpret_cast<png_bytep>(rows.Row(y)), nullptr);
+			}
+		}
+
+		if (m_alpha)
+		{
+			for (unsigned y = 0; y != rows.Height; ++y)
+			{
+				Premultiply(rows.Row(y), rows.Width);
+			}
+		}
+
+		m_row += rows.Height;
+
+		return true;
+	}
+
+private:
+
+	bool ReadWhole()
+	{
+		m_whole.Resize(m_width, m_height);
+
+		std::vector<png_bytep> pointers(m_height);
+
+		for (unsigned y = 0; y != m_height; ++y)
+		{
+			pointers[y] = reinterpret_cast<png_bytep>(m_whole.View().Row(y));
+		}
+
+		if (setjmp(png_jmpbuf(m_png))) return false;
+
+		png_read_image(m_png, pointers.data());
+
+		return true;
+	}
+
+	static void Premultiply(uint32_t * row, unsigned const width)
+	{
+		for (unsigned x = 0; x != width; ++x)
+		{
+			uint32_t const pixel = row[x];
+			unsigned const a = pixel >> 24;
+
+			if (a == 0xFF) continue;
+
+			row[x] = PackColor(
+				static_cast<uint8_t>(Divide255((pixel & 0xFF) * a)),
+				static_cast<uint8_t>(Divide255((pixel >> 8 & 0xFF) * a)),
+				static_cast<uint8_t>(Divide255((pixel >> 16 & 0xFF) * a)),
+				static_cast<uint8_t>(a));
+		}
+	}
+};
+
+#endif
+
+// Opens a JPEG or PNG file by its signature. Returns nullptr if the file
+// cannot be read or no decoder for its format was built.
+inline std::unique_ptr<ImageDecoder> OpenImageFile(char const * path)
+{
+	FileHandle file(fopen(path, "rb"));
+
+	if (!file) return nullptr;
+
+	unsigned char signature[8] = {};
+	size_t const read = fread(signature, 1, sizeof(signature), file.get());
+	rewind(file.get());
+
+#if IMAGE_JPEG
+	if (read >= 2 && signature[0] == 0xFF && signature[1] == 0xD8)
+	{
+		JpegDecoder * jpeg = new JpegDecoder(std::move(file));
+		std::unique_ptr<ImageDecoder> decoder(jpeg);
+
+		return jpeg->Open() ? std::move(decoder) : nullptr;
+	}
+#endif
+
+#if IMAGE_PNG
+	if (read == 8 && 0 == png_sig_cmp(signature, 0, 8))
+	{
+		PngDecoder * png = new PngDecoder(std::move(file));
+		std::unique_ptr<ImageDecoder> decoder(png);
+
+		return png->Open() ? std::move(decoder) : nullptr;
+	}
+#endif
+
+	(void)read;
+
+	return nullptr;
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "Debug.h"
+#include "Raster.h"
+#include "Trace.h"
+
+// Background images decoded top to bottom in strips on a worker thread. The
+// pixels are BGRA8 premultiplied, like the card surfaces, and rows become
+// readable as soon as their strip is done, so card backs near the top can be
+// drawn long before a large image is fully decoded.
+
+// A decoder produces an image one band of rows at a time. Implementations
+// wrap a codec: WIC on Windows, libjpeg and libpng elsewhere.
+struct ImageDecoder
+{
+	virtual ~ImageDecoder()
+	{}
+
+	virtual unsigned Width() const = 0;
+	virtual unsigned Height() const = 0;
+
+	// Decodes the next rows.Height rows into rows. Returns false if the image
+	// is corrupt, after which no more rows are decoded.
+	virtual bool ReadRows(PixelView const & rows) = 0;
+};
+
+struct StreamingImage
+{
+	// Rows decoded between two progress reports
+	static unsigned const StripRows = 64;
+
+	typedef std::function<void (unsigned rowsReady)> Progress;
+
+	unsigned m_width = 0;
+	unsigned m_height = 0;
+	std::unique_ptr<uint32_t[]> m_pixels; // left uninitialized, rows are written before they are read
+	std::unique_ptr<ImageDecoder> m_decoder;
+	Progress m_progress;
+	std::atomic<unsigned> m_rowsReady;
+	std::atomic<bool> m_failed;
+	std::atomic<bool> m_cancel;
+	std::mutex m_mutex;
+	std::condition_variable m_ready;
+	std::thread m_thread;
+
+	// Starts decoding. Progress, if any, is called on the worker thread after
+	// every strip and when decoding fails.
+	StreamingImage(std::unique_ptr<ImageDecoder> decoder,
+		Progress progress = Progress()) :
+		m_width(decoder->Width()),
+		m_height(decoder->Height()),
+		m_pixels(new uint32_t[static_cast<size_t>(m_width) * m_height]),
+		m_decoder(std::move(decoder)),
+		m_progress(std::move(progress)),
+		m_rowsReady(0),
+		m_failed(false),
+		m_cancel(false)
+	{
+		m_thread = std::thread([this] { Decode(); });
+	}
+
+	~StreamingImage()
+	{
+		m_cancel = true;
+		m_thread.join();
+	}
+
+	StreamingImage(StreamingImage const &) = delete;
+	StreamingImage & operator=(StreamingImage const &) = delete;
+
+	unsigned Width() const
+	{
+		return m_width;
+	}
+
+	unsigned Height() const
+	{
+		return m_height;
+	}
+
+	unsigned RowsReady() const
+	{
+		return m_rowsReady.load(std::memory_order_acquire);
+	}
+
+	bool IsComplete() const
+	{
+		return RowsReady() == Height();
+	}
+
+	bool Failed() const
+	{
+		return m_failed;
+	}
+
+	// True once every row above bottom has been decoded
+	bool IsReady(unsigned const bottom) const
+	{
+		return std::min(bottom, Height()) <= RowsReady();
+	}
+
+	// The decoded rows only. Reading them never races with the worker.
+	ConstPixelView ReadyView() const
+	{
+		return ConstPixelView(m_pixels.get(), m_width, RowsReady(), m_width);
+	}
+
+	// Blocks until the rows above bottom are decoded or decoding has failed.
+	// Returns true if the rows are ready.
+	bool Wait(unsigned const bottom)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		m_ready.wait(lock, [&]
+		{
+			return IsReady(bottom) || m_failed;
+		});
+
+		return IsReady(bottom);
+	}
+
+private:
+
+	void Decode()
+	{
+		GlobalTracer().NameThread("Decoder");
+
+		unsigned row = 0;
+
+		while (row != Height() && !m_cancel)
+		{
+			unsigned const rows = std::min(static_cast<unsigned>(StripRows), Height() - row);
+			PixelView const strip(m_pixels.get() + static_cast<size_t>(row) * m_width, m_width, rows, m_width);
+			bool decoded = false;
+
+			{
+				TraceScope const scope("DecodeStrip", row);
+				decoded = m_decoder->ReadRows(strip);
+			}
+
+			// Published under the lock so that Wait cannot miss the change
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+
+				if (decoded)
+				{
+					row += rows;
+					m_rowsReady.store(row, std::memory_order_release);
+				}
+				else
+				{
+					m_failed = true;
+				}
+			}
+
+			m_ready.notify_all();
+
+			if (m_progress) m_progress(row);
+
+			if (!decoded) break;
+		}
+
+		// The codec is not needed once the pixels are decoded
+		m_decoder.reset();
+	}
+};
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Layout.h"
+#include "MappedFile.h"
+#include "Trace.h"
+
+// Timestamped input of a session of games, as the sample receives it: the
+// clicks at their client points, new games and DPI changes. With the first
+// game's seed and the board's geometry this is everything a session depends
+// on, so a log played back through the same board logic deals the same
+// cards and takes the same turns. See InputReplay.h.
+
+enum class InputKind : uint8_t
+{
+	Click,   // X and Y are the client point in physical pixels
+	NewGame, // dealt from the seed after the current game's
+	Dpi,     // X and Y are the new DPI
+};
+
+struct InputEvent
+{
+	uint64_t Time; // microseconds since the session started
+	InputKind Kind;
+	float X;
+	float Y;
+};
+
+struct InputLog
+{
+	uint64_t Seed = 0; // of the first game
+	BoardGeometry Geometry;
+	float DpiX = 96.0f; // at the start
+	float DpiY = 96.0f;
+	std::vector<InputEvent> Events;
+
+	// Events are in the order they arrived, so times never decrease
+	void Record(uint64_t const time,
+		InputKind const kind,
+		float const x = 0.0f,
+		float const y = 0.0f)
+	{
+		ASSERT(Events.empty() || Events.back().Time <= time);
+
+		Events.push_back(InputEvent { time, kind, x, y });
+	}
+
+	double Seconds() const
+	{
+		return Events.empty() ? 0.0 : Events.back().Time / 1e6;
+	}
+};
+
+inline uint64_t InputMicroseconds(double const seconds)
+{
+	return static_cast<uint64_t>(seconds * 1e6 + 0.5);
+}
+
+// The binary format is a magic number and then variable length integers, as
+// in the binary trace: the seed, the rows and columns, the margin, card size
+// and DPI as the bits of their floats, the event count and then each event
+// as its kind, the change in time from the previous event and the bits of X
+// and Y. Clicks take about a dozen bytes.
+
+static char const InputLogMagic[4] = { 'I', 'N', 'P', '1' };
+
+inline uint64_t InputFloatBits(float const value)
+{
+	uint32_t bits = 0;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+inline float InputFloat(uint64_t const number)
+{
+	uint32_t const bits = static_cast<uint32_t>(number);
+	float value = 0.0f;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+inline std::vector<uint8_t> ExportInputLog(InputLog const & log)
+{
+	std::vector<uint8_t> data(InputLogMagic, InputLogMagic + sizeof(InputLogMagic));
+	data.reserve(64 + log.Events.size() * 12);
+
+	WriteTraceNumber(data, log.Seed);
+	WriteTraceNumber(data, log.Geometry.Rows);
+	WriteTraceNumber(data, log.Geometry.Columns);
+	WriteTraceNumber(data, InputFloatBits(log.Geometry.Margin));
+	WriteTraceNumber(data, InputFloatBits(log.Geometry.CardWidth));
+	WriteTraceNumber(data, InputFloatBits(log.Geometry.CardHeight));
+	WriteTraceNumber(data, InputFloatBits(log.DpiX));
+	WriteTraceNumber(data, InputFloatBits(log.DpiY));
+	WriteTraceNumber(data, log.Events.size());
+
+	uint64_t previous = 0;
+
+	for (InputEvent const & event : log.Events)
+	{
+		WriteTraceNumber(data, static_cast<uint64_t>(event.Kind));
+		WriteTraceNumber(data, event.Time - previous);
+		WriteTraceNumber(data, InputFloatBits(event.X));
+		WriteTraceNumber(data, InputFloatBits(event.Y));
+
+		previous = event.Time;
+	}
+
+	return data;
+}
+
+// Returns false if the data is not a complete input log for a board that
+// can be dealt
+inline bool ImportInputLog(uint8_t const * const data,
+	size_t const size,
+	InputLog & log)
+{
+	if (size < sizeof(InputLogMagic) || 0 != memcmp(data, InputLogMagic, sizeof(InputLogMagic))) return false;
+
+	TraceReader reader(data + sizeof(InputLogMagic), size - sizeof(InputLogMagic));
+
+	log = InputLog();
+	log.Seed = reader.Number();
+
+	uint64_t const rows = reader.Number();
+	uint64_t const columns = reader.Number();
+
+	if (rows == 0 || columns == 0 || rows > 0xFFFF || columns > 0xFFFF || rows * columns % 2 != 0) return false;
+
+	log.Geometry.Rows = static_cast<unsigned>(rows);
+	log.Geometry.Columns = static_cast<unsigned>(columns);
+	log.Geometry.Margin = InputFloat(reader.Number());
+	log.Geometry.CardWidth = InputFloat(reader.Number());
+	log.Geometry.CardHeight = InputFloat(reader.Number());
+	log.DpiX = InputFloat(reader.Number());
+	log.DpiY = InputFloat(reader.Number());
+	log.Events.resize(reader.Count());
+
+	uint64_t previous = 0;
+
+	for (InputEvent & event : log.Events)
+	{
+		uint64_t const kind = reader.Number();
+
+		if (kind > static_cast<uint64_t>(InputKind::Dpi)) return false;
+
+		event.Kind = static_cast<InputKind>(kind);
+		event.Time = previous + reader.Number();
+		event.X = InputFloat(reader.Number());
+		event.Y = InputFloat(reader.Number());
+
+		previous = event.Time;
+	}
+
+	return !reader.m_failed && reader.m_next == reader.m_end;
+}
+
+// The file is written next to the target and moved over it once complete
+inline bool WriteInputLog(PathChar const * path,
+	InputLog const & log)
+{
+	std::basic_string<PathChar> temporary(path);
+	temporary += static_cast<PathChar>('~');
+
+	FILE * file = OpenFile(temporary.c_str(), true);
+
+	if (!file) return false;
+
+	std::vector<uint8_t> const data = ExportInputLog(log);
+
+	bool const written = data.size() == fwrite(data.data(), 1, data.size(), file);
+
+	if (0 != fclose(file) || !written || !MoveFileOver(temporary.c_str(), path))
+	{
+		RemoveFile(temporary.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+inline bool ReadInputLog(PathChar const * path,
+	InputLog & log)
+{
+	MappedFile file;
+
+	return file.Open(path) && ImportInputLog(file.Data(), file.Size(), log);
+}
@@ -0,0 +1,582 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "BoardScene.h"
+#include "InputLog.h"
+#include "Interaction.h"
+#include "Metrics.h"
+#include "ParallelRenderer.h"
+#include "Random.h"
+#include "RecordingCompositor.h"
+#include "RenderThread.h"
+
+// Plays an input log back without a window or a GPU, so that a recorded
+// session can be run on any machine as a performance regression test. The
+// game is the sample's own logic: the board dealt from the log's seeds, the
+// animator and the interaction queue, over the recording compositor with
+// the tiles drawn by the software renderer.
+
+// The sample's game without a window. Clicks are hit tested and queued as
+// the sample's handlers do, and applied by Frame, once per frame.
+struct HeadlessGame
+{
+	RecordingCompositor m_compositor;
+	Board m_board;
+	Animator m_animator;
+	BoardScene m_scene;
+	InteractionQueue m_queue;
+	ThreadPool m_pool;
+	PixelBuffer m_background;
+	std::unique_ptr<CardAtlas> m_atlas;
+	ScenePages m_pages;
+	std::vector<PixelBuffer> m_staging;
+	float m_dpiX = 0.0f;
+	float m_dpiY = 0.0f;
+	uint64_t m_gameSeed = 0;
+	uint64_t m_nextSeed = 0;
+	unsigned m_games = 0;
+
+	// Deals the log's first game, as the sample does when it starts
+	explicit HeadlessGame(InputLog const & log,
+		unsigned const threads = ThreadPool::DefaultThreads()) :
+		m_compositor(false),
+		m_board(log.Geometry),
+		m_scene(m_compositor, log.Geometry.CardCount()),
+		m_pool(threads),
+		m_background(static_cast<unsigned>(std::ceil(log.Geometry.Width())),
+			static_cast<unsigned>(std::ceil(log.Geometry.Height()))),
+		m_dpiX(log.DpiX),
+		m_dpiY(log.DpiY),
+		m_nextSeed(log.Seed)
+	{
+		// A gradient, so that every back differs as the image's would
+		for (unsigned y = 0; y != m_background.Height; ++y)
+			for (unsigned x = 0; x != m_background.Width; ++x)
+			{
+				m_background.Pixels[y * m_background.Width + x] = 0xFF000000u |
+					(x * 255 / m_background.Width) << 16 |
+					(y * 255 / m_background.Height) << 8 |
+					0x80u;
+			}
+
+		for (unsigned index = 0; index != m_board.CardCount(); ++index)
+		{
+			m_animator.CreateVariable(0.0);
+		}
+
+		NewGame();
+	}
+
+	PhysicalLayout Layout() const
+	{
+		return PhysicalLayout(m_board.m_geometry, m_dpiX, m_dpiY);
+	}
+
+	// Deals from the next seed and rebuilds the scene from its pool. Input
+	// still queued belonged to the old game and is dropped.
+	void NewGame()
+	{
+		m_gameSeed = m_nextSeed;
+		m_nextSeed = NextGameSeed(m_gameSeed);
+
+		Xoshiro256 generator(m_gameSeed);
+		m_board.Deal(CardAlphabet::Latin(), generator);
+
+		for (unsigned index = 0; index != m_board.CardCount(); ++index)
+		{
+			m_animator.Reset(index, 0.0);
+		}
+
+		m_queue.Clear();
+
+		CreateLayout();
+
+		m_scene.Clear();
+		m_scene.ReleasePages(m_pages);
+		m_pages = m_scene.CreatePages(*m_atlas);
+		m_scene.Build(m_board, *m_atlas, m_pages, Layout());
+
+		DrawCards(m_pages);
+
+		m_compositor.Commit();
+		++m_games;
+	}
+
+	// Lays the cards out at the new DPI on new tiles, keeping the tree. The
+	// sample spreads the redraw over a few frames; here it is done at once.
+	void SetDpi(float const dpiX,
+		float const dpiY)
+	{
+		m_dpiX = dpiX;
+		m_dpiY = dpiY;
+
+		CreateLayout();
+
+		ScenePages pages = m_scene.CreatePages(*m_atlas);
+		PhysicalLayout const layout = Layout();
+
+		DrawCards(pages);
+
+		for (unsigned index = 0; index != m_board.CardCount(); ++index)
+		{
+			if (!m_scene.Contains(index)) continue;
+
+			m_scene.SetCardLayout(index, m_board[index], *m_atlas, pages, layout);
+		}
+
+		m_scene.DiscardPages(m_pages);
+		m_pages = std::move(pages);
+
+		m_compositor.Commit();
+	}
+
+	// Queues a click at the physical client point. Returns false if it
+	// missed every card that can be selected, which the sample ignores.
+	bool Click(float const x,
+		float const y)
+	{
+		unsigned const card = m_board.CardAtPoint(x, y, m_dpiX, m_dpiY);
+
+		if (!m_board.CanSelect(card)) return false;
+
+		m_queue.Click(card);
+		return true;
+	}
+
+	// Paints at the time, as the sample's paint handler does: releases the
+	// matched cards that have turned away and commits the input since the
+	// last frame. Returns false if there was nothing to commit.
+	bool Frame(double const time)
+	{
+		m_compositor.m_time = time;
+
+		m_animator.Update(m_compositor.NextFrameTime());
+
+		if (m_scene.ReleaseMatched(m_board, m_animator))
+		{
+			m_queue.Invalidate();
+		}
+
+		return m_queue.Flush(m_board, m_animator, m_scene);
+	}
+
+private:
+
+	void CreateLayout()
+	{
+		PhysicalLayout const layout = Layout();
+
+		m_board.Arrange(m_dpiX, m_dpiY);
+		m_atlas.reset(new CardAtlas(m_board, layout.SurfaceWidth(), layout.SurfaceHeight()));
+	}
+
+	void DrawCards(ScenePages const & pages)
+	{
+		BoardGeometry const & geometry = m_board.m_geometry;
+		PixelBuffer const & background = m_background;
+
+		SoftwareRenderer const renderer(m_dpiX,
+			m_dpiY,
+			geometry.CardWidth,
+			geometry.CardHeight,
+			geometry.CardHeight / 2.0f,
+			background.View());
+
+		DrawAtlasPages(m_board, *m_atlas, renderer, m_pool, m_staging);
+
+		for (unsigned page = 0; page != pages.size(); ++page)
+		{
+			PixelBuffer const & staged = m_staging[page];
+			pages[page]->Upload(0, 0, staged.View());
+		}
+	}
+};
+
+// The centre of the card, in physical client pixels
+inline void CardCentre(Board const & board,
+	unsigned const index,
+	float const dpiX,
+	float const dpiY,
+	float & x,
+	float & y)
+{
+	x = board[index].OffsetX + LogicalToPhysical(board.m_geometry.CardWidth, dpiX) / 2.0f;
+	y = board[index].OffsetY + LogicalToPhysical(board.m_geometry.CardHeight, dpiY) / 2.0f;
+}
+
+// A scripted session for the benchmarks: a player who turns an unknown card and then its partner if it has been
+// seen, or else another unknown card, a few tenths of a second a click. Now
+// and then a click lands between the cards. Each game is played out and
+// followed by a new one, with the DPI changed halfway through the session.
+inline InputLog ScriptInputSession(BoardGeometry const & geometry,
+	uint64_t const seed,
+	unsigned const games)
+{
+	InputLog log;
+	log.Seed = seed;
+	log.Geometry = geometry;
+
+	Board board(geometry);
+	Xoshiro256 player(seed ^ 0x5EED);
+	uint64_t gameSeed = seed;
+	uint64_t time = 200000;
+	float dpiX = log.DpiX;
+	float dpiY = log.DpiY;
+
+	auto const click = [&](unsigned const index)
+	{
+		float x = 0.0f;
+		float y = 0.0f;
+		CardCentre(board, index, dpiX, dpiY, x, y);
+
+		time += 150000 + RandomBelow(player, 450000);
+		log.Record(time, InputKind::Click, x, y);
+
+		board.Select(index);
+	};
+
+	for (unsigned game = 0; game != games; ++game)
+	{
+		if (game != 0)
+		{
+			time += 1000000;
+			log.Record(time, InputKind::NewGame);
+			gameSeed = NextGameSeed(gameSeed);
+		}
+
+		if (game == games / 2 && game != 0)
+		{
+			dpiX = dpiY = 144.0f;
+			time += 250000;
+			log.Record(time, InputKind::Dpi, dpiX, dpiY);
+		}
+
+		Xoshiro256 generator(gameSeed);
+		board.Deal(CardAlphabet::Latin(), generator);
+		board.Arrange(dpiX, dpiY);
+
+		std::vector<bool> seen(board.CardCount(), false);
+
+		for (;;)
+		{
+			std::vector<unsigned> unknown;
+			unsigned left = 0;
+
+			for (unsigned index = 0; index != board.CardCount(); ++index)
+			{
+				if (board[index].Status == CardStatus::Matched) continue;
+
+				++left;
+
+				if (!seen[index]) unknown.push_back(index);
+			}
+
+			if (left == 0) break;
+
+			if (RandomBelow(player, 8) == 0)
+			{
+				time += 200000;
+				log.Record(time, InputKind::Click, 1.0f, 1.0f);
+			}
+
+			// Any card left once every card has been seen
+			unsigned first = 0;
+
+			if (unknown.empty())
+			{
+				while (board[first].Status == CardStatus::Matched) ++first;
+			}
+			else
+			{
+				first = unknown[RandomBelow(player, static_cast<uint32_t>(unknown.size()))];
+			}
+
+			click(first);
+			seen[first] = true;
+
+			unsigned second = Board::NoCard;
+
+			for (unsigned index = 0; index != board.CardCount(); ++index)
+			{
+				if (index != first && seen[index] && board.CanSelect(index) && Board::IsMatch(board[first].Value, board[index].Value))
+				{
+					second = index;
+				}
+			}
+
+			if (second == Board::NoCard)
+			{
+				do
+				{
+					second = RandomBelow(player, board.CardCount());
+				}
+				while (!board.CanSelect(second));
+			}
+
+			click(second);
+			seen[second] = true;
+		}
+	}
+
+	return log;
+}
+
+struct ReplayOptions
+{
+	// Log seconds played per second; 1 plays at the recorded pace and 0 as
+	// fast as possible, with no waiting for events or frames
+	double Speed = 1.0;
+
+	// Frames are in log time, so that the clicks of each frame and with them
+	// the animations are the same at any speed
+	double FrameInterval = 1.0 / 60.0;
+
+	// Events after this many log seconds are left out
+	double Until = std::numeric_limits<double>::infinity();
+};
+
+// Latency is wall time from an event's arrival to the commit that shows
+// it: for a click the wait for its frame and the frame's work, for a new
+// game or a DPI change the rebuild. At full speed there is no wait, so it
+// is the work alone. Handling is the time the message thread spends on an
+// event before it can take the next one.
+struct ReplayReport
+{
+	DurationSamples Latency;
+	DurationSamples Handling;
+	DurationSamples FrameWork; // frames that committed
+	unsigned Events = 0;
+	unsigned Clicks = 0;
+	unsigned Missed = 0; // clicks on no card or a card that cannot be selected
+	unsigned Frames = 0; // that committed
+	double Seconds = 0.0;
+};
+
+// Feeds the log's events to the game at their times scaled by the speed,
+// with a frame every interval of log time between them, until the input
+// of the last event is committed
+inline ReplayReport ReplayInput(InputLog const & log,
+	HeadlessGame & game,
+	ReplayOptions const & options = ReplayOptions())
+{
+	typedef std::chrono::steady_clock Clock;
+
+	ReplayReport report;
+	Stopwatch const clock;
+	std::vector<double> arrivals; // of the clicks waiting for a frame
+
+	// Sleeps until the log time comes round at the replay's speed
+	auto const wait = [&](double const logSeconds)
+	{
+		if (options.Speed <= 0.0) return;
+
+		std::this_thread::sleep_until(clock.m_start +
+			std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(logSeconds / options.Speed)));
+	};
+
+	size_t count = 0;
+
+	while (count != log.Events.size() && log.Events[count].Time / 1e6 <= options.Until)
+	{
+		++count;
+	}
+
+	size_t next = 0;
+	double frame = options.FrameInterval;
+
+	for (;;)
+	{
+		double const time = next != count ? log.Events[next].Time / 1e6 : std::numeric_limits<double>::infinity();
+
+		if (time <= frame)
+		{
+			wait(time);
+
+			InputEvent const & event = log.Events[next++];
+			double const arrival = clock.ElapsedSeconds();
+			++report.Events;
+
+			if (InputKind::Click == event.Kind)
+			{
+				if (game.Click(event.X, event.Y))
+				{
+					arrivals.push_back(arrival);
+					++report.Clicks;
+				}
+				else
+				{
+					++report.Missed;
+				}
+			}
+			else
+			{
+				if (InputKind::NewGame == event.Kind)
+				{
+					game.NewGame();
+					arrivals.clear();
+				}
+				else
+				{
+					game.SetDpi(event.X, event.Y);
+				}
+
+				report.Latency.Record(clock.ElapsedSeconds() - arrival);
+			}
+
+			report.Handling.Record(clock.ElapsedSeconds() - arrival);
+			continue;
+		}
+
+		if (next == count && arrivals.empty()) break;
+
+		wait(frame);
+
+		Stopwatch const work;
+
+		if (game.Frame(frame))
+		{
+			report.FrameWork.Record(work.ElapsedSeconds());
+			++report.Frames;
+		}
+
+		double const committed = clock.ElapsedSeconds();
+
+		for (double const arrival : arrivals)
+		{
+			report.Latency.Record(committed - arrival);
+		}
+
+		arrivals.clear();
+		frame += options.FrameInterval;
+	}
+
+	report.Seconds = clock.ElapsedSeconds();
+	return report;
+}
+
+// Runs the headless game as the sample's render thread does, in wall time
+// with frames on a 60 Hz grid, and publishes the board after every change
+struct HeadlessRenderClient : RenderClient
+{
+	HeadlessGame & m_game;
+	SnapshotBuffer<BoardSnapshot> m_snapshots;
+	Stopwatch const m_clock;
+	double m_frameInterval = 1.0 / 60.0;
+	unsigned m_clicks = 0; // queued
+
+	explicit HeadlessRenderClient(HeadlessGame & game) :
+		m_game(game),
+		m_snapshots(BoardSnapshot(game.m_board.m_geometry))
+	{
+		Publish();
+	}
+
+	bool Apply(RenderCommand const & command) override
+	{
+		switch (command.Kind)
+		{
+		case RenderCommandKind::Click:
+			if (!m_game.Click(command.X, command.Y)) return false;
+			++m_clicks;
+			return true;
+
+		case RenderCommandKind::NewGame:
+			m_game.NewGame();
+			Publish();
+			return true;
+
+		case RenderCommandKind::Dpi:
+			m_game.SetDpi(command.X, command.Y);
+			Publish();
+			return true;
+
+		default:
+			return false;
+		}
+	}
+
+	bool FramePending() override
+	{
+		return false;
+	}
+
+	bool Frame() override
+	{
+		if (!m_game.Frame(m_clock.ElapsedSeconds())) return false;
+
+		Publish();
+		return true;
+	}
+
+	double SecondsToNextFrame() override
+	{
+		return m_frameInterval - std::fmod(m_clock.ElapsedSeconds(), m_frameInterval);
+	}
+
+	void Publish()
+	{
+		BoardSnapshot & snapshot = m_snapshots.BeginWrite();
+		snapshot.Cards = m_game.m_board;
+		snapshot.DpiX = m_game.m_dpiX;
+		snapshot.DpiY = m_game.m_dpiY;
+		snapshot.Games = m_game.m_games;
+		m_snapshots.Publish();
+	}
+};
+
+// Posts the log's events from this thread, as the sample's message loop
+// does, to the game on a render thread. Frames are paced in wall time
+// rather than placed in log time, so clicks are batched by when they arrive.
+inline ReplayReport ReplayOnRenderThread(InputLog const & log,
+	HeadlessGame & game,
+	ReplayOptions const & options = ReplayOptions())
+{
+	typedef std::chrono::steady_clock Clock;
+
+	ReplayReport report;
+	HeadlessRenderClient client(game);
+	RenderThread thread;
+	unsigned const target = thread.Add(client);
+	unsigned clicks = 0;
+
+	thread.Start();
+
+	Stopwatch const clock;
+
+	for (InputEvent const & event : log.Events)
+	{
+		double const time = event.Time / 1e6;
+
+		if (time > options.Until) break;
+
+		if (options.Speed > 0.0)
+		{
+			std::this_thread::sleep_until(clock.m_start +
+				std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(time / options.Speed)));
+		}
+
+		Stopwatch const handling;
+
+		thread.Post(RenderCommandForInput(event.Kind), target, event.X, event.Y);
+
+		report.Handling.Record(handling.ElapsedSeconds());
+		++report.Events;
+		clicks += InputKind::Click == event.Kind;
+	}
+
+	thread.Settle();
+	thread.Stop();
+
+	report.Latency = thread.m_latency;
+	report.FrameWork = thread.m_frameWork;
+	report.Frames = thread.m_frames;
+	report.Clicks = client.m_clicks;
+	report.Missed = clicks - client.m_clicks;
+	report.Seconds = clock.ElapsedSeconds();
+	return report;
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <vector>
+#include "Animation.h"
+#include "Board.h"
+
+// Input and state changes are queued as they arrive and applied once per
+// frame: every click since the last frame goes into one storyboard scheduled
+// at the next frame time, each card that changed gets its new curve once, and
+// the frame is committed once. This keeps scripted or replayed input at any
+// rate to one Commit per frame.
+
+// The compositor calls a frame needs. The sample implements it over
+// DirectComposition; the benchmarks use a fake that counts the calls.
+struct FrameCompositor
+{
+	virtual ~FrameCompositor() {}
+
+	// The time of the next frame, from GetFrameStatistics
+	virtual double NextFrameTime() = 0;
+
+	// Replaces the card's rotation with the curve. Implementations keep one
+	// animation object per card and refill it.
+	virtual void AnimateAngle(unsigned card, AnimationCurve const & curve) = 0;
+
+	virtual void Commit() = 0;
+};
+
+// Seconds a card takes to turn from face down to face up
+static double const FlipDuration = 1.0;
+
+// Angle of a card face up and of a matched card turned edge on
+static double const FaceUpAngle = 180.0;
+static double const MatchedAngle = 90.0;
+
+inline AccelerateDecelerate CreateFlipTransition(double const duration,
+	double const finalValue)
+{
+	return AccelerateDecelerate(duration, finalValue, 0.2, 0.8);
+}
+
+struct InteractionQueue
+{
+	std::vector<unsigned> m_clicks;
+	std::vector<unsigned> m_changed;
+	std::vector<bool> m_isChanged;
+	bool m_dirty = false;
+
+	unsigned m_frames = 0;
+	unsigned m_commits = 0;
+	unsigned m_clicksApplied = 0;
+
+	void Click(unsigned const card)
+	{
+		m_clicks.push_back(card);
+	}
+
+	// Marks a change made outside the queue, such as a redrawn surface, so
+	// that it is committed with the next frame
+	void Invalidate()
+	{
+		m_dirty = true;
+	}
+
+	bool Empty() const
+	{
+		return m_clicks.empty() && !m_dirty;
+	}
+
+	// Forgets queued input, for example after device loss
+	void Clear()
+	{
+		m_clicks.clear();
+		m_changed.clear();
+		m_isChanged.clear();
+		m_dirty = false;
+	}
+
+	// Applies everything queued since the last frame. Returns false if there
+	// was nothing to commit.
+	bool Flush(Board & board,
+		Animator & animator,
+		FrameCompositor & compositor)
+	{
+		if (Empty()) return false;
+
+		++m_frames;
+
+		if (!m_clicks.empty())
+		{
+			ApplyClicks(board, animator, compositor);
+		}
+
+		compositor.Commit();
+		++m_commits;
+
+		Clear();
+
+		return true;
+	}
+
+private:
+
+	void ApplyClicks(Board & board,
+		Animator & animator,
+		FrameCompositor & compositor)
+	{
+		double const next = compositor.NextFrameTime();
+
+		animator.Update(next);
+
+		Storyboard storyboard;
+		m_isChanged.assign(board.CardCount(), false);
+
+		for (unsigned const card : m_clicks)
+		{
+			if (!board.CanSelect(card)) continue;
+
+			Selection const selection = board.Select(card);
+			++m_clicksApplied;
+
+			// A later click in the same frame overrides what an earlier one
+			// scheduled for the card
+			storyboard.RemoveTransitions(selection.Second);
+
+			Keyframe const keyframe = AddShowTransition(animator, selection.Second, storyboard);
+
+			if (SelectionResult::Selected != selection.Result)
+			{
+				double const finalValue = SelectionResult::Matched == selection.Result ? MatchedAngle : 0.0;
+
+				storyboard.RemoveTransitions(selection.First, keyframe);
+				storyboard.AddTransitionAtKeyframe(selection.First, CreateFlipTransition(FlipDuration, finalValue), keyframe);
+				storyboard.AddTransitionAtKeyframe(selection.Second, CreateFlipTransition(FlipDuration, finalValue), keyframe);
+			}
+
+			Changed(selection.First);
+			Changed(selection.Second);
+		}
+
+		if (storyboard.Empty()) return;
+
+		animator.Schedule(storyboard, next);
+
+		for (unsigned const card : m_changed)
+		{
+			compositor.AnimateAngle(card, animator.GetCurve(card));
+		}
+	}
+
+	// Turns the card face up from wherever it is, taking as long as the part
+	// of the turn that is left
+	static Keyframe AddShowTransition(Animator const & animator,
+		unsigned const card,
+		Storyboard & storyboard)
+	{
+		double const angle = animator.Value(card);
+
+		double const duration = (FaceUpAngle - angle) / FaceUpAngle * FlipDuration;
+
+		return storyboard.AddTransition(card, CreateFlipTransition(duration, FaceUpAngle));
+	}
+
+	void Changed(unsigned const card)
+	{
+		if (m_isChanged[card]) return;
+
+		m_isChanged[card] = true;
+		m_changed.push_back(card);
+	}
+};
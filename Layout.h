@@ -0,0 +1,263 @@
+#pragma once
+
+#include <vector>
+
+// Board layout math shared by the window and the headless board engine.
+// Logical units are device independent pixels (1/96 inch).
+
+template <typename T>
+static float PhysicalToLogical(T const pixel,
+	float const dpi)
+{
+	return pixel * 96.0f / dpi;
+}
+
+template <typename T>
+static float LogicalToPhysical(T const pixel,
+	float const dpi)
+{
+	return pixel * dpi / 96.0f;
+}
+
+struct BoardGeometry
+{
+	unsigned Rows = 0;
+	unsigned Columns = 0;
+	float Margin = 0.0f;
+	float CardWidth = 0.0f;
+	float CardHeight = 0.0f;
+
+	BoardGeometry() = default;
+
+	constexpr BoardGeometry(unsigned const rows,
+		unsigned const columns,
+		float const margin,
+		float const cardWidth,
+		float const cardHeight) :
+		Rows(rows),
+		Columns(columns),
+		Margin(margin),
+		CardWidth(cardWidth),
+		CardHeight(cardHeight)
+	{}
+
+	constexpr unsigned CardCount() const
+	{
+		return Rows * Columns;
+	}
+
+	constexpr float Width() const
+	{
+		return Columns * (CardWidth + Margin) + Margin;
+	}
+
+	constexpr float Height() const
+	{
+		return Rows * (CardHeight + Margin) + Margin;
+	}
+
+	constexpr float CardLeft(unsigned const column) const
+	{
+		return column * (CardWidth + Margin) + Margin;
+	}
+
+	constexpr float CardTop(unsigned const row) const
+	{
+		return row * (CardHeight + Margin) + Margin;
+	}
+};
+
+// Layout tables hold what the formulas above give for every row and column
+// of a board: the logical card offsets, the board size and the pitch that
+// hit testing divides by. StaticBoardLayout generates them at compile time
+// for a board size given by a policy; BoardLayout computes them at run time
+// for any board. Both have the same interface and give exactly the values of
+// the formulas, so that either can arrange and hit test the board.
+
+template <unsigned Rows, unsigned Columns>
+struct LayoutTable
+{
+	float Left[Columns];
+	float Top[Rows];
+};
+
+template <unsigned Rows, unsigned Columns>
+constexpr LayoutTable<Rows, Columns> MakeLayoutTable(BoardGeometry const & geometry)
+{
+	LayoutTable<Rows, Columns> table = {};
+
+	for (unsigned column = 0; column != Columns; ++column)
+	{
+		table.Left[column] = geometry.CardLeft(column);
+	}
+
+	for (unsigned row = 0; row != Rows; ++row)
+	{
+		table.Top[row] = geometry.CardTop(row);
+	}
+
+	return table;
+}
+
+// Policy is a type with a constexpr Geometry function, such as SampleBoard
+// below
+template <typename Policy>
+struct StaticBoardLayout
+{
+	static constexpr BoardGeometry Geometry = Policy::Geometry();
+	static constexpr unsigned RowCount = Geometry.Rows;
+	static constexpr unsigned ColumnCount = Geometry.Columns;
+	static constexpr LayoutTable<RowCount, ColumnCount> Table = MakeLayoutTable<RowCount, ColumnCount>(Geometry);
+
+	static_assert(RowCount * ColumnCount % 2 == 0, "cards come in pairs");
+
+	constexpr unsigned Rows() const { return RowCount; }
+	constexpr unsigned Columns() const { return ColumnCount; }
+	constexpr float Margin() const { return Geometry.Margin; }
+	constexpr float CardWidth() const { return Geometry.CardWidth; }
+	constexpr float CardHeight() const { return Geometry.CardHeight; }
+	constexpr float Width() const { return Geometry.Width(); }
+	constexpr float Height() const { return Geometry.Height(); }
+	constexpr float PitchX() const { return Geometry.CardWidth + Geometry.Margin; }
+	constexpr float PitchY() const { return Geometry.CardHeight + Geometry.Margin; }
+
+	constexpr float CardLeft(unsigned const column) const
+	{
+		return Table.Left[column];
+	}
+
+	constexpr float CardTop(unsigned const row) const
+	{
+		return Table.Top[row];
+	}
+};
+
+template <typename Policy>
+constexpr BoardGeometry StaticBoardLayout<Policy>::Geometry;
+
+template <typename Policy>
+constexpr LayoutTable<StaticBoardLayout<Policy>::RowCount, StaticBoardLayout<Policy>::ColumnCount> StaticBoardLayout<Policy>::Table;
+
+// The sample's board, fixed at compile time so that the compiler generates
+// its layout table. The benchmarks lay out the sample's cards on boards of
+// other sizes.
+struct SampleBoard
+{
+	static constexpr BoardGeometry Geometry()
+	{
+		return BoardGeometry(3, 6, 15.0f, 150.0f, 210.0f);
+	}
+
+	static constexpr BoardGeometry Geometry(unsigned const rows,
+		unsigned const columns)
+	{
+		return BoardGeometry(rows, columns, Geometry().Margin, Geometry().CardWidth, Geometry().CardHeight);
+	}
+};
+
+struct BoardLayout
+{
+	BoardGeometry Geometry;
+	std::vector<float> Left;
+	std::vector<float> Top;
+
+	BoardLayout() = default;
+
+	explicit BoardLayout(BoardGeometry const & geometry) :
+		Geometry(geometry),
+		Left(geometry.Columns),
+		Top(geometry.Rows)
+	{
+		for (unsigned column = 0; column != geometry.Columns; ++column)
+		{
+			Left[column] = geometry.CardLeft(column);
+		}
+
+		for (unsigned row = 0; row != geometry.Rows; ++row)
+		{
+			Top[row] = geometry.CardTop(row);
+		}
+	}
+
+	unsigned Rows() const { return Geometry.Rows; }
+	unsigned Columns() const { return Geometry.Columns; }
+	float Margin() const { return Geometry.Margin; }
+	float CardWidth() const { return Geometry.CardWidth; }
+	float CardHeight() const { return Geometry.CardHeight; }
+	float Width() const { return Geometry.Width(); }
+	float Height() const { return Geometry.Height(); }
+	float PitchX() const { return Geometry.CardWidth + Geometry.Margin; }
+	float PitchY() const { return Geometry.CardHeight + Geometry.Margin; }
+
+	float CardLeft(unsigned const column) const
+	{
+		return Left[column];
+	}
+
+	float CardTop(unsigned const row) const
+	{
+		return Top[row];
+	}
+};
+
+// The board at one DPI in physical pixels: card positions for the visual
+// offsets, card surface sizes and the client area. Everything the window
+// recomputes when the DPI changes comes from here.
+struct PhysicalLayout
+{
+	BoardGeometry Geometry;
+	float DpiX = 96.0f;
+	float DpiY = 96.0f;
+
+	PhysicalLayout() = default;
+
+	PhysicalLayout(BoardGeometry const & geometry,
+		float const dpiX,
+		float const dpiY) :
+		Geometry(geometry),
+		DpiX(dpiX),
+		DpiY(dpiY)
+	{}
+
+	float CardLeft(unsigned const column) const
+	{
+		return LogicalToPhysical(Geometry.CardLeft(column), DpiX);
+	}
+
+	float CardTop(unsigned const row) const
+	{
+		return LogicalToPhysical(Geometry.CardTop(row), DpiY);
+	}
+
+	// Exact card size, used for the flip transform
+	float CardWidth() const
+	{
+		return LogicalToPhysical(Geometry.CardWidth, DpiX);
+	}
+
+	float CardHeight() const
+	{
+		return LogicalToPhysical(Geometry.CardHeight, DpiY);
+	}
+
+	// Card surfaces cover whole pixels
+	unsigned SurfaceWidth() const
+	{
+		return static_cast<unsigned>(CardWidth());
+	}
+
+	unsigned SurfaceHeight() const
+	{
+		return static_cast<unsigned>(CardHeight());
+	}
+
+	unsigned ClientWidth() const
+	{
+		return static_cast<unsigned>(LogicalToPhysical(Geometry.Width(), DpiX));
+	}
+
+	unsigned ClientHeight() const
+	{
+		return static_cast<unsigned>(LogicalToPhysical(Geometry.Height(), DpiY));
+	}
+};
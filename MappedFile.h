@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include "Debug.h"
+
+// Read-only memory mapped files and the few file system calls the caches
+// need, for Windows and POSIX. Paths are wide on Windows.
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+typedef wchar_t PathChar;
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+typedef char PathChar;
+#endif
+
+struct MappedFile
+{
+	uint8_t const * m_data = nullptr;
+	size_t m_size = 0;
+
+	MappedFile() = default;
+
+	MappedFile(MappedFile const &) = delete;
+	MappedFile & operator=(MappedFile const &) = delete;
+
+	~MappedFile()
+	{
+		Close();
+	}
+
+	bool IsOpen() const
+	{
+		return m_data != nullptr;
+	}
+
+	uint8_t const * Data() const
+	{
+		return m_data;
+	}
+
+	size_t Size() const
+	{
+		return m_size;
+	}
+
+	// Maps the whole file. Returns false if it is missing or empty.
+	bool Open(PathChar const * path)
+	{
+		Close();
+
+#ifdef _WIN32
+		HANDLE const file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+		if (file == INVALID_HANDLE_VALUE) return false;
+
+		LARGE_INTEGER size = {};
+		HANDLE mapping = nullptr;
+
+		if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+		{
+			mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		}
+
+		// The view keeps the mapping and the file alive
+		CloseHandle(file);
+
+		if (!mapping) return false;
+
+		m_data = static_cast<uint8_t const *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		CloseHandle(mapping);
+
+		if (!m_data) return false;
+
+		m_size = static_cast<size_t>(size.QuadPart);
+#else
+		int const file = open(path, O_RDONLY);
+
+		if (file < 0) return false;
+
+		struct stat status = {};
+		void * data = MAP_FAILED;
+
+		if (0 == fstat(file, &status) && status.st_size > 0)
+		{
+			data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+		}
+
+		close(file);
+
+		if (data == MAP_FAILED) return false;
+
+		m_data = static_cast<uint8_t const *>(data);
+		m_size = static_cast<size_t>(status.st_size);
+#endif
+
+		return true;
+	}
+
+	void Close()
+	{
+		if (!m_data) return;
+
+#ifdef _WIN32
+		UnmapViewOfFile(m_data);
+#else
+		munmap(const_cast<uint8_t *>(m_data), m_size);
+#endif
+
+		m_data = nullptr;
+		m_size = 0;
+	}
+};
+
+inline FILE * OpenFile(PathChar const * path, bool const write)
+{
+#ifdef _WIN32
+	FILE * file = nullptr;
+	return 0 == _wfopen_s(&file, path, write ? L"wb" : L"rb") ? file : nullptr;
+#else
+	return fopen(path, write ? "wb" : "rb");
+#endif
+}
+
+// Replaces target with source, so that readers never see a partial file
+inline bool MoveFileOver(PathChar const * source, PathChar const * target)
+{
+#ifdef _WIN32
+	return 0 != MoveFileExW(source, target, MOVEFILE_REPLACE_EXISTING);
+#else
+	return 0 == rename(source, target);
+#endif
+}
+
+inline void RemoveFile(PathChar const * path)
+{
+#ifdef _WIN32
+	DeleteFileW(path);
+#else
+	unlink(path);
+#endif
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cmath>
+
+// 4x4 float matrices for the card transforms, with the layout and the
+// conventions of D2D1::Matrix4x4F and D3DMATRIX: row major, row vectors,
+// transforms applied left to right. Products use SSE2 or NEON where the
+// compiler targets them and give the same bits as the scalar reference,
+// which adds the terms in the order the D2D helpers do.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MATRIX_SSE2 1
+#endif
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define MATRIX_NEON 1
+#endif
+
+// A point or direction in homogeneous coordinates
+struct Vector4
+{
+	float X;
+	float Y;
+	float Z;
+	float W;
+};
+
+struct Matrix4x4;
+
+inline Matrix4x4 Multiply(Matrix4x4 const & left, Matrix4x4 const & right);
+
+struct Matrix4x4
+{
+	float M[4][4];
+
+	static Matrix4x4 Identity()
+	{
+		return
+		{{
+			{ 1.0f, 0.0f, 0.0f, 0.0f },
+			{ 0.0f, 1.0f, 0.0f, 0.0f },
+			{ 0.0f, 0.0f, 1.0f, 0.0f },
+			{ 0.0f, 0.0f, 0.0f, 1.0f },
+		}};
+	}
+
+	static Matrix4x4 Translation(float const x,
+		float const y,
+		float const z)
+	{
+		Matrix4x4 matrix = Identity();
+		matrix.M[3][0] = x;
+		matrix.M[3][1] = y;
+		matrix.M[3][2] = z;
+		return matrix;
+	}
+
+	static Matrix4x4 Scale(float const x,
+		float const y,
+		float const z)
+	{
+		Matrix4x4 matrix = Identity();
+		matrix.M[0][0] = x;
+		matrix.M[1][1] = y;
+		matrix.M[2][2] = z;
+		return matrix;
+	}
+
+	static Matrix4x4 RotationY(float const degrees)
+	{
+		float const radians = degrees * (3.141592654f / 180.0f);
+		float const sine = std::sin(radians);
+		float const cosine = std::cos(radians);
+
+		Matrix4x4 matrix = Identity();
+		matrix.M[0][0] = cosine;
+		matrix.M[0][2] = -sine;
+		matrix.M[2][0] = sine;
+		matrix.M[2][2] = cosine;
+		return matrix;
+	}
+
+	// Perspective with the eye at the given distance along z
+	static Matrix4x4 PerspectiveProjection(float const depth)
+	{
+		Matrix4x4 matrix = Identity();
+		matrix.M[2][3] = depth > 0.0f ? -1.0f / depth : 0.0f;
+		return matrix;
+	}
+
+	Matrix4x4 operator*(Matrix4x4 const & other) const
+	{
+		return Multiply(*this, other);
+	}
+
+	// The point as a row vector times the matrix
+	Vector4 Transform(Vector4 const & point) const
+	{
+		return
+		{
+			point.X * M[0][0] + point.Y * M[1][0] + point.Z * M[2][0] + point.W * M[3][0],
+			point.X * M[0][1] + point.Y * M[1][1] + point.Z * M[2][1] + point.W * M[3][1],
+			point.X * M[0][2] + point.Y * M[1][2] + point.Z * M[2][2] + point.W * M[3][2],
+			point.X * M[0][3] + point.Y * M[1][3] + point.Z * M[2][3] + point.W * M[3][3],
+		};
+	}
+
+	bool operator==(Matrix4x4 const & other) const
+	{
+		for (unsigned row = 0; row != 4; ++row)
+			for (unsigned column = 0; column != 4; ++column)
+			{
+				if (M[row][column] != other.M[row][column]) return false;
+			}
+
+		return true;
+	}
+};
+
+static_assert(sizeof(Matrix4x4) == 16 * sizeof(float), "same layout as D3DMATRIX");
+
+inline Matrix4x4 MultiplyScalar(Matrix4x4 const & left, Matrix4x4 const & right)
+{
+	Matrix4x4 result;
+
+	for (unsigned row = 0; row != 4; ++row)
+		for (unsigned column = 0; column != 4; ++column)
+		{
+			result.M[row][column] =
+				left.M[row][0] * right.M[0][column] +
+				left.M[row][1] * right.M[1][column] +
+				left.M[row][2] * right.M[2][column] +
+				left.M[row][3] * right.M[3][column];
+		}
+
+	return result;
+}
+
+// Each row of the result is the rows of the right matrix scaled by the
+// elements of the row on the left, summed in the scalar order
+#if MATRIX_SSE2
+inline Matrix4x4 MultiplySse2(Matrix4x4 const & left, Matrix4x4 const & right)
+{
+	__m128 const right0 = _mm_loadu_ps(right.M[0]);
+	__m128 const right1 = _mm_loadu_ps(right.M[1]);
+	__m128 const right2 = _mm_loadu_ps(right.M[2]);
+	__m128 const right3 = _mm_loadu_ps(right.M[3]);
+
+	Matrix4x4 result;
+
+	for (unsigned row = 0; row != 4; ++row)
+	{
+		__m128 const elements = _mm_loadu_ps(left.M[row]);
+
+		__m128 value = _mm_mul_ps(_mm_shuffle_ps(elements, elements, _MM_SHUFFLE(0, 0, 0, 0)), right0);
+		value = _mm_add_ps(value, _mm_mul_ps(_mm_shuffle_ps(elements, elements, _MM_SHUFFLE(1, 1, 1, 1)), right1));
+		value = _mm_add_ps(value, _mm_mul_ps(_mm_shuffle_ps(elements, elements, _MM_SHUFFLE(2, 2, 2, 2)), right2));
+		value = _mm_add_ps(value, _mm_mul_ps(_mm_shuffle_ps(elements, elements, _MM_SHUFFLE(3, 3, 3, 3)), right3));
+
+		_mm_storeu_ps(result.M[row], value);
+	}
+
+	return result;
+}
+#endif
+
+#if MATRIX_NEON
+inline Matrix4x4 MultiplyNeon(Matrix4x4 const & left, Matrix4x4 const & right)
+{
+	float32x4_t const right0 = vld1q_f32(right.M[0]);
+	float32x4_t const right1 = vld1q_f32(right.M[1]);
+	float32x4_t const right2 = vld1q_f32(right.M[2]);
+	float32x4_t const right3 = vld1q_f32(right.M[3]);
+
+	Matrix4x4 result;
+
+	for (unsigned row = 0; row != 4; ++row)
+	{
+		// Separate multiplies and adds rather than vmlaq, which may fuse
+		float32x4_t value = vmulq_n_f32(right0, left.M[row][0]);
+		value = vaddq_f32(value, vmulq_n_f32(right1, left.M[row][1]));
+		value = vaddq_f32(value, vmulq_n_f32(right2, left.M[row][2]));
+		value = vaddq_f32(value, vmulq_n_f32(right3, left.M[row][3]));
+
+		vst1q_f32(result.M[row], value);
+	}
+
+	return result;
+}
+#endif
+
+inline Matrix4x4 Multiply(Matrix4x4 const & left, Matrix4x4 const & right)
+{
+#if MATRIX_SSE2
+	return MultiplySse2(left, right);
+#elif MATRIX_NEON
+	return MultiplyNeon(left, right);
+#else
+	return MultiplyScalar(left, right);
+#endif
+}
+
+// The matrices either side of a card face's rotation. The face is centered
+// on the origin, turned over if it is the front, rotated, seen in
+// perspective from twice the card width away and moved back. They depend
+// only on the card size and the side, so faces of the same size share them.
+inline Matrix4x4 CardFacePreTransform(float const width,
+	float const height,
+	bool const front)
+{
+	return Matrix4x4::Translation(-width / 2.0f, -height / 2.0f, 0.0f) *
+		Matrix4x4::RotationY(front ? 180.0f : 0.0f);
+}
+
+inline Matrix4x4 CardFacePostTransform(float const width,
+	float const height)
+{
+	return Matrix4x4::PerspectiveProjection(width * 2.0f) *
+		Matrix4x4::Translation(width / 2.0f, height / 2.0f, 0.0f);
+}
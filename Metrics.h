@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+// Timing counters the sample keeps about itself, such as how long it takes
+// to rebuild device resources after device loss.
+
+struct Stopwatch
+{
+	typedef std::chrono::steady_clock Clock;
+
+	Clock::time_point m_start = Clock::now();
+
+	void Restart()
+	{
+		m_start = Clock::now();
+	}
+
+	double ElapsedSeconds() const
+	{
+		return std::chrono::duration<double>(Clock::now() - m_start).count();
+	}
+};
+
+// Count, last, mean and worst case of a repeated operation, in seconds
+struct DurationMetric
+{
+	unsigned Count = 0;
+	double Last = 0.0;
+	double Total = 0.0;
+	double Max = 0.0;
+
+	void Record(double const seconds)
+	{
+		++Count;
+		Last = seconds;
+		Total += seconds;
+		Max = std::max(Max, seconds);
+	}
+
+	double Mean() const
+	{
+		return Count ? Total / Count : 0.0;
+	}
+};
+
+// Every duration of a repeated operation, for percentiles where the mean
+// hides the slow cases, such as the latency of each replayed input event
+struct DurationSamples
+{
+	std::vector<double> Seconds;
+
+	void Record(double const seconds)
+	{
+		Seconds.push_back(seconds);
+	}
+
+	unsigned Count() const
+	{
+		return static_cast<unsigned>(Seconds.size());
+	}
+
+	// Nearest rank, percent from 0 to 100
+	double Percentile(double const percent) const
+	{
+		if (Seconds.empty()) return 0.0;
+
+		std::vector<double> sorted(Seconds);
+		size_t const rank = static_cast<size_t>(percent / 100.0 * (sorted.size() - 1) + 0.5);
+		std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+
+		return sorted[rank];
+	}
+
+	double Max() const
+	{
+		return Seconds.empty() ? 0.0 : *std::max_element(Seconds.begin(), Seconds.end());
+	}
+};
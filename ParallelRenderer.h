@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include "Atlas.h"
+#include "SoftwareRenderer.h"
+#include "ThreadPool.h"
+
+// Rasterizes the card atlas on a thread pool. Every tile is one task and
+// tiles never overlap, so the workers draw straight into the CPU pages
+// without locks. Uploading the pages is left to the caller, on the thread
+// that owns the compositor.
+
+// The pages hold the unique fronts and, if backs is true, the back of every
+// card still in play. Glyphs are rasterized up front on the calling thread,
+// through the renderer's glyph cache if it has one, as the cache is not
+// thread safe.
+inline void DrawAtlasPages(Board const & board,
+	CardAtlas const & atlas,
+	SoftwareRenderer const & renderer,
+	ThreadPool & pool,
+	std::vector<PixelBuffer> & pages,
+	bool const backs = true)
+{
+	pages.resize(atlas.m_atlas.PageCount());
+
+	for (unsigned page = 0; page != atlas.m_atlas.PageCount(); ++page)
+	{
+		pages[page].Resize(atlas.m_atlas.m_pageWidth, atlas.m_atlas.PageHeight(page));
+	}
+
+	std::vector<CoverageMask> rasterized;
+	std::vector<CoverageMask const *> glyphs;
+
+	if (!renderer.m_glyphs)
+	{
+		rasterized.reserve(atlas.m_uniqueFronts.size());
+	}
+
+	for (CardAtlas::Front const & front : atlas.m_uniqueFronts)
+	{
+		if (renderer.m_glyphs)
+		{
+			GlyphKey const key(front.Value, SoftwareRenderer::Font(), renderer.m_fontSize, renderer.m_dpiY);
+
+			glyphs.push_back(&renderer.m_glyphs->Get(key, [&]
+			{
+				return renderer.RasterizeGlyph(front.Value);
+			}));
+		}
+		else
+		{
+			rasterized.push_back(renderer.RasterizeGlyph(front.Value));
+			glyphs.push_back(&rasterized.back());
+		}
+	}
+
+	unsigned const fronts = static_cast<unsigned>(atlas.m_uniqueFronts.size());
+	unsigned const tiles = fronts + (backs ? board.CardCount() : 0);
+
+	auto const tile = [&](AtlasRect const & rect)
+	{
+		return pages[rect.Page].View().SubView(rect.Left, rect.Top, rect.Width, rect.Height);
+	};
+
+	pool.ParallelFor(tiles, [&](unsigned const index, unsigned)
+	{
+		if (index < fronts)
+		{
+			renderer.DrawCardFront(tile(atlas.m_uniqueFronts[index].Rect), *glyphs[index]);
+			return;
+		}
+
+		unsigned const card = index - fronts;
+
+		if (!atlas.Contains(card)) return;
+
+		renderer.DrawCardBack(tile(atlas.BackRect(card)), board[card].OffsetX, board[card].OffsetY);
+	});
+}
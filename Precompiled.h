@@ -10,10 +10,10 @@
 #include <d2d1_2helper.h>
 #include <dcomp.h>
 #include <array>
+#include <memory>
 #include <random>
 #include <dwrite_2.h>
 #include <wincodec.h>
-#include <UIAnimation.h>
 
 #include "Debug.h"
 
@@ -21,4 +21,5 @@
 #pragma comment(lib, "d3d11")
 #pragma comment(lib, "d2d1")
 #pragma comment(lib, "dcomp")
-#pragma comment(lib, "dwrite")
\ No newline at end of file
+#pragma comment(lib, "dwrite")
+#pragma comment(lib, "shell32")
\ No newline at end of file
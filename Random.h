@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+// Small, seedable random number generators for dealing cards. Each is a
+// standard uniform random bit generator, so it also works with the standard
+// library's shuffles and distributions, and the same seed gives the same
+// sequence on every platform and compiler, which std::mt19937 only promises
+// for the raw engine and not for the distributions over it.
+
+// Spreads a 64-bit seed over the state of the generators below, so that
+// similar seeds give unrelated sequences. Also a generator of its own.
+struct SplitMix64
+{
+	typedef uint64_t result_type;
+
+	uint64_t m_state = 0;
+
+	explicit SplitMix64(uint64_t const seed) :
+		m_state(seed)
+	{}
+
+	static constexpr result_type min()
+	{
+		return 0;
+	}
+
+	static constexpr result_type max()
+	{
+		return std::numeric_limits<uint64_t>::max();
+	}
+
+	uint64_t operator()()
+	{
+		uint64_t z = m_state += 0x9E3779B97F4A7C15ull;
+		z = (z ^ z >> 30) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ z >> 27) * 0x94D049BB133111EBull;
+		return z ^ z >> 31;
+	}
+};
+
+// The seed of the game after the one dealt from seed, so that a session of
+// games follows from its first seed
+inline uint64_t NextGameSeed(uint64_t const seed)
+{
+	return SplitMix64(seed)();
+}
+
+// xoshiro256** by Blackman and Vigna: 256 bits of state, all 64 output bits
+// usable, a few instructions per number
+struct Xoshiro256
+{
+	typedef uint64_t result_type;
+
+	uint64_t m_state[4];
+
+	explicit Xoshiro256(uint64_t const seed)
+	{
+		SplitMix64 seeder(seed);
+
+		for (uint64_t & word : m_state)
+		{
+			word = seeder();
+		}
+	}
+
+	static constexpr result_type min()
+	{
+		return 0;
+	}
+
+	static constexpr result_type max()
+	{
+		return std::numeric_limits<uint64_t>::max();
+	}
+
+	uint64_t operator()()
+	{
+		uint64_t const result = Rotate(m_state[1] * 5, 7) * 9;
+		uint64_t const shifted = m_state[1] << 17;
+
+		m_state[2] ^= m_state[0];
+		m_state[3] ^= m_state[1];
+		m_state[1] ^= m_state[2];
+		m_state[0] ^= m_state[3];
+		m_state[2] ^= shifted;
+		m_state[3] = Rotate(m_state[3], 45);
+
+		return result;
+	}
+
+private:
+
+	static uint64_t Rotate(uint64_t const value, int const bits)
+	{
+		return value << bits | value >> (64 - bits);
+	}
+};
+
+// PCG32 (XSH RR) by O'Neill: 64 bits of state and a stream selector, 32
+// bits per number. Seeded as the reference pcg32_srandom_r.
+struct Pcg32
+{
+	typedef uint32_t result_type;
+
+	uint64_t m_state = 0;
+	uint64_t m_increment = 0;
+
+	// The default stream is the reference's default increment
+	explicit Pcg32(uint64_t const seed,
+		uint64_t const stream = 0x6D1F1CE5CA5CADEDull)
+	{
+		m_increment = stream << 1 | 1;
+		Step();
+		m_state += seed;
+		Step();
+	}
+
+	static constexpr result_type min()
+	{
+		return 0;
+	}
+
+	static constexpr result_type max()
+	{
+		return std::numeric_limits<uint32_t>::max();
+	}
+
+	uint32_t operator()()
+	{
+		uint64_t const previous = m_state;
+		Step();
+
+		uint32_t const shifted = static_cast<uint32_t>((previous >> 18 ^ previous) >> 27);
+		unsigned const rotation = static_cast<unsigned>(previous >> 59);
+
+		return shifted >> rotation | shifted << (-rotation & 31);
+	}
+
+private:
+
+	void Step()
+	{
+		m_state = m_state * 6364136223846793005ull + m_increment;
+	}
+};
+
+// A number in [0, bound) without bias, by Lemire's multiply and shift. It
+// only divides when the first try lands in the few values that would bias
+// it, so it costs about a multiplication where a distribution object costs
+// a division or more per call. Takes the low 32 bits of each number, so the
+// generator must make at least that many.
+template <typename Generator>
+inline uint32_t RandomBelow(Generator & generator,
+	uint32_t const bound)
+{
+	static_assert(Generator::min() == 0 && Generator::max() >= 0xFFFFFFFFu, "32 random bits per call");
+
+	uint64_t product = static_cast<uint64_t>(static_cast<uint32_t>(generator())) * bound;
+	uint32_t low = static_cast<uint32_t>(product);
+
+	if (low < bound)
+	{
+		uint32_t const threshold = (0u - bound) % bound;
+
+		while (low < threshold)
+		{
+			product = static_cast<uint64_t>(static_cast<uint32_t>(generator())) * bound;
+			low = static_cast<uint32_t>(product);
+		}
+	}
+
+	return static_cast<uint32_t>(product >> 32);
+}
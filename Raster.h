@@ -0,0 +1,555 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#include "Debug.h"
+#include "BitmapFont.h"
+
+// CPU raster kernels over BGRA8 premultiplied pixels, the same format as the
+// composition surfaces (DXGI_FORMAT_B8G8R8A8_UNORM, premultiplied alpha).
+// Every kernel has a scalar reference and the widest SIMD variant the
+// compiler targets: AVX2, SSE2 or NEON. The variants produce identical bits.
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define RASTER_AVX2 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RASTER_SSE2 1
+#endif
+
+#if defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define RASTER_NEON 1
+#endif
+
+template <typename Pixel>
+struct BasicPixelView
+{
+	Pixel * Pixels = nullptr;
+	unsigned Width = 0;
+	unsigned Height = 0;
+	unsigned Stride = 0; // in pixels
+
+	BasicPixelView() = default;
+
+	BasicPixelView(Pixel * pixels,
+		unsigned const width,
+		unsigned const height,
+		unsigned const stride) :
+		Pixels(pixels),
+		Width(width),
+		Height(height),
+		Stride(stride)
+	{}
+
+	// A view of writable pixels is also a view of const ones
+	template <typename Other,
+		typename = typename std::enable_if<std::is_convertible<Other *, Pixel *>::value>::type>
+	BasicPixelView(BasicPixelView<Other> const & other) :
+		Pixels(other.Pixels),
+		Width(other.Width),
+		Height(other.Height),
+		Stride(other.Stride)
+	{}
+
+	Pixel * Row(unsigned const y) const
+	{
+		ASSERT(y < Height);
+		return Pixels + static_cast<size_t>(y) * Stride;
+	}
+
+	// Returns the part of the view starting at x, y, clipped to the view.
+	BasicPixelView SubView(unsigned const x,
+		unsigned const y,
+		unsigned const width,
+		unsigned const height) const
+	{
+		if (x >= Width || y >= Height) return BasicPixelView();
+
+		return BasicPixelView(Pixels + static_cast<size_t>(y) * Stride + x,
+			std::min(width, Width - x),
+			std::min(height, Height - y),
+			Stride);
+	}
+};
+
+typedef BasicPixelView<uint32_t> PixelView;
+typedef BasicPixelView<uint32_t const> ConstPixelView;
+
+struct PixelBuffer
+{
+	unsigned Width = 0;
+	unsigned Height = 0;
+	std::vector<uint32_t> Pixels;
+
+	PixelBuffer() = default;
+
+	PixelBuffer(unsigned const width, unsigned const height) :
+		Width(width),
+		Height(height),
+		Pixels(static_cast<size_t>(width) * height)
+	{}
+
+	void Resize(unsigned const width, unsigned const height)
+	{
+		Width = width;
+		Height = height;
+		Pixels.resize(static_cast<size_t>(width) * height);
+	}
+
+	PixelView View()
+	{
+		return PixelView(Pixels.data(), Width, Height, Width);
+	}
+
+	ConstPixelView View() const
+	{
+		return ConstPixelView(Pixels.data(), Width, Height, Width);
+	}
+};
+
+inline uint32_t PackColor(uint8_t const b,
+	uint8_t const g,
+	uint8_t const r,
+	uint8_t const a)
+{
+	return static_cast<uint32_t>(b) |
+		static_cast<uint32_t>(g) << 8 |
+		static_cast<uint32_t>(r) << 16 |
+		static_cast<uint32_t>(a) << 24;
+}
+
+// Straight alpha floats, as taken by D2D1::ColorF, to a premultiplied pixel
+inline uint32_t PremultipliedColor(float const r,
+	float const g,
+	float const b,
+	float const a = 1.0f)
+{
+	auto const channel = [a](float const value)
+	{
+		return static_cast<uint8_t>(std::min(std::max(value * a, 0.0f), 1.0f) * 255.0f + 0.5f);
+	};
+
+	return PackColor(channel(b), channel(g), channel(r), channel(1.0f));
+}
+
+// Rounded x / 255, exact for x in [0, 255 * 255]
+inline unsigned Divide255(unsigned const x)
+{
+	return (x + 128 + ((x + 128) >> 8)) >> 8;
+}
+
+//
+// Fill: dst[i] = color
+//
+
+inline void FillRowScalar(uint32_t * dst, unsigned const count, uint32_t const color)
+{
+	for (unsigned i = 0; i != count; ++i)
+	{
+		dst[i] = color;
+	}
+}
+
+#if RASTER_SSE2
+inline void FillRowSse2(uint32_t * dst, unsigned const count, uint32_t const color)
+{
+	__m128i const value = _mm_set1_epi32(static_cast<int>(color));
+	unsigned i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), value);
+	}
+
+	FillRowScalar(dst + i, count - i, color);
+}
+#endif
+
+#if RASTER_AVX2
+inline void FillRowAvx2(uint32_t * dst, unsigned const count, uint32_t const color)
+{
+	__m256i const value = _mm256_set1_epi32(static_cast<int>(color));
+	unsigned i = 0;
+
+	for (; i + 8 <= count; i += 8)
+	{
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), value);
+	}
+
+	FillRowScalar(dst + i, count - i, color);
+}
+#endif
+
+#if RASTER_NEON
+inline void FillRowNeon(uint32_t * dst, unsigned const count, uint32_t const color)
+{
+	uint32x4_t const value = vdupq_n_u32(color);
+	unsigned i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		vst1q_u32(dst + i, value);
+	}
+
+	FillRowScalar(dst + i, count - i, color);
+}
+#endif
+
+inline void FillRow(uint32_t * dst, unsigned const count, uint32_t const color)
+{
+#if RASTER_AVX2
+	FillRowAvx2(dst, count, color);
+#elif RASTER_SSE2
+	FillRowSse2(dst, count, color);
+#elif RASTER_NEON
+	FillRowNeon(dst, count, color);
+#else
+	FillRowScalar(dst, count, color);
+#endif
+}
+
+//
+// Copy: the background is premultiplied BGRA8 like the target, so rows are
+// copied as they are, alpha and all. memcpy is as fast as any kernel here.
+//
+
+inline void CopyRow(uint32_t * dst, uint32_t const * src, unsigned const count)
+{
+	memcpy(dst, src, count * sizeof(uint32_t));
+}
+
+//
+// Glyph compositing: source over with a solid premultiplied color scaled by
+// an 8-bit coverage mask.
+//   s = color * coverage / 255
+//   dst = s + dst * (255 - s.alpha) / 255
+//
+
+inline void CompositeRowScalar(uint32_t * dst,
+	uint8_t const * coverage,
+	unsigned const count,
+	uint32_t const color)
+{
+	for (unsigned i = 0; i != count; ++i)
+	{
+		unsigned const a = coverage[i];
+
+		if (a == 0) continue;
+
+		unsigned const sa = Divide255((color >> 24) * a);
+		unsigned const inverse = 255 - sa;
+		uint32_t const d = dst[i];
+		uint32_t result = 0;
+
+		for (unsigned shift = 0; shift != 32; shift += 8)
+		{
+			unsigned const s = Divide255((color >> shift & 0xFF) * a);
+			unsigned const value = s + Divide255((d >> shift & 0xFF) * inverse);
+			result |= static_cast<uint32_t>(value) << shift;
+		}
+
+		dst[i] = result;
+	}
+}
+
+#if RASTER_SSE2
+inline __m128i Divide255Sse2(__m128i const x)
+{
+	__m128i const t = _mm_add_epi16(x, _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// Composites two pixels held as 16-bit channels
+inline __m128i CompositePairSse2(__m128i const dst,
+	__m128i const coverage,
+	__m128i const color)
+{
+	__m128i const s = Divide255Sse2(_mm_mullo_epi16(color, coverage));
+
+	__m128i const alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	__m128i const inverse = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+
+	return _mm_add_epi16(s, Divide255Sse2(_mm_mullo_epi16(dst, inverse)));
+}
+
+inline void CompositeRowSse2(uint32_t * dst,
+	uint8_t const * coverage,
+	unsigned const count,
+	uint32_t const color)
+{
+	__m128i const zero = _mm_setzero_si128();
+	__m128i const color16 = _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(color)), zero);
+	unsigned i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		int packed;
+		memcpy(&packed, coverage + i, sizeof(packed));
+
+		if (packed == 0) continue;
+
+		// c0 c0 c1 c1 c2 c2 c3 c3 as 16-bit lanes, then four lanes per pixel
+		__m128i const cover16 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero);
+		__m128i const pairs = _mm_unpacklo_epi16(cover16, cover16);
+		__m128i const coverLow = _mm_unpacklo_epi32(pairs, pairs);
+		__m128i const coverHigh = _mm_unpackhi_epi32(pairs, pairs);
+
+		__m128i const d = _mm_loadu_si128(reinterpret_cast<__m128i const *>(dst + i));
+
+		__m128i const low = CompositePairSse2(_mm_unpacklo_epi8(d, zero), coverLow, color16);
+		__m128i const high = CompositePairSse2(_mm_unpackhi_epi8(d, zero), coverHigh, color16);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(low, high));
+	}
+
+	CompositeRowScalar(dst + i, coverage + i, count - i, color);
+}
+#endif
+
+#if RASTER_AVX2
+inline __m256i Divide255Avx2(__m256i const x)
+{
+	__m256i const t = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+	return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+inline __m256i CompositePairAvx2(__m256i const dst,
+	__m256i const coverage,
+	__m256i const color)
+{
+	__m256i const s = Divide255Avx2(_mm256_mullo_epi16(color, coverage));
+
+	__m256i const alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	__m256i const inverse = _mm256_sub_epi16(_mm256_set1_epi16(255), alpha);
+
+	return _mm256_add_epi16(s, Divide255Avx2(_mm256_mullo_epi16(dst, inverse)));
+}
+
+inline void CompositeRowAvx2(uint32_t * dst,
+	uint8_t const * coverage,
+	unsigned const count,
+	uint32_t const color)
+{
+	__m256i const zero = _mm256_setzero_si256();
+	__m256i const color16 = _mm256_unpacklo_epi8(_mm256_set1_epi32(static_cast<int>(color)), zero);
+	unsigned i = 0;
+
+	for (; i + 8 <= count; i += 8)
+	{
+		int packed[2];
+		memcpy(packed, coverage + i, sizeof(packed));
+
+		if ((packed[0] | packed[1]) == 0) continue;
+
+		// Each 128-bit lane handles four pixels, the low lane 0-3 and the
+		// high lane 4-7, so the coverage is split the same way.
+		__m256i const cover8 = _mm256_setr_epi32(packed[0], 0, 0, 0, packed[1], 0, 0, 0);
+		__m256i const cover16 = _mm256_unpacklo_epi8(cover8, zero);
+		__m256i const pairs = _mm256_unpacklo_epi16(cover16, cover16);
+		__m256i const coverLow = _mm256_unpacklo_epi32(pairs, pairs);
+		__m256i const coverHigh = _mm256_unpackhi_epi32(pairs, pairs);
+
+		__m256i const d = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(dst + i));
+
+		__m256i const low = CompositePairAvx2(_mm256_unpacklo_epi8(d, zero), coverLow, color16);
+		__m256i const high = CompositePairAvx2(_mm256_unpackhi_epi8(d, zero), coverHigh, color16);
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_packus_epi16(low, high));
+	}
+
+	CompositeRowScalar(dst + i, coverage + i, count - i, color);
+}
+#endif
+
+#if RASTER_NEON
+inline uint8x8_t Divide255Neon(uint16x8_t const x)
+{
+	uint16x8_t const t = vaddq_u16(x, vdupq_n_u16(128));
+	return vshrn_n_u16(vaddq_u16(t, vshrq_n_u16(t, 8)), 8);
+}
+
+inline void CompositeRowNeon(uint32_t * dst,
+	uint8_t const * coverage,
+	unsigned const count,
+	uint32_t const color)
+{
+	uint8x8_t const colorB = vdup_n_u8(static_cast<uint8_t>(color));
+	uint8x8_t const colorG = vdup_n_u8(static_cast<uint8_t>(color >> 8));
+	uint8x8_t const colorR = vdup_n_u8(static_cast<uint8_t>(color >> 16));
+	uint8x8_t const colorA = vdup_n_u8(static_cast<uint8_t>(color >> 24));
+	unsigned i = 0;
+
+	for (; i + 8 <= count; i += 8)
+	{
+		uint8x8_t const a = vld1_u8(coverage + i);
+
+		if (vget_lane_u64(vreinterpret_u64_u8(a), 0) == 0) continue;
+
+		uint8_t * bytes = reinterpret_cast<uint8_t *>(dst + i);
+		uint8x8x4_t d = vld4_u8(bytes);
+
+		uint8x8_t const sa = Divide255Neon(vmull_u8(colorA, a));
+		uint8x8_t const inverse = vmvn_u8(sa);
+
+		d.val[0] = vadd_u8(Divide255Neon(vmull_u8(colorB, a)), Divide255Neon(vmull_u8(d.val[0], inverse)));
+		d.val[1] = vadd_u8(Divide255Neon(vmull_u8(colorG, a)), Divide255Neon(vmull_u8(d.val[1], inverse)));
+		d.val[2] = vadd_u8(Divide255Neon(vmull_u8(colorR, a)), Divide255Neon(vmull_u8(d.val[2], inverse)));
+		d.val[3] = vadd_u8(sa, Divide255Neon(vmull_u8(d.val[3], inverse)));
+
+		vst4_u8(bytes, d);
+	}
+
+	CompositeRowScalar(dst + i, coverage + i, count - i, color);
+}
+#endif
+
+inline void CompositeRow(uint32_t * dst,
+	uint8_t const * coverage,
+	unsigned const count,
+	uint32_t const color)
+{
+#if RASTER_AVX2
+	CompositeRowAvx2(dst, coverage, count, color);
+#elif RASTER_SSE2
+	CompositeRowSse2(dst, coverage, count, color);
+#elif RASTER_NEON
+	CompositeRowNeon(dst, coverage, count, color);
+#else
+	CompositeRowScalar(dst, coverage, count, color);
+#endif
+}
+
+//
+// Rectangle operations built on the row kernels
+//
+
+inline void Clear(PixelView const & target, uint32_t const color)
+{
+	for (unsigned y = 0; y != target.Height; ++y)
+	{
+		FillRow(target.Row(y), target.Width, color);
+	}
+}
+
+// Copies the source rectangle at sourceX, sourceY to the top left of the
+// target. Target pixels outside the source image are cleared to transparent.
+inline void CopyRect(PixelView const & target,
+	ConstPixelView const & source,
+	int const sourceX,
+	int const sourceY)
+{
+	for (unsigned y = 0; y != target.Height; ++y)
+	{
+		uint32_t * row = target.Row(y);
+		int const sy = sourceY + static_cast<int>(y);
+
+		if (sy < 0 || sy >= static_cast<int>(source.Height))
+		{
+			FillRow(row, target.Width, 0);
+			continue;
+		}
+
+		int const first = std::min(std::max(-sourceX, 0), static_cast<int>(target.Width));
+		int const last = std::max(std::min(static_cast<int>(source.Width) - sourceX, static_cast<int>(target.Width)), first);
+
+		FillRow(row, first, 0);
+
+		if (last > first)
+		{
+			CopyRow(row + first, source.Row(sy) + sourceX + first, last - first);
+		}
+
+		FillRow(row + last, target.Width - last, 0);
+	}
+}
+
+// As ScaleRect below into a target of width by height pixels, drawing only
+// the part of it at partX, partY the size of the view given. The part's
+// pixels are the same as in the whole.
+inline void ScaleRectPart(PixelView const & part,
+	ConstPixelView const & source,
+	float const sourceX,
+	float const sourceY,
+	float const sourceWidth,
+	float const sourceHeight,
+	unsigned const width,
+	unsigned const height,
+	unsigned const partX,
+	unsigned const partY)
+{
+	float const stepX = sourceWidth / width;
+	float const stepY = sourceHeight / height;
+
+	for (unsigned y = 0; y != part.Height; ++y)
+	{
+		uint32_t * row = part.Row(y);
+		int const sy = static_cast<int>(std::floor(sourceY + (partY + y + 0.5f) * stepY));
+
+		if (sy < 0 || sy >= static_cast<int>(source.Height))
+		{
+			FillRow(row, part.Width, 0);
+			continue;
+		}
+
+		uint32_t const * sourceRow = source.Row(sy);
+
+		for (unsigned x = 0; x != part.Width; ++x)
+		{
+			int const sx = static_cast<int>(std::floor(sourceX + (partX + x + 0.5f) * stepX));
+
+			row[x] = sx < 0 || sx >= static_cast<int>(source.Width) ? 0 : sourceRow[sx];
+		}
+	}
+}
+
+// Nearest neighbour scale of the source rectangle to fill the target, used
+// when the DPI is not 96 and a logical pixel of the background covers more
+// or less than one physical pixel.
+inline void ScaleRect(PixelView const & target,
+	ConstPixelView const & source,
+	float const sourceX,
+	float const sourceY,
+	float const sourceWidth,
+	float const sourceHeight)
+{
+	ScaleRectPart(target,
+		source,
+		sourceX,
+		sourceY,
+		sourceWidth,
+		sourceHeight,
+		target.Width,
+		target.Height,
+		0,
+		0);
+}
+
+// Composites the mask with its top left corner at x, y, clipped to the target.
+inline void Composite(PixelView const & target,
+	int const x,
+	int const y,
+	CoverageMask const & mask,
+	uint32_t const color)
+{
+	int const left = std::max(x, 0);
+	int const top = std::max(y, 0);
+	int const right = std::min(x + static_cast<int>(mask.Width), static_cast<int>(target.Width));
+	int const bottom = std::min(y + static_cast<int>(mask.Height), static_cast<int>(target.Height));
+
+	if (right <= left) return;
+
+	for (int row = top; row < bottom; ++row)
+	{
+		CompositeRow(target.Row(row) + left,
+			mask.Row(row - y) + (left - x),
+			right - left,
+			color);
+	}
+}
@@ -0,0 +1,437 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "Compositor.h"
+
+// A compositor that only remembers what it is told. It keeps the visual
+// tree and the state of every object in memory, counts the calls made in
+// each frame and can log every change. It runs headless on any platform, so
+// the benchmarks can hold the sample to a budget of calls per frame.
+
+// What happened between two commits
+struct CompositorCounters
+{
+	unsigned Allocations = 0;  // objects created
+	unsigned PropertySets = 0; // object properties changed
+	unsigned TreeChanges = 0;  // visuals added or removed, root set
+	unsigned Uploads = 0;
+	uint64_t UploadedPixels = 0;
+	unsigned Commits = 0;
+
+	CompositorCounters & operator+=(CompositorCounters const & other)
+	{
+		Allocations += other.Allocations;
+		PropertySets += other.PropertySets;
+		TreeChanges += other.TreeChanges;
+		Uploads += other.Uploads;
+		UploadedPixels += other.UploadedPixels;
+		Commits += other.Commits;
+		return *this;
+	}
+};
+
+enum class RecordedProperty
+{
+	Offset,
+	Clip,
+	BackFaceVisible,
+	Content,
+	Transform,
+	AddVisual,
+	RemoveVisual,
+	RemoveAllVisuals,
+	Root,
+	Matrix,
+	Axis,
+	Angle,
+	AngleAnimation,
+	Upload,
+};
+
+// One change to one object. Target is the object passed in, if any, and
+// Values the numbers, as many as the property has.
+struct RecordedChange
+{
+	unsigned Frame;
+	unsigned Object;
+	RecordedProperty Property;
+	unsigned Target;
+	float Values[4];
+};
+
+// Shared by the compositor and its objects, which may outlive it
+struct RecordingState
+{
+	CompositorCounters Frame;
+	std::vector<CompositorCounters> Frames;
+	std::vector<RecordedChange> Changes;
+	bool RecordChanges = true;
+	unsigned NextId = 1;
+	unsigned LiveObjects = 0;
+	uint64_t LiveSurfaceBytes = 0; // as BGRA8 surfaces would take
+
+	void Change(unsigned const object,
+		RecordedProperty const property,
+		unsigned const target = 0,
+		float const a = 0.0f,
+		float const b = 0.0f,
+		float const c = 0.0f,
+		float const d = 0.0f)
+	{
+		if (property == RecordedProperty::AddVisual ||
+			property == RecordedProperty::RemoveVisual ||
+			property == RecordedProperty::RemoveAllVisuals ||
+			property == RecordedProperty::Root)
+		{
+			++Frame.TreeChanges;
+		}
+		else if (property != RecordedProperty::Upload)
+		{
+			++Frame.PropertySets;
+		}
+
+		if (!RecordChanges) return;
+
+		Changes.push_back({ static_cast<unsigned>(Frames.size()), object, property, target, { a, b, c, d } });
+	}
+};
+
+struct RecordingObject
+{
+	std::shared_ptr<RecordingState> m_state;
+	unsigned m_id;
+
+	explicit RecordingObject(std::shared_ptr<RecordingState> const & state) :
+		m_state(state),
+		m_id(state->NextId++)
+	{
+		++m_state->Frame.Allocations;
+		++m_state->LiveObjects;
+	}
+
+	RecordingObject(RecordingObject const &) = delete;
+	RecordingObject & operator=(RecordingObject const &) = delete;
+
+	~RecordingObject()
+	{
+		--m_state->LiveObjects;
+	}
+};
+
+template <typename T>
+unsigned RecordedId(std::shared_ptr<T> const & object)
+{
+	RecordingObject const * recorded = dynamic_cast<RecordingObject const *>(object.get());
+
+	return recorded ? recorded->m_id : 0;
+}
+
+struct RecordingSurface : CompositorSurface, RecordingObject
+{
+	unsigned m_width;
+	unsigned m_height;
+
+	RecordingSurface(std::shared_ptr<RecordingState> const & state,
+		unsigned const width,
+		unsigned const height) :
+		RecordingObject(state),
+		m_width(width),
+		m_height(height)
+	{
+		m_state->LiveSurfaceBytes += Bytes();
+	}
+
+	~RecordingSurface()
+	{
+		m_state->LiveSurfaceBytes -= Bytes();
+	}
+
+	uint64_t Bytes() const
+	{
+		return 4ull * m_width * m_height;
+	}
+
+	unsigned Width() const override
+	{
+		return m_width;
+	}
+
+	unsigned Height() const override
+	{
+		return m_height;
+	}
+
+	void Upload(unsigned const left, unsigned const top, ConstPixelView const & pixels) override
+	{
+		ASSERT(left + pixels.Width <= m_width && top + pixels.Height <= m_height);
+
+		++m_state->Frame.Uploads;
+		m_state->Frame.UploadedPixels += static_cast<uint64_t>(pixels.Width) * pixels.Height;
+
+		m_state->Change(m_id, RecordedProperty::Upload, 0,
+			static_cast<float>(left),
+			static_cast<float>(top),
+			static_cast<float>(pixels.Width),
+			static_cast<float>(pixels.Height));
+	}
+};
+
+struct RecordingMatrixTransform : CompositorMatrixTransform, RecordingObject
+{
+	Matrix4x4 m_matrix = Matrix4x4::Identity();
+
+	explicit RecordingMatrixTransform(std::shared_ptr<RecordingState> const & state) :
+		RecordingObject(state)
+	{}
+
+	void SetMatrix(Matrix4x4 const & matrix) override
+	{
+		m_matrix = matrix;
+		m_state->Change(m_id, RecordedProperty::Matrix);
+	}
+};
+
+struct RecordingRotateTransform : CompositorRotateTransform, RecordingObject
+{
+	float m_axis[3] = { 0.0f, 0.0f, 1.0f };
+	float m_angle = 0.0f;
+	AnimationCurve m_curve;
+	bool m_animated = false;
+
+	explicit RecordingRotateTransform(std::shared_ptr<RecordingState> const & state) :
+		RecordingObject(state)
+	{}
+
+	void SetAxis(float const x, float const y, float const z) override
+	{
+		m_axis[0] = x;
+		m_axis[1] = y;
+		m_axis[2] = z;
+		m_state->Change(m_id, RecordedProperty::Axis, 0, x, y, z);
+	}
+
+	void SetAngle(float const angle) override
+	{
+		m_angle = angle;
+		m_animated = false;
+		m_state->Change(m_id, RecordedProperty::Angle, 0, angle);
+	}
+
+	void SetAngle(AnimationCurve const & curve) override
+	{
+		m_curve = curve;
+		m_animated = true;
+		m_state->Change(m_id, RecordedProperty::AngleAnimation, 0,
+			static_cast<float>(curve.End),
+			curve.EndValue,
+			static_cast<float>(curve.Segments.size()));
+	}
+};
+
+struct RecordingTransformGroup : CompositorTransform, RecordingObject
+{
+	std::vector<std::shared_ptr<CompositorTransform>> m_transforms;
+
+	RecordingTransformGroup(std::shared_ptr<RecordingState> const & state,
+		std::shared_ptr<CompositorTransform> const * transforms,
+		unsigned const count) :
+		RecordingObject(state),
+		m_transforms(transforms, transforms + count)
+	{}
+};
+
+struct RecordingVisual : CompositorVisual, RecordingObject
+{
+	float m_offset[2] = {};
+	float m_clip[4] = {};
+	bool m_clipped = false;
+	bool m_backFaceVisible = true;
+	std::shared_ptr<CompositorSurface> m_content;
+	std::shared_ptr<CompositorTransform> m_transform;
+	std::vector<std::shared_ptr<CompositorVisual>> m_children;
+
+	explicit RecordingVisual(std::shared_ptr<RecordingState> const & state) :
+		RecordingObject(state)
+	{}
+
+	void SetOffset(float const x, float const y) override
+	{
+		m_offset[0] = x;
+		m_offset[1] = y;
+		m_state->Change(m_id, RecordedProperty::Offset, 0, x, y);
+	}
+
+	void SetClip(float const left, float const top, float const right, float const bottom) override
+	{
+		m_clip[0] = left;
+		m_clip[1] = top;
+		m_clip[2] = right;
+		m_clip[3] = bottom;
+		m_clipped = true;
+		m_state->Change(m_id, RecordedProperty::Clip, 0, left, top, right, bottom);
+	}
+
+	void SetBackFaceVisible(bool const visible) override
+	{
+		m_backFaceVisible = visible;
+		m_state->Change(m_id, RecordedProperty::BackFaceVisible, 0, visible ? 1.0f : 0.0f);
+	}
+
+	void SetContent(std::shared_ptr<CompositorSurface> const & surface) override
+	{
+		m_content = surface;
+		m_state->Change(m_id, RecordedProperty::Content, RecordedId(surface));
+	}
+
+	void SetTransform(std::shared_ptr<CompositorTransform> const & transform) override
+	{
+		m_transform = transform;
+		m_state->Change(m_id, RecordedProperty::Transform, RecordedId(transform));
+	}
+
+	void AddVisual(std::shared_ptr<CompositorVisual> const & child) override
+	{
+		ASSERT(std::find(m_children.begin(), m_children.end(), child) == m_children.end());
+
+		m_children.push_back(child);
+		m_state->Change(m_id, RecordedProperty::AddVisual, RecordedId(child));
+	}
+
+	void RemoveVisual(std::shared_ptr<CompositorVisual> const & child) override
+	{
+		auto const found = std::find(m_children.begin(), m_children.end(), child);
+		ASSERT(found != m_children.end());
+
+		m_children.erase(found);
+		m_state->Change(m_id, RecordedProperty::RemoveVisual, RecordedId(child));
+	}
+
+	void RemoveAllVisuals() override
+	{
+		m_children.clear();
+		m_state->Change(m_id, RecordedProperty::RemoveAllVisuals);
+	}
+
+	// This visual and all below it
+	unsigned CountVisuals() const
+	{
+		unsigned count = 1;
+
+		for (std::shared_ptr<CompositorVisual> const & child : m_children)
+		{
+			count += static_cast<RecordingVisual const &>(*child).CountVisuals();
+		}
+
+		return count;
+	}
+};
+
+struct RecordingCompositor : Compositor
+{
+	std::shared_ptr<RecordingState> m_state = std::make_shared<RecordingState>();
+	std::shared_ptr<CompositorVisual> m_root;
+	double m_time = 0.0;
+	double m_frameInterval = 1.0 / 60.0;
+
+	// With recordChanges false only the counters are kept
+	explicit RecordingCompositor(bool const recordChanges = true)
+	{
+		m_state->RecordChanges = recordChanges;
+	}
+
+	// Another target on the device of an existing compositor, as windows
+	// sharing a DirectComposition device each have their own. Objects,
+	// surface bytes and commits are counted for the device as a whole.
+	explicit RecordingCompositor(std::shared_ptr<RecordingState> const & device) :
+		m_state(device)
+	{}
+
+	std::shared_ptr<CompositorVisual> CreateVisual() override
+	{
+		return std::make_shared<RecordingVisual>(m_state);
+	}
+
+	std::shared_ptr<CompositorSurface> CreateSurface(unsigned const width, unsigned const height) override
+	{
+		return std::make_shared<RecordingSurface>(m_state, width, height);
+	}
+
+	std::shared_ptr<CompositorMatrixTransform> CreateMatrixTransform() override
+	{
+		return std::make_shared<RecordingMatrixTransform>(m_state);
+	}
+
+	std::shared_ptr<CompositorRotateTransform> CreateRotateTransform() override
+	{
+		return std::make_shared<RecordingRotateTransform>(m_state);
+	}
+
+	std::shared_ptr<CompositorTransform> CreateTransformGroup(std::shared_ptr<CompositorTransform> const * transforms,
+		unsigned const count) override
+	{
+		return std::make_shared<RecordingTransformGroup>(m_state, transforms, count);
+	}
+
+	void SetRoot(std::shared_ptr<CompositorVisual> const & root) override
+	{
+		m_root = root;
+		m_state->Change(0, RecordedProperty::Root, RecordedId(root));
+	}
+
+	double NextFrameTime() override
+	{
+		return m_time + m_frameInterval;
+	}
+
+	void Commit() override
+	{
+		m_state->Frame.Commits = 1;
+		m_state->Frames.push_back(m_state->Frame);
+		m_state->Frame = CompositorCounters();
+
+		m_time += m_frameInterval;
+	}
+
+	void WaitForCommitCompletion() override
+	{}
+
+	// Counters of the committed frames and of the one in progress
+	std::vector<CompositorCounters> const & Frames() const
+	{
+		return m_state->Frames;
+	}
+
+	CompositorCounters const & CurrentFrame() const
+	{
+		return m_state->Frame;
+	}
+
+	std::vector<RecordedChange> const & Changes() const
+	{
+		return m_state->Changes;
+	}
+
+	unsigned LiveObjects() const
+	{
+		return m_state->LiveObjects;
+	}
+
+	uint64_t LiveSurfaceBytes() const
+	{
+		return m_state->LiveSurfaceBytes;
+	}
+
+	unsigned CountVisuals() const
+	{
+		return m_root ? static_cast<RecordingVisual const &>(*m_root).CountVisuals() : 0;
+	}
+
+	void ClearRecording()
+	{
+		m_state->Frames.clear();
+		m_state->Changes.clear();
+		m_state->Frame = CompositorCounters();
+	}
+};
@@ -0,0 +1,518 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Board.h"
+#include "Debug.h"
+#include "InputLog.h"
+#include "Metrics.h"
+#include "Trace.h"
+
+// A thread that does the rendering apart from the window's message loop:
+// hit testing, storyboards, drawing and commits. The message thread only
+// posts commands, so a slow device rebuild no longer holds up input and a
+// burst of input no longer holds up a frame. Commands go through a lock free
+// queue with one producer and one consumer; the game's state comes back
+// through a double buffered snapshot. Nothing here depends on Windows, so
+// the benchmarks run it with the headless game.
+
+// A ring of commands from one thread to another. Capacity is a power of two.
+// Each index is written by one side only, and the two are kept on separate
+// cache lines so that the producer and the consumer do not share one.
+template <typename T>
+struct SpscQueue
+{
+	std::unique_ptr<T[]> m_items;
+	size_t m_mask;
+	char m_padding0[64];
+	std::atomic<size_t> m_tail; // pushed, written by the producer
+	char m_padding1[64];
+	std::atomic<size_t> m_head; // popped, written by the consumer
+	char m_padding2[64];
+
+	explicit SpscQueue(size_t const capacity) :
+		m_items(new T[capacity]()),
+		m_mask(capacity - 1),
+		m_tail(0),
+		m_head(0)
+	{
+		ASSERT(capacity && (capacity & m_mask) == 0);
+	}
+
+	size_t Capacity() const
+	{
+		return m_mask + 1;
+	}
+
+	// Producer only. Returns false if the queue is full.
+	bool TryPush(T const & item)
+	{
+		size_t const tail = m_tail.load(std::memory_order_relaxed);
+
+		if (tail - m_head.load(std::memory_order_acquire) == Capacity()) return false;
+
+		m_items[tail & m_mask] = item;
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer only. Returns false if the queue is empty.
+	bool TryPop(T & item)
+	{
+		size_t const head = m_head.load(std::memory_order_relaxed);
+
+		if (head == m_tail.load(std::memory_order_acquire)) return false;
+
+		item = m_items[head & m_mask];
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Either side; the other may change it at any time
+	bool Empty() const
+	{
+		return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+	}
+};
+
+// Two copies of a value, one being written while the other is read. The
+// writer fills the back copy and publishes it as the front; the reader holds
+// the front while it looks at it. The writer only waits if the reader still
+// holds the copy it is about to overwrite, which it does for no longer than
+// a hit test.
+template <typename T>
+struct SnapshotBuffer
+{
+	// Bit 0 is the front copy, bit 1 is set while the reader holds a copy
+	// and bit 2 is the copy it holds
+	static unsigned const Front = 1;
+	static unsigned const Held = 2;
+	static unsigned const HeldCopy = 4;
+
+	T m_copies[2];
+	std::atomic<unsigned> m_state;
+	std::atomic<uint64_t> m_published; // snapshots ever published
+
+	explicit SnapshotBuffer(T const & initial = T()) :
+		m_copies { initial, initial },
+		m_state(0),
+		m_published(0)
+	{}
+
+	// Writer only. The back copy, once the reader has let go of it.
+	T & BeginWrite()
+	{
+		unsigned const back = (m_state.load(std::memory_order_relaxed) & Front) ^ 1;
+
+		for (;;)
+		{
+			unsigned const state = m_state.load(std::memory_order_acquire);
+
+			if (!(state & Held) || (state & HeldCopy ? 1u : 0u) != back) break;
+
+			std::this_thread::yield();
+		}
+
+		return m_copies[back];
+	}
+
+	// Writer only. Makes the back copy the front.
+	void Publish()
+	{
+		unsigned state = m_state.load(std::memory_order_relaxed);
+
+		while (!m_state.compare_exchange_weak(state, state ^ Front, std::memory_order_acq_rel))
+		{}
+
+		m_published.fetch_add(1, std::memory_order_release);
+	}
+
+	// Reader only. The front copy, which the writer leaves alone until
+	// Release.
+	T const & Acquire()
+	{
+		unsigned state = m_state.load(std::memory_order_relaxed);
+
+		while (!m_state.compare_exchange_weak(state, state | Held | (state & Front ? HeldCopy : 0), std::memory_order_acq_rel))
+		{}
+
+		return m_copies[state & Front];
+	}
+
+	void Release()
+	{
+		unsigned state = m_state.load(std::memory_order_relaxed);
+
+		while (!m_state.compare_exchange_weak(state, state & Front, std::memory_order_acq_rel))
+		{}
+	}
+
+	uint64_t Published() const
+	{
+		return m_published.load(std::memory_order_acquire);
+	}
+};
+
+// Holds the front copy of a snapshot for the scope
+template <typename T>
+struct SnapshotReader
+{
+	SnapshotBuffer<T> & m_buffer;
+	T const & m_snapshot;
+
+	explicit SnapshotReader(SnapshotBuffer<T> & buffer) :
+		m_buffer(buffer),
+		m_snapshot(buffer.Acquire())
+	{}
+
+	~SnapshotReader()
+	{
+		m_buffer.Release();
+	}
+
+	SnapshotReader(SnapshotReader const &) = delete;
+	SnapshotReader & operator=(SnapshotReader const &) = delete;
+
+	T const & operator*() const
+	{
+		return m_snapshot;
+	}
+
+	T const * operator->() const
+	{
+		return &m_snapshot;
+	}
+};
+
+// What the message thread sees of a board: the cards as last committed, for
+// input that needs to know what is on screen without asking the render thread
+struct BoardSnapshot
+{
+	Board Cards;
+	float DpiX = 96.0f;
+	float DpiY = 96.0f;
+	unsigned Games = 0; // dealt so far, none until the board is first shown
+
+	explicit BoardSnapshot(BoardGeometry const & geometry) :
+		Cards(geometry)
+	{}
+};
+
+enum class RenderCommandKind : uint8_t
+{
+	Click,      // X and Y are the client point in physical pixels
+	NewGame,
+	Dpi,        // X and Y are the new DPI
+	Paint,      // the window was invalidated
+	Background, // more of the background has been decoded
+	Close,      // the window is closing and takes no more commands
+};
+
+inline RenderCommandKind RenderCommandForInput(InputKind const kind)
+{
+	switch (kind)
+	{
+	case InputKind::Click: return RenderCommandKind::Click;
+	case InputKind::NewGame: return RenderCommandKind::NewGame;
+	default: return RenderCommandKind::Dpi;
+	}
+}
+
+struct RenderCommand
+{
+	RenderCommandKind Kind = RenderCommandKind::Paint;
+	unsigned Client = 0; // that the command is for
+	float X = 0.0f;
+	float Y = 0.0f;
+	double Arrival = 0.0; // seconds on the render thread's clock, set by Post
+};
+
+// A window's part of the rendering, called on the render thread only
+struct RenderClient
+{
+	virtual ~RenderClient() {}
+
+	// Carries out a command. Returns false if it changed nothing, such as a
+	// click that missed every card, so that it has no latency to measure.
+	virtual bool Apply(RenderCommand const & command) = 0;
+
+	// Whether there is something to commit without new commands, such as a
+	// redraw spread over several frames
+	virtual bool FramePending() = 0;
+
+	// Commits everything applied since the last frame. Returns false if
+	// there was nothing to commit.
+	virtual bool Frame() = 0;
+
+	// Until the composition engine shows the next frame, from its frame
+	// statistics
+	virtual double SecondsToNextFrame() = 0;
+};
+
+// Runs the clients on a thread of its own. Commands are applied as they
+// arrive, but commits are paced: after a commit the next one waits until
+// the frame the first targeted has been shown, and everything applied in
+// the meantime goes into it. The clients are added before Start.
+//
+// Latency is the time from a command's Post to the end of the frame that
+// follows its Apply. The counters and samples belong to the render thread
+// and are read once it has stopped.
+struct RenderThread
+{
+	typedef std::chrono::steady_clock Clock;
+
+	static size_t const DefaultCapacity = 1024;
+
+	std::vector<RenderClient *> m_clients;
+	std::vector<bool> m_changed; // by commands since the last frame
+	SpscQueue<RenderCommand> m_commands;
+	Stopwatch const m_clock;
+	std::thread m_thread;
+	std::atomic<bool> m_stop;
+	std::atomic<bool> m_sleeping;
+	std::atomic<unsigned> m_settled; // commands applied and committed
+	unsigned m_posted = 0;           // on the message thread
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+
+	DurationSamples m_latency;
+	DurationSamples m_frameWork; // of the frames that committed
+	unsigned m_frames = 0;       // that committed
+	unsigned m_received = 0;
+	unsigned m_applied = 0;
+	unsigned m_fullWaits = 0;    // posts that found the queue full, on the message thread
+
+	explicit RenderThread(size_t const capacity = DefaultCapacity) :
+		m_commands(capacity),
+		m_stop(false),
+		m_sleeping(false),
+		m_settled(0)
+	{}
+
+	~RenderThread()
+	{
+		Stop();
+	}
+
+	// Returns the client's index for its commands
+	unsigned Add(RenderClient & client)
+	{
+		ASSERT(!m_thread.joinable());
+
+		m_clients.push_back(&client);
+		m_changed.push_back(false);
+		return static_cast<unsigned>(m_clients.size() - 1);
+	}
+
+	void Start()
+	{
+		ASSERT(!m_thread.joinable());
+
+		m_stop = false;
+		m_thread = std::thread([this] { Run(); });
+	}
+
+	// Finishes the command being applied and the frame in progress. Commands
+	// still queued are dropped.
+	void Stop()
+	{
+		if (!m_thread.joinable()) return;
+
+		m_stop = true;
+		Wake();
+		m_thread.join();
+	}
+
+	double Now() const
+	{
+		return m_clock.ElapsedSeconds();
+	}
+
+	// Message thread only. Never blocks on the render thread's work: if the
+	// queue is full, which takes a thousand commands in one frame, it yields
+	// until the render thread has taken some.
+	void Post(RenderCommand command)
+	{
+		command.Arrival = Now();
+		++m_posted;
+
+		if (!m_commands.TryPush(command))
+		{
+			++m_fullWaits;
+
+			do
+			{
+				std::this_thread::yield();
+			}
+			while (!m_commands.TryPush(command));
+		}
+
+		// Pairs with the fence in Wait, so that either the render thread
+		// sees the command or this sees it going to sleep
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (m_sleeping.load(std::memory_order_relaxed))
+		{
+			Wake();
+		}
+	}
+
+	void Post(RenderCommandKind const kind,
+		unsigned const client,
+		float const x = 0.0f,
+		float const y = 0.0f)
+	{
+		RenderCommand command;
+		command.Kind = kind;
+		command.Client = client;
+		command.X = x;
+		command.Y = y;
+
+		Post(command);
+	}
+
+	// Message thread only. Waits until every command posted has been applied
+	// and the frames it needed committed.
+	void Settle()
+	{
+		ASSERT(m_thread.joinable());
+
+		while (m_settled.load(std::memory_order_acquire) != m_posted)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+private:
+
+	void Wake()
+	{
+		std::lock_guard<std::mutex> const lock(m_mutex);
+		m_wake.notify_one();
+	}
+
+	// Sleeps until a command arrives, and if there is something to commit,
+	// until the time given at the latest
+	void Wait(bool const timed,
+		Clock::time_point const until)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		m_sleeping.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		auto const ready = [this]
+		{
+			return m_stop.load(std::memory_order_relaxed) || !m_commands.Empty();
+		};
+
+		if (timed)
+		{
+			m_wake.wait_until(lock, until, ready);
+		}
+		else
+		{
+			m_wake.wait(lock, ready);
+		}
+
+		m_sleeping.store(false, std::memory_order_relaxed);
+	}
+
+	bool FramePending()
+	{
+		for (unsigned client = 0; client != m_clients.size(); ++client)
+		{
+			if (m_changed[client] || m_clients[client]->FramePending()) return true;
+		}
+
+		return false;
+	}
+
+	void Run()
+	{
+		GlobalTracer().NameThread("Render");
+
+		std::vector<double> arrivals; // of the commands applied since the last frame
+		Clock::time_point hold = Clock::now(); // of the next commit
+
+		while (!m_stop.load(std::memory_order_relaxed))
+		{
+			bool const pending = !arrivals.empty() || FramePending();
+
+			if (!pending && m_commands.Empty())
+			{
+				m_settled.store(m_received, std::memory_order_release);
+			}
+
+			if (m_commands.Empty() && (!pending || Clock::now() < hold))
+			{
+				Wait(pending, hold);
+			}
+
+			// A burst of commands is applied until its frame is due, so that
+			// it is shown over several frames rather than all at once
+			RenderCommand command;
+
+			while (!m_stop.load(std::memory_order_relaxed) &&
+				(arrivals.empty() || Clock::now() < hold) &&
+				m_commands.TryPop(command))
+			{
+				++m_received;
+
+				if (command.Client >= m_clients.size()) continue;
+
+				TraceScope const scope("RenderCommand", static_cast<uint64_t>(command.Kind));
+
+				if (m_clients[command.Client]->Apply(command))
+				{
+					++m_applied;
+					m_changed[command.Client] = true;
+					arrivals.push_back(command.Arrival);
+				}
+			}
+
+			if (Clock::now() < hold || !FramePending()) continue;
+
+			TraceScope const scope("RenderFrame");
+			Stopwatch const work;
+			bool committed = false;
+			double untilFrame = std::numeric_limits<double>::infinity();
+
+			for (unsigned client = 0; client != m_clients.size(); ++client)
+			{
+				if (!m_changed[client] && !m_clients[client]->FramePending()) continue;
+
+				m_changed[client] = false;
+
+				if (m_clients[client]->Frame())
+				{
+					committed = true;
+					untilFrame = std::min(untilFrame, m_clients[client]->SecondsToNextFrame());
+				}
+			}
+
+			double const end = Now();
+
+			for (double const arrival : arrivals)
+			{
+				m_latency.Record(end - arrival);
+			}
+
+			arrivals.clear();
+
+			if (!committed) continue;
+
+			m_frameWork.Record(work.ElapsedSeconds());
+			++m_frames;
+
+			hold = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(std::max(0.0, untilFrame)));
+		}
+	}
+};
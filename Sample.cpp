@@ -1,5 +1,22 @@
 #include "Precompiled.h"
 #include "Window.h"
+#include "Animation.h"
+#include "Atlas.h"
+#include "Board.h"
+#include "BoardScene.h"
+#include "DirtyRects.h"
+#include "GameSnapshot.h"
+#include "GlyphCache.h"
+#include "ImageSource.h"
+#include "InputLog.h"
+#include "Interaction.h"
+#include "Metrics.h"
+#include "ParallelRenderer.h"
+#include "RenderThread.h"
+#include "SharedResources.h"
+#include "SoftwareRenderer.h"
+#include "TileCache.h"
+#include "Trace.h"
 
 using namespace Microsoft::WRL;
 using namespace D2D1;
@@ -7,199 +24,1326 @@ using namespace std;
 
 extern "C" IMAGE_DOS_HEADER __ImageBase;
 
-static unsigned const CardRows = 3;
-static unsigned const CardColumns = 6;
-static float const CardMargin = 15.0f;
-static float const CardWidth = 150.0f;
-static float const CardHeight = 210.0f;
+typedef StaticBoardLayout<SampleBoard> SampleLayout;
 
-static float const WindowWidth = CardColumns * (CardWidth + CardMargin) + CardMargin;
-static float const WindowHeight = CardRows * (CardHeight + CardMargin) + CardMargin;
+static constexpr BoardGeometry Geometry = SampleBoard::Geometry();
+static unsigned const CardRows = Geometry.Rows;
+static unsigned const CardColumns = Geometry.Columns;
+static float const CardWidth = Geometry.CardWidth;
+static float const CardHeight = Geometry.CardHeight;
+static wchar_t const FontFamily[] = L"Candara";
+static float const FontSize = CardHeight / 2.0f;
+static wchar_t const DefaultBackground[] = L"C:\\temp\\background.jpg";
+
+// Posted by the decoder thread whenever more of the background is ready
+static UINT const WM_BACKGROUND_PROGRESS = WM_APP + 1;
+
+// Posted by the render thread after rebuilding, with the microseconds taken
+static UINT const WM_REBUILT = WM_APP + 2;
 
 struct ComException
 {
 	HRESULT result;
 
-	ComException(HRESULT const value) : result(value)
-	{}
-};
+	ComException(HRESULT const value) : result(value)
+	{}
+};
+
+static void HR(HRESULT const result)
+{
+	if (S_OK != result)
+	{
+		throw ComException(result);
+	}
+}
+
+// Physical rows of a card back, from its top, that the first rowsReady rows
+// of the background cover, with the row below each for linear filtering.
+// The background is laid out in logical units, one pixel per DIP.
+static unsigned CardBackRowsReady(unsigned const rowsReady,
+	unsigned const imageHeight,
+	float const offsetY,
+	float const dpiY,
+	unsigned const height)
+{
+	// Rows past the image's bottom come out transparent either way
+	if (rowsReady >= imageHeight) return height;
+
+	float const rows = std::floor(LogicalToPhysical(static_cast<float>(rowsReady) - 1.0f, dpiY) - offsetY);
+
+	return static_cast<unsigned>(std::min(std::max(rows, 0.0f), static_cast<float>(height)));
+}
+
+// Begins drawing a rectangle of a surface with the context set up for the
+// given DPI and the rectangle's offset within the surface. The context's
+// origin is originX, originY physical pixels up and left of the rectangle.
+static ComPtr<ID2D1DeviceContext> BeginDraw(IDCompositionSurface * surface,
+	AtlasRect const & rect,
+	float const dpiX,
+	float const dpiY,
+	unsigned const originX = 0,
+	unsigned const originY = 0)
+{
+	ComPtr<ID2D1DeviceContext> dc;
+	POINT offset = {};
+
+	RECT const update =
+	{
+		static_cast<LONG>(rect.Left),
+		static_cast<LONG>(rect.Top),
+		static_cast<LONG>(rect.Left + rect.Width),
+		static_cast<LONG>(rect.Top + rect.Height)
+	};
+
+	HR(surface->BeginDraw(&update,
+		__uuidof(dc),
+		reinterpret_cast<void **>(dc.GetAddressOf()),
+		&offset));
+
+	dc->SetDpi(dpiX, dpiY);
+
+	dc->SetTransform(Matrix3x2F::Translation(PhysicalToLogical(offset.x - static_cast<LONG>(originX), dpiX),
+		PhysicalToLogical(offset.y - static_cast<LONG>(originY), dpiY)));
+
+	return dc;
+}
+
+//
+// DirectComposition implementation of the compositor interface. Objects
+// passed between them are always from this compositor.
+//
+
+struct DirectCompositionSurface : CompositorSurface
+{
+	ComPtr<IDCompositionSurface> m_surface;
+	unsigned m_width = 0;
+	unsigned m_height = 0;
+
+	DirectCompositionSurface(IDCompositionDesktopDevice * device,
+		unsigned const width,
+		unsigned const height) :
+		m_width(width),
+		m_height(height)
+	{
+		HR(device->CreateSurface(width,
+			height,
+			DXGI_FORMAT_B8G8R8A8_UNORM,
+			DXGI_ALPHA_MODE_PREMULTIPLIED,
+			m_surface.GetAddressOf()));
+	}
+
+	unsigned Width() const override
+	{
+		return m_width;
+	}
+
+	unsigned Height() const override
+	{
+		return m_height;
+	}
+
+	// Pixels are physical, so the context and the bitmap both use 96 DPI
+	void Upload(unsigned const left,
+		unsigned const top,
+		ConstPixelView const & pixels) override
+	{
+		AtlasRect rect;
+		rect.Left = left;
+		rect.Top = top;
+		rect.Width = pixels.Width;
+		rect.Height = pixels.Height;
+
+		ComPtr<ID2D1DeviceContext> const dc = BeginDraw(m_surface.Get(), rect, 96.0f, 96.0f);
+
+		D2D1_BITMAP_PROPERTIES1 const properties = BitmapProperties1(D2D1_BITMAP_OPTIONS_NONE,
+			PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
+
+		ComPtr<ID2D1Bitmap1> bitmap;
+
+		HR(dc->CreateBitmap(SizeU(pixels.Width, pixels.Height),
+			pixels.Pixels,
+			static_cast<unsigned>(pixels.Stride * sizeof(uint32_t)),
+			properties,
+			bitmap.GetAddressOf()));
+
+		dc->DrawBitmap(bitmap.Get(),
+			nullptr,
+			1.0f,
+			D2D1_INTERPOLATION_MODE_NEAREST_NEIGHBOR);
+
+		HR(m_surface->EndDraw());
+	}
+};
+
+static IDCompositionSurface * NativeSurface(shared_ptr<CompositorSurface> const & surface)
+{
+	return surface ? static_cast<DirectCompositionSurface &>(*surface).m_surface.Get() : nullptr;
+}
+
+static DirtyRect WholeTile(CardTile const & tile)
+{
+	return DirtyRect(0, 0, tile.Rect.Width, tile.Rect.Height);
+}
+
+// Begins drawing part of a tile, see BeginDraw above. Only the part is the
+// update rectangle, so the surface copies no more than the part, but the
+// context's origin stays at the tile's top left and the card is drawn as a
+// whole, clipped to the part.
+static ComPtr<ID2D1DeviceContext> BeginDraw(CardTile const & tile,
+	DirtyRect const & part,
+	float const dpiX,
+	float const dpiY)
+{
+	AtlasRect rect = tile.Rect;
+	rect.Left += part.Left;
+	rect.Top += part.Top;
+	rect.Width = part.Width();
+	rect.Height = part.Height();
+
+	ComPtr<ID2D1DeviceContext> const dc = BeginDraw(NativeSurface(tile.Surface), rect, dpiX, dpiY, part.Left, part.Top);
+
+	dc->PushAxisAlignedClip(RectF(PhysicalToLogical(part.Left, dpiX),
+		PhysicalToLogical(part.Top, dpiY),
+		PhysicalToLogical(part.Right, dpiX),
+		PhysicalToLogical(part.Bottom, dpiY)),
+		D2D1_ANTIALIAS_MODE_ALIASED);
+
+	return dc;
+}
+
+static void EndDraw(CardTile const & tile,
+	ID2D1DeviceContext * dc)
+{
+	dc->PopAxisAlignedClip();
+
+	HR(NativeSurface(tile.Surface)->EndDraw());
+}
+
+// Every transform of this compositor derives from this as well
+struct DirectCompositionTransform
+{
+	ComPtr<IDCompositionTransform3D> m_transform3D;
+
+	virtual ~DirectCompositionTransform()
+	{}
+};
+
+static IDCompositionTransform3D * NativeTransform(shared_ptr<CompositorTransform> const & transform)
+{
+	return transform ? dynamic_cast<DirectCompositionTransform &>(*transform).m_transform3D.Get() : nullptr;
+}
+
+struct DirectCompositionMatrixTransform : CompositorMatrixTransform, DirectCompositionTransform
+{
+	ComPtr<IDCompositionMatrixTransform3D> m_transform;
+
+	explicit DirectCompositionMatrixTransform(IDCompositionDesktopDevice * device)
+	{
+		HR(device->CreateMatrixTransform3D(m_transform.GetAddressOf()));
+		m_transform3D = m_transform;
+	}
+
+	void SetMatrix(Matrix4x4 const & matrix) override
+	{
+		HR(m_transform->SetMatrix(reinterpret_cast<D3DMATRIX const &>(matrix)));
+	}
+};
+
+// The animation object is reset and refilled for every new curve rather
+// than created for every click
+struct DirectCompositionRotateTransform : CompositorRotateTransform, DirectCompositionTransform
+{
+	ComPtr<IDCompositionDesktopDevice> m_device;
+	ComPtr<IDCompositionRotateTransform3D> m_transform;
+	ComPtr<IDCompositionAnimation> m_animation;
+
+	explicit DirectCompositionRotateTransform(IDCompositionDesktopDevice * device) :
+		m_device(device)
+	{
+		HR(device->CreateRotateTransform3D(m_transform.GetAddressOf()));
+		m_transform3D = m_transform;
+	}
+
+	void SetAxis(float const x, float const y, float const z) override
+	{
+		HR(m_transform->SetAxisX(x));
+		HR(m_transform->SetAxisY(y));
+		HR(m_transform->SetAxisZ(z));
+	}
+
+	void SetAngle(float const angle) override
+	{
+		HR(m_transform->SetAngle(angle));
+	}
+
+	void SetAngle(AnimationCurve const & curve) override
+	{
+		if (m_animation)
+		{
+			HR(m_animation->Reset());
+		}
+		else
+		{
+			HR(m_device->CreateAnimation(m_animation.GetAddressOf()));
+		}
+
+		for (CurveSegment const & segment : curve.Segments)
+		{
+			HR(m_animation->AddCubic(segment.Begin,
+				segment.Constant,
+				segment.Linear,
+				segment.Quadratic,
+				segment.Cubic));
+		}
+
+		HR(m_animation->End(curve.End, curve.EndValue));
+		HR(m_transform->SetAngle(m_animation.Get()));
+	}
+};
+
+struct DirectCompositionTransformGroup : CompositorTransform, DirectCompositionTransform
+{
+	DirectCompositionTransformGroup(IDCompositionDesktopDevice * device,
+		shared_ptr<CompositorTransform> const * transforms,
+		unsigned const count)
+	{
+		vector<IDCompositionTransform3D *> natives;
+
+		for (unsigned i = 0; i != count; ++i)
+		{
+			natives.push_back(NativeTransform(transforms[i]));
+		}
+
+		HR(device->CreateTransform3DGroup(natives.data(),
+			count,
+			m_transform3D.GetAddressOf()));
+	}
+};
+
+struct DirectCompositionVisual : CompositorVisual
+{
+	ComPtr<IDCompositionVisual2> m_visual;
+
+	explicit DirectCompositionVisual(IDCompositionDesktopDevice * device)
+	{
+		HR(device->CreateVisual(m_visual.GetAddressOf()));
+	}
+
+	static IDCompositionVisual * Native(shared_ptr<CompositorVisual> const & visual)
+	{
+		return static_cast<DirectCompositionVisual &>(*visual).m_visual.Get();
+	}
+
+	void SetOffset(float const x, float const y) override
+	{
+		HR(m_visual->SetOffsetX(x));
+		HR(m_visual->SetOffsetY(y));
+	}
+
+	void SetClip(float const left, float const top, float const right, float const bottom) override
+	{
+		HR(m_visual->SetClip(RectF(left, top, right, bottom)));
+	}
+
+	void SetBackFaceVisible(bool const visible) override
+	{
+		HR(m_visual->SetBackFaceVisibility(visible ?
+			DCOMPOSITION_BACKFACE_VISIBILITY_VISIBLE :
+			DCOMPOSITION_BACKFACE_VISIBILITY_HIDDEN));
+	}
+
+	void SetContent(shared_ptr<CompositorSurface> const & surface) override
+	{
+		HR(m_visual->SetContent(NativeSurface(surface)));
+	}
+
+	void SetTransform(shared_ptr<CompositorTransform> const & transform) override
+	{
+		HR(m_visual->SetEffect(NativeTransform(transform)));
+	}
+
+	void AddVisual(shared_ptr<CompositorVisual> const & child) override
+	{
+		HR(m_visual->AddVisual(Native(child), false, nullptr));
+	}
+
+	void RemoveVisual(shared_ptr<CompositorVisual> const & child) override
+	{
+		HR(m_visual->RemoveVisual(Native(child)));
+	}
+
+	void RemoveAllVisuals() override
+	{
+		HR(m_visual->RemoveAllVisuals());
+	}
+};
+
+struct DirectCompositionCompositor : Compositor
+{
+	ComPtr<IDCompositionDesktopDevice> m_device;
+	HWND m_window = nullptr;
+	ComPtr<IDCompositionTarget> m_target;
+
+	DirectCompositionCompositor(ComPtr<IDCompositionDesktopDevice> const & device,
+		HWND const window) :
+		m_device(device),
+		m_window(window)
+	{}
+
+	shared_ptr<CompositorVisual> CreateVisual() override
+	{
+		return make_shared<DirectCompositionVisual>(m_device.Get());
+	}
+
+	shared_ptr<CompositorSurface> CreateSurface(unsigned const width, unsigned const height) override
+	{
+		return make_shared<DirectCompositionSurface>(m_device.Get(), width, height);
+	}
+
+	shared_ptr<CompositorMatrixTransform> CreateMatrixTransform() override
+	{
+		return make_shared<DirectCompositionMatrixTransform>(m_device.Get());
+	}
+
+	shared_ptr<CompositorRotateTransform> CreateRotateTransform() override
+	{
+		return make_shared<DirectCompositionRotateTransform>(m_device.Get());
+	}
+
+	shared_ptr<CompositorTransform> CreateTransformGroup(shared_ptr<CompositorTransform> const * transforms,
+		unsigned const count) override
+	{
+		return make_shared<DirectCompositionTransformGroup>(m_device.Get(), transforms, count);
+	}
+
+	void SetRoot(shared_ptr<CompositorVisual> const & root) override
+	{
+		if (!m_target)
+		{
+			HR(m_device->CreateTargetForHwnd(m_window,
+				true,
+				m_target.GetAddressOf()));
+		}
+
+		HR(m_target->SetRoot(DirectCompositionVisual::Native(root)));
+	}
+
+	double NextFrameTime() override
+	{
+		DCOMPOSITION_FRAME_STATISTICS stats = {};
+		HR(m_device->GetFrameStatistics(&stats));
+
+		return static_cast<double>(stats.nextEstimatedFrameTime.QuadPart) / stats.timeFrequency.QuadPart;
+	}
+
+	void Commit() override
+	{
+		TraceScope const scope("Commit");
+
+		HR(m_device->Commit());
+	}
+
+	// From the frame statistics, for pacing commits
+	double SecondsToNextFrame()
+	{
+		DCOMPOSITION_FRAME_STATISTICS stats = {};
+		HR(m_device->GetFrameStatistics(&stats));
+
+		return static_cast<double>(stats.nextEstimatedFrameTime.QuadPart - stats.currentTime.QuadPart) / stats.timeFrequency.QuadPart;
+	}
+
+	// The performance counter time of the frame that will show the last
+	// commit
+	uint64_t NextPresentTicks()
+	{
+		DCOMPOSITION_FRAME_STATISTICS stats = {};
+		HR(m_device->GetFrameStatistics(&stats));
+
+		return static_cast<uint64_t>(stats.nextEstimatedFrameTime.QuadPart);
+	}
+
+	void WaitForCommitCompletion() override
+	{
+		HR(m_device->WaitForCommitCompletion());
+	}
+};
+
+// The card font, rasterized on the CPU with DirectWrite so that the glyphs
+// can be cached independently of the device.
+struct DirectWriteFont
+{
+	ComPtr<IDWriteFactory2> Factory;
+	ComPtr<IDWriteFontFace> Face;
+	uint32_t Id = FontId(FontFamily);
+
+	// Produces the coverage DrawText would, centered in a card with the
+	// font's advance and line metrics.
+	CoverageMask Rasterize(wchar_t const value,
+		float const dpiX,
+		float const dpiY) const
+	{
+		UINT32 const codePoint = value;
+		UINT16 index = 0;
+
+		HR(Face->GetGlyphIndices(&codePoint, 1, &index));
+
+		DWRITE_FONT_METRICS metrics = {};
+		Face->GetMetrics(&metrics);
+
+		DWRITE_GLYPH_METRICS glyphMetrics = {};
+		HR(Face->GetDesignGlyphMetrics(&index, 1, &glyphMetrics, false));
+
+		float const scale = FontSize / metrics.designUnitsPerEm;
+		float const lineHeight = (metrics.ascent + metrics.descent + metrics.lineGap) * scale;
+
+		float const originX = (CardWidth - glyphMetrics.advanceWidth * scale) / 2.0f;
+		float const originY = (CardHeight - lineHeight) / 2.0f + metrics.ascent * scale;
+
+		DWRITE_GLYPH_RUN run = {};
+		run.fontFace = Face.Get();
+		run.fontEmSize = FontSize;
+		run.glyphCount = 1;
+		run.glyphIndices = &index;
+
+		DWRITE_MATRIX const transform =
+		{
+			dpiX / 96.0f, 0.0f,
+			0.0f, dpiY / 96.0f,
+			0.0f, 0.0f
+		};
+
+		ComPtr<IDWriteGlyphRunAnalysis> analysis;
+
+		HR(Factory->CreateGlyphRunAnalysis(&run,
+			&transform,
+			DWRITE_RENDERING_MODE_NATURAL_SYMMETRIC,
+			DWRITE_MEASURING_MODE_NATURAL,
+			DWRITE_GRID_FIT_MODE_DEFAULT,
+			DWRITE_TEXT_ANTIALIAS_MODE_GRAYSCALE,
+			originX,
+			originY,
+			analysis.GetAddressOf()));
+
+		RECT bounds = {};
+		HR(analysis->GetAlphaTextureBounds(DWRITE_TEXTURE_ALIASED_1x1, &bounds));
+
+		CoverageMask mask;
+		mask.Left = bounds.left;
+		mask.Top = bounds.top;
+		mask.Width = bounds.right - bounds.left;
+		mask.Height = bounds.bottom - bounds.top;
+		mask.Alpha.resize(mask.Width * mask.Height);
+
+		if (!mask.Alpha.empty())
+		{
+			HR(analysis->CreateAlphaTexture(DWRITE_TEXTURE_ALIASED_1x1,
+				&bounds,
+				mask.Alpha.data(),
+				static_cast<unsigned>(mask.Alpha.size())));
+		}
+
+		return mask;
+	}
+};
+
+// Draws card faces into composition surfaces
+struct CardRenderer
+{
+	virtual ~CardRenderer()
+	{}
+
+	virtual void DrawCardFront(CardTile const & tile,
+		wchar_t const value) = 0;
+
+	// offsetX and offsetY are the card's physical position on the board
+	virtual void DrawCardBack(CardTile const & tile,
+		float const offsetX,
+		float const offsetY) = 0;
+
+	// Draw only the part of the tile, leaving the rest as it was
+	virtual void DrawCardFront(CardTile const & tile,
+		wchar_t const value,
+		DirtyRect const & part) = 0;
+
+	virtual void DrawCardBack(CardTile const & tile,
+		float const offsetX,
+		float const offsetY,
+		DirtyRect const & part) = 0;
+};
+
+struct Direct2DCardRenderer : CardRenderer
+{
+	float m_dpiX = 0.0f;
+	float m_dpiY = 0.0f;
+	DirectWriteFont const & m_font;
+	GlyphCache & m_glyphs;
+	StreamingImage const * m_background;
+	unsigned m_uploadedRows = 0;
+	ComPtr<ID2D1SolidColorBrush> m_brush;
+	ComPtr<ID2D1Bitmap1> m_bitmap;
+
+	Direct2DCardRenderer(ComPtr<ID2D1Device> const & device2D,
+		DirectWriteFont const & font,
+		GlyphCache & glyphs,
+		StreamingImage const * background,
+		float const dpiX,
+		float const dpiY) :
+		m_dpiX(dpiX),
+		m_dpiY(dpiY),
+		m_font(font),
+		m_glyphs(glyphs),
+		m_background(background)
+	{
+		ComPtr<ID2D1DeviceContext> dc;
+
+		HR(device2D->CreateDeviceContext(D2D1_DEVICE_CONTEXT_OPTIONS_NONE,
+			dc.GetAddressOf()));
+
+		D2D1_COLOR_F const color = ColorF(0.0f, 0.0f, 0.0f);
+
+		HR(dc->CreateSolidColorBrush(color, m_brush.GetAddressOf()));
+
+		// Not needed when the backs come from the tile cache
+		if (!background) return;
+
+		// Filled from the decoded rows as they become ready
+		HR(dc->CreateBitmap(SizeU(background->Width(), background->Height()),
+			nullptr,
+			0,
+			BitmapProperties1(D2D1_BITMAP_OPTIONS_NONE,
+				PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED)),
+			m_bitmap.GetAddressOf()));
+	}
+
+	void UploadBackground()
+	{
+		ConstPixelView const ready = m_background->ReadyView();
+
+		if (ready.Height == m_uploadedRows) return;
+
+		D2D1_RECT_U const rect = RectU(0, m_uploadedRows, ready.Width, ready.Height);
+
+		HR(m_bitmap->CopyFromMemory(&rect,
+			ready.Row(m_uploadedRows),
+			static_cast<unsigned>(ready.Stride * sizeof(uint32_t))));
+
+		m_uploadedRows = ready.Height;
+	}
+
+	void DrawCardBack(CardTile const & tile,
+		float const offsetX,
+		float const offsetY) override
+	{
+		DrawCardBack(tile, offsetX, offsetY, WholeTile(tile));
+	}
+
+	void DrawCardBack(CardTile const & tile,
+		float const offsetX,
+		float const offsetY,
+		DirtyRect const & part) override
+	{
+		ASSERT(m_background);
+
+		UploadBackground();
+
+		ComPtr<ID2D1DeviceContext> const dc = BeginDraw(tile, part, m_dpiX, m_dpiY);
+
+		// Left blank until the rows behind the part are decoded
+		if (part.Bottom > CardBackRowsReady(m_uploadedRows, m_background->Height(), offsetY, m_dpiY, tile.Rect.Height))
+		{
+			dc->Clear(ColorF(0.0f, 0.0f, 0.0f, 0.0f));
+
+			EndDraw(tile, dc.Get());
+			return;
+		}
+
+		D2D1_RECT_F source = RectF(
+			PhysicalToLogical(offsetX, m_dpiX),
+			PhysicalToLogical(offsetY, m_dpiY));
+
+		source.right = source.left + CardWidth;
+		source.bottom = source.top + CardHeight;
+
+		dc->DrawBitmap(m_bitmap.Get(),
+			nullptr,
+			1.0f,
+			D2D1_INTERPOLATION_MODE_LINEAR,
+			&source);
+
+		EndDraw(tile, dc.Get());
+	}
+
+	void DrawCardFront(CardTile const & tile,
+		wchar_t const value) override
+	{
+		DrawCardFront(tile, value, WholeTile(tile));
+	}
+
+	void DrawCardFront(CardTile const & tile,
+		wchar_t const value,
+		DirtyRect const & part) override
+	{
+		CoverageMask const & glyph = m_glyphs.Get(GlyphKey(value, m_font.Id, FontSize, m_dpiY), [&]
+		{
+			return m_font.Rasterize(value, m_dpiX, m_dpiY);
+		});
+
+		ComPtr<ID2D1DeviceContext> const dc = BeginDraw(tile, part, m_dpiX, m_dpiY);
+
+		dc->Clear(ColorF(1.0f, 1.0f, 1.0f));
+
+		if (!glyph.Alpha.empty())
+		{
+			ComPtr<ID2D1Bitmap1> mask;
+
+			HR(dc->CreateBitmap(SizeU(glyph.Width, glyph.Height),
+				glyph.Alpha.data(),
+				glyph.Width,
+				BitmapProperties1(D2D1_BITMAP_OPTIONS_NONE,
+					PixelFormat(DXGI_FORMAT_A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED),
+					m_dpiX,
+					m_dpiY),
+				mask.GetAddressOf()));
+
+			D2D1_RECT_F const destination = RectF(
+				PhysicalToLogical(glyph.Left, m_dpiX),
+				PhysicalToLogical(glyph.Top, m_dpiY),
+				PhysicalToLogical(glyph.Left + static_cast<int>(glyph.Width), m_dpiX),
+				PhysicalToLogical(glyph.Top + static_cast<int>(glyph.Height), m_dpiY));
+
+			// FillOpacityMask requires aliased rendering
+			dc->SetAntialiasMode(D2D1_ANTIALIAS_MODE_ALIASED);
+
+			dc->FillOpacityMask(mask.Get(),
+				m_brush.Get(),
+				&destination,
+				nullptr);
+		}
+
+		EndDraw(tile, dc.Get());
+	}
+};
+
+// Decodes the background with WIC. The format converter only decodes the
+// rows each CopyPixels call asks for, so strips are decoded on demand. It is
+// used on the decoder thread, which joins the process MTA implicitly.
+struct WicImageDecoder : ImageDecoder
+{
+	ComPtr<IWICFormatConverter> m_image;
+	unsigned m_width = 0;
+	unsigned m_height = 0;
+	unsigned m_row = 0;
+
+	explicit WicImageDecoder(wchar_t const * path)
+	{
+		ComPtr<IWICImagingFactory2> factory;
+
+		HR(CoCreateInstance(CLSID_WICImagingFactory,
+			nullptr,
+			CLSCTX_INPROC,
+			__uuidof(factory),
+			reinterpret_cast<void **>(factory.GetAddressOf())));
+
+		ComPtr<IWICBitmapDecoder> decoder;
+
+		HR(factory->CreateDecoderFromFilename(path,
+			nullptr,
+			GENERIC_READ,
+			WICDecodeMetadataCacheOnDemand,
+			decoder.GetAddressOf()));
+
+		ComPtr<IWICBitmapFrameDecode> source;
+
+		HR(decoder->GetFrame(0, source.GetAddressOf()));
+
+		HR(factory->CreateFormatConverter(m_image.GetAddressOf()));
+
+		HR(m_image->Initialize(source.Get(),
+			GUID_WICPixelFormat32bppPBGRA,
+			WICBitmapDitherTypeNone,
+			nullptr,
+			0.0,
+			WICBitmapPaletteTypeMedianCut));
+
+		HR(m_image->GetSize(&m_width, &m_height));
+	}
+
+	unsigned Width() const override
+	{
+		return m_width;
+	}
+
+	unsigned Height() const override
+	{
+		return m_height;
+	}
+
+	bool ReadRows(PixelView const & rows) override
+	{
+		WICRect const rect =
+		{
+			0,
+			static_cast<INT>(m_row),
+			static_cast<INT>(m_width),
+			static_cast<INT>(rows.Height)
+		};
+
+		unsigned const stride = static_cast<unsigned>(rows.Stride * sizeof(uint32_t));
+
+		HRESULT const result = m_image->CopyPixels(&rect,
+			stride,
+			stride * (rows.Height - 1) + m_width * sizeof(uint32_t),
+			reinterpret_cast<BYTE *>(rows.Pixels));
+
+		m_row += rows.Height;
+
+		return S_OK == result;
+	}
+};
+
+// Rasterizes on the CPU and only uses Direct2D to upload the pixels. Used
+// when there is no hardware device and the sample falls back to WARP.
+struct SoftwareCardRenderer : CardRenderer
+{
+	StreamingImage const * m_background;
+	SoftwareRenderer m_renderer;
+	PixelBuffer m_staging;
+
+	SoftwareCardRenderer(StreamingImage const * background,
+		GlyphCache & glyphs,
+		float const dpiX,
+		float const dpiY) :
+		m_background(background),
+		m_renderer(dpiX, dpiY, CardWidth, CardHeight, FontSize, ConstPixelView(), &glyphs),
+		m_staging(m_renderer.Width(), m_renderer.Height())
+	{}
+
+	void DrawCardBack(CardTile const & tile,
+		float const offsetX,
+		float const offsetY) override
+	{
+		ASSERT(m_background);
+
+		// Rows that are not decoded yet come out transparent
+		m_renderer.m_background = m_background->ReadyView();
+
+		m_renderer.DrawCardBack(m_staging.View(), offsetX, offsetY);
+
+		Upload(tile);
+	}
+
+	void DrawCardFront(CardTile const & tile,
+		wchar_t const value) override
+	{
+		m_renderer.DrawCardFront(m_staging.View(), value);
+
+		Upload(tile);
+	}
+
+	void DrawCardBack(CardTile const & tile,
+		float const offsetX,
+		float const offsetY,
+		DirtyRect const & part) override
+	{
+		ASSERT(m_background);
+
+		m_renderer.m_background = m_background->ReadyView();
+
+		m_renderer.DrawCardBack(m_staging.View(), offsetX, offsetY, part);
+
+		Upload(tile, part);
+	}
+
+	void DrawCardFront(CardTile const & tile,
+		wchar_t const value,
+		DirtyRect const & part) override
+	{
+		m_renderer.DrawCardFront(m_staging.View(), value, part);
+
+		Upload(tile, part);
+	}
+
+	void Upload(CardTile const & tile)
+	{
+		tile.Surface->Upload(tile.Rect.Left, tile.Rect.Top, m_staging.View());
+	}
+
+	void Upload(CardTile const & tile,
+		DirtyRect const & part)
+	{
+		tile.Surface->Upload(tile.Rect.Left + part.Left,
+			tile.Rect.Top + part.Top,
+			m_staging.View().SubView(part.Left, part.Top, part.Width(), part.Height()));
+	}
+};
+
+// A card back drawn before the background behind it was decoded, and the
+// rows of it drawn from decoded background since
+struct PendingBack
+{
+	unsigned Card;
+	CardTile Tile;
+	unsigned Rows;
+};
+
+// Cards redrawn per frame after a DPI change
+static unsigned const DpiRedrawCardsPerFrame = 8;
+
+// Surfaces at the new DPI that the cards move to as they are redrawn
+struct DpiRedraw
+{
+	ScenePages Pages;
+	vector<bool> FrontDrawn;
+	unsigned NextCard = 0;
+};
+
+// The devices and the device independent resources all windows share. A
+// window keeps only its composition target, scene, layout and tiles, so
+// each window after the first costs little more than its surfaces. After
+// device loss the first window to paint recreates the devices, and the
+// others rebuild on them when they see the generation change. Apart from
+// the window list, everything here is used on the render thread.
+struct SharedDevice
+{
+	// Device independent resources
+	DirectWriteFont m_font;
+	wstring m_backgroundPath;
+	uint64_t m_backgroundHash = 0;
+
+	// Told about background progress and device loss, and declared before
+	// the resources so they outlive the decoder that posts to them
+	vector<HWND> m_windows;
+	mutex m_windowsMutex;
+
+	SharedBoardResources m_resources;
+
+	// Device resources
+	ComPtr<ID3D11Device> m_device3D;
+	ComPtr<ID2D1Device> m_device2D;
+	ComPtr<IDCompositionDesktopDevice> m_device;
+	bool m_softwareRendering = false;
+	unsigned m_generation = 0; // counts the devices created
+
+	// Does all the windows' device work, so that only it touches the devices.
+	// Declared last, as it calls on everything above.
+	RenderThread m_renderThread;
+
+	explicit SharedDevice(wchar_t const * background)
+	{
+		CreateFontFace();
+
+		m_backgroundPath = background;
+		m_backgroundHash = HashFile(background);
+	}
+
+	void AddWindow(HWND const window)
+	{
+		lock_guard<mutex> const lock(m_windowsMutex);
+		m_windows.push_back(window);
+	}
+
+	// Returns the number of windows left
+	size_t RemoveWindow(HWND const window)
+	{
+		lock_guard<mutex> const lock(m_windowsMutex);
+		m_windows.erase(remove(m_windows.begin(), m_windows.end(), window), m_windows.end());
+		return m_windows.size();
+	}
+
+	void PostToWindows(UINT const message)
+	{
+		lock_guard<mutex> const lock(m_windowsMutex);
+
+		for (HWND const window : m_windows)
+		{
+			PostMessage(window, message, 0, 0);
+		}
+	}
+
+	// Starts decoding the background on a worker thread. Card backs are drawn
+	// from whatever rows are ready and redrawn as the rest arrives.
+	void StartDecoding()
+	{
+		ASSERT(!m_resources.Background);
+
+		m_resources.Background = make_unique<StreamingImage>(make_unique<WicImageDecoder>(m_backgroundPath.c_str()), [this](unsigned)
+		{
+			PostToWindows(WM_BACKGROUND_PROGRESS);
+		});
+	}
+
+	void CreateFontFace()
+	{
+		HR(DWriteCreateFactory(
+			DWRITE_FACTORY_TYPE_SHARED,
+			__uuidof(m_font.Factory),
+			reinterpret_cast<IUnknown **>(m_font.Factory.GetAddressOf())
+		));
+
+		ComPtr<IDWriteFontCollection> collection;
+		HR(m_font.Factory->GetSystemFontCollection(collection.GetAddressOf()));
+
+		UINT32 familyIndex = 0;
+		BOOL exists = FALSE;
+		HR(collection->FindFamilyName(FontFamily, &familyIndex, &exists));
+
+		// Like CreateTextFormat, fall back to another family if it is missing
+		if (!exists) familyIndex = 0;
+
+		ComPtr<IDWriteFontFamily> family;
+		HR(collection->GetFontFamily(familyIndex, family.GetAddressOf()));
+
+		ComPtr<IDWriteFont> font;
+		HR(family->GetFirstMatchingFont(DWRITE_FONT_WEIGHT_NORMAL,
+			DWRITE_FONT_STRETCH_NORMAL,
+			DWRITE_FONT_STYLE_NORMAL,
+			font.GetAddressOf()));
+
+		HR(font->CreateFontFace(m_font.Face.GetAddressOf()));
+	}
+
+	bool IsDeviceCreated() const
+	{
+		return m_device3D;
+	}
+
+	// Drops the devices if they are still those of the generation that
+	// failed, and has every window repaint to rebuild on new ones
+	void ReleaseDeviceResources(unsigned const generation)
+	{
+		if (generation != m_generation || !IsDeviceCreated()) return;
+
+		m_device.Reset();
+		m_device2D.Reset();
+		m_device3D.Reset();
+
+		lock_guard<mutex> const lock(m_windowsMutex);
+
+		for (HWND const window : m_windows)
+		{
+			VERIFY(InvalidateRect(window, nullptr, false));
+		}
+	}
+
+	void CreateDeviceResources()
+	{
+		ASSERT(!IsDeviceCreated());
+
+		TraceScope const scope("CreateDeviceResources");
 
-static void HR(HRESULT const result)
-{
-	if (S_OK != result)
+		CreateDevice3D();
+
+		m_device2D = CreateDevice2D();
+
+		HR(DCompositionCreateDevice2(m_device2D.Get(),
+			__uuidof(m_device),
+			reinterpret_cast<void **>(m_device.ReleaseAndGetAddressOf())));
+
+		++m_generation;
+		m_resources.ReleaseDeviceResources();
+	}
+
+	void CreateDevice3D()
 	{
-		throw ComException(result);
+		unsigned flags = D3D11_CREATE_DEVICE_BGRA_SUPPORT |
+			D3D11_CREATE_DEVICE_SINGLETHREADED;
+		#ifdef _DEBUG
+		flags |= D3D11_CREATE_DEVICE_DEBUG;
+		#endif
+
+		HRESULT const result = D3D11CreateDevice(nullptr,
+			D3D_DRIVER_TYPE_HARDWARE,
+			nullptr,
+			flags,
+			nullptr, 0,
+			D3D11_SDK_VERSION,
+			m_device3D.ReleaseAndGetAddressOf(),
+			nullptr,
+			nullptr);
+
+		m_softwareRendering = S_OK != result;
+
+		if (m_softwareRendering)
+		{
+			TRACE(L"Hardware device failed 0x%X, falling back to WARP\n", result);
+
+			HR(D3D11CreateDevice(nullptr,
+				D3D_DRIVER_TYPE_WARP,
+				nullptr,
+				flags,
+				nullptr, 0,
+				D3D11_SDK_VERSION,
+				m_device3D.ReleaseAndGetAddressOf(),
+				nullptr,
+				nullptr));
+		}
 	}
-}
 
-template <typename T>
-static float PhysicalToLogical(T const pixel,
-	float const dpi)
-{
-	return pixel * 96.0f / dpi;
-}
+	ComPtr<ID2D1Device> CreateDevice2D()
+	{
+		ComPtr<IDXGIDevice3> deviceX;
+		HR(m_device3D.As(&deviceX));
 
-template <typename T>
-static float LogicalToPhysical(T const pixel,
-	float const dpi)
-{
-	return pixel * dpi / 96.0f;
-}
+		D2D1_CREATION_PROPERTIES properties = {};
+#ifdef _DEBUG
+		properties.debugLevel = D2D1_DEBUG_LEVEL_INFORMATION;
+#endif
 
-enum class CardStatus
-{
-	Hidden,
-	Selected,
-	Matched
-};
+		ComPtr<ID2D1Device> device2D;
 
-struct Card
-{
-	// Device independed resources
-	CardStatus Status = CardStatus::Hidden;
-	wchar_t Value = L' ';
-	float OffsetX = 0.0f;
-	float OffsetY = 0.0f;
-	ComPtr<IUIAnimationVariable2> Variable;
+		HR(D2D1CreateDevice(deviceX.Get(),
+			properties,
+			device2D.GetAddressOf()));
 
-	// Device resources
-	ComPtr<IDCompositionRotateTransform3D> Rotation;
+		return device2D;
+	}
 };
 
-struct SampleWindow : Window<SampleWindow>
+// The message thread handles the window's messages and posts what they ask
+// for to the render thread, which does the work as the window's render
+// client. The board comes back to the message thread as a snapshot.
+struct SampleWindow : Window<SampleWindow>, RenderClient
 {
-	// Device independent resources
+	// Device independent resources, the shared ones by reference
+	SharedDevice & m_shared;
+	DirectWriteFont const & m_font;
+	GlyphCache & m_glyphs;
+	unique_ptr<StreamingImage> & m_background;
+	ThreadPool & m_pool;
 	float m_dpiX = 0.0f;
 	float m_dpiY = 0.0f;
-	ComPtr<IDWriteTextFormat> m_textFormat;
-	ComPtr<IWICFormatConverter> m_image;
-	ComPtr<IUIAnimationManager2> m_manager;
-	ComPtr<IUIAnimationTransitionLibrary2> m_library;
-	Card * m_firstCard = nullptr;
+	TileCache m_tiles;
+	Animator m_animator;
+	Board m_board = Board(Geometry);
+	uint64_t m_gameSeed = 0;
+	uint64_t m_nextSeed = 0;
+	unsigned m_games = 0;
+	DurationMetric m_rebuilds;
+
+	// The game as saved for the next start, and whether this one began from
+	// it rather than from a deal
+	GameSaveFile m_save;
+	bool m_restored = false;
+	DurationMetric m_newGames;
+
+	// Layout for the current DPI, kept across device loss
+	unique_ptr<CardAtlas> m_atlas;
+
+	// Input waiting for the next frame, and when the first of it arrived
+	InteractionQueue m_interactions;
+	uint64_t m_inputTicks = 0;
+
+	// The message thread's part: the window's own DPI, for sizing it, and
+	// every input since the window opened, saved on exit for replaying
+	float m_windowDpiX = 0.0f;
+	float m_windowDpiY = 0.0f;
+	InputLog m_inputLog;
+	Stopwatch m_inputClock;
+
+	// The board as last shown, published by the render thread
+	SnapshotBuffer<BoardSnapshot> m_snapshots { BoardSnapshot(Geometry) };
+	unsigned m_client = 0; // of the render thread
+	bool m_closed = false;
+
+	// Device resources, on the shared devices of the generation built on
+	unsigned m_deviceGeneration = 0;
+	unique_ptr<DirectCompositionCompositor> m_compositor;
+	unique_ptr<BoardScene> m_scene;
+	ScenePages m_pages;
+	unique_ptr<CardRenderer> m_renderer;
+	vector<PendingBack> m_pendingBacks;
+	FrameDamage m_backDamage;
+	unique_ptr<DpiRedraw> m_dpiRedraw;
+	bool m_visualsCreated = false;
+
+	// The software path's tiles are rasterized into CPU pages, kept across
+	// device loss
+	vector<PixelBuffer> m_stagingPages;
+
+	// The first game is dealt from the seed, the next ones from seeds that
+	// follow from it. With restore the window carries on its saved game, if
+	// there is one, instead.
+	SampleWindow(SharedDevice & shared,
+		uint64_t const seed,
+		unsigned const window,
+		bool const restore) :
+		m_shared(shared),
+		m_font(shared.m_font),
+		m_glyphs(shared.m_resources.Glyphs),
+		m_background(shared.m_resources.Background),
+		m_pool(shared.m_resources.Pool),
+		m_nextSeed(seed),
+		m_save(GamePath(window, L".state").c_str(), GamePath(window, L".state.log").c_str())
+	{
+		CreateDesktopWindow();
+		m_shared.AddWindow(m_window);
+		m_client = m_shared.m_renderThread.Add(*this);
+		m_restored = restore && RestoreGame();
 
-	// Contains some device resources
-	array<Card, CardRows * CardColumns> m_cards;
+		if (!m_restored)
+		{
+			ShuffleCards();
+			SaveGame();
+		}
 
-	// Device resources
-	ComPtr<ID3D11Device> m_device3D;
-	//ComPtr<IDCompositionDevice2> m_device;
-	ComPtr<IDCompositionDesktopDevice> m_device;
-	ComPtr<IDCompositionTarget> m_target;
+		m_inputLog.Seed = m_gameSeed;
+		m_inputLog.Geometry = Geometry;
+		m_inputLog.DpiX = m_dpiX;
+		m_inputLog.DpiY = m_dpiY;
+		m_inputClock.Restart();
+		UpdateTileCache();
+		PrepareAnimations();
+	}
 
-	SampleWindow()
+	// A restored game's cards start at rest as their status shows them. The
+	// turns that were in flight are not resumed, as there is no frame clock
+	// to resume them on before the first paint.
+	void PrepareAnimations()
 	{
-		CreateDesktopWindow();
-		ShuffleCards();
-		CreateTextFormat();
-		CreateImage();
-		PrepareAnimationManager();
+		for (unsigned index = 0; index != m_board.CardCount(); ++index)
+		{
+			VERIFY(index == m_animator.CreateVariable(RestingAngle(m_board[index].Status)));
+		}
 	}
 
-	void PrepareAnimationManager()
+	// The saved game of the window, in the temp folder. The first window's
+	// is SampleGame.state and the others' are numbered.
+	static wstring GamePath(unsigned const window,
+		wchar_t const * const extension)
 	{
-		HR(CoCreateInstance(__uuidof(UIAnimationManager2),
-			nullptr,
-			CLSCTX_INPROC,
-			__uuidof(m_manager),
-			reinterpret_cast<void**>(m_manager.GetAddressOf())));
+		wchar_t directory[MAX_PATH + 1] = {};
+		VERIFY(GetTempPath(_countof(directory), directory));
 
-		HR(CoCreateInstance(__uuidof(UIAnimationTransitionLibrary2),
-			nullptr,
-			CLSCTX_INPROC,
-			__uuidof(m_library),
-			reinterpret_cast<void **>(m_library.GetAddressOf())));
+		wstring path = wstring(directory) + L"SampleGame";
 
-		for (Card & card : m_cards)
+		if (window != 0)
 		{
-			HR(m_manager->CreateAnimationVariable(0.0, card.Variable.GetAddressOf()));
+			path += L"-" + to_wstring(window);
 		}
+
+		return path + extension;
 	}
 
-	void CreateImage()
+	bool RestoreGame()
 	{
-		ComPtr<IWICImagingFactory2> factory;
-
-		HR(CoCreateInstance(CLSID_WICImagingFactory,
-			nullptr,
-			CLSCTX_INPROC,
-			__uuidof(factory),
-			reinterpret_cast<void **>(factory.GetAddressOf())));
-
-		ComPtr<IWICBitmapDecoder> decoder;
+		GameProgress progress;
 
-		HR(factory->CreateDecoderFromFilename(L"C:\\temp\\background.jpg",
-			nullptr,
-			GENERIC_READ,
-			WICDecodeMetadataCacheOnDemand,
-			decoder.GetAddressOf()));
+		if (!m_save.Restore(CardAlphabet::Latin(), m_board, progress)) return false;
 
-		ComPtr<IWICBitmapFrameDecode> source;
+		m_gameSeed = progress.Seed;
+		m_nextSeed = NextGameSeed(m_gameSeed);
+		m_games = progress.Games;
 
-		HR(decoder->GetFrame(0, source.GetAddressOf()));
+		TRACE(L"Game seed %llu restored\n", m_gameSeed);
+		return true;
+	}
 
-		HR(factory->CreateFormatConverter(m_image.GetAddressOf()));
+	// Folds the log into a new snapshot of the board and the turns in flight
+	void SaveGame()
+	{
+		GameProgress progress;
+		progress.Seed = m_gameSeed;
+		progress.Games = m_games;
+		progress.Animations = CollectAnimations(m_animator);
 
-		HR(m_image->Initialize(source.Get(),
-			GUID_WICPixelFormat32bppBGR,
-			WICBitmapDitherTypeNone,
-			nullptr,
-			0.0,
-			WICBitmapPaletteTypeMedianCut));
+		if (!m_save.Snapshot(m_board, progress))
+		{
+			TRACE(L"Game not saved\n");
+		}
 	}
 
-	void CreateTextFormat()
+	TileCacheKey CreateTileCacheKey() const
 	{
-		ComPtr<IDWriteFactory2> factory;
+		PhysicalLayout const layout = Layout();
+
+		TileCacheKey key;
+		key.SourceHash = m_shared.m_backgroundHash;
+		key.DpiX = m_dpiX;
+		key.DpiY = m_dpiY;
+		key.TileWidth = layout.SurfaceWidth();
+		key.TileHeight = layout.SurfaceHeight();
+		key.Rows = CardRows;
+		key.Columns = CardColumns;
+		return key;
+	}
 
-		HR(DWriteCreateFactory(
-			DWRITE_FACTORY_TYPE_SHARED,
-			__uuidof(factory),
-			reinterpret_cast<IUnknown **>(factory.GetAddressOf())
-		));
+	wstring TileCachePath() const
+	{
+		wchar_t directory[MAX_PATH + 1] = {};
+		VERIFY(GetTempPath(_countof(directory), directory));
 
-		HR(factory->CreateTextFormat(L"Candara",
-			nullptr,
-			DWRITE_FONT_WEIGHT_NORMAL,
-			DWRITE_FONT_STYLE_NORMAL,
-			DWRITE_FONT_STRETCH_NORMAL,
-			CardHeight / 2.0f,
-			L"en",
-			m_textFormat.GetAddressOf()));
+		wchar_t name[64];
+		swprintf_s(name, L"SampleBackground-%.0fx%.0f.tiles", m_dpiX, m_dpiY);
 
-		HR(m_textFormat->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_CENTER));
-		HR(m_textFormat->SetParagraphAlignment(DWRITE_PARAGRAPH_ALIGNMENT_CENTER));
+		return wstring(directory) + name;
 	}
 
-	void ShuffleCards()
+	// Maps the card back tiles for the current DPI. On a miss the tiles are
+	// written once the background is decoded, which this starts if need be.
+	void UpdateTileCache()
 	{
-		random_device device;
-		mt19937 generator(device());
-		uniform_int_distribution<short> const distribution(L'A', L'Z');
+		// Without a readable source there is nothing to key the cache on
+		if (!m_shared.m_backgroundHash)
+		{
+			if (!m_background) m_shared.StartDecoding();
+			return;
+		}
+
+		TileCacheKey const key = CreateTileCacheKey();
+
+		if (m_tiles.IsOpen() && m_tiles.m_key == key) return;
 
-		array<wchar_t, CardRows * CardColumns> values;
+		wstring const path = TileCachePath();
 
-		for (unsigned i = 0; i != CardRows * CardColumns / 2; ++i)
+		if (m_tiles.Open(path.c_str(), key))
 		{
-			wchar_t const value = distribution(generator);
-			values[i * 2 + 0] = value;
-			values[i * 2 + 1] = tolower(value);
+			TRACE(L"Background tiles mapped from %s\n", path.c_str());
+			return;
 		}
 
-		shuffle(begin(values), end(values), generator);
+		if (!m_background)
+		{
+			m_shared.StartDecoding();
+			return;
+		}
+
+		if (!m_background->IsComplete()) return;
+
+		PhysicalLayout const layout = Layout();
+		SoftwareRenderer const renderer(m_dpiX, m_dpiY, CardWidth, CardHeight, FontSize, m_background->ReadyView());
 
-		for (unsigned i = 0; i != CardRows * CardColumns; ++i)
+		bool const written = WriteTileCache(path.c_str(), key, [&](unsigned const slot, PixelView const & tile)
 		{
-			Card & card = m_cards[i];
-			card.Value = values[i];
-			card.Status = CardStatus::Hidden;
+			renderer.DrawCardBack(tile, layout.CardLeft(slot % CardColumns), layout.CardTop(slot / CardColumns));
+		});
+
+		if (written)
+		{
+			VERIFY(m_tiles.Open(path.c_str(), key));
 		}
+	}
+
+	// The game's seed is traced, so that the deal can be repeated by passing
+	// it on the command line
+	void ShuffleCards()
+	{
+		m_gameSeed = m_nextSeed;
+		m_nextSeed = NextGameSeed(m_nextSeed);
+
+		Xoshiro256 generator(m_gameSeed);
+		m_board.Deal(CardAlphabet::Latin(), generator);
+		++m_games;
+
+		m_save.Append(GameRecordKind::NewGame, m_gameSeed);
+
+		TRACE(L"Game seed %llu\n", m_gameSeed);
 
 #ifdef _DEBUG
 		for (unsigned row = 0; row != CardRows; ++row)
 		{
 			for (unsigned column = 0; column != CardColumns; ++column)
 			{
-				Card &card = m_cards[row * CardColumns + column];
+				Card const & card = m_board[row * CardColumns + column];
 				TRACE(L"%c ", card.Value);
 			}
 
@@ -238,276 +1382,379 @@ struct SampleWindow : Window<SampleWindow>
 		ASSERT(m_window);
 	}
 
-	bool IsDeviceCreated() const
+	// Whether the window's tree is on the shared devices as they are now
+	bool IsDeviceCurrent() const
 	{
-		return m_device3D;
+		return m_shared.IsDeviceCreated() && m_deviceGeneration == m_shared.m_generation;
 	}
 
+	// Drops the window's device objects, and the shared devices if they are
+	// the ones it built on. The background pixels, glyphs and layout are kept
+	// so that the next paint only has to recreate what lived on the GPU.
 	void ReleaseDeviceResources()
 	{
-		m_device3D.Reset();
+		ReleaseWindowResources();
+		m_shared.ReleaseDeviceResources(m_deviceGeneration);
 	}
 
-	void CreateDevice3D()
+	// Drops the window's own device objects only
+	void ReleaseWindowResources()
 	{
-		ASSERT(!IsDeviceCreated());
-
-		unsigned flags = D3D11_CREATE_DEVICE_BGRA_SUPPORT |
-			D3D11_CREATE_DEVICE_SINGLETHREADED;
-		#ifdef _DEBUG
-		flags |= D3D11_CREATE_DEVICE_DEBUG;
-		#endif
-
-		HR(D3D11CreateDevice(nullptr,
-			D3D_DRIVER_TYPE_HARDWARE,
-			nullptr,
-			flags,
-			nullptr, 0,
-			D3D11_SDK_VERSION,
-			m_device3D.GetAddressOf(),
-			nullptr,
-			nullptr));
+		m_dpiRedraw.reset();
+		m_pendingBacks.clear();
+		m_backDamage.Clear();
+		m_interactions.Clear();
+		m_inputTicks = 0;
+		m_renderer.reset();
+		m_pages.clear();
+		m_scene.reset();
+		m_compositor.reset();
+		m_visualsCreated = false;
 	}
 
-	ComPtr<ID2D1Device> CreateDevice2D()
+	// Called when the DPI changes before there is a visual tree to update
+	void ReleaseLayout()
 	{
-		ComPtr<IDXGIDevice3> deviceX;
-		HR(m_device3D.As(&deviceX));
+		m_atlas.reset();
+		m_visualsCreated = false;
+	}
 
-		D2D1_CREATION_PROPERTIES properties = {};
-#ifdef _DEBUG
-		properties.debugLevel = D2D1_DEBUG_LEVEL_INFORMATION;
-#endif
+	unique_ptr<CardRenderer> CreateCardRenderer()
+	{
+		if (m_shared.m_softwareRendering)
+		{
+			return make_unique<SoftwareCardRenderer>(m_background.get(), m_glyphs, m_dpiX, m_dpiY);
+		}
 
-		ComPtr<ID2D1Device> device2D;
+		return make_unique<Direct2DCardRenderer>(m_shared.m_device2D, m_font, m_glyphs, m_background.get(), m_dpiX, m_dpiY);
+	}
 
-		HR(D2D1CreateDevice(deviceX.Get(),
-			properties,
-			device2D.GetAddressOf()));
+	void DrawCardFront(CardTile const & tile,
+		wchar_t const value)
+	{
+		TraceScope const scope("DrawCardFront", value);
 
-		return device2D;
+		m_renderer->DrawCardFront(tile, value);
 	}
 
-	ComPtr<IDCompositionVisual2> CreateVisual()
+	// Uploads the back from the tile cache, or draws it and remembers it if
+	// the background behind it is not fully decoded yet
+	void DrawCardBack(unsigned const index,
+		CardTile const & tile)
 	{
-		ComPtr<IDCompositionVisual2> visual;
+		TraceScope const scope("DrawCardBack", index);
+
+		if (m_tiles.IsOpen())
+		{
+			tile.Surface->Upload(tile.Rect.Left, tile.Rect.Top, m_tiles.Tile(index));
+			return;
+		}
 
-		//HR(m_device->CreateVisual(reinterpret_cast<IDCompositionVisual**>(visual.GetAddressOf())));
-		//HR(m_device->CreateVisual((IDCompositionVisual**)visual.GetAddressOf()));
-		HR(m_device->CreateVisual(visual.GetAddressOf()));
+		Card const & card = m_board[index];
 
-		HR(visual->SetBackFaceVisibility(DCOMPOSITION_BACKFACE_VISIBILITY_HIDDEN));
+		// Checked first, as more rows may arrive while the back is drawn
+		bool const ready = tile.Rect.Height == CardBackRowsReady(m_background->RowsReady(),
+			m_background->Height(),
+			card.OffsetY,
+			m_dpiY,
+			tile.Rect.Height);
 
-		return visual;
+		m_renderer->DrawCardBack(tile, card.OffsetX, card.OffsetY);
+
+		if (!ready)
+		{
+			m_pendingBacks.push_back(PendingBack { index, tile, 0 });
+		}
 	}
 
-	template <typename T>
-	ComPtr<IDCompositionSurface> CreateSurface(T const width,
-		T const height)
+	// Rasterizes every tile of the atlas on the thread pool and uploads the
+	// pages whole. Only the render thread touches the device, so the
+	// Direct3D device stays single threaded.
+	void DrawCardsInParallel(ScenePages const & pages)
 	{
-		ComPtr<IDCompositionSurface> surface;
+		TraceScope const scope("DrawCardsInParallel", m_pool.ThreadCount());
 
-		HR(m_device->CreateSurface(
-			static_cast<unsigned>(width),
-			static_cast<unsigned>(height),
-			DXGI_FORMAT_B8G8R8A8_UNORM,
-			DXGI_ALPHA_MODE_PREMULTIPLIED,
-			surface.GetAddressOf()));
+		CardAtlas const & atlas = *m_atlas;
+		bool const cachedBacks = m_tiles.IsOpen();
 
-		return surface;
-	}
+		// One snapshot of the decoded rows for every back
+		ConstPixelView const background = cachedBacks ? ConstPixelView() : m_background->ReadyView();
+		SoftwareRenderer const renderer(m_dpiX, m_dpiY, CardWidth, CardHeight, FontSize, background, &m_glyphs);
 
-	void CreateDeviceResources()
-	{
-		ASSERT(!IsDeviceCreated());
+		DrawAtlasPages(m_board, atlas, renderer, m_pool, m_stagingPages, !cachedBacks);
 
-		CreateDevice3D();
+		for (unsigned page = 0; page != pages.size(); ++page)
+		{
+			pages[page]->Upload(0, 0, m_stagingPages[page].View());
+		}
 
-		ComPtr<ID2D1Device> const device2D = CreateDevice2D();
+		for (unsigned index = 0; index != m_board.CardCount(); ++index)
+		{
+			if (!m_scene->Contains(index)) continue;
 
-		HR(DCompositionCreateDevice2(device2D.Get(),
-			__uuidof(m_device),
-			reinterpret_cast<void **>(m_device.ReleaseAndGetAddressOf())));
+			AtlasRect const & rect = atlas.BackRect(index);
+
+			if (cachedBacks)
+			{
+				pages[rect.Page]->Upload(rect.Left, rect.Top, m_tiles.Tile(index));
+			}
+			else if (rect.Height > CardBackRowsReady(background.Height, m_background->Height(), m_board[index].OffsetY, m_dpiY, rect.Height))
+			{
+				m_pendingBacks.push_back(PendingBack { index, CardTile(pages[rect.Page], rect), 0 });
+			}
+		}
+	}
+
+	PhysicalLayout Layout() const
+	{
+		return PhysicalLayout(Geometry, m_dpiX, m_dpiY);
+	}
 
-		HR(m_device->CreateTargetForHwnd(m_window,
-			true,
-			m_target.ReleaseAndGetAddressOf()));
+	// Hands the board as it is now to the message thread
+	void PublishSnapshot()
+	{
+		BoardSnapshot & snapshot = m_snapshots.BeginWrite();
+		snapshot.Cards = m_board;
+		snapshot.DpiX = m_dpiX;
+		snapshot.DpiY = m_dpiY;
+		snapshot.Games = m_games;
+		m_snapshots.Publish();
+	}
 
-		ComPtr<IDCompositionVisual2> rootVisual = CreateVisual();
+	// Recreates whatever was invalidated: the device after device loss, the
+	// layout after a DPI change, and in either case the visual tree.
+	void RebuildDeviceResources()
+	{
+		Stopwatch const stopwatch;
 
-		HR(m_target->SetRoot(rootVisual.Get()));
+		if (!m_shared.IsDeviceCreated())
+		{
+			m_shared.CreateDeviceResources();
+		}
 
-		ComPtr<ID2D1DeviceContext> dc;
+		m_deviceGeneration = m_shared.m_generation;
 
-		HR(device2D->CreateDeviceContext(D2D1_DEVICE_CONTEXT_OPTIONS_NONE,
-			dc.GetAddressOf()));
+		if (!m_atlas)
+		{
+			CreateLayout();
+		}
 
-		D2D1_COLOR_F const color = ColorF(0.0f, 0.0f, 0.0f);
+		CreateVisualTree();
 
-		ComPtr<ID2D1SolidColorBrush> brush;
+		m_rebuilds.Record(stopwatch.ElapsedSeconds());
 
-		HR(dc->CreateSolidColorBrush(color, brush.GetAddressOf()));
+		TRACE(L"Rebuilt device resources in %.2f ms (%u rebuilds, mean %.2f ms, max %.2f ms)\n",
+			m_rebuilds.Last * 1000.0,
+			m_rebuilds.Count,
+			m_rebuilds.Mean() * 1000.0,
+			m_rebuilds.Max * 1000.0);
 
-		ComPtr<ID2D1Bitmap1> bitmap;
+		// The title belongs to the message thread
+		PostMessage(m_window, WM_REBUILT, static_cast<WPARAM>(m_rebuilds.Last * 1e6), 0);
+	}
 
-		HR(dc->CreateBitmapFromWicBitmap(m_image.Get(), bitmap.GetAddressOf()));
+	void CreateLayout()
+	{
+		PhysicalLayout const layout = Layout();
 
-		float const width = LogicalToPhysical(CardWidth, m_dpiX);
-		float const height = LogicalToPhysical(CardHeight, m_dpiY);
+		m_board.Arrange(SampleLayout(), m_dpiX, m_dpiY);
 
-		for (unsigned row = 0; row != CardRows; ++row)
-			for (unsigned column = 0; column != CardColumns; ++column)
-			{
-				Card & card = m_cards[row * CardColumns + column];
+		m_atlas = make_unique<CardAtlas>(m_board, layout.SurfaceWidth(), layout.SurfaceHeight());
 
-				card.OffsetX = LogicalToPhysical(column * (CardWidth + CardMargin) + CardMargin, m_dpiX);
-				card.OffsetY = LogicalToPhysical(row * (CardHeight + CardMargin) + CardMargin, m_dpiY);
+		UpdateTileCache();
 
-				if (card.Status == CardStatus::Matched) continue;
+		TRACE(L"Atlas %u pages %.1f%% occupied, %lld bytes saved\n",
+			m_atlas->m_atlas.PageCount(),
+			m_atlas->m_atlas.Occupancy() * 100.0,
+			m_atlas->SavedBytes());
+	}
 
-				ComPtr<IDCompositionVisual2> frontVisual = CreateVisual();
-				HR(frontVisual->SetOffsetX(card.OffsetX));
-				HR(frontVisual->SetOffsetY(card.OffsetY));
+	void CreateVisualTree()
+	{
+		ASSERT(IsDeviceCurrent() && m_atlas);
 
-				HR(rootVisual->AddVisual(frontVisual.Get(), false, nullptr));
+		m_pages.clear();
+		m_scene.reset();
+		m_compositor = make_unique<DirectCompositionCompositor>(m_shared.m_device, m_window);
+		m_scene = make_unique<BoardScene>(*m_compositor, m_board.CardCount(), m_shared.m_resources.FaceTransforms);
 
-				ComPtr<IDCompositionVisual2> backVisual = CreateVisual();
-				HR(backVisual->SetOffsetX(card.OffsetX));
-				HR(backVisual->SetOffsetY(card.OffsetY));
+		m_renderer = CreateCardRenderer();
 
-				HR(rootVisual->AddVisual(backVisual.Get(), false, nullptr));
+		BuildScene();
 
-				ComPtr<IDCompositionSurface> frontSurface = CreateSurface(width, height);
+		m_visualsCreated = true;
+	}
 
-				HR(frontVisual->SetContent(frontSurface.Get()));
+	// Puts every card in play on pages from the scene's pool and draws the
+	// tiles. Cards and pages of an earlier game go back to the pool first,
+	// so after the first game this only redraws.
+	void BuildScene()
+	{
+		m_pendingBacks.clear();
 
-				DrawCardFront(frontSurface, card.Value, brush);
+		m_scene->Clear();
+		m_scene->ReleasePages(m_pages);
 
-				ComPtr<IDCompositionSurface> backSurface = CreateSurface(width, height);
+		CardAtlas const & atlas = *m_atlas;
 
-				HR(backVisual->SetContent(backSurface.Get()));
+		m_pages = m_scene->CreatePages(atlas);
 
-				DrawCardBack(backSurface, card.OffsetX, card.OffsetY, bitmap);
+		m_scene->Build(m_board, atlas, m_pages, Layout());
 
-				HR(m_device->CreateRotateTransform3D(card.Rotation.ReleaseAndGetAddressOf()));
+		if (m_shared.m_softwareRendering)
+		{
+			DrawCardsInParallel(m_pages);
+		}
+		else
+		{
+			for (CardAtlas::Front const & front : atlas.m_uniqueFronts)
+			{
+				DrawCardFront(CardTile(m_pages[front.Rect.Page], front.Rect), front.Value);
+			}
 
-				if (card.Status == CardStatus::Selected)
-				{
-					HR(card.Rotation->SetAngle(180.0f));
-				}
+			for (unsigned index = 0; index != m_board.CardCount(); ++index)
+			{
+				if (!m_scene->Contains(index)) continue;
 
-				HR(card.Rotation->SetAxisZ(0.0f));
-				HR(card.Rotation->SetAxisY(1.0f));
+				AtlasRect const & backRect = atlas.BackRect(index);
 
-				CreateEffect(frontVisual, card.Rotation, true);
-				CreateEffect(backVisual, card.Rotation, false);
+				DrawCardBack(index, CardTile(m_pages[backRect.Page], backRect));
 			}
+		}
 
-		HR(m_device->Commit());
+		m_compositor->Commit();
 	}
 
-	void CreateEffect(ComPtr<IDCompositionVisual2> const & visual,
-		ComPtr<IDCompositionRotateTransform3D> const & rotation,
-		bool const front)
+	// Deals again. With a visual tree the scene is rebuilt at once from its
+	// pool; without one the next paint builds it.
+	void NewGame()
 	{
-		float const width = LogicalToPhysical(CardWidth, m_dpiX);
-		float const height = LogicalToPhysical(CardHeight, m_dpiY);
+		Stopwatch const stopwatch;
+
+		ShuffleCards();
 
-		ComPtr<IDCompositionMatrixTransform3D> pre;
-		HR(m_device->CreateMatrixTransform3D(pre.GetAddressOf()));
+		for (unsigned index = 0; index != m_board.CardCount(); ++index)
+		{
+			m_animator.Reset(index, 0.0);
+		}
 
-		D2D1_MATRIX_4X4_F preMatrix = Matrix4x4F::Translation(-width / 2.0f, -height / 2.0f, 0.0f) *
-			Matrix4x4F::RotationY(front ? 180.0f : 0.0f);
+		m_interactions.Clear();
+		m_inputTicks = 0;
 
-		HR(pre->SetMatrix(reinterpret_cast<D3DMATRIX const &>(preMatrix)));
+		if (!m_visualsCreated)
+		{
+			ReleaseLayout();
+			return;
+		}
 
-		ComPtr<IDCompositionMatrixTransform3D> post;
-		HR(m_device->CreateMatrixTransform3D(post.GetAddressOf()));
+		// The cards still on the old pages are about to be rebuilt anyway
+		if (m_dpiRedraw)
+		{
+			m_scene->DiscardPages(m_pages);
+			m_pages = move(m_dpiRedraw->Pages);
+			m_dpiRedraw.reset();
+		}
 
-		D2D1_MATRIX_4X4_F postMartix =
-			Matrix4x4F::PerspectiveProjection(width * 2.0f) *
-			Matrix4x4F::Translation(width / 2.0f, height / 2.0f, 0.0f);
+		CreateLayout();
+		BuildScene();
 
-		HR(post->SetMatrix(reinterpret_cast<D3DMATRIX const &>(postMartix)));
+		m_newGames.Record(stopwatch.ElapsedSeconds());
 
-		IDCompositionTransform3D * transforms[] =
-		{
-			pre.Get(),
-			rotation.Get(),
-			post.Get()
-		};
+		PoolCounters const & cards = m_scene->m_pool.m_cardCounters;
+		PoolCounters const & pages = m_scene->m_pool.m_pageCounters;
 
-		ComPtr<IDCompositionTransform3D> transform;
+		TRACE(L"New game in %.2f ms (cards %.0f%% pooled, pages %.0f%% pooled, peak %u pages %.1f MB)\n",
+			m_newGames.Last * 1000.0,
+			cards.HitRate() * 100.0,
+			pages.HitRate() * 100.0,
+			pages.PeakResident,
+			pages.PeakResidentBytes / 1048576.0);
+	}
 
-		HR(m_device->CreateTransform3DGroup(transforms,
-			_countof(transforms),
-			transform.GetAddressOf()));
+	// Matched cards that have finished turning away leave the tree for the
+	// scene's pool
+	void ReleaseMatchedCards()
+	{
+		m_animator.Update(m_compositor->NextFrameTime());
 
-		HR(visual->SetEffect(transform.Get()));
+		if (m_scene->ReleaseMatched(m_board, m_animator))
+		{
+			m_interactions.Invalidate();
+		}
 	}
 
-	void DrawCardBack(ComPtr<IDCompositionSurface> const & surface,
-		float const offsetX,
-		float const offsetY,
-		ComPtr<ID2D1Bitmap1> const & bitmap)
+	// Lays the board out at the new DPI and queues every card for redrawing.
+	// The visual tree and the rotation transforms are kept; each card moves
+	// to its new tiles once they have been drawn.
+	void BeginDpiRedraw()
 	{
-		ComPtr<ID2D1DeviceContext> dc;
-		POINT offset = {};
+		ASSERT(m_visualsCreated);
 
-		HR(surface->BeginDraw(nullptr,
-			__uuidof(dc),
-			reinterpret_cast<void **>(dc.GetAddressOf()),
-			&offset));
+		CreateLayout();
 
-		dc->SetDpi(m_dpiX, m_dpiY);
+		m_renderer = CreateCardRenderer();
+		m_pendingBacks.clear();
 
-		dc->SetTransform(Matrix3x2F::Translation(
-			PhysicalToLogical(offset.x, m_dpiX),
-			PhysicalToLogical(offset.y, m_dpiY)));
+		m_dpiRedraw = make_unique<DpiRedraw>();
+		m_dpiRedraw->Pages = m_scene->CreatePages(*m_atlas);
+		m_dpiRedraw->FrontDrawn.assign(m_atlas->m_uniqueFronts.size(), false);
+	}
 
-		D2D1_RECT_F source = RectF(
-			PhysicalToLogical(offset.x, m_dpiX),
-			PhysicalToLogical(offset.y, m_dpiY));
+	// Redraws up to DpiRedrawCardsPerFrame cards for the next commit, so that
+	// a DPI change on a large board is spread over several frames.
+	void ContinueDpiRedraw()
+	{
+		DpiRedraw & redraw = *m_dpiRedraw;
+		CardAtlas const & atlas = *m_atlas;
 
-		source.right = source.left + CardWidth;
-		source.bottom = source.top + CardHeight;
+		// Let the previous batch reach the compositor first
+		if (redraw.NextCard != 0)
+		{
+			m_compositor->WaitForCommitCompletion();
+		}
 
-		dc->DrawBitmap(bitmap.Get(),
-			nullptr,
-			1.0f,
-			D2D1_INTERPOLATION_MODE_LINEAR,
-			&source);
+		for (unsigned drawn = 0; redraw.NextCard != m_board.CardCount() && drawn != DpiRedrawCardsPerFrame; ++redraw.NextCard)
+		{
+			unsigned const index = redraw.NextCard;
+			Card const & card = m_board[index];
+
+			if (!m_scene->Contains(index)) continue;
+
+			// Matched before the new layout was made, so already turned away
+			if (!atlas.Contains(index))
+			{
+				m_scene->RemoveCard(index);
+				continue;
+			}
 
-		HR(surface->EndDraw());
+			unsigned const front = atlas.m_fronts[index];
 
-	}
+			if (!redraw.FrontDrawn[front])
+			{
+				CardAtlas::Front const & unique = atlas.m_uniqueFronts[front];
 
-	void DrawCardFront(ComPtr<IDCompositionSurface> const & surface,
-		wchar_t const value,
-		ComPtr<ID2D1SolidColorBrush> const & brush)
-	{
-		ComPtr<ID2D1DeviceContext> dc;
-		POINT offset = {};
+				DrawCardFront(CardTile(redraw.Pages[unique.Rect.Page], unique.Rect), unique.Value);
+				redraw.FrontDrawn[front] = true;
+			}
 
-		HR(surface->BeginDraw(nullptr,
-			__uuidof(dc),
-			reinterpret_cast<void **>(dc.GetAddressOf()),
-			&offset));
+			AtlasRect const & backRect = atlas.BackRect(index);
 
-		dc->SetDpi(m_dpiX, m_dpiY);
+			DrawCardBack(index, CardTile(redraw.Pages[backRect.Page], backRect));
 
-		dc->SetTransform(Matrix3x2F::Translation(PhysicalToLogical(offset.x, m_dpiX),
-			PhysicalToLogical(offset.y, m_dpiY)));
+			m_scene->SetCardLayout(index, card, atlas, redraw.Pages, Layout());
 
-		dc->Clear(ColorF(1.0f, 1.0f, 1.0f));
+			++drawn;
+		}
 
-		dc->DrawText(&value,
-			1,
-			m_textFormat.Get(),
-			RectF(0.0f, 0.0f, CardWidth, CardHeight),
-			brush.Get());
+		m_interactions.Invalidate();
 
-		HR(surface->EndDraw());
+		// The old pages are the old size, so no later game could use them
+		if (redraw.NextCard == m_board.CardCount())
+		{
+			m_scene->DiscardPages(m_pages);
+			m_pages = move(redraw.Pages);
+			m_dpiRedraw.reset();
+		}
 	}
 
 	LRESULT MessageHandler(UINT const message,
@@ -518,10 +1765,22 @@ struct SampleWindow : Window<SampleWindow>
 		{
 			LeftButtonUpHandler(lparam);
 		}
+		else if (WM_KEYDOWN == message && VK_F2 == wparam)
+		{
+			NewGameHandler();
+		}
 		else if (WM_PAINT == message)
 		{
 			PaintHandler();
 		}
+		else if (WM_BACKGROUND_PROGRESS == message)
+		{
+			Post(RenderCommandKind::Background);
+		}
+		else if (WM_REBUILT == message)
+		{
+			RebuiltHandler(wparam);
+		}
 		else if (WM_DPICHANGED == message)
 		{
 			DpiChangedHandler(wparam, lparam);
@@ -534,6 +1793,16 @@ struct SampleWindow : Window<SampleWindow>
 		{
 			// Prevent window resizing due to device lost
 		}
+		else if (WM_DESTROY == message)
+		{
+			Post(RenderCommandKind::Close);
+
+			// The session ends with the last window
+			if (0 == m_shared.RemoveWindow(m_window))
+			{
+				PostQuitMessage(0);
+			}
+		}
 		else
 		{
 			return __super::MessageHandler(message, wparam, lparam);
@@ -542,260 +1811,450 @@ struct SampleWindow : Window<SampleWindow>
 		return 0;
 	}
 
-	Card * CardAtPoint(LPARAM const lparam)
+	void Post(RenderCommandKind const kind,
+		float const x = 0.0f,
+		float const y = 0.0f)
 	{
-		float const x = static_cast<float>(LOWORD(lparam));
-		float const y = static_cast<float>(HIWORD(lparam));
+		m_shared.m_renderThread.Post(kind, m_client, x, y);
+	}
+
+	void RecordInput(InputKind const kind,
+		float const x = 0.0f,
+		float const y = 0.0f)
+	{
+		m_inputLog.Record(InputMicroseconds(m_inputClock.ElapsedSeconds()), kind, x, y);
+	}
 
-		float const width = LogicalToPhysical(CardWidth, m_dpiX);
-		float const height = LogicalToPhysical(CardHeight, m_dpiY);
+	// Clicks are hit tested and queued on the render thread and applied by
+	// its next frame, together with any other input that arrives before it.
+	// Until the board has been shown there is nothing to click.
+	void LeftButtonUpHandler(LPARAM const lparam)
+	{
+		TraceScope const scope("LeftButtonUpHandler");
 
-		for (Card &card : m_cards)
 		{
-			if (x > card.OffsetX &&
-				y > card.OffsetY &&
-				x < (card.OffsetX + width) &&
-				y < (card.OffsetY + height))
-			{
-				return &card;
-			}
+			SnapshotReader<BoardSnapshot> const snapshot(m_snapshots);
+
+			if (snapshot->Games == 0) return;
 		}
 
-		return nullptr;
+		float const x = static_cast<float>(LOWORD(lparam));
+		float const y = static_cast<float>(HIWORD(lparam));
+
+		RecordInput(InputKind::Click, x, y);
+
+		Post(RenderCommandKind::Click, x, y);
 	}
 
-	bool IsMatch(wchar_t const first, wchar_t const second)
+	void NewGameHandler()
 	{
-		int const expected = 'a' - 'A';
-
-		int const actual = abs(first - second);
+		RecordInput(InputKind::NewGame);
 
-		return expected == actual;
+		Post(RenderCommandKind::NewGame);
 	}
 
-	ComPtr<IUIAnimationTransition2> CreateTransition(double const duration,
-		double const finalValue)
+	void DpiChangedHandler(WPARAM const wparam, LPARAM const lparam)
 	{
-		ComPtr<IUIAnimationTransition2> transition;
+		m_windowDpiX = LOWORD(wparam);
+		m_windowDpiY = HIWORD(wparam);
+
+		RecordInput(InputKind::Dpi, m_windowDpiX, m_windowDpiY);
 
-		HR(m_library->CreateAccelerateDecelerateTransition(duration,
-			finalValue,
-			0.2, 0.8,
-			transition.GetAddressOf()));
+		RECT const * suggested = reinterpret_cast<RECT const*>(lparam);
+
+		D2D1_SIZE_U const size = GetEffectiveWindowSize();
+
+		VERIFY(SetWindowPos(m_window,
+			nullptr,
+			suggested->left,
+			suggested->top,
+			size.width,
+			size.height,
+			SWP_NOACTIVATE | SWP_NOZORDER));
 
-		return transition;
+		Post(RenderCommandKind::Dpi, m_windowDpiX, m_windowDpiY);
 	}
 
-	UI_ANIMATION_KEYFRAME AddShowTransition(Card const &card,
-		ComPtr<IUIAnimationStoryboard2> const & storyboard)
+	void RebuiltHandler(WPARAM const microseconds)
 	{
-		double angle = 0.0;
-		HR(card.Variable->GetValue(&angle));
+		wchar_t title[64];
+		swprintf_s(title, L"Sample Window (rebuilt in %.1f ms)", microseconds / 1000.0);
+		VERIFY(SetWindowText(m_window, title));
+	}
 
-		double const duration = (180.0 - angle) / 180.0;
+	// The window has no redirection surface to paint, so the paint is only
+	// a sign that the window needs its tree, which the render thread checks
+	void PaintHandler()
+	{
+		VERIFY(ValidateRect(m_window, nullptr));
 
-		ComPtr<IUIAnimationTransition2> transition = CreateTransition(duration, 180.0);
+		Post(RenderCommandKind::Paint);
+	}
 
-		HR(storyboard->AddTransition(card.Variable.Get(), transition.Get()));
+	D2D1_SIZE_U GetEffectiveWindowSize()
+	{
+		PhysicalLayout const layout(Geometry, m_windowDpiX, m_windowDpiY);
 
-		UI_ANIMATION_KEYFRAME keyframe = nullptr;
+		RECT rect =
+		{
+			0,
+			0,
+			static_cast<LONG>(layout.ClientWidth()),
+			static_cast<LONG>(layout.ClientHeight())
+		};
 
-		HR(storyboard->AddKeyframeAfterTransition(
-			transition.Get(),
-			&keyframe));
+		VERIFY(AdjustWindowRect(&rect,
+			GetWindowLong(m_window, GWL_STYLE),
+			false));
 
-		return keyframe;
+		return SizeU(rect.right - rect.left,
+			rect.bottom - rect.top);
 	}
 
-	void AddHideTransition(Card const &card,
-		ComPtr<IUIAnimationStoryboard2> const & storyboard,
-		UI_ANIMATION_KEYFRAME keyframe,
-		double const finalValue)
+	// Before the render thread starts, so the window's DPI is the board's
+	void CreateHandler()
 	{
-		ComPtr<IUIAnimationTransition2> transition = CreateTransition(1.0, finalValue);
-		HR(storyboard->AddTransitionAtKeyframe(
-			card.Variable.Get(),
-			transition.Get(),
-			keyframe));
-	}
+		HMONITOR const monitor = MonitorFromWindow(m_window,
+			MONITOR_DEFAULTTONEAREST);
 
-	void UpdateAnimation(Card const &card)
-	{
-		ComPtr<IDCompositionAnimation> animation;
-		HR(m_device->CreateAnimation(animation.GetAddressOf()));
-		HR(card.Variable->GetCurve(animation.Get()));
-		HR(card.Rotation->SetAngle(animation.Get()));
+		unsigned dpiX = 0;
+		unsigned dpiY = 0;
+
+		HR(GetDpiForMonitor(monitor, MDT_EFFECTIVE_DPI, &dpiX, &dpiY));
+
+		m_dpiX = m_windowDpiX = static_cast<float>(dpiX);
+		m_dpiY = m_windowDpiY = static_cast<float>(dpiY);
+
+		D2D1_SIZE_U const size = GetEffectiveWindowSize();
+
+		VERIFY(SetWindowPos(m_window,
+			nullptr,
+			0, 0,
+			size.width,
+			size.height,
+			SWP_NOACTIVATE | SWP_NOMOVE | SWP_NOZORDER));
 	}
 
-	void LeftButtonUpHandler(LPARAM const lparam)
+	// The render client, on the render thread from here on. A command that
+	// fails releases the device resources and has the window repainted to
+	// rebuild them.
+	bool Apply(RenderCommand const & command) override
 	{
+		if (m_closed) return false;
+
 		try
 		{
-			Card *nextCard = CardAtPoint(lparam);
+			switch (command.Kind)
+			{
+			case RenderCommandKind::Click:
+				return ClickCommand(command.X, command.Y);
+
+			case RenderCommandKind::NewGame:
+				NewGameCommand();
+				return true;
+
+			case RenderCommandKind::Dpi:
+				DpiCommand(command.X, command.Y);
+				return true;
+
+			case RenderCommandKind::Paint:
+				return PaintCommand();
 
-			if (!nextCard) return;
+			case RenderCommandKind::Background:
+				return BackgroundCommand();
 
-			if (nextCard == m_firstCard) return;
+			case RenderCommandKind::Close:
+				SaveGame();
+				ReleaseWindowResources();
+				m_closed = true;
+				return false;
+			}
+		}
+		catch (ComException const & e)
+		{
+			TRACE(L"Render command %u failed 0x%X\n", static_cast<unsigned>(command.Kind), e.result);
 
-			if (nextCard->Status == CardStatus::Matched) return;
+			ReleaseDeviceResources();
 
-			DCOMPOSITION_FRAME_STATISTICS stats = {};
-			HR(m_device->GetFrameStatistics(&stats));
+			VERIFY(InvalidateRect(m_window, nullptr, false));
+		}
 
-			double const next = static_cast<double>(stats.nextEstimatedFrameTime.QuadPart) / stats.timeFrequency.QuadPart;
+		return false;
+	}
 
-			HR(m_manager->Update(next));
+	// A redraw spread over frames comes back for its next batch
+	bool FramePending() override
+	{
+		return !m_closed && m_visualsCreated && (m_dpiRedraw || !m_interactions.Empty());
+	}
 
-			ComPtr<IUIAnimationStoryboard2> storyboard;
-			HR(m_manager->CreateStoryboard(storyboard.GetAddressOf()));
+	// One commit for the input and redraws since the last frame
+	bool Frame() override
+	{
+		if (m_closed || !m_visualsCreated) return false;
 
-			if (!m_firstCard)
+		try
+		{
+			if (m_dpiRedraw)
 			{
-				m_firstCard = nextCard;
-				nextCard->Status = CardStatus::Selected;
-
-				AddShowTransition(*nextCard, storyboard);
-				HR(storyboard->Schedule(next));
-				UpdateAnimation(*nextCard);
+				ContinueDpiRedraw();
 			}
-			else
-			{
-				m_firstCard->Status = CardStatus::Hidden;
 
-				if (IsMatch(m_firstCard->Value, nextCard->Value))
-				{
-					m_firstCard->Status = nextCard->Status = CardStatus::Matched;
+			ReleaseMatchedCards();
 
-					UI_ANIMATION_KEYFRAME keyframe = AddShowTransition(*nextCard, storyboard);
+			// The board selects as the queue does, skipping the same clicks
+			for (unsigned const card : m_interactions.m_clicks)
+			{
+				m_save.Append(GameRecordKind::Select, card);
+			}
 
-					AddHideTransition(*m_firstCard, storyboard, keyframe, 90.0);
+			bool const committed = m_interactions.Flush(m_board, m_animator, *m_scene);
 
-					AddHideTransition(*nextCard, storyboard, keyframe, 90.0);
-				}
-				else
-				{
-					UI_ANIMATION_KEYFRAME keyframe = AddShowTransition(*nextCard, storyboard);
+			if (m_save.NeedsSnapshot())
+			{
+				SaveGame();
+			}
 
-					AddHideTransition(*m_firstCard, storyboard, keyframe, 0.0);
+			// From the first click of the frame to the frame showing it
+			if (m_inputTicks)
+			{
+				uint64_t const present = m_compositor->NextPresentTicks();
 
-					AddHideTransition(*nextCard, storyboard, keyframe, 0.0);
-				}
+				GlobalTracer().Record("InputToPresent",
+					m_inputTicks,
+					present > m_inputTicks ? present - m_inputTicks : 0);
 
-				HR(storyboard->Schedule(next));
-				UpdateAnimation(*m_firstCard);
-				UpdateAnimation(*nextCard);
+				m_inputTicks = 0;
+			}
 
-				m_firstCard = nullptr;
+			if (committed)
+			{
+				PublishSnapshot();
 			}
 
-			HR(m_device->Commit());
+			return committed;
 		}
-		catch (ComException const &e)
+		catch (ComException const & e)
 		{
-			TRACE(L"LeftButtonUpHandler failed 0x%X\n", e.result);
+			TRACE(L"Frame failed 0x%X\n", e.result);
 
 			ReleaseDeviceResources();
 
 			VERIFY(InvalidateRect(m_window, nullptr, false));
 		}
+
+		return false;
 	}
 
-	void DpiChangedHandler(WPARAM const wparam, LPARAM const lparam)
+	double SecondsToNextFrame() override
 	{
-		m_dpiX = LOWORD(wparam);
-		m_dpiY = HIWORD(wparam);
+		if (!m_compositor) return 0.0;
 
-		RECT const * suggested = reinterpret_cast<RECT const*>(lparam);
+		try
+		{
+			return m_compositor->SecondsToNextFrame();
+		}
+		catch (ComException const &)
+		{
+			return 0.0;
+		}
+	}
 
-		D2D1_SIZE_U const size = GetEffectiveWindowSize();
+	bool ClickCommand(float const x,
+		float const y)
+	{
+		if (!m_visualsCreated) return false;
 
-		VERIFY(SetWindowPos(m_window,
-			nullptr,
-			suggested->left,
-			suggested->top,
-			size.width,
-			size.height,
-			SWP_NOACTIVATE | SWP_NOZORDER));
+		unsigned const card = m_board.CardAtPoint(SampleLayout(), x, y, m_dpiX, m_dpiY);
+
+		if (!m_board.CanSelect(card)) return false;
+
+		if (!m_inputTicks)
+		{
+			m_inputTicks = TraceClock::Now();
+		}
 
-		ReleaseDeviceResources();
+		m_interactions.Click(card);
+		return true;
 	}
 
-	D2D1_SIZE_U GetEffectiveWindowSize()
+	void NewGameCommand()
 	{
-		RECT rect =
-		{
-			0,
-			0,
-			static_cast<unsigned>(LogicalToPhysical(WindowWidth, m_dpiX)),
-			static_cast<unsigned>(LogicalToPhysical(WindowHeight, m_dpiY))
-		};
+		TraceScope const scope("NewGameCommand");
 
-		VERIFY(AdjustWindowRect(&rect,
-			GetWindowLong(m_window, GWL_STYLE),
-			false));
+		NewGame();
 
-		return SizeU(rect.right - rect.left,
-			rect.bottom - rect.top);
+		if (m_visualsCreated)
+		{
+			PublishSnapshot();
+		}
 	}
 
-	void CreateHandler()
+	void DpiCommand(float const dpiX,
+		float const dpiY)
 	{
-		HMONITOR const monitor = MonitorFromWindow(m_window,
-			MONITOR_DEFAULTTONEAREST);
+		m_dpiX = dpiX;
+		m_dpiY = dpiY;
 
-		unsigned dpiX = 0;
-		unsigned dpiY = 0;
+		if (m_visualsCreated)
+		{
+			BeginDpiRedraw();
+			PublishSnapshot();
+		}
+		else
+		{
+			ReleaseLayout();
+		}
+	}
 
-		HR(GetDpiForMonitor(monitor, MDT_EFFECTIVE_DPI, &dpiX, &dpiY));
+	// Rebuilds whatever device loss or a DPI change left to rebuild. Returns
+	// false if there was nothing to do.
+	bool PaintCommand()
+	{
+		// Another window may have recreated the devices since this one
+		// built on them
+		if (m_visualsCreated && !IsDeviceCurrent())
+		{
+			ReleaseWindowResources();
+		}
 
-		m_dpiX = static_cast<float>(dpiX);
-		m_dpiY = static_cast<float>(dpiY);
+		if (m_shared.IsDeviceCreated())
+		{
+			HR(m_shared.m_device3D->GetDeviceRemovedReason());
+		}
 
-		D2D1_SIZE_U const size = GetEffectiveWindowSize();
+		if (m_visualsCreated) return false;
 
-		VERIFY(SetWindowPos(m_window,
-			nullptr,
-			0, 0,
-			size.width,
-			size.height,
-			SWP_NOACTIVATE | SWP_NOMOVE | SWP_NOZORDER));
+		RebuildDeviceResources();
+		PublishSnapshot();
+		return true;
 	}
 
-	void PaintHandler()
+	// Redraws the rows of card backs whose part of the background has been
+	// decoded since they were drawn, each as its own update rectangle rather
+	// than the whole back. Returns true if there are any to commit.
+	bool BackgroundCommand()
 	{
-		try
+		if (m_background->Failed())
 		{
-			RECT rect = {};
-			VERIFY(GetClientRect(m_window, &rect));
+			TRACE(L"Background decoding failed after %u rows\n", m_background->RowsReady());
+		}
 
-			TRACE(L"Paint %d %d (%.2f %.2f)\n",
-				rect.right,
-				rect.bottom,
-				PhysicalToLogical(rect.right, m_dpiX),
-				PhysicalToLogical(rect.bottom, m_dpiY));
+		if (m_background->IsComplete())
+		{
+			UpdateTileCache();
+		}
 
-			if (IsDeviceCreated())
-			{
-				HR(m_device3D->GetDeviceRemovedReason());
+		if (!m_visualsCreated || m_pendingBacks.empty()) return false;
 
-			}
-			else
-			{
-				CreateDeviceResources();
-			}
+		unsigned const rowsReady = m_background->RowsReady();
+
+		for (unsigned slot = 0; slot != m_pendingBacks.size(); ++slot)
+		{
+			PendingBack & back = m_pendingBacks[slot];
+			AtlasRect const & rect = back.Tile.Rect;
+
+			unsigned const rows = CardBackRowsReady(rowsReady,
+				m_background->Height(),
+				m_board[back.Card].OffsetY,
+				m_dpiY,
+				rect.Height);
 
-			VERIFY(ValidateRect(m_window, nullptr));
+			if (rows <= back.Rows) continue;
+
+			m_backDamage.Add(slot, rect.Width, rect.Height, DirtyRect(0, back.Rows, rect.Width, rows));
 		}
-		catch (ComException const & e)
+
+		if (m_backDamage.Empty()) return false;
+
 		{
-			TRACE(L"PaintHandler failed 0x%X\n", e.result);
+			TraceScope const scope("DrawBackRows", m_backDamage.m_surfaces.size());
 
-			ReleaseDeviceResources();
+			// Rows count as drawn only once they are, so that rows a failed
+			// draw left out are drawn again
+			m_backDamage.Flush([&](unsigned const slot, DirtyRect const & part)
+			{
+				PendingBack & back = m_pendingBacks[slot];
+				Card const & card = m_board[back.Card];
+
+				m_renderer->DrawCardBack(back.Tile, card.OffsetX, card.OffsetY, part);
+
+				back.Rows = max(back.Rows, part.Bottom);
+			});
 		}
+
+		m_pendingBacks.erase(remove_if(m_pendingBacks.begin(), m_pendingBacks.end(), [](PendingBack const & back)
+		{
+			return back.Rows == back.Tile.Rect.Height;
+		}), m_pendingBacks.end());
+
+		m_interactions.Invalidate();
+		return true;
 	}
 
 };
 
+// Writes the trace to the temp folder, as Chrome trace JSON and in the
+// binary form
+static void SaveTrace()
+{
+	wchar_t directory[MAX_PATH + 1] = {};
+	VERIFY(GetTempPath(_countof(directory), directory));
+
+	TraceSnapshot const snapshot = GlobalTracer().Collect();
+	string const json = ExportChromeTrace(snapshot);
+	vector<uint8_t> const binary = ExportBinaryTrace(snapshot);
+
+	wstring const paths[] =
+	{
+		wstring(directory) + L"SampleTrace.json",
+		wstring(directory) + L"SampleTrace.trace",
+	};
+
+	void const * const data[] = { json.data(), binary.data() };
+	size_t const sizes[] = { json.size(), binary.size() };
+
+	for (unsigned i = 0; i != _countof(paths); ++i)
+	{
+		FILE * file = OpenFile(paths[i].c_str(), true);
+
+		if (!file) continue;
+
+		bool const written = sizes[i] == fwrite(data[i], 1, sizes[i], file);
+
+		if (0 != fclose(file) || !written)
+		{
+			RemoveFile(paths[i].c_str());
+			continue;
+		}
+
+		TRACE(L"Trace written to %s\n", paths[i].c_str());
+	}
+}
+
+// Writes a window's input to the temp folder, for InputReplayBenchmark. The
+// first window's is SampleInput.log and the others' are numbered.
+static void SaveInput(InputLog const & log,
+	unsigned const window)
+{
+	wchar_t directory[MAX_PATH + 1] = {};
+	VERIFY(GetTempPath(_countof(directory), directory));
+
+	wstring path = wstring(directory) + L"SampleInput";
+
+	if (window != 0)
+	{
+		path += L"-" + to_wstring(window);
+	}
+
+	path += L".log";
+
+	if (WriteInputLog(path.c_str(), log))
+	{
+		TRACE(L"Input written to %s (%u events)\n", path.c_str(), static_cast<unsigned>(log.Events.size()));
+	}
+}
+
 int __stdcall wWinMain(HINSTANCE, 
                        HINSTANCE, 
                        PWSTR, 
@@ -803,11 +2262,84 @@ int __stdcall wWinMain(HINSTANCE,
 {
 	HR(CoInitializeEx(nullptr, COINITBASE_MULTITHREADED));
 
-	SampleWindow window;
+	// The background image, the first game's seed and the number of windows
+	// can be given on the command line. Each window deals from its own seed,
+	// and all of them share the devices, background and glyphs.
+	int argumentCount = 0;
+	LPWSTR * arguments = CommandLineToArgvW(GetCommandLineW(), &argumentCount);
+
+	uint64_t seed = 0;
+
+	if (arguments && argumentCount > 2)
+	{
+		seed = wcstoull(arguments[2], nullptr, 10);
+	}
+	else
+	{
+		random_device device;
+		seed = static_cast<uint64_t>(device()) << 32 | device();
+	}
+
+	// Without a seed the windows carry on their saved games
+	bool const restore = !arguments || argumentCount <= 2;
+
+	unsigned windowCount = 1;
+
+	if (arguments && argumentCount > 3)
+	{
+		windowCount = max(1u, static_cast<unsigned>(wcstoul(arguments[3], nullptr, 10)));
+	}
+
+	GlobalTracer().NameThread("UI");
+
+	SharedDevice shared(arguments && argumentCount > 1 ? arguments[1] : DefaultBackground);
+	vector<unique_ptr<SampleWindow>> windows;
+
+	for (unsigned window = 0; window != windowCount; ++window)
+	{
+		windows.push_back(make_unique<SampleWindow>(shared, seed + window, window, restore));
+	}
+
+	LocalFree(arguments);
+
+	RenderThread & renderThread = shared.m_renderThread;
+	renderThread.Start();
+
 	MSG message;
 
 	while (GetMessage(&message, nullptr, 0, 0))
 	{
 		DispatchMessage(&message);
 	}
+
+	// Before the windows it renders go
+	renderThread.Stop();
+
+	TRACE(L"Input to commit p50 %.2f ms, p99 %.2f ms over %u commands, %u commits\n",
+		renderThread.m_latency.Percentile(50.0) * 1000.0,
+		renderThread.m_latency.Percentile(99.0) * 1000.0,
+		renderThread.m_applied,
+		renderThread.m_frames);
+
+	for (unsigned window = 0; window != windowCount; ++window)
+	{
+		// A restored game's input does not start from a deal to replay
+		if (!windows[window]->m_restored)
+		{
+			SaveInput(windows[window]->m_inputLog, window);
+		}
+
+		DamageCounters const & backs = windows[window]->m_backDamage.m_counters;
+
+		if (backs.Frames)
+		{
+			TRACE(L"Back rows redrawn in %u frames, %.0f pixels per frame, peak %llu, %.0f%% of whole backs\n",
+				backs.Frames,
+				backs.PixelsPerFrame(),
+				backs.PeakFramePixels,
+				backs.DrawnShare() * 100.0);
+		}
+	}
+
+	SaveTrace();
 }
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <memory>
+#include "BoardScene.h"
+#include "GlyphCache.h"
+#include "ImageSource.h"
+#include "ThreadPool.h"
+
+// What the boards of one process share, so that a board after the first
+// pays only for its own target, scene, layout and tiles: the decoded
+// background, the glyphs, the workers that rasterize tiles and the card face
+// transforms. The transforms are compositor objects, so boards that share
+// them must share the compositor device too. The sample keeps these next
+// to its D3D, D2D and DirectComposition devices, one set for all windows.
+// Every board uses them from the one UI thread.
+struct SharedBoardResources
+{
+	std::unique_ptr<StreamingImage> Background; // started by the first board that needs it
+	GlyphCache Glyphs;
+	ThreadPool Pool;
+	std::shared_ptr<FaceTransformCache> FaceTransforms = std::make_shared<FaceTransformCache>();
+
+	explicit SharedBoardResources(unsigned const threads = ThreadPool::DefaultThreads()) :
+		Pool(threads)
+	{}
+
+	// Pixels of the background and coverage of the glyphs
+	size_t Bytes() const
+	{
+		size_t const background = Background ? 4ull * Background->Width() * Background->Height() : 0;
+
+		return background + Glyphs.Bytes();
+	}
+
+	// Called when the device is recreated
+	void ReleaseDeviceResources()
+	{
+		FaceTransforms->Clear();
+	}
+};
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <cmath>
+#include "DirtyRects.h"
+#include "GlyphCache.h"
+#include "Layout.h"
+#include "Raster.h"
+
+// Draws card faces into BGRA8 premultiplied pixels without a GPU. Mirrors
+// DrawCardFront and DrawCardBack in Sample.cpp: a white face with a centered
+// black letter, and a back showing the background at the card's offset.
+
+struct SoftwareRenderer
+{
+	float m_dpiX = 96.0f;
+	float m_dpiY = 96.0f;
+	float m_cardWidth = 0.0f;
+	float m_cardHeight = 0.0f;
+	float m_fontSize = 0.0f;
+	uint32_t m_faceColor = PremultipliedColor(1.0f, 1.0f, 1.0f);
+	uint32_t m_textColor = PremultipliedColor(0.0f, 0.0f, 0.0f);
+	ConstPixelView m_background;
+	GlyphCache * m_glyphs = nullptr;
+
+	// Card size and font size are logical, the background is in pixels at
+	// 96 DPI like the bitmap D2D creates from the decoded image.
+	SoftwareRenderer(float const dpiX,
+		float const dpiY,
+		float const cardWidth,
+		float const cardHeight,
+		float const fontSize,
+		ConstPixelView const & background,
+		GlyphCache * glyphs = nullptr) :
+		m_dpiX(dpiX),
+		m_dpiY(dpiY),
+		m_cardWidth(cardWidth),
+		m_cardHeight(cardHeight),
+		m_fontSize(fontSize),
+		m_background(background),
+		m_glyphs(glyphs)
+	{}
+
+	static uint32_t Font()
+	{
+		static uint32_t const font = FontId(L"BitmapFont 5x7");
+		return font;
+	}
+
+	// Physical size of a card surface
+	unsigned Width() const
+	{
+		return static_cast<unsigned>(LogicalToPhysical(m_cardWidth, m_dpiX));
+	}
+
+	unsigned Height() const
+	{
+		return static_cast<unsigned>(LogicalToPhysical(m_cardHeight, m_dpiY));
+	}
+
+	// Rasterizes the glyph centered on a card face
+	CoverageMask RasterizeGlyph(wchar_t const value) const
+	{
+		CoverageMask glyph = RasterizeBitmapGlyph(value, LogicalToPhysical(m_fontSize, m_dpiY));
+
+		glyph.Left = (static_cast<int>(Width()) - static_cast<int>(glyph.Width)) / 2;
+		glyph.Top = (static_cast<int>(Height()) - static_cast<int>(glyph.Height)) / 2;
+
+		return glyph;
+	}
+
+	void DrawCardFront(PixelView const & target,
+		wchar_t const value) const
+	{
+		if (!m_glyphs)
+		{
+			DrawCardFront(target, RasterizeGlyph(value));
+			return;
+		}
+
+		GlyphKey const key(value, Font(), m_fontSize, m_dpiY);
+
+		DrawCardFront(target, m_glyphs->Get(key, [&]
+		{
+			return RasterizeGlyph(value);
+		}));
+	}
+
+	void DrawCardFront(PixelView const & target,
+		CoverageMask const & glyph) const
+	{
+		Clear(target, m_faceColor);
+
+		Composite(target,
+			glyph.Left,
+			glyph.Top,
+			glyph,
+			m_textColor);
+	}
+
+	// Draws only the part of the face within the target, the card's whole
+	// surface, leaving the rest of it as it was
+	void DrawCardFront(PixelView const & target,
+		wchar_t const value,
+		DirtyRect const & part) const
+	{
+		if (!m_glyphs)
+		{
+			DrawCardFront(target, RasterizeGlyph(value), part);
+			return;
+		}
+
+		GlyphKey const key(value, Font(), m_fontSize, m_dpiY);
+
+		DrawCardFront(target, m_glyphs->Get(key, [&]
+		{
+			return RasterizeGlyph(value);
+		}), part);
+	}
+
+	void DrawCardFront(PixelView const & target,
+		CoverageMask const & glyph,
+		DirtyRect const & part) const
+	{
+		PixelView const view = target.SubView(part.Left, part.Top, part.Width(), part.Height());
+
+		Clear(view, m_faceColor);
+
+		Composite(view,
+			glyph.Left - static_cast<int>(part.Left),
+			glyph.Top - static_cast<int>(part.Top),
+			glyph,
+			m_textColor);
+	}
+
+	// offsetX and offsetY are the card's physical position on the board.
+	void DrawCardBack(PixelView const & target,
+		float const offsetX,
+		float const offsetY) const
+	{
+		float const sourceX = PhysicalToLogical(offsetX, m_dpiX);
+		float const sourceY = PhysicalToLogical(offsetY, m_dpiY);
+
+		if (m_dpiX == 96.0f && m_dpiY == 96.0f)
+		{
+			CopyRect(target,
+				m_background,
+				static_cast<int>(std::floor(sourceX)),
+				static_cast<int>(std::floor(sourceY)));
+		}
+		else
+		{
+			ScaleRect(target,
+				m_background,
+				sourceX,
+				sourceY,
+				m_cardWidth,
+				m_cardHeight);
+		}
+	}
+
+	void DrawCardBack(PixelView const & target,
+		float const offsetX,
+		float const offsetY,
+		DirtyRect const & part) const
+	{
+		PixelView const view = target.SubView(part.Left, part.Top, part.Width(), part.Height());
+
+		float const sourceX = PhysicalToLogical(offsetX, m_dpiX);
+		float const sourceY = PhysicalToLogical(offsetY, m_dpiY);
+
+		if (m_dpiX == 96.0f && m_dpiY == 96.0f)
+		{
+			CopyRect(view,
+				m_background,
+				static_cast<int>(std::floor(sourceX)) + static_cast<int>(part.Left),
+				static_cast<int>(std::floor(sourceY)) + static_cast<int>(part.Top));
+		}
+		else
+		{
+			ScaleRectPart(view,
+				m_background,
+				sourceX,
+				sourceY,
+				m_cardWidth,
+				m_cardHeight,
+				target.Width,
+				target.Height,
+				part.Left,
+				part.Top);
+		}
+	}
+};
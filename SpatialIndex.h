@@ -0,0 +1,174 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "Debug.h"
+
+// Uniform grid over axis aligned bounds for hit-testing cards that have been
+// moved or rotated away from their board slots. Board::CardAtPoint covers the
+// regular layout; this index handles any arrangement of items.
+
+struct Bounds
+{
+	float Left = 0.0f;
+	float Top = 0.0f;
+	float Right = 0.0f;
+	float Bottom = 0.0f;
+
+	Bounds() = default;
+
+	Bounds(float const left,
+		float const top,
+		float const right,
+		float const bottom) :
+		Left(left),
+		Top(top),
+		Right(right),
+		Bottom(bottom)
+	{}
+
+	// Strict containment, matching the board's hit-test
+	bool Contains(float const x, float const y) const
+	{
+		return x > Left && y > Top && x < Right && y < Bottom;
+	}
+};
+
+struct SpatialGrid
+{
+	static unsigned const NoItem = ~0u;
+
+	float m_left = 0.0f;
+	float m_top = 0.0f;
+	float m_cellWidth = 1.0f;
+	float m_cellHeight = 1.0f;
+	unsigned m_columns = 0;
+	unsigned m_rows = 0;
+
+	std::vector<Bounds> m_bounds;
+	std::vector<std::vector<unsigned>> m_cells;
+
+	// Covers the area with cells of the given size. Items outside the area
+	// are clamped into the border cells, so they remain reachable.
+	SpatialGrid(Bounds const & area,
+		float const cellWidth,
+		float const cellHeight) :
+		m_left(area.Left),
+		m_top(area.Top),
+		m_cellWidth(cellWidth),
+		m_cellHeight(cellHeight)
+	{
+		ASSERT(cellWidth > 0.0f && cellHeight > 0.0f);
+
+		m_columns = std::max(1u, static_cast<unsigned>(std::ceil((area.Right - area.Left) / cellWidth)));
+		m_rows = std::max(1u, static_cast<unsigned>(std::ceil((area.Bottom - area.Top) / cellHeight)));
+
+		m_cells.resize(m_columns * m_rows);
+	}
+
+	unsigned ItemCount() const
+	{
+		return static_cast<unsigned>(m_bounds.size());
+	}
+
+	unsigned Column(float const x) const
+	{
+		float const column = std::floor((x - m_left) / m_cellWidth);
+
+		if (!(column > 0.0f)) return 0;
+		if (column >= m_columns) return m_columns - 1;
+		return static_cast<unsigned>(column);
+	}
+
+	unsigned Row(float const y) const
+	{
+		float const row = std::floor((y - m_top) / m_cellHeight);
+
+		if (!(row > 0.0f)) return 0;
+		if (row >= m_rows) return m_rows - 1;
+		return static_cast<unsigned>(row);
+	}
+
+	// Adds an item and returns its index. Indices are dense and stable.
+	unsigned Insert(Bounds const & bounds)
+	{
+		unsigned const item = ItemCount();
+		m_bounds.push_back(bounds);
+		Link(item);
+		return item;
+	}
+
+	// Moves an item, for example when its card is animated or rotated.
+	void Update(unsigned const item, Bounds const & bounds)
+	{
+		ASSERT(item < ItemCount());
+
+		Unlink(item);
+		m_bounds[item] = bounds;
+		Link(item);
+	}
+
+	// Returns the lowest indexed item containing the point or NoItem, the
+	// same answer as a linear scan over the items in order.
+	unsigned Query(float const x, float const y) const
+	{
+		return Query(x, y, [&](unsigned const item)
+		{
+			return m_bounds[item].Contains(x, y);
+		});
+	}
+
+	// As above but with a precise test for items whose shape is smaller
+	// than their bounds, such as a card part way through a flip.
+	template <typename Contains>
+	unsigned Query(float const x, float const y, Contains && contains) const
+	{
+		std::vector<unsigned> const & cell = m_cells[Row(y) * m_columns + Column(x)];
+
+		for (unsigned const item : cell)
+		{
+			if (contains(item)) return item;
+		}
+
+		return NoItem;
+	}
+
+private:
+
+	template <typename Action>
+	void ForEachCell(Bounds const & bounds, Action && action)
+	{
+		unsigned const left = Column(bounds.Left);
+		unsigned const right = Column(bounds.Right);
+		unsigned const top = Row(bounds.Top);
+		unsigned const bottom = Row(bounds.Bottom);
+
+		for (unsigned row = top; row <= bottom; ++row)
+			for (unsigned column = left; column <= right; ++column)
+			{
+				action(m_cells[row * m_columns + column]);
+			}
+	}
+
+	// Cells are kept sorted so that Query returns the lowest index first.
+	void Link(unsigned const item)
+	{
+		ForEachCell(m_bounds[item], [&](std::vector<unsigned> & cell)
+		{
+			cell.insert(std::lower_bound(cell.begin(), cell.end(), item), item);
+		});
+	}
+
+	void Unlink(unsigned const item)
+	{
+		ForEachCell(m_bounds[item], [&](std::vector<unsigned> & cell)
+		{
+			auto const position = std::lower_bound(cell.begin(), cell.end(), item);
+
+			ASSERT(position != cell.end() && *position == item);
+
+			cell.erase(position);
+		});
+	}
+};
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads for data parallel loops such as rasterizing
+// the card tiles. Each thread has its own queue of ranges; it takes work from
+// the back of its own queue and, once that is empty, steals from the front
+// of the others, so uneven work such as fronts and backs evens out. The
+// thread calling ParallelFor works too, as thread 0.
+
+struct ThreadPool
+{
+	// One call to ParallelFor
+	struct Batch
+	{
+		std::function<void (unsigned index, unsigned thread)> Body;
+		unsigned Remaining = 0;
+		std::mutex Mutex;
+		std::condition_variable Done;
+	};
+
+	// A range of indices of a batch
+	struct Task
+	{
+		Batch * Owner;
+		unsigned Begin;
+		unsigned End;
+	};
+
+	struct Queue
+	{
+		std::mutex Mutex;
+		std::deque<Task> Tasks;
+	};
+
+	// Ranges handed out per thread, so that a thread that finishes early
+	// still finds some to steal
+	static unsigned const TasksPerThread = 4;
+
+	std::vector<std::unique_ptr<Queue>> m_queues; // the caller's first
+	std::vector<std::thread> m_workers;
+	std::atomic<unsigned> m_queued;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	bool m_stop = false;
+
+	// Threads counts the caller, so a pool of one runs everything inline
+	explicit ThreadPool(unsigned const threads = DefaultThreads()) :
+		m_queued(0)
+	{
+		unsigned const count = std::max(1u, threads);
+
+		for (unsigned thread = 0; thread != count; ++thread)
+		{
+			m_queues.push_back(std::unique_ptr<Queue>(new Queue));
+		}
+
+		for (unsigned thread = 1; thread != count; ++thread)
+		{
+			m_workers.emplace_back([this, thread] { Work(thread); });
+		}
+	}
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+
+		m_wake.notify_all();
+
+		for (std::thread & worker : m_workers)
+		{
+			worker.join();
+		}
+	}
+
+	ThreadPool(ThreadPool const &) = delete;
+	ThreadPool & operator=(ThreadPool const &) = delete;
+
+	static unsigned DefaultThreads()
+	{
+		return std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	unsigned ThreadCount() const
+	{
+		return static_cast<unsigned>(m_queues.size());
+	}
+
+	// Calls body(index, thread) for every index below count and returns once
+	// all calls have returned. Thread is below ThreadCount, for per thread
+	// scratch space. Only one thread may call ParallelFor at a time and the
+	// body must not throw.
+	template <typename Body>
+	void ParallelFor(unsigned const count, Body && body)
+	{
+		if (count == 0) return;
+
+		if (ThreadCount() == 1)
+		{
+			for (unsigned index = 0; index != count; ++index)
+			{
+				body(index, 0);
+			}
+
+			return;
+		}
+
+		Batch batch;
+		batch.Body = std::forward<Body>(body);
+		batch.Remaining = count;
+
+		unsigned const grain = std::max(1u, count / (ThreadCount() * TasksPerThread));
+		unsigned const tasks = (count + grain - 1) / grain;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_queued += tasks;
+		}
+
+		for (unsigned task = 0; task != tasks; ++task)
+		{
+			Queue & queue = *m_queues[task % ThreadCount()];
+
+			std::lock_guard<std::mutex> lock(queue.Mutex);
+			queue.Tasks.push_back({ &batch, task * grain, std::min(count, (task + 1) * grain) });
+		}
+
+		m_wake.notify_all();
+
+		Task task;
+
+		while (Take(0, task))
+		{
+			Execute(task, 0);
+		}
+
+		// Other threads may still be running the last ranges
+		std::unique_lock<std::mutex> lock(batch.Mutex);
+
+		batch.Done.wait(lock, [&]
+		{
+			return batch.Remaining == 0;
+		});
+	}
+
+private:
+
+	void Work(unsigned const thread)
+	{
+		for (;;)
+		{
+			Task task;
+
+			if (Take(thread, task))
+			{
+				Execute(task, thread);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_mutex);
+
+			m_wake.wait(lock, [&]
+			{
+				return m_stop || m_queued != 0;
+			});
+
+			if (m_stop && m_queued == 0) return;
+		}
+	}
+
+	// The newest range of the thread's own queue, or else the oldest of the
+	// next queue that has any
+	bool Take(unsigned const thread, Task & task)
+	{
+		for (unsigned offset = 0; offset != ThreadCount(); ++offset)
+		{
+			Queue & queue = *m_queues[(thread + offset) % ThreadCount()];
+
+			std::lock_guard<std::mutex> lock(queue.Mutex);
+
+			if (queue.Tasks.empty()) continue;
+
+			if (offset == 0)
+			{
+				task = queue.Tasks.back();
+				queue.Tasks.pop_back();
+			}
+			else
+			{
+				task = queue.Tasks.front();
+				queue.Tasks.pop_front();
+			}
+
+			--m_queued;
+			return true;
+		}
+
+		return false;
+	}
+
+	static void Execute(Task const & task, unsigned const thread)
+	{
+		Batch & batch = *task.Owner;
+
+		for (unsigned index = task.Begin; index != task.End; ++index)
+		{
+			batch.Body(index, thread);
+		}
+
+		// Counted under the lock, as the batch lives only until the caller
+		// sees it done
+		std::lock_guard<std::mutex> lock(batch.Mutex);
+
+		batch.Remaining -= task.End - task.Begin;
+
+		if (batch.Remaining == 0)
+		{
+			batch.Done.notify_one();
+		}
+	}
+};
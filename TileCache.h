@@ -0,0 +1,184 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "MappedFile.h"
+#include "Raster.h"
+
+// On-disk cache of the card backs. The background is stored already cut into
+// one tile per card slot, at the physical card size and pixel format of the
+// surfaces, so a warm start maps the file and uploads backs straight from it
+// without decoding the image. A cache is only used when its key matches: the
+// hash of the source image, the DPI and the board layout.
+
+// FNV-1a over a block of bytes
+inline uint64_t HashBytes(uint8_t const * data,
+	size_t const size,
+	uint64_t hash = 0xCBF29CE484222325ull)
+{
+	for (size_t i = 0; i != size; ++i)
+	{
+		hash = (hash ^ data[i]) * 0x100000001B3ull;
+	}
+
+	return hash;
+}
+
+// Hash of the file contents, or 0 if the file cannot be read
+inline uint64_t HashFile(PathChar const * path)
+{
+	MappedFile file;
+
+	if (!file.Open(path)) return 0;
+
+	return HashBytes(file.Data(), file.Size());
+}
+
+struct TileCacheKey
+{
+	uint64_t SourceHash = 0;
+	float DpiX = 0.0f;
+	float DpiY = 0.0f;
+	uint32_t TileWidth = 0;
+	uint32_t TileHeight = 0;
+	uint32_t Rows = 0;
+	uint32_t Columns = 0;
+
+	bool operator==(TileCacheKey const & other) const
+	{
+		return SourceHash == other.SourceHash &&
+			DpiX == other.DpiX &&
+			DpiY == other.DpiY &&
+			TileWidth == other.TileWidth &&
+			TileHeight == other.TileHeight &&
+			Rows == other.Rows &&
+			Columns == other.Columns;
+	}
+
+	size_t TileBytes() const
+	{
+		return static_cast<size_t>(TileWidth) * TileHeight * sizeof(uint32_t);
+	}
+};
+
+struct TileCacheHeader
+{
+	static uint32_t const Signature = 0x43544742; // "BGTC"
+	static uint32_t const CurrentVersion = 1;
+
+	// Premultiplied BGRA8, DXGI_FORMAT_B8G8R8A8_UNORM
+	static uint32_t const FormatBgra8 = 1;
+
+	uint32_t Magic = Signature;
+	uint32_t Version = CurrentVersion;
+	uint32_t Format = FormatBgra8;
+	uint32_t Reserved = 0;
+	TileCacheKey Key;
+};
+
+// Tiles follow the header in slot order, row by row. The header size keeps
+// them 16 byte aligned within the file.
+static_assert(sizeof(TileCacheHeader) % 16 == 0, "tiles are aligned");
+
+struct TileCache
+{
+	MappedFile m_file;
+	TileCacheKey m_key;
+
+	// Maps the cache file and checks it against the key. Returns false if the
+	// file is missing, truncated, from another version or for another key.
+	bool Open(PathChar const * path, TileCacheKey const & key)
+	{
+		m_file.Close();
+
+		if (!m_file.Open(path)) return false;
+
+		TileCacheHeader header;
+
+		if (m_file.Size() < sizeof(header))
+		{
+			m_file.Close();
+			return false;
+		}
+
+		memcpy(&header, m_file.Data(), sizeof(header));
+
+		bool const valid = header.Magic == TileCacheHeader::Signature &&
+			header.Version == TileCacheHeader::CurrentVersion &&
+			header.Format == TileCacheHeader::FormatBgra8 &&
+			header.Key == key &&
+			m_file.Size() == sizeof(header) + key.TileBytes() * key.Rows * key.Columns;
+
+		if (!valid)
+		{
+			m_file.Close();
+			return false;
+		}
+
+		m_key = key;
+		return true;
+	}
+
+	bool IsOpen() const
+	{
+		return m_file.IsOpen();
+	}
+
+	void Close()
+	{
+		m_file.Close();
+	}
+
+	// The tile for the card slot, pointing into the mapped file
+	ConstPixelView Tile(unsigned const slot) const
+	{
+		ASSERT(IsOpen() && slot < m_key.Rows * m_key.Columns);
+
+		uint8_t const * tile = m_file.Data() + sizeof(TileCacheHeader) + m_key.TileBytes() * slot;
+
+		return ConstPixelView(reinterpret_cast<uint32_t const *>(tile),
+			m_key.TileWidth,
+			m_key.TileHeight,
+			m_key.TileWidth);
+	}
+};
+
+// Writes a cache file, drawing each tile with draw(slot, PixelView). The file
+// is written next to the target and moved over it once complete.
+template <typename Draw>
+bool WriteTileCache(PathChar const * path,
+	TileCacheKey const & key,
+	Draw && draw)
+{
+	std::basic_string<PathChar> temporary(path);
+	temporary += static_cast<PathChar>('~');
+
+	FILE * file = OpenFile(temporary.c_str(), true);
+
+	if (!file) return false;
+
+	TileCacheHeader header;
+	header.Key = key;
+
+	bool written = 1 == fwrite(&header, sizeof(header), 1, file);
+
+	PixelBuffer tile(key.TileWidth, key.TileHeight);
+
+	for (unsigned slot = 0; written && slot != key.Rows * key.Columns; ++slot)
+	{
+		draw(slot, tile.View());
+
+		written = 1 == fwrite(tile.Pixels.data(), key.TileBytes(), 1, file);
+	}
+
+	written = 0 == fclose(file) && written;
+
+	if (!written || !MoveFileOver(temporary.c_str(), path))
+	{
+		RemoveFile(temporary.c_str());
+		return false;
+	}
+
+	return true;
+}
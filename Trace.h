@@ -0,0 +1,653 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Debug.h"
+
+// Always on instrumentation. Every thread records timed events into its own
+// ring buffer without locks; the oldest events are overwritten once it is
+// full. A snapshot of all the rings can be taken at any time and exported as
+// Chrome trace JSON (chrome://tracing, Perfetto) or in a compact binary form.
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define TRACE_RDTSC 1
+#endif
+
+// The cheapest steady clock there is. On Windows this is the performance
+// counter, so that times from the frame statistics can be recorded as is.
+// Elsewhere on x86 it is the time stamp counter, which is constant rate on
+// any processor recent enough to run the sample.
+struct TraceClock
+{
+	static uint64_t Now()
+	{
+#ifdef _WIN32
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+		return static_cast<uint64_t>(now.QuadPart);
+#elif TRACE_RDTSC
+		return __rdtsc();
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+};
+
+// Measures the ticks per second of the trace clock against the system
+// clock, over the time since it was created
+struct TraceCalibration
+{
+	uint64_t m_ticks = TraceClock::Now();
+	std::chrono::steady_clock::time_point m_time = std::chrono::steady_clock::now();
+
+	uint64_t Frequency() const
+	{
+#ifdef _WIN32
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		return static_cast<uint64_t>(frequency.QuadPart);
+#elif TRACE_RDTSC
+		uint64_t const ticks = TraceClock::Now() - m_ticks;
+		double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_time).count();
+
+		return seconds > 0.0 ? static_cast<uint64_t>(ticks / seconds) : 1;
+#else
+		return 1000000000;
+#endif
+	}
+};
+
+// Name is a string that outlives the tracer, usually a literal. Argument is
+// whatever the event wants to add, such as a card index.
+struct TraceEvent
+{
+	char const * Name;
+	uint64_t Start;
+	uint64_t Duration;
+	uint64_t Argument;
+};
+
+// One thread's events. Only the owning thread writes; any thread may read.
+struct TraceBuffer
+{
+	std::unique_ptr<TraceEvent[]> m_events;
+	uint64_t m_mask;
+	std::atomic<uint64_t> m_head; // events ever written
+	std::thread::id m_owner;
+	unsigned m_thread;
+	char const * m_name = nullptr;
+
+	// Capacity is a power of two. The ring is zeroed up front so that
+	// recording never takes a page fault.
+	TraceBuffer(uint64_t const capacity,
+		unsigned const thread) :
+		m_events(new TraceEvent[capacity]()),
+		m_mask(capacity - 1),
+		m_head(0),
+		m_owner(std::this_thread::get_id()),
+		m_thread(thread)
+	{
+		ASSERT(capacity && (capacity & m_mask) == 0);
+	}
+
+	void Write(TraceEvent const & event)
+	{
+		uint64_t const head = m_head.load(std::memory_order_relaxed);
+
+		// A reader that sees the slot overwritten also sees the head that
+		// published the previous event, and so knows to drop it
+		std::atomic_thread_fence(std::memory_order_release);
+
+		m_events[head & m_mask] = event;
+
+		m_head.store(head + 1, std::memory_order_release);
+	}
+
+	// Appends the events still in the ring, oldest first, and returns the
+	// number of older ones that have been overwritten. The oldest slot of a
+	// full ring is never read, as the owner may be writing it.
+	uint64_t Read(std::vector<TraceEvent> & events) const
+	{
+		uint64_t const capacity = m_mask + 1;
+		uint64_t const end = m_head.load(std::memory_order_acquire);
+		uint64_t begin = end > capacity ? end - capacity : 0;
+
+		size_t const first = events.size();
+
+		for (uint64_t index = begin; index != end; ++index)
+		{
+			events.push_back(m_events[index & m_mask]);
+		}
+
+		// Drop the slots the owner may have reused while they were copied,
+		// including the one it may be writing now
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t const later = m_head.load(std::memory_order_relaxed) + 1;
+		uint64_t const valid = later > capacity ? later - capacity : 0;
+
+		if (valid > begin)
+		{
+			uint64_t const reused = std::min(valid, end) - begin;
+
+			events.erase(events.begin() + first, events.begin() + first + static_cast<size_t>(reused));
+			begin += reused;
+		}
+
+		return begin;
+	}
+};
+
+// The snapshot of a trace. Names are stored once and referred to by index.
+struct TraceRecord
+{
+	unsigned Name;
+	uint64_t Start;
+	uint64_t Duration;
+	uint64_t Argument;
+
+	bool operator==(TraceRecord const & other) const
+	{
+		return Name == other.Name &&
+			Start == other.Start &&
+			Duration == other.Duration &&
+			Argument == other.Argument;
+	}
+};
+
+struct TraceThread
+{
+	unsigned Id = 0;
+	std::string Name;
+	uint64_t Dropped = 0; // overwritten before the snapshot was taken
+	std::vector<TraceRecord> Records;
+
+	bool operator==(TraceThread const & other) const
+	{
+		return Id == other.Id &&
+			Name == other.Name &&
+			Dropped == other.Dropped &&
+			Records == other.Records;
+	}
+};
+
+struct TraceSnapshot
+{
+	uint64_t Frequency = 1; // clock ticks per second
+	std::vector<std::string> Names;
+	std::vector<TraceThread> Threads;
+
+	bool operator==(TraceSnapshot const & other) const
+	{
+		return Frequency == other.Frequency &&
+			Names == other.Names &&
+			Threads == other.Threads;
+	}
+
+	size_t RecordCount() const
+	{
+		size_t count = 0;
+
+		for (TraceThread const & thread : Threads)
+		{
+			count += thread.Records.size();
+		}
+
+		return count;
+	}
+};
+
+struct Tracer
+{
+	static uint64_t const DefaultCapacity = 1 << 15;
+
+	uint64_t m_capacity;
+	uint64_t m_id;
+	TraceCalibration m_calibration;
+	std::mutex m_mutex; // guards the list of buffers, never an event
+	std::vector<std::unique_ptr<TraceBuffer>> m_buffers;
+
+	// Capacity is the number of events kept per thread
+	explicit Tracer(uint64_t const capacity = DefaultCapacity) :
+		m_capacity(1),
+		m_id(NextId())
+	{
+		while (m_capacity < capacity)
+		{
+			m_capacity *= 2;
+		}
+	}
+
+	Tracer(Tracer const &) = delete;
+	Tracer & operator=(Tracer const &) = delete;
+
+	void Record(char const * const name,
+		uint64_t const start,
+		uint64_t const duration,
+		uint64_t const argument = 0)
+	{
+		ThreadBuffer().Write({ name, start, duration, argument });
+	}
+
+	// Names the calling thread in the exported traces
+	void NameThread(char const * const name)
+	{
+		TraceBuffer & buffer = ThreadBuffer();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		buffer.m_name = name;
+	}
+
+	// The calling thread's buffer. The first call on a thread creates it;
+	// later ones find it in a thread local cache.
+	TraceBuffer & ThreadBuffer()
+	{
+		struct Cache
+		{
+			uint64_t Tracer;
+			TraceBuffer * Buffer;
+		};
+
+		static thread_local Cache cache = {};
+
+		if (cache.Tracer != m_id)
+		{
+			cache.Buffer = &FindBuffer();
+			cache.Tracer = m_id;
+		}
+
+		return *cache.Buffer;
+	}
+
+	TraceSnapshot Collect()
+	{
+		TraceSnapshot snapshot;
+		snapshot.Frequency = m_calibration.Frequency();
+
+		std::unordered_map<char const *, unsigned> pointers;
+		std::unordered_map<std::string, unsigned> names;
+		std::vector<TraceEvent> events;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (std::unique_ptr<TraceBuffer> const & buffer : m_buffers)
+		{
+			TraceThread thread;
+			thread.Id = buffer->m_thread;
+			thread.Name = buffer->m_name ? buffer->m_name : "";
+
+			events.clear();
+			thread.Dropped = buffer->Read(events);
+			thread.Records.reserve(events.size());
+
+			for (TraceEvent const & event : events)
+			{
+				auto found = pointers.find(event.Name);
+
+				if (found == pointers.end())
+				{
+					auto const name = names.emplace(event.Name, static_cast<unsigned>(snapshot.Names.size()));
+
+					if (name.second)
+					{
+						snapshot.Names.push_back(event.Name);
+					}
+
+					found = pointers.emplace(event.Name, name.first->second).first;
+				}
+
+				thread.Records.push_back({ found->second, event.Start, event.Duration, event.Argument });
+			}
+
+			snapshot.Threads.push_back(std::move(thread));
+		}
+
+		return snapshot;
+	}
+
+private:
+
+	static uint64_t NextId()
+	{
+		static std::atomic<uint64_t> next(1);
+		return next++;
+	}
+
+	TraceBuffer & FindBuffer()
+	{
+		std::thread::id const self = std::this_thread::get_id();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		for (std::unique_ptr<TraceBuffer> const & buffer : m_buffers)
+		{
+			if (buffer->m_owner == self) return *buffer;
+		}
+
+		m_buffers.push_back(std::unique_ptr<TraceBuffer>(new TraceBuffer(m_capacity, static_cast<unsigned>(m_buffers.size()) + 1)));
+		return *m_buffers.back();
+	}
+};
+
+// The tracer the sample records into
+inline Tracer & GlobalTracer()
+{
+	static Tracer tracer;
+	return tracer;
+}
+
+// Records the time from construction to destruction as one event
+struct TraceScope
+{
+	Tracer & m_tracer;
+	char const * m_name;
+	uint64_t m_argument;
+	uint64_t m_start;
+
+	TraceScope(Tracer & tracer,
+		char const * const name,
+		uint64_t const argument = 0) :
+		m_tracer(tracer),
+		m_name(name),
+		m_argument(argument),
+		m_start(TraceClock::Now())
+	{}
+
+	explicit TraceScope(char const * const name,
+		uint64_t const argument = 0) :
+		TraceScope(GlobalTracer(), name, argument)
+	{}
+
+	TraceScope(TraceScope const &) = delete;
+	TraceScope & operator=(TraceScope const &) = delete;
+
+	~TraceScope()
+	{
+		m_tracer.Record(m_name, m_start, TraceClock::Now() - m_start, m_argument);
+	}
+};
+
+// A string as the inside of a JSON string
+inline std::string EscapeJson(std::string const & text)
+{
+	std::string escaped;
+
+	for (char const c : text)
+	{
+		if (c == '"' || c == '\\')
+		{
+			escaped += '\\';
+			escaped += c;
+		}
+		else if (static_cast<unsigned char>(c) < 0x20)
+		{
+			char code[8];
+			snprintf(code, sizeof(code), "\\u%04x", c);
+			escaped += code;
+		}
+		else
+		{
+			escaped += c;
+		}
+	}
+
+	return escaped;
+}
+
+// Chrome trace event format, with times in microseconds from the first
+// event and the argument only where it is set
+inline std::string ExportChromeTrace(TraceSnapshot const & snapshot)
+{
+	uint64_t origin = UINT64_MAX;
+
+	for (TraceThread const & thread : snapshot.Threads)
+		for (TraceRecord const & record : thread.Records)
+		{
+			origin = std::min(origin, record.Start);
+		}
+
+	double const nanoseconds = 1e9 / snapshot.Frequency;
+
+	std::vector<std::string> names;
+
+	for (std::string const & name : snapshot.Names)
+	{
+		names.push_back(EscapeJson(name));
+	}
+
+	std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	json.reserve(snapshot.RecordCount() * 112);
+	char line[160];
+	bool first = true;
+
+	for (TraceThread const & thread : snapshot.Threads)
+	{
+		if (!thread.Name.empty())
+		{
+			snprintf(line, sizeof(line), "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"",
+				first ? "" : ",",
+				thread.Id);
+
+			json += line;
+			json += EscapeJson(thread.Name);
+			json += "\"}}";
+			first = false;
+		}
+
+		for (TraceRecord const & record : thread.Records)
+		{
+			json += first ? "\n{\"name\":\"" : ",\n{\"name\":\"";
+			json += names[record.Name];
+
+			// Integers format much faster than doubles
+			unsigned long long const start = static_cast<unsigned long long>((record.Start - origin) * nanoseconds);
+			unsigned long long const duration = static_cast<unsigned long long>(record.Duration * nanoseconds);
+
+			snprintf(line, sizeof(line), "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%llu.%03llu,\"dur\":%llu.%03llu",
+				thread.Id,
+				start / 1000,
+				start % 1000,
+				duration / 1000,
+				duration % 1000);
+
+			json += line;
+
+			if (record.Argument)
+			{
+				snprintf(line, sizeof(line), ",\"args\":{\"argument\":%llu}",
+					static_cast<unsigned long long>(record.Argument));
+
+				json += line;
+			}
+
+			json += '}';
+			first = false;
+		}
+	}
+
+	json += "\n]}\n";
+	return json;
+}
+
+// The binary format is a magic number and then variable length integers:
+// the frequency, the names as lengths and bytes, and for each thread its id,
+// name, dropped count and records. A record is its name index, the change
+// in start time from the previous record, zigzag encoded as nested scopes
+// end in reverse order, the duration and the argument. Most records take
+// eight bytes or less.
+
+static char const TraceMagic[4] = { 'T', 'R', 'C', '1' };
+
+inline void WriteTraceNumber(std::vector<uint8_t> & data, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		data.push_back(static_cast<uint8_t>(value | 0x80));
+		value >>= 7;
+	}
+
+	data.push_back(static_cast<uint8_t>(value));
+}
+
+inline void WriteTraceString(std::vector<uint8_t> & data, std::string const & value)
+{
+	WriteTraceNumber(data, value.size());
+	data.insert(data.end(), value.begin(), value.end());
+}
+
+inline std::vector<uint8_t> ExportBinaryTrace(TraceSnapshot const & snapshot)
+{
+	std::vector<uint8_t> data(TraceMagic, TraceMagic + sizeof(TraceMagic));
+	data.reserve(16 + snapshot.RecordCount() * 8);
+
+	WriteTraceNumber(data, snapshot.Frequency);
+	WriteTraceNumber(data, snapshot.Names.size());
+
+	for (std::string const & name : snapshot.Names)
+	{
+		WriteTraceString(data, name);
+	}
+
+	WriteTraceNumber(data, snapshot.Threads.size());
+
+	for (TraceThread const & thread : snapshot.Threads)
+	{
+		WriteTraceNumber(data, thread.Id);
+		WriteTraceString(data, thread.Name);
+		WriteTraceNumber(data, thread.Dropped);
+		WriteTraceNumber(data, thread.Records.size());
+
+		uint64_t previous = 0;
+
+		for (TraceRecord const & record : thread.Records)
+		{
+			int64_t const change = static_cast<int64_t>(record.Start - previous);
+
+			WriteTraceNumber(data, record.Name);
+			WriteTraceNumber(data, (static_cast<uint64_t>(change) << 1) ^ static_cast<uint64_t>(change >> 63));
+			WriteTraceNumber(data, record.Duration);
+			WriteTraceNumber(data, record.Argument);
+
+			previous = record.Start;
+		}
+	}
+
+	return data;
+}
+
+struct TraceReader
+{
+	uint8_t const * m_next;
+	uint8_t const * m_end;
+	bool m_failed = false;
+
+	TraceReader(uint8_t const * const data, size_t const size) :
+		m_next(data),
+		m_end(data + size)
+	{}
+
+	uint64_t Number()
+	{
+		uint64_t value = 0;
+
+		for (unsigned shift = 0; shift < 64; shift += 7)
+		{
+			if (m_next == m_end) break;
+
+			uint8_t const byte = *m_next++;
+			value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+
+			if (byte < 0x80) return value;
+		}
+
+		m_failed = true;
+		return 0;
+	}
+
+	// A count of things at least one byte each, so a corrupt count cannot
+	// make the reader allocate more than the data could hold
+	size_t Count()
+	{
+		uint64_t const count = Number();
+
+		if (count > static_cast<uint64_t>(m_end - m_next))
+		{
+			m_failed = true;
+			return 0;
+		}
+
+		return static_cast<size_t>(count);
+	}
+
+	std::string String()
+	{
+		size_t const length = Count();
+		std::string value(reinterpret_cast<char const *>(m_next), length);
+		m_next += length;
+		return value;
+	}
+};
+
+// Returns false if the data is not a complete binary trace
+inline bool ImportBinaryTrace(uint8_t const * const data,
+	size_t const size,
+	TraceSnapshot & snapshot)
+{
+	if (size < sizeof(TraceMagic) || 0 != memcmp(data, TraceMagic, sizeof(TraceMagic))) return false;
+
+	TraceReader reader(data + sizeof(TraceMagic), size - sizeof(TraceMagic));
+
+	snapshot = TraceSnapshot();
+	snapshot.Frequency = reader.Number();
+	snapshot.Names.resize(reader.Count());
+
+	for (std::string & name : snapshot.Names)
+	{
+		name = reader.String();
+	}
+
+	snapshot.Threads.resize(reader.Count());
+
+	for (TraceThread & thread : snapshot.Threads)
+	{
+		thread.Id = static_cast<unsigned>(reader.Number());
+		thread.Name = reader.String();
+		thread.Dropped = reader.Number();
+		thread.Records.resize(reader.Count());
+
+		uint64_t previous = 0;
+
+		for (TraceRecord & record : thread.Records)
+		{
+			record.Name = static_cast<unsigned>(reader.Number());
+
+			uint64_t const change = reader.Number();
+			record.Start = previous + ((change >> 1) ^ (0 - (change & 1)));
+			record.Duration = reader.Number();
+			record.Argument = reader.Number();
+
+			if (record.Name >= snapshot.Names.size()) return false;
+
+			previous = record.Start;
+		}
+
+		if (reader.m_failed) return false;
+	}
+
+	return !reader.m_failed && reader.m_next == reader.m_end;
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include "Layout.h"
+#include "Matrix.h"
+
+// A scrollable, zoomable window onto a board larger than the client area.
+// Positions are physical pixels of the board as laid out at the current
+// DPI; the zoom scales the board on the compositor, so the tiles are not
+// redrawn when it changes.
+
+struct BoardViewport
+{
+	static constexpr float MinimumZoom = 0.25f;
+	static constexpr float MaximumZoom = 4.0f;
+
+	float Left = 0.0f; // board point at the client's top left
+	float Top = 0.0f;
+	float ClientWidth = 0.0f;
+	float ClientHeight = 0.0f;
+	float Zoom = 1.0f;
+
+	BoardViewport() = default;
+
+	BoardViewport(float const clientWidth,
+		float const clientHeight) :
+		ClientWidth(clientWidth),
+		ClientHeight(clientHeight)
+	{}
+
+	// Size of the board area shown
+	float Width() const
+	{
+		return ClientWidth / Zoom;
+	}
+
+	float Height() const
+	{
+		return ClientHeight / Zoom;
+	}
+
+	// Client point to board point, for hit testing
+	float BoardX(float const clientX) const
+	{
+		return Left + clientX / Zoom;
+	}
+
+	float BoardY(float const clientY) const
+	{
+		return Top + clientY / Zoom;
+	}
+
+	// By client pixels, as a mouse wheel or a drag moves
+	void ScrollBy(float const clientX,
+		float const clientY)
+	{
+		Left += clientX / Zoom;
+		Top += clientY / Zoom;
+	}
+
+	// Keeps the board point under the client point where it is
+	void ZoomAt(float const factor,
+		float const clientX,
+		float const clientY)
+	{
+		float const x = BoardX(clientX);
+		float const y = BoardY(clientY);
+
+		Zoom = std::min(std::max(Zoom * factor, static_cast<float>(MinimumZoom)), static_cast<float>(MaximumZoom));
+
+		Left = x - clientX / Zoom;
+		Top = y - clientY / Zoom;
+	}
+
+	// Keeps the view on the board, centering a board smaller than the view
+	void Clamp(float const boardWidth,
+		float const boardHeight)
+	{
+		Left = ClampAxis(Left, Width(), boardWidth);
+		Top = ClampAxis(Top, Height(), boardHeight);
+	}
+
+	// For the root visual: board points to client points
+	Matrix4x4 Transform() const
+	{
+		return Matrix4x4::Translation(-Left, -Top, 0.0f) *
+			Matrix4x4::Scale(Zoom, Zoom, 1.0f);
+	}
+
+	bool operator==(BoardViewport const & other) const
+	{
+		return Left == other.Left &&
+			Top == other.Top &&
+			ClientWidth == other.ClientWidth &&
+			ClientHeight == other.ClientHeight &&
+			Zoom == other.Zoom;
+	}
+
+	bool operator!=(BoardViewport const & other) const
+	{
+		return !(*this == other);
+	}
+
+private:
+
+	static float ClampAxis(float const start,
+		float const shown,
+		float const board)
+	{
+		if (shown >= board) return (board - shown) / 2.0f;
+
+		return std::min(std::max(start, 0.0f), board - shown);
+	}
+};
+
+// Rows and columns of cards, the last ones excluded
+struct CardRange
+{
+	unsigned FirstRow = 0;
+	unsigned LastRow = 0;
+	unsigned FirstColumn = 0;
+	unsigned LastColumn = 0;
+
+	unsigned Count() const
+	{
+		return (LastRow - FirstRow) * (LastColumn - FirstColumn);
+	}
+
+	bool Contains(unsigned const row,
+		unsigned const column) const
+	{
+		return row >= FirstRow && row < LastRow && column >= FirstColumn && column < LastColumn;
+	}
+
+	bool operator==(CardRange const & other) const
+	{
+		return FirstRow == other.FirstRow &&
+			LastRow == other.LastRow &&
+			FirstColumn == other.FirstColumn &&
+			LastColumn == other.LastColumn;
+	}
+};
+
+// Cards in the slots along one axis from start to end in logical units,
+// counting the gaps before a card with it. Conservative, so a view ending in
+// a gap may take one card more.
+inline void VisibleSlots(float const start,
+	float const end,
+	float const margin,
+	float const pitch,
+	unsigned const count,
+	unsigned const prefetch,
+	unsigned & first,
+	unsigned & last)
+{
+	float const from = std::floor((start - margin) / pitch);
+	float const to = std::floor((end - margin) / pitch) + 1.0f;
+
+	float const lower = std::max(from - prefetch, 0.0f);
+	float const upper = std::min(to + prefetch, static_cast<float>(count));
+
+	first = static_cast<unsigned>(std::min(lower, static_cast<float>(count)));
+	last = std::max(first, static_cast<unsigned>(std::max(upper, 0.0f)));
+}
+
+// The cards the viewport shows with prefetch more rows and columns on
+// every side, so that cards scrolled into view are usually ready
+inline CardRange VisibleCards(PhysicalLayout const & layout,
+	BoardViewport const & viewport,
+	unsigned const prefetch)
+{
+	BoardGeometry const & geometry = layout.Geometry;
+	CardRange range;
+
+	VisibleSlots(PhysicalToLogical(viewport.Left, layout.DpiX),
+		PhysicalToLogical(viewport.Left + viewport.Width(), layout.DpiX),
+		geometry.Margin,
+		geometry.CardWidth + geometry.Margin,
+		geometry.Columns,
+		prefetch,
+		range.FirstColumn,
+		range.LastColumn);
+
+	VisibleSlots(PhysicalToLogical(viewport.Top, layout.DpiY),
+		PhysicalToLogical(viewport.Top + viewport.Height(), layout.DpiY),
+		geometry.Margin,
+		geometry.CardHeight + geometry.Margin,
+		geometry.Rows,
+		prefetch,
+		range.FirstRow,
+		range.LastRow);
+
+	return range;
+}
@@ -0,0 +1,352 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "BoardScene.h"
+#include "Viewport.h"
+
+// The board's visual tree for boards too large to keep whole. Only cards in
+// the viewport, and a prefetch margin around it, have faces and a back tile.
+// A card that scrolls out hands its slot, with the visuals, transforms and
+// tile, to one that scrolls in, so compositor objects and surface memory
+// grow with the largest view rather than with the board. Fronts are shared
+// by value, as in the atlas, and kept for the whole layout.
+
+// A card's faces and back tile, kept while no card uses them
+struct VirtualSlot
+{
+	SceneCard Card;
+	CardTile Back;
+	unsigned Index; // the card shown, or Board::NoCard
+};
+
+struct VirtualFront
+{
+	wchar_t Value;
+	CardTile Tile;
+};
+
+struct VirtualBoardScene : FrameCompositor
+{
+	static unsigned const NoSlot = ~0u;
+
+	Compositor & m_compositor;
+	CardFaceFactory m_faces;
+	std::shared_ptr<CompositorVisual> m_root;
+	std::shared_ptr<CompositorMatrixTransform> m_view;
+	unsigned m_prefetch = 0;
+
+	// Set by SetLayout
+	PhysicalLayout m_layout;
+	std::vector<VirtualFront> m_fronts;
+	std::vector<std::shared_ptr<CompositorSurface>> m_frontPages;
+	unsigned m_frontOf[128]; // letters to m_fronts, as in the atlas
+	std::vector<unsigned> m_cardSlots;
+
+	// Grown by Update, by pages of as many rows of back tiles as needed
+	std::vector<VirtualSlot> m_slots;
+	std::vector<unsigned> m_freeSlots;
+	std::vector<std::shared_ptr<CompositorSurface>> m_slotPages;
+	unsigned m_slotColumns = 0;
+	unsigned m_slotRows = 0;
+
+	BoardViewport m_viewport;
+	CardRange m_range;
+
+	// Prefetch is in rows and columns of cards
+	VirtualBoardScene(Compositor & compositor,
+		unsigned const prefetch,
+		std::shared_ptr<FaceTransformCache> const & transformCache = nullptr) :
+		m_compositor(compositor),
+		m_faces(compositor, transformCache),
+		m_prefetch(prefetch)
+	{
+		m_root = m_faces.CreateVisual();
+		m_view = m_compositor.CreateMatrixTransform();
+		m_root->SetTransform(m_view);
+		m_compositor.SetRoot(m_root);
+	}
+
+	// Drops every slot and makes the fronts for the board at this layout.
+	// The caller draws the fronts; the backs follow as Update returns them.
+	void SetLayout(Board const & board,
+		PhysicalLayout const & layout)
+	{
+		for (VirtualSlot const & slot : m_slots)
+		{
+			if (slot.Index == Board::NoCard) continue;
+
+			m_root->RemoveVisual(slot.Card.Front.Visual);
+			m_root->RemoveVisual(slot.Card.Back.Visual);
+		}
+
+		m_slots.clear();
+		m_freeSlots.clear();
+		m_slotPages.clear();
+		m_range = CardRange();
+
+		m_layout = layout;
+		m_cardSlots.assign(board.CardCount(), static_cast<unsigned>(NoSlot));
+
+		unsigned const width = layout.SurfaceWidth();
+		unsigned const height = layout.SurfaceHeight();
+
+		m_slotColumns = std::max(1u, CardAtlas::PageSize / (width + CardAtlas::Padding));
+		m_slotRows = std::max(1u, CardAtlas::PageSize / (height + CardAtlas::Padding));
+
+		CreateFronts(board, width, height);
+	}
+
+	bool Contains(unsigned const index) const
+	{
+		return m_cardSlots[index] != NoSlot;
+	}
+
+	CardTile const & BackTile(unsigned const index) const
+	{
+		ASSERT(Contains(index));
+		return m_slots[m_cardSlots[index]].Back;
+	}
+
+	unsigned SlotCount() const
+	{
+		return static_cast<unsigned>(m_slots.size());
+	}
+
+	// Cards with faces now
+	unsigned LiveCount() const
+	{
+		return SlotCount() - static_cast<unsigned>(m_freeSlots.size());
+	}
+
+	unsigned long long SurfaceBytes() const
+	{
+		unsigned long long bytes = 0;
+
+		for (std::shared_ptr<CompositorSurface> const & page : m_frontPages)
+		{
+			bytes += 4ull * page->Width() * page->Height();
+		}
+
+		for (std::shared_ptr<CompositorSurface> const & page : m_slotPages)
+		{
+			bytes += 4ull * page->Width() * page->Height();
+		}
+
+		return bytes;
+	}
+
+	// Moves the view and gives faces to the cards it now shows, taking slots
+	// from cards that went out of it. Adds the cards whose backs need drawing.
+	void Update(Board const & board,
+		BoardViewport const & viewport,
+		std::vector<unsigned> & backs)
+	{
+		if (viewport != m_viewport)
+		{
+			m_viewport = viewport;
+			m_view->SetMatrix(viewport.Transform());
+		}
+
+		CardRange const range = VisibleCards(m_layout, viewport, m_prefetch);
+
+		if (range == m_range) return;
+
+		unsigned const columns = m_layout.Geometry.Columns;
+
+		// Freed first, so that the cards coming in can reuse the slots
+		for (unsigned row = m_range.FirstRow; row != m_range.LastRow; ++row)
+			for (unsigned column = m_range.FirstColumn; column != m_range.LastColumn; ++column)
+			{
+				unsigned const index = row * columns + column;
+
+				if (Contains(index) && !range.Contains(row, column))
+				{
+					RemoveCard(index);
+				}
+			}
+
+		size_t const first = backs.size();
+
+		for (unsigned row = range.FirstRow; row != range.LastRow; ++row)
+			for (unsigned column = range.FirstColumn; column != range.LastColumn; ++column)
+			{
+				unsigned const index = row * columns + column;
+
+				if (Contains(index) || board[index].Status == CardStatus::Matched) continue;
+
+				backs.push_back(index);
+			}
+
+		unsigned const added = static_cast<unsigned>(backs.size() - first);
+
+		if (added > m_freeSlots.size())
+		{
+			GrowPool(added - static_cast<unsigned>(m_freeSlots.size()));
+		}
+
+		for (size_t back = first; back != backs.size(); ++back)
+		{
+			AddCard(board, backs[back]);
+		}
+
+		m_range = range;
+	}
+
+	// Returns the card's slot to the pool
+	void RemoveCard(unsigned const index)
+	{
+		if (!Contains(index)) return;
+
+		unsigned const slot = m_cardSlots[index];
+		VirtualSlot & virtualSlot = m_slots[slot];
+
+		m_root->RemoveVisual(virtualSlot.Card.Front.Visual);
+		m_root->RemoveVisual(virtualSlot.Card.Back.Visual);
+
+		virtualSlot.Index = Board::NoCard;
+		m_cardSlots[index] = NoSlot;
+		m_freeSlots.push_back(slot);
+	}
+
+	double NextFrameTime() override
+	{
+		return m_compositor.NextFrameTime();
+	}
+
+	// Cards out of view keep their state on the board and pick it up when
+	// they come back
+	void AnimateAngle(unsigned const card, AnimationCurve const & curve) override
+	{
+		if (!Contains(card)) return;
+
+		m_slots[m_cardSlots[card]].Card.Rotation->SetAngle(curve);
+	}
+
+	void Commit() override
+	{
+		m_compositor.Commit();
+	}
+
+private:
+
+	unsigned FrontIndex(wchar_t const value) const
+	{
+		if (static_cast<unsigned>(value) < 128) return m_frontOf[value];
+
+		for (unsigned index = 0; index != m_fronts.size(); ++index)
+		{
+			if (m_fronts[index].Value == value) return index;
+		}
+
+		return NoSlot;
+	}
+
+	void CreateFronts(Board const & board,
+		unsigned const width,
+		unsigned const height)
+	{
+		m_fronts.clear();
+		m_frontPages.clear();
+		std::fill(std::begin(m_frontOf), std::end(m_frontOf), static_cast<unsigned>(NoSlot));
+
+		std::vector<wchar_t> values;
+
+		for (Card const & card : board)
+		{
+			if (card.Status == CardStatus::Matched) continue;
+
+			if (FrontIndex(card.Value) != NoSlot) continue;
+
+			if (static_cast<unsigned>(card.Value) < 128)
+			{
+				m_frontOf[card.Value] = static_cast<unsigned>(values.size());
+			}
+
+			values.push_back(card.Value);
+			m_fronts.push_back(VirtualFront { card.Value, CardTile(nullptr, AtlasRect()) });
+		}
+
+		Atlas atlas(CardAtlas::PageWidth(static_cast<unsigned>(values.size()), width),
+			std::max(static_cast<unsigned>(CardAtlas::PageSize), height + CardAtlas::Padding),
+			CardAtlas::Padding);
+
+		std::vector<AtlasRect> rects;
+
+		for (unsigned index = 0; index != values.size(); ++index)
+		{
+			rects.push_back(atlas.Insert(width, height));
+		}
+
+		for (unsigned page = 0; page != atlas.PageCount(); ++page)
+		{
+			m_frontPages.push_back(m_compositor.CreateSurface(atlas.m_pageWidth, atlas.PageHeight(page)));
+		}
+
+		for (unsigned index = 0; index != values.size(); ++index)
+		{
+			m_fronts[index].Tile = CardTile(m_frontPages[rects[index].Page], rects[index]);
+		}
+	}
+
+	// At least count new free slots, each with its own back tile. Pages are
+	// at most the size of an atlas page and hold whole rows of tiles, so a
+	// small view does not pay for a full page.
+	void GrowPool(unsigned count)
+	{
+		unsigned const width = m_layout.SurfaceWidth();
+		unsigned const height = m_layout.SurfaceHeight();
+
+		while (count != 0)
+		{
+			unsigned const rows = std::min(m_slotRows, (count + m_slotColumns - 1) / m_slotColumns);
+			unsigned const page = static_cast<unsigned>(m_slotPages.size());
+
+			m_slotPages.push_back(m_compositor.CreateSurface(m_slotColumns * (width + CardAtlas::Padding),
+				rows * (height + CardAtlas::Padding)));
+
+			for (unsigned tile = 0; tile != rows * m_slotColumns; ++tile)
+			{
+				AtlasRect rect;
+				rect.Page = page;
+				rect.Left = tile % m_slotColumns * (width + CardAtlas::Padding);
+				rect.Top = tile / m_slotColumns * (height + CardAtlas::Padding);
+				rect.Width = width;
+				rect.Height = height;
+
+				m_freeSlots.push_back(SlotCount());
+				m_slots.push_back(VirtualSlot { SceneCard(), CardTile(m_slotPages.back(), rect), Board::NoCard });
+
+				m_faces.CreateCard(m_slots.back().Card, false);
+			}
+
+			count -= std::min(count, rows * m_slotColumns);
+		}
+	}
+
+	void AddCard(Board const & board,
+		unsigned const index)
+	{
+		ASSERT(!m_freeSlots.empty());
+
+		unsigned const slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+
+		VirtualSlot & virtualSlot = m_slots[slot];
+		SceneCard & scene = virtualSlot.Card;
+		Card const & card = board[index];
+		CardTile const & front = m_fronts[FrontIndex(card.Value)].Tile;
+
+		virtualSlot.Index = index;
+		m_cardSlots[index] = slot;
+
+		// Any animation the slot had belongs to the card it showed before
+		scene.Rotation->SetAngle(card.Status == CardStatus::Selected ? static_cast<float>(FaceUpAngle) : 0.0f);
+
+		m_faces.SetFaceLayout(scene.Front, scene.Rotation, card, front.Surface, front.Rect, m_layout, true);
+		m_faces.SetFaceLayout(scene.Back, scene.Rotation, card, virtualSlot.Back.Surface, virtualSlot.Back.Rect, m_layout, false);
+
+		m_root->AddVisual(scene.Front.Visual);
+		m_root->AddVisual(scene.Back.Visual);
+	}
+};
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "AnimationBenchmark"
+  "AnimationBenchmark.pdb"
+  "CMakeFiles/AnimationBenchmark.dir/Benchmarks/AnimationBenchmark.cpp.o"
+  "CMakeFiles/AnimationBenchmark.dir/Benchmarks/AnimationBenchmark.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/AnimationBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
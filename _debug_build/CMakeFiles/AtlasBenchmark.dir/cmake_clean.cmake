@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "AtlasBenchmark"
+  "AtlasBenchmark.pdb"
+  "CMakeFiles/AtlasBenchmark.dir/Benchmarks/AtlasBenchmark.cpp.o"
+  "CMakeFiles/AtlasBenchmark.dir/Benchmarks/AtlasBenchmark.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/AtlasBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "BoardBenchmark"
+  "BoardBenchmark.pdb"
+  "CMakeFiles/BoardBenchmark.dir/Benchmarks/BoardBenchmark.cpp.o"
+  "CMakeFiles/BoardBenchmark.dir/Benchmarks/BoardBenchmark.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/BoardBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
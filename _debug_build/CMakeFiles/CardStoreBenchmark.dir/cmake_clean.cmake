@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/CardStoreBenchmark.dir/Benchmarks/CardStoreBenchmark.cpp.o"
+  "CMakeFiles/CardStoreBenchmark.dir/Benchmarks/CardStoreBenchmark.cpp.o.d"
+  "CardStoreBenchmark"
+  "CardStoreBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/CardStoreBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
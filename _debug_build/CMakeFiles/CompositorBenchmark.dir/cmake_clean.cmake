@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/CompositorBenchmark.dir/Benchmarks/CompositorBenchmark.cpp.o"
+  "CMakeFiles/CompositorBenchmark.dir/Benchmarks/CompositorBenchmark.cpp.o.d"
+  "CompositorBenchmark"
+  "CompositorBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/CompositorBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/DealBenchmark.dir/Benchmarks/DealBenchmark.cpp.o"
+  "CMakeFiles/DealBenchmark.dir/Benchmarks/DealBenchmark.cpp.o.d"
+  "DealBenchmark"
+  "DealBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/DealBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
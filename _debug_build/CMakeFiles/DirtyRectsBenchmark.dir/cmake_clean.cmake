@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/DirtyRectsBenchmark.dir/Benchmarks/DirtyRectsBenchmark.cpp.o"
+  "CMakeFiles/DirtyRectsBenchmark.dir/Benchmarks/DirtyRectsBenchmark.cpp.o.d"
+  "DirtyRectsBenchmark"
+  "DirtyRectsBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/DirtyRectsBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
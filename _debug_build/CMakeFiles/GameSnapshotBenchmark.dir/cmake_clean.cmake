@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/GameSnapshotBenchmark.dir/Benchmarks/GameSnapshotBenchmark.cpp.o"
+  "CMakeFiles/GameSnapshotBenchmark.dir/Benchmarks/GameSnapshotBenchmark.cpp.o.d"
+  "GameSnapshotBenchmark"
+  "GameSnapshotBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/GameSnapshotBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
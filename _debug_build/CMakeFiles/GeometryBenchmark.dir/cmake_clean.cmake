@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/GeometryBenchmark.dir/Benchmarks/GeometryBenchmark.cpp.o"
+  "CMakeFiles/GeometryBenchmark.dir/Benchmarks/GeometryBenchmark.cpp.o.d"
+  "GeometryBenchmark"
+  "GeometryBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/GeometryBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
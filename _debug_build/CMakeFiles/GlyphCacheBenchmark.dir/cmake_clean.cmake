@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/GlyphCacheBenchmark.dir/Benchmarks/GlyphCacheBenchmark.cpp.o"
+  "CMakeFiles/GlyphCacheBenchmark.dir/Benchmarks/GlyphCacheBenchmark.cpp.o.d"
+  "GlyphCacheBenchmark"
+  "GlyphCacheBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/GlyphCacheBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/HitTestBenchmark.dir/Benchmarks/HitTestBenchmark.cpp.o"
+  "CMakeFiles/HitTestBenchmark.dir/Benchmarks/HitTestBenchmark.cpp.o.d"
+  "HitTestBenchmark"
+  "HitTestBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/HitTestBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/ImageBenchmark.dir/Benchmarks/ImageBenchmark.cpp.o"
+  "CMakeFiles/ImageBenchmark.dir/Benchmarks/ImageBenchmark.cpp.o.d"
+  "ImageBenchmark"
+  "ImageBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/ImageBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
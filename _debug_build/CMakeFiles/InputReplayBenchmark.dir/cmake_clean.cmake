@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/InputReplayBenchmark.dir/Benchmarks/InputReplayBenchmark.cpp.o"
+  "CMakeFiles/InputReplayBenchmark.dir/Benchmarks/InputReplayBenchmark.cpp.o.d"
+  "InputReplayBenchmark"
+  "InputReplayBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/InputReplayBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
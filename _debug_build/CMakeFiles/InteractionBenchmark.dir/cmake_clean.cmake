@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/InteractionBenchmark.dir/Benchmarks/InteractionBenchmark.cpp.o"
+  "CMakeFiles/InteractionBenchmark.dir/Benchmarks/InteractionBenchmark.cpp.o.d"
+  "InteractionBenchmark"
+  "InteractionBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/InteractionBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
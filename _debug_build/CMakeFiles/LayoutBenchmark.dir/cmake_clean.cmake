@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/LayoutBenchmark.dir/Benchmarks/LayoutBenchmark.cpp.o"
+  "CMakeFiles/LayoutBenchmark.dir/Benchmarks/LayoutBenchmark.cpp.o.d"
+  "LayoutBenchmark"
+  "LayoutBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/LayoutBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
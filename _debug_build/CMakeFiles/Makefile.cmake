@@ -0,0 +1,82 @@
+# CMAKE generated file: DO NOT EDIT!
+# Generated by "Unix Makefiles" Generator, CMake Version 3.25
+
+# The generator used is:
+set(CMAKE_DEPENDS_GENERATOR "Unix Makefiles")
+
+# The top level Makefile was generated from the following files:
+set(CMAKE_MAKEFILE_DEPENDS
+  "CMakeCache.txt"
+  "/root/repo/CMakeLists.txt"
+  "CMakeFiles/3.25.1/CMakeCXXCompiler.cmake"
+  "CMakeFiles/3.25.1/CMakeSystem.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeCXXInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeCheckCompilerFlagCommonPatterns.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeCommonLanguageInclude.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeGenericSystem.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeInitializeConfigs.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeLanguageInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeSystemSpecificInformation.cmake"
+  "/usr/share/cmake-3.25/Modules/CMakeSystemSpecificInitialize.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckCXXCompilerFlag.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckCXXSourceCompiles.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckIncludeFileCXX.cmake"
+  "/usr/share/cmake-3.25/Modules/CheckLibraryExists.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/CMakeCommonCompilerMacros.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/GNU-CXX.cmake"
+  "/usr/share/cmake-3.25/Modules/Compiler/GNU.cmake"
+  "/usr/share/cmake-3.25/Modules/FindJPEG.cmake"
+  "/usr/share/cmake-3.25/Modules/FindPNG.cmake"
+  "/usr/share/cmake-3.25/Modules/FindPackageHandleStandardArgs.cmake"
+  "/usr/share/cmake-3.25/Modules/FindPackageMessage.cmake"
+  "/usr/share/cmake-3.25/Modules/FindThreads.cmake"
+  "/usr/share/cmake-3.25/Modules/FindZLIB.cmake"
+  "/usr/share/cmake-3.25/Modules/Internal/CheckCompilerFlag.cmake"
+  "/usr/share/cmake-3.25/Modules/Internal/CheckFlagCommonConfig.cmake"
+  "/usr/share/cmake-3.25/Modules/Internal/CheckSourceCompiles.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux-GNU-CXX.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux-GNU.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/Linux.cmake"
+  "/usr/share/cmake-3.25/Modules/Platform/UnixPaths.cmake"
+  "/usr/share/cmake-3.25/Modules/SelectLibraryConfigurations.cmake"
+  )
+
+# The corresponding makefile is:
+set(CMAKE_MAKEFILE_OUTPUTS
+  "Makefile"
+  "CMakeFiles/cmake.check_cache"
+  )
+
+# Byproducts of CMake generate step:
+set(CMAKE_MAKEFILE_PRODUCTS
+  "CMakeFiles/CMakeDirectoryInformation.cmake"
+  )
+
+# Dependency information for all targets:
+set(CMAKE_DEPEND_INFO_FILES
+  "CMakeFiles/AnimationBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/AtlasBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/BoardBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/CardStoreBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/CompositorBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/DealBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/DirtyRectsBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/GameSnapshotBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/GeometryBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/GlyphCacheBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/HitTestBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/InputReplayBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/InteractionBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/LayoutBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/MatrixBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/MultiBoardBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/ParallelRasterBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/RecoveryBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/RasterBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/RenderThreadBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/TraceBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/ViewportBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/ImageBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/TileCacheBenchmark.dir/DependInfo.cmake"
+  "CMakeFiles/RasterBenchmarkAvx2.dir/DependInfo.cmake"
+  )
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/MatrixBenchmark.dir/Benchmarks/MatrixBenchmark.cpp.o"
+  "CMakeFiles/MatrixBenchmark.dir/Benchmarks/MatrixBenchmark.cpp.o.d"
+  "MatrixBenchmark"
+  "MatrixBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/MatrixBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/MultiBoardBenchmark.dir/Benchmarks/MultiBoardBenchmark.cpp.o"
+  "CMakeFiles/MultiBoardBenchmark.dir/Benchmarks/MultiBoardBenchmark.cpp.o.d"
+  "MultiBoardBenchmark"
+  "MultiBoardBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/MultiBoardBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/ParallelRasterBenchmark.dir/Benchmarks/ParallelRasterBenchmark.cpp.o"
+  "CMakeFiles/ParallelRasterBenchmark.dir/Benchmarks/ParallelRasterBenchmark.cpp.o.d"
+  "ParallelRasterBenchmark"
+  "ParallelRasterBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/ParallelRasterBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
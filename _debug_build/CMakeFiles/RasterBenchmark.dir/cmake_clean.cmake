@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/RasterBenchmark.dir/Benchmarks/RasterBenchmark.cpp.o"
+  "CMakeFiles/RasterBenchmark.dir/Benchmarks/RasterBenchmark.cpp.o.d"
+  "RasterBenchmark"
+  "RasterBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/RasterBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/RasterBenchmarkAvx2.dir/Benchmarks/RasterBenchmark.cpp.o"
+  "CMakeFiles/RasterBenchmarkAvx2.dir/Benchmarks/RasterBenchmark.cpp.o.d"
+  "RasterBenchmarkAvx2"
+  "RasterBenchmarkAvx2.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/RasterBenchmarkAvx2.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
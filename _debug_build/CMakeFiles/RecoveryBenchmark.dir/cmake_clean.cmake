@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/RecoveryBenchmark.dir/Benchmarks/RecoveryBenchmark.cpp.o"
+  "CMakeFiles/RecoveryBenchmark.dir/Benchmarks/RecoveryBenchmark.cpp.o.d"
+  "RecoveryBenchmark"
+  "RecoveryBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/RecoveryBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/RenderThreadBenchmark.dir/Benchmarks/RenderThreadBenchmark.cpp.o"
+  "CMakeFiles/RenderThreadBenchmark.dir/Benchmarks/RenderThreadBenchmark.cpp.o.d"
+  "RenderThreadBenchmark"
+  "RenderThreadBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/RenderThreadBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
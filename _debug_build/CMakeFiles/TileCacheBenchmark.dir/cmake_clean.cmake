@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/TileCacheBenchmark.dir/Benchmarks/TileCacheBenchmark.cpp.o"
+  "CMakeFiles/TileCacheBenchmark.dir/Benchmarks/TileCacheBenchmark.cpp.o.d"
+  "TileCacheBenchmark"
+  "TileCacheBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/TileCacheBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/TraceBenchmark.dir/Benchmarks/TraceBenchmark.cpp.o"
+  "CMakeFiles/TraceBenchmark.dir/Benchmarks/TraceBenchmark.cpp.o.d"
+  "TraceBenchmark"
+  "TraceBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/TraceBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
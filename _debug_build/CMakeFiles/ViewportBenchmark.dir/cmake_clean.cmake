@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/ViewportBenchmark.dir/Benchmarks/ViewportBenchmark.cpp.o"
+  "CMakeFiles/ViewportBenchmark.dir/Benchmarks/ViewportBenchmark.cpp.o.d"
+  "ViewportBenchmark"
+  "ViewportBenchmark.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/ViewportBenchmark.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()